@@ -36,7 +36,27 @@ Buffer::Buffer(size_t limit) :
 }
 
 Buffer::Buffer(std::vector<uint8_t> data) :
-	data(data), write_head(data.size()) {
+	data(std::move(data)) {
+	write_head = this->data.size();
+}
+
+Buffer::Buffer(Buffer &&other) :
+	data(std::move(other.data)),
+	read_head(other.read_head),
+	write_head(other.write_head),
+	limit(other.limit) {
+	other.read_head = 0;
+	other.write_head = 0;
+}
+
+Buffer &Buffer::operator=(Buffer &&other) {
+	data = std::move(other.data);
+	read_head = other.read_head;
+	write_head = other.write_head;
+	limit = other.limit;
+	other.read_head = 0;
+	other.write_head = 0;
+	return *this;
 }
 
 Buffer::~Buffer() {
@@ -140,7 +160,10 @@ void Buffer::TryEnsureSpace(size_t size) {
 }
 
 void Buffer::Compact() {
-	std::copy(data.begin() + read_head, data.end(), data.begin());
+	if(read_head == 0) {
+		return;
+	}
+	std::copy(data.begin() + read_head, data.begin() + write_head, data.begin());
 	write_head-= read_head;
 	read_head = 0;
 }
@@ -149,6 +172,34 @@ std::vector<uint8_t> Buffer::GetData() {
 	return std::vector<uint8_t>(data.begin() + read_head, data.begin() + write_head);
 }
 
+std::vector<uint8_t> Buffer::TakeData() {
+	if(read_head > 0) {
+		Compact();
+	}
+	std::vector<uint8_t> out;
+	out.swap(data);
+	out.resize(write_head);
+	write_head = 0;
+	return out;
+}
+
+std::vector<uint8_t> Buffer::TakeData(size_t size) {
+	if(read_head > 0) {
+		std::vector<uint8_t> out(Read(), Read() + size);
+		MarkRead(size);
+		return out;
+	}
+	size_t rest = write_head - size;
+	std::vector<uint8_t> remaining(std::max(rest, (size_t) 2048));
+	std::copy_n(data.begin() + size, rest, remaining.begin());
+	std::vector<uint8_t> out;
+	out.swap(data);
+	out.resize(size);
+	data.swap(remaining);
+	write_head = rest;
+	return out;
+}
+
 std::string Buffer::GetString() {
 	return std::string(data.begin() + read_head, data.begin() + write_head);
 }
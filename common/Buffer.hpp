@@ -38,6 +38,12 @@ class Buffer {
 	Buffer(std::vector<uint8_t> data);
 	~Buffer();
 
+	Buffer(const Buffer &other) = default;
+	Buffer &operator=(const Buffer &other) = default;
+	// moves the storage instead of copying it, leaving other empty
+	Buffer(Buffer &&other);
+	Buffer &operator=(Buffer &&other);
+
 	// Tries to reserve at least `size` bytes, returns a tuple
 	// of the write head pointer and a size of how many bytes
 	// can be written. call MarkWritten to mark how many
@@ -55,7 +61,7 @@ class Buffer {
 	bool Write(const char *data);
 	
 	template<typename T>
-	bool Write(std::vector<T> data) {
+	bool Write(const std::vector<T> &data) {
 		static_assert(std::is_standard_layout<T>::value, "T must be standard layout");
 		return Write((uint8_t*) data.data(), sizeof(T) * data.size());
 	}
@@ -105,6 +111,14 @@ class Buffer {
 	size_t WriteAvailableHint();
 
 	std::vector<uint8_t> GetData();
+	// Hands the unread data over to the caller without copying it,
+	// leaving the buffer empty.
+	std::vector<uint8_t> TakeData();
+	// Hands the next `size` unread bytes (which must be available) over to
+	// the caller. If they sit at the start of the storage, the storage itself
+	// is handed over and only the data after them is copied into new
+	// storage. Otherwise, they're copied.
+	std::vector<uint8_t> TakeData(size_t size);
 
 	void Compact(); // guarantees that data pending read won't be moved around
 
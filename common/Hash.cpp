@@ -0,0 +1,395 @@
+//
+// Twili - Homebrew debug monitor for the Nintendo Switch
+// Copyright (C) 2019 misson20000 <xenotoad@xenotoad.net>
+//
+// This file is part of Twili.
+//
+// Twili is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Twili is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Twili.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "Hash.hpp"
+
+#include<algorithm>
+
+#include<string.h>
+
+namespace twili {
+namespace util {
+
+size_t GetDigestSize(HashAlgorithm algorithm) {
+	return algorithm == HashAlgorithm::Sha256 ? 32 : 8;
+}
+
+// XXH3, following the reference implementation at
+// https://github.com/Cyan4973/xxHash
+
+static const uint32_t PRIME32_1 = 0x9e3779b1;
+static const uint32_t PRIME32_2 = 0x85ebca77;
+static const uint32_t PRIME32_3 = 0xc2b2ae3d;
+static const uint64_t PRIME64_1 = 0x9e3779b185ebca87ull;
+static const uint64_t PRIME64_2 = 0xc2b2ae3d27d4eb4full;
+static const uint64_t PRIME64_3 = 0x165667b19e3779f9ull;
+static const uint64_t PRIME64_4 = 0x85ebca77c2b2ae63ull;
+static const uint64_t PRIME64_5 = 0x27d4eb2f165667c5ull;
+static const uint64_t PRIME_MX1 = 0x165667919e3779f9ull;
+static const uint64_t PRIME_MX2 = 0x9fb21c651e98df25ull;
+
+static const uint8_t XXH3_SECRET[192] = {
+	0xb8, 0xfe, 0x6c, 0x39, 0x23, 0xa4, 0x4b, 0xbe, 0x7c, 0x01, 0x81, 0x2c, 0xf7, 0x21, 0xad, 0x1c,
+	0xde, 0xd4, 0x6d, 0xe9, 0x83, 0x90, 0x97, 0xdb, 0x72, 0x40, 0xa4, 0xa4, 0xb7, 0xb3, 0x67, 0x1f,
+	0xcb, 0x79, 0xe6, 0x4e, 0xcc, 0xc0, 0xe5, 0x78, 0x82, 0x5a, 0xd0, 0x7d, 0xcc, 0xff, 0x72, 0x21,
+	0xb8, 0x08, 0x46, 0x74, 0xf7, 0x43, 0x24, 0x8e, 0xe0, 0x35, 0x90, 0xe6, 0x81, 0x3a, 0x26, 0x4c,
+	0x3c, 0x28, 0x52, 0xbb, 0x91, 0xc3, 0x00, 0xcb, 0x88, 0xd0, 0x65, 0x8b, 0x1b, 0x53, 0x2e, 0xa3,
+	0x71, 0x64, 0x48, 0x97, 0xa2, 0x0d, 0xf9, 0x4e, 0x38, 0x19, 0xef, 0x46, 0xa9, 0xde, 0xac, 0xd8,
+	0xa8, 0xfa, 0x76, 0x3f, 0xe3, 0x9c, 0x34, 0x3f, 0xf9, 0xdc, 0xbb, 0xc7, 0xc7, 0x0b, 0x4f, 0x1d,
+	0x8a, 0x51, 0xe0, 0x4b, 0xcd, 0xb4, 0x59, 0x31, 0xc8, 0x9f, 0x7e, 0xc9, 0xd9, 0x78, 0x73, 0x64,
+	0xea, 0xc5, 0xac, 0x83, 0x34, 0xd3, 0xeb, 0xc3, 0xc5, 0x81, 0xa0, 0xff, 0xfa, 0x13, 0x63, 0xeb,
+	0x17, 0x0d, 0xdd, 0x51, 0xb7, 0xf0, 0xda, 0x49, 0xd3, 0x16, 0x55, 0x26, 0x29, 0xd4, 0x68, 0x9e,
+	0x2b, 0x16, 0xbe, 0x58, 0x7d, 0x47, 0xa1, 0xfc, 0x8f, 0xf8, 0xb8, 0xd1, 0x7a, 0xd0, 0x31, 0xce,
+	0x45, 0xcb, 0x3a, 0x8f, 0x95, 0x16, 0x04, 0x28, 0xaf, 0xd7, 0xfb, 0xca, 0xbb, 0x4b, 0x40, 0x7e,
+};
+// stripes use the secret 8 bytes further along each, so a block runs out
+// of secret after this many
+static const size_t XXH3_STRIPES_PER_BLOCK = (sizeof(XXH3_SECRET) - 64) / 8;
+static const size_t XXH3_SHORT_MAX = 240;
+
+// XXH3 reads its input little-endian, like everything twili and twib run on
+static inline uint64_t Read64(const uint8_t *p) {
+	uint64_t v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static inline uint32_t Read32(const uint8_t *p) {
+	uint32_t v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static inline uint64_t Rotate(uint64_t x, int r) {
+	return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t Swap64(uint64_t x) {
+	x = ((x & 0x00ff00ff00ff00ffull) << 8) | ((x >> 8) & 0x00ff00ff00ff00ffull);
+	x = ((x & 0x0000ffff0000ffffull) << 16) | ((x >> 16) & 0x0000ffff0000ffffull);
+	return (x << 32) | (x >> 32);
+}
+
+// xors the halves of the 128-bit product
+static inline uint64_t MulFold(uint64_t a, uint64_t b) {
+#if defined(__SIZEOF_INT128__)
+	unsigned __int128 product = (unsigned __int128) a * b;
+	return (uint64_t) product ^ (uint64_t) (product >> 64);
+#else
+	uint64_t lo_lo = (a & 0xffffffff) * (b & 0xffffffff);
+	uint64_t hi_lo = (a >> 32) * (b & 0xffffffff);
+	uint64_t lo_hi = (a & 0xffffffff) * (b >> 32);
+	uint64_t hi_hi = (a >> 32) * (b >> 32);
+	uint64_t cross = (lo_lo >> 32) + (hi_lo & 0xffffffff) + lo_hi;
+	uint64_t upper = (hi_lo >> 32) + (cross >> 32) + hi_hi;
+	uint64_t lower = (cross << 32) | (lo_lo & 0xffffffff);
+	return lower ^ upper;
+#endif
+}
+
+static inline uint64_t Xxh64Avalanche(uint64_t h) {
+	h^= h >> 33;
+	h*= PRIME64_2;
+	h^= h >> 29;
+	h*= PRIME64_3;
+	h^= h >> 32;
+	return h;
+}
+
+static inline uint64_t Avalanche(uint64_t h) {
+	h^= h >> 37;
+	h*= PRIME_MX1;
+	h^= h >> 32;
+	return h;
+}
+
+static inline uint64_t Mix16(const uint8_t *data, const uint8_t *secret) {
+	return MulFold(Read64(data) ^ Read64(secret), Read64(data + 8) ^ Read64(secret + 8));
+}
+
+static uint64_t HashShort(const uint8_t *data, size_t size) {
+	const uint8_t *secret = XXH3_SECRET;
+	if(size == 0) {
+		return Xxh64Avalanche(Read64(secret + 56) ^ Read64(secret + 64));
+	} else if(size <= 3) {
+		uint32_t combined = (data[0] << 16) | (data[size >> 1] << 24) | data[size - 1] | (size << 8);
+		return Xxh64Avalanche(combined ^ (uint64_t) (Read32(secret) ^ Read32(secret + 4)));
+	} else if(size <= 8) {
+		uint64_t input = Read32(data + size - 4) + ((uint64_t) Read32(data) << 32);
+		uint64_t h = input ^ (Read64(secret + 8) ^ Read64(secret + 16));
+		h^= Rotate(h, 49) ^ Rotate(h, 24);
+		h*= PRIME_MX2;
+		h^= (h >> 35) + size;
+		h*= PRIME_MX2;
+		return h ^ (h >> 28);
+	} else if(size <= 16) {
+		uint64_t lo = Read64(data) ^ (Read64(secret + 24) ^ Read64(secret + 32));
+		uint64_t hi = Read64(data + size - 8) ^ (Read64(secret + 40) ^ Read64(secret + 48));
+		return Avalanche(size + Swap64(lo) + hi + MulFold(lo, hi));
+	} else if(size <= 128) {
+		uint64_t acc = size * PRIME64_1;
+		// pairs from the front and back, working inwards
+		for(size_t i = 0; i < 4 && size > i * 32; i++) {
+			acc+= Mix16(data + i * 16, secret + i * 32);
+			acc+= Mix16(data + size - (i + 1) * 16, secret + i * 32 + 16);
+		}
+		return Avalanche(acc);
+	} else {
+		uint64_t acc = size * PRIME64_1;
+		for(size_t i = 0; i < 8; i++) {
+			acc+= Mix16(data + i * 16, secret + i * 16);
+		}
+		acc = Avalanche(acc);
+		for(size_t i = 8; i < size / 16; i++) {
+			acc+= Mix16(data + i * 16, secret + (i - 8) * 16 + 3);
+		}
+		acc+= Mix16(data + size - 16, secret + 136 - 17);
+		return Avalanche(acc);
+	}
+}
+
+static inline void Accumulate(uint64_t acc[8], const uint8_t *stripe, const uint8_t *secret) {
+	for(int i = 0; i < 8; i++) {
+		uint64_t value = Read64(stripe + i * 8);
+		uint64_t key = value ^ Read64(secret + i * 8);
+		acc[i ^ 1]+= value;
+		acc[i]+= (key & 0xffffffff) * (key >> 32);
+	}
+}
+
+static inline void Scramble(uint64_t acc[8], const uint8_t *secret) {
+	for(int i = 0; i < 8; i++) {
+		uint64_t a = acc[i];
+		a^= a >> 47;
+		a^= Read64(secret + i * 8);
+		acc[i] = a * PRIME32_1;
+	}
+}
+
+FastHash::FastHash() :
+	acc {PRIME32_3, PRIME64_1, PRIME64_2, PRIME64_3, PRIME64_4, PRIME32_2, PRIME64_5, PRIME32_1} {
+}
+
+void FastHash::ConsumeStripes(const uint8_t *data, size_t count) {
+	for(size_t i = 0; i < count; i++) {
+		Accumulate(acc, data + i * StripeSize, XXH3_SECRET + stripes_in_block * 8);
+		if(++stripes_in_block == XXH3_STRIPES_PER_BLOCK) {
+			Scramble(acc, XXH3_SECRET + sizeof(XXH3_SECRET) - StripeSize);
+			stripes_in_block = 0;
+		}
+	}
+}
+
+void FastHash::Update(const uint8_t *data, size_t size) {
+	total_size+= size;
+	// the buffer is only consumed once more input shows up, so the last
+	// stripe is always left for Finish
+	if(buffer_size + size <= BufferSize) {
+		memcpy(buffer + buffer_size, data, size);
+		buffer_size+= size;
+		return;
+	}
+	if(buffer_size > 0) {
+		size_t fill = BufferSize - buffer_size;
+		memcpy(buffer + buffer_size, data, fill);
+		data+= fill;
+		size-= fill;
+		ConsumeStripes(buffer, BufferSize / StripeSize);
+		memcpy(previous, buffer + BufferSize - StripeSize, StripeSize);
+		buffer_size = 0;
+	}
+	if(size > BufferSize) {
+		size_t consumed = ((size - 1) / BufferSize) * BufferSize;
+		ConsumeStripes(data, consumed / StripeSize);
+		memcpy(previous, data + consumed - StripeSize, StripeSize);
+		data+= consumed;
+		size-= consumed;
+	}
+	memcpy(buffer, data, size);
+	buffer_size = size;
+}
+
+uint64_t FastHash::Finish() {
+	uint64_t h;
+	if(total_size <= XXH3_SHORT_MAX) {
+		h = HashShort(buffer, buffer_size);
+	} else {
+		const uint8_t *last_stripe;
+		uint8_t joined[StripeSize];
+		if(buffer_size >= StripeSize) {
+			ConsumeStripes(buffer, (buffer_size - 1) / StripeSize);
+			last_stripe = buffer + buffer_size - StripeSize;
+		} else {
+			memcpy(joined, previous + buffer_size, StripeSize - buffer_size);
+			memcpy(joined + StripeSize - buffer_size, buffer, buffer_size);
+			last_stripe = joined;
+		}
+		Accumulate(acc, last_stripe, XXH3_SECRET + sizeof(XXH3_SECRET) - StripeSize - 7);
+
+		h = total_size * PRIME64_1;
+		for(int i = 0; i < 4; i++) {
+			h+= MulFold(acc[i * 2] ^ Read64(XXH3_SECRET + 11 + i * 16), acc[i * 2 + 1] ^ Read64(XXH3_SECRET + 11 + i * 16 + 8));
+		}
+		h = Avalanche(h);
+	}
+	
+	*this = FastHash();
+	return h;
+}
+
+static const uint32_t SHA256_K[64] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+static inline uint32_t RotateRight(uint32_t x, int r) {
+	return (x >> r) | (x << (32 - r));
+}
+
+Sha256::Sha256() :
+	state {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19} {
+}
+
+void Sha256::Compress(const uint8_t *chunk) {
+	uint32_t w[64];
+	for(int i = 0; i < 16; i++) {
+		w[i] = (chunk[i * 4] << 24) | (chunk[i * 4 + 1] << 16) | (chunk[i * 4 + 2] << 8) | chunk[i * 4 + 3];
+	}
+	for(int i = 16; i < 64; i++) {
+		uint32_t s0 = RotateRight(w[i - 15], 7) ^ RotateRight(w[i - 15], 18) ^ (w[i - 15] >> 3);
+		uint32_t s1 = RotateRight(w[i - 2], 17) ^ RotateRight(w[i - 2], 19) ^ (w[i - 2] >> 10);
+		w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+	}
+	
+	uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+	uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+	for(int i = 0; i < 64; i++) {
+		uint32_t s1 = RotateRight(e, 6) ^ RotateRight(e, 11) ^ RotateRight(e, 25);
+		uint32_t ch = (e & f) ^ (~e & g);
+		uint32_t t1 = h + s1 + ch + SHA256_K[i] + w[i];
+		uint32_t s0 = RotateRight(a, 2) ^ RotateRight(a, 13) ^ RotateRight(a, 22);
+		uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+		uint32_t t2 = s0 + maj;
+		h = g;
+		g = f;
+		f = e;
+		e = d + t1;
+		d = c;
+		c = b;
+		b = a;
+		a = t1 + t2;
+	}
+	state[0]+= a; state[1]+= b; state[2]+= c; state[3]+= d;
+	state[4]+= e; state[5]+= f; state[6]+= g; state[7]+= h;
+}
+
+void Sha256::Update(const uint8_t *data, size_t size) {
+	total_size+= size;
+	if(chunk_size > 0) {
+		size_t fill = std::min(size, sizeof(chunk) - chunk_size);
+		memcpy(chunk + chunk_size, data, fill);
+		chunk_size+= fill;
+		data+= fill;
+		size-= fill;
+		if(chunk_size < sizeof(chunk)) {
+			return;
+		}
+		Compress(chunk);
+		chunk_size = 0;
+	}
+	for(; size >= 64; data+= 64, size-= 64) {
+		Compress(data);
+	}
+	memcpy(chunk, data, size);
+	chunk_size = size;
+}
+
+void Sha256::Finish(uint8_t digest[32]) {
+	uint64_t bit_size = total_size * 8;
+	uint8_t padding[72] = {0x80};
+	size_t padding_size = (chunk_size < 56 ? 56 : 120) - chunk_size;
+	for(int i = 0; i < 8; i++) {
+		padding[padding_size + i] = bit_size >> (56 - i * 8);
+	}
+	Update(padding, padding_size + 8);
+	
+	for(int i = 0; i < 8; i++) {
+		digest[i * 4 + 0] = state[i] >> 24;
+		digest[i * 4 + 1] = state[i] >> 16;
+		digest[i * 4 + 2] = state[i] >> 8;
+		digest[i * 4 + 3] = state[i];
+	}
+	*this = Sha256();
+}
+
+BlockHasher::BlockHasher(HashAlgorithm algorithm, uint64_t block_size) :
+	algorithm(algorithm),
+	block_size(block_size) {
+}
+
+void BlockHasher::Update(const uint8_t *data, size_t size) {
+	while(size > 0) {
+		size_t part = size;
+		if(block_size != 0 && part > block_size - block_offset) {
+			part = block_size - block_offset;
+		}
+		if(algorithm == HashAlgorithm::Sha256) {
+			sha256.Update(data, part);
+		} else {
+			fast.Update(data, part);
+		}
+		block_offset+= part;
+		data+= part;
+		size-= part;
+		if(block_offset == block_size) {
+			FinishBlock();
+		}
+	}
+}
+
+std::vector<uint8_t> BlockHasher::Finish() {
+	if(block_size == 0 || block_offset > 0) {
+		FinishBlock();
+	}
+	std::vector<uint8_t> result;
+	std::swap(result, digests);
+	return result;
+}
+
+void BlockHasher::FinishBlock() {
+	size_t offset = digests.size();
+	digests.resize(offset + GetDigestSize(algorithm));
+	if(algorithm == HashAlgorithm::Sha256) {
+		sha256.Finish(digests.data() + offset);
+	} else {
+		uint64_t h = fast.Finish();
+		memcpy(digests.data() + offset, &h, sizeof(h));
+	}
+	block_offset = 0;
+}
+
+} // namespace util
+} // namespace twili
@@ -0,0 +1,100 @@
+//
+// Twili - Homebrew debug monitor for the Nintendo Switch
+// Copyright (C) 2019 misson20000 <xenotoad@xenotoad.net>
+//
+// This file is part of Twili.
+//
+// Twili is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Twili is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Twili.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#pragma once
+
+#include<vector>
+
+#include<stdint.h>
+#include<stddef.h>
+
+namespace twili {
+namespace util {
+
+// Streaming hashes shared between twili (for ITwibFileAccessor's HASH) and
+// twib, so that a file hashed on either side gives the same digest.
+
+enum class HashAlgorithm : uint32_t {
+	Fast = 0, // XXH3_64bits with seed 0; the same function as HashPage
+	Sha256 = 1,
+};
+
+size_t GetDigestSize(HashAlgorithm algorithm);
+
+// Streaming XXH3_64bits with the default secret and seed 0, giving the same
+// digests as xxHash's XXH3_64bits() over the concatenated input.
+class FastHash {
+ public:
+	FastHash();
+	void Update(const uint8_t *data, size_t size);
+	uint64_t Finish();
+ private:
+	static const size_t StripeSize = 64;
+	static const size_t BufferSize = 256;
+	
+	void ConsumeStripes(const uint8_t *data, size_t count);
+	
+	uint64_t acc[8];
+	// inputs up to 240 bytes are hashed differently, all at once, so they
+	// stay here until Finish
+	uint8_t buffer[BufferSize];
+	size_t buffer_size = 0;
+	// the stripe before buffer, in case the last stripe has to reach back
+	// into it
+	uint8_t previous[StripeSize];
+	size_t stripes_in_block = 0;
+	uint64_t total_size = 0;
+};
+
+class Sha256 {
+ public:
+	Sha256();
+	void Update(const uint8_t *data, size_t size);
+	void Finish(uint8_t digest[32]);
+ private:
+	void Compress(const uint8_t *chunk);
+	
+	uint32_t state[8];
+	uint8_t chunk[64];
+	size_t chunk_size = 0;
+	uint64_t total_size = 0;
+};
+
+// Hashes a stream in blocks of block_size bytes, or as a whole if block_size
+// is 0, and returns the digests back to back. A block-wise hash of an empty
+// stream has no digests.
+class BlockHasher {
+ public:
+	BlockHasher(HashAlgorithm algorithm, uint64_t block_size);
+	void Update(const uint8_t *data, size_t size);
+	std::vector<uint8_t> Finish();
+ private:
+	void FinishBlock();
+	
+	HashAlgorithm algorithm;
+	uint64_t block_size;
+	uint64_t block_offset = 0;
+	FastHash fast;
+	Sha256 sha256;
+	std::vector<uint8_t> digests;
+};
+
+} // namespace util
+} // namespace twili
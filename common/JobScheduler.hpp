@@ -0,0 +1,86 @@
+//
+// Twili - Homebrew debug monitor for the Nintendo Switch
+// Copyright (C) 2019 misson20000 <xenotoad@xenotoad.net>
+//
+// This file is part of Twili.
+//
+// Twili is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Twili is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Twili.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#pragma once
+
+#include<deque>
+#include<map>
+#include<optional>
+#include<utility>
+
+#include<stdint.h>
+#include<stddef.h>
+
+namespace twili {
+namespace util {
+
+// Decides which job twili's worker pool runs next. Jobs are queued per owner
+// (the client that sent the request) and owners take turns, so one client
+// queueing a lot of slow work can't hold up everyone else's. This does no
+// locking and doesn't depend on libtransistor, so that it can be built and
+// tested on a host; WorkerPool holds a mutex around it.
+template<typename Job>
+class JobScheduler {
+ public:
+	JobScheduler(size_t capacity) : capacity(capacity) {
+	}
+
+	// Returns false, leaving job alone, if capacity jobs are already queued.
+	bool Submit(uint64_t owner, Job &&job) {
+		if(queued_count >= capacity) {
+			return false;
+		}
+		queues[owner].push_back(std::move(job));
+		queued_count++;
+		return true;
+	}
+
+	// Takes the oldest job of the next owner after the last one served.
+	std::optional<Job> Next() {
+		if(queues.empty()) {
+			return std::nullopt;
+		}
+		auto i = last_owner ? queues.upper_bound(*last_owner) : queues.begin();
+		if(i == queues.end()) {
+			i = queues.begin();
+		}
+		std::optional<Job> job(std::move(i->second.front()));
+		i->second.pop_front();
+		last_owner = i->first;
+		if(i->second.empty()) {
+			queues.erase(i);
+		}
+		queued_count--;
+		return job;
+	}
+
+	size_t GetQueuedCount() const {
+		return queued_count;
+	}
+	
+ private:
+	const size_t capacity;
+	std::map<uint64_t, std::deque<Job>> queues;
+	std::optional<uint64_t> last_owner;
+	size_t queued_count = 0;
+};
+
+} // namespace util
+} // namespace twili
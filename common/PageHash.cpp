@@ -0,0 +1,56 @@
+//
+// Twili - Homebrew debug monitor for the Nintendo Switch
+// Copyright (C) 2019 misson20000 <xenotoad@xenotoad.net>
+//
+// This file is part of Twili.
+//
+// Twili is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Twili is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Twili.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include "PageHash.hpp"
+#include "Hash.hpp"
+
+#include<algorithm>
+
+#include<string.h>
+
+namespace twili {
+namespace util {
+
+uint64_t HashPage(const uint8_t *data, size_t size) {
+	FastHash hash;
+	hash.Update(data, size);
+	uint64_t h = hash.Finish();
+	return h == PAGE_HASH_UNREADABLE ? 1 : h;
+}
+
+std::vector<PageRange> DiffPageHashes(const std::vector<uint64_t> &previous, const std::vector<uint64_t> &current) {
+	std::vector<PageRange> ranges;
+	size_t count = std::max(previous.size(), current.size());
+	for(size_t i = 0; i < count; i++) {
+		if(i < previous.size() && i < current.size() && previous[i] == current[i]) {
+			continue;
+		}
+		if(!ranges.empty() && ranges.back().first_page + ranges.back().page_count == i) {
+			ranges.back().page_count++;
+		} else {
+			ranges.push_back({i, 1});
+		}
+	}
+	return ranges;
+}
+
+} // namespace util
+} // namespace twili
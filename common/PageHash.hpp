@@ -0,0 +1,51 @@
+//
+// Twili - Homebrew debug monitor for the Nintendo Switch
+// Copyright (C) 2019 misson20000 <xenotoad@xenotoad.net>
+//
+// This file is part of Twili.
+//
+// Twili is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Twili is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Twili.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#pragma once
+
+#include<vector>
+
+#include<stdint.h>
+#include<stddef.h>
+
+namespace twili {
+namespace util {
+
+// Per-page memory hashing, used by ITwibDebugger's HASH_PAGES on the console
+// and by twib to decide which pages changed between two snapshots.
+
+const size_t PAGE_HASH_PAGE_SIZE = 0x1000;
+// HashPage never returns this, so it can mark pages that couldn't be read
+const uint64_t PAGE_HASH_UNREADABLE = 0;
+
+uint64_t HashPage(const uint8_t *data, size_t size);
+
+struct PageRange {
+	size_t first_page;
+	size_t page_count;
+};
+
+// Returns ranges of consecutive pages whose hashes differ between the two
+// lists. Pages past the end of the shorter list count as changed.
+std::vector<PageRange> DiffPageHashes(const std::vector<uint64_t> &previous, const std::vector<uint64_t> &current);
+
+} // namespace util
+} // namespace twili
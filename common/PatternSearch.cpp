@@ -0,0 +1,142 @@
+//
+// Twili - Homebrew debug monitor for the Nintendo Switch
+// Copyright (C) 2019 misson20000 <xenotoad@xenotoad.net>
+//
+// This file is part of Twili.
+//
+// Twili is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Twili is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Twili.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include "PatternSearch.hpp"
+
+#include<algorithm>
+
+#include<string.h>
+
+namespace twili {
+namespace util {
+
+PatternMatcher::PatternMatcher(std::vector<uint8_t> pattern, std::vector<uint8_t> mask, uint64_t alignment) :
+	pattern(std::move(pattern)),
+	mask(std::move(mask)),
+	alignment(alignment) {
+	if(this->mask.empty()) {
+		this->mask.resize(this->pattern.size(), 0xff);
+	}
+	if(!IsValid()) {
+		return;
+	}
+	for(size_t i = 0; i < this->pattern.size(); i++) {
+		this->pattern[i]&= this->mask[i];
+		if(!has_anchor && this->mask[i] == 0xff) {
+			anchor_offset = i;
+			has_anchor = true;
+		}
+	}
+}
+
+bool PatternMatcher::IsValid() const {
+	return !pattern.empty() && mask.size() == pattern.size() && alignment != 0;
+}
+
+size_t PatternMatcher::GetPatternSize() const {
+	return pattern.size();
+}
+
+bool PatternMatcher::MatchesAt(const uint8_t *data) const {
+	// accumulate differences instead of breaking early so that the compiler can
+	// vectorize this loop
+	uint8_t diff = 0;
+	for(size_t i = 0; i < pattern.size(); i++) {
+		diff|= (data[i] & mask[i]) ^ pattern[i];
+	}
+	return diff == 0;
+}
+
+bool PatternMatcher::Search(const uint8_t *data, size_t size, size_t limit, uint64_t address, std::vector<uint64_t> &results, size_t max_results) const {
+	if(!IsValid() || size < pattern.size()) {
+		return results.size() >= max_results;
+	}
+	// last offset that a match could start at
+	size_t last = std::min(limit, size - pattern.size() + 1);
+	
+	if(!has_anchor || alignment >= 0x100) {
+		// either we have nothing to scan for, or the alignment is sparse enough
+		// that testing each aligned offset is cheaper than scanning. memchr
+		// skips ahead so quickly that for random data it wins until about here,
+		// even though most of its hits are misaligned.
+		size_t misalignment = address % alignment;
+		size_t offset = misalignment ? alignment - misalignment : 0;
+		for(; offset < last; offset+= alignment) {
+			if(MatchesAt(data + offset)) {
+				results.push_back(address + offset);
+				if(results.size() >= max_results) {
+					return true;
+				}
+			}
+		}
+		return false;
+	}
+
+	const uint8_t anchor = pattern[anchor_offset];
+	size_t offset = 0;
+	while(offset < last) {
+		const uint8_t *hit = (const uint8_t*) memchr(data + offset + anchor_offset, anchor, last - offset);
+		if(hit == nullptr) {
+			break;
+		}
+		offset = (hit - data) - anchor_offset;
+		if((address + offset) % alignment == 0 && MatchesAt(data + offset)) {
+			results.push_back(address + offset);
+			if(results.size() >= max_results) {
+				return true;
+			}
+		}
+		offset++;
+	}
+	return false;
+}
+
+PatternScanner::PatternScanner(const PatternMatcher &matcher, std::vector<uint64_t> &results, size_t max_results) :
+	matcher(matcher),
+	results(results),
+	max_results(max_results) {
+}
+
+uint8_t *PatternScanner::Prepare(uint64_t address, size_t size) {
+	if(address != carry_end) {
+		carry = 0;
+	}
+	buffer.resize(carry + size);
+	piece_address = address;
+	piece_size = size;
+	return buffer.data() + carry;
+}
+
+bool PatternScanner::Commit() {
+	// the carried bytes are too few to hold a match by themselves, so nothing
+	// found here was already reported for the last piece
+	size_t window = carry + piece_size;
+	bool full = matcher.Search(buffer.data(), window, window, piece_address - carry, results, max_results);
+
+	size_t overlap = matcher.IsValid() ? matcher.GetPatternSize() - 1 : 0;
+	carry = std::min(overlap, window);
+	memmove(buffer.data(), buffer.data() + window - carry, carry);
+	carry_end = piece_address + piece_size;
+	return full;
+}
+
+} // namespace util
+} // namespace twili
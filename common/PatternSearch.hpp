@@ -0,0 +1,90 @@
+//
+// Twili - Homebrew debug monitor for the Nintendo Switch
+// Copyright (C) 2019 misson20000 <xenotoad@xenotoad.net>
+//
+// This file is part of Twili.
+//
+// Twili is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Twili is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Twili.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#pragma once
+
+#include<vector>
+
+#include<stdint.h>
+#include<stddef.h>
+
+namespace twili {
+namespace util {
+
+// Masked byte pattern matcher, shared between twili (for ITwibDebugger's
+// SEARCH_MEMORY) and twib. A byte at offset i matches if
+// (data[i] & mask[i]) == (pattern[i] & mask[i]). Match start addresses must be
+// a multiple of the alignment.
+class PatternMatcher {
+ public:
+	// an empty mask matches every byte of the pattern exactly
+	PatternMatcher(std::vector<uint8_t> pattern, std::vector<uint8_t> mask, uint64_t alignment);
+
+	// whether the pattern, mask, and alignment describe a searchable pattern
+	bool IsValid() const;
+	size_t GetPatternSize() const;
+
+	// Searches for matches that start within the first `limit` bytes of
+	// `data` and lie entirely within the `size` bytes of `data`. `address` is
+	// the address of data[0], used for alignment and for reporting matches.
+	// Stops early once `results` holds `max_results` entries. Returns whether
+	// the limit was reached.
+	bool Search(const uint8_t *data, size_t size, size_t limit, uint64_t address, std::vector<uint64_t> &results, size_t max_results) const;
+	
+ private:
+	bool MatchesAt(const uint8_t *data) const;
+	
+	std::vector<uint8_t> pattern;
+	std::vector<uint8_t> mask;
+	uint64_t alignment;
+	// offset of a byte in the pattern that is fully unmasked, so we can find
+	// candidates with memchr instead of testing every offset
+	size_t anchor_offset;
+	bool has_anchor = false;
+};
+
+// Feeds memory to a PatternMatcher one piece at a time. The tail of each piece
+// is kept around, so matches that span two contiguous pieces are still found.
+class PatternScanner {
+ public:
+	PatternScanner(const PatternMatcher &matcher, std::vector<uint64_t> &results, size_t max_results);
+
+	// Returns where to put the `size` bytes found at `address`. If they don't
+	// directly follow the last piece, the tail of that piece is dropped.
+	uint8_t *Prepare(uint64_t address, size_t size);
+	// Searches the piece passed to the last Prepare call. Returns whether the
+	// result limit was reached.
+	bool Commit();
+
+ private:
+	const PatternMatcher &matcher;
+	std::vector<uint64_t> &results;
+	size_t max_results;
+	
+	std::vector<uint8_t> buffer;
+	size_t carry = 0;
+	uint64_t carry_end = 0;
+	uint64_t piece_address = 0;
+	size_t piece_size = 0;
+};
+
+} // namespace util
+} // namespace twili
@@ -47,6 +47,7 @@ class ITwibMetaInterface {
 	enum class Command : uint32_t {
 		LIST_DEVICES = 10,
 		CONNECT_TCP = 11,
+		READ_DEVICE_LOG = 12,
 	};
 };
 
@@ -69,6 +70,8 @@ class ITwibDeviceInterface {
 		OPEN_FILESYSTEM_ACCESSOR = 23,
 		WAIT_TO_DEBUG_APPLICATION = 24,
 		WAIT_TO_DEBUG_TITLE = 25,
+		CLOSE_OBJECTS = 26,
+		JOIN_SESSION = 27,
 	};
 };
 
@@ -104,6 +107,38 @@ class ITwibDebugger {
 		GET_TARGET_ENTRY = 21,
 		LAUNCH_DEBUG_PROCESS = 22,
 		GET_NRO_INFOS = 24,
+		SEARCH_MEMORY = 25,
+		HASH_PAGES = 26,
+		GET_DEBUG_EVENTS = 27,
+		QUERY_MEMORY_MAP = 28,
+		CREATE_MEMORY_WATCH = 29,
+	};
+
+	// SEARCH_MEMORY never returns more matches than this, so that a loose
+	// pattern can't run the console out of memory. A max_results of 0 asks
+	// for this many.
+	static constexpr uint32_t SEARCH_MEMORY_MAX_RESULTS = 0x10000;
+	// HASH_PAGES hashes at most this much per request, and returns fewer
+	// hashes than asked for if the range was bigger
+	static constexpr uint64_t HASH_PAGES_MAX_SIZE = 0x10000000;
+};
+
+class ITwibMemoryWatch {
+ public:
+	enum class Command : uint32_t {
+		READ = 10,
+	};
+
+	struct Range {
+		uint64_t address;
+		uint64_t size;
+	};
+
+	// READ sends the new contents of every change, concatenated, after the list
+	struct Change {
+		uint64_t timestamp; // system ticks
+		uint64_t address;
+		uint64_t size;
 	};
 };
 
@@ -134,6 +169,15 @@ class ITwibFilesystemAccessor {
 		GET_ENTRY_TYPE = 17,
 		OPEN_FILE = 18,
 		OPEN_DIRECTORY = 19,
+		WALK_DIRECTORY = 20,
+	};
+
+	// WALK_DIRECTORY responds with these packed back to back, each followed
+	// by path_size bytes of path relative to the directory that was walked
+	struct WalkEntry {
+		uint64_t file_size;
+		uint32_t entry_type; // 0 for directories, 1 for files
+		uint32_t path_size;
 	};
 };
 
@@ -145,6 +189,11 @@ class ITwibFileAccessor {
 		FLUSH = 12,
 		SET_SIZE = 13,
 		GET_SIZE = 14,
+		// streams the whole range back in one response, followed by a u32
+		// result code, since an error partway through can't be reported
+		// once the response has begun
+		READ_STREAM = 15,
+		HASH = 16,
 	};
 };
 
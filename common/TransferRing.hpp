@@ -0,0 +1,164 @@
+//
+// Twili - Homebrew debug monitor for the Nintendo Switch
+// Copyright (C) 2019 misson20000 <xenotoad@xenotoad.net>
+//
+// This file is part of Twili.
+//
+// Twili is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Twili is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Twili.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#pragma once
+
+#include<memory>
+#include<vector>
+
+#include<stdint.h>
+#include<stddef.h>
+#include<string.h>
+
+#include "err.hpp"
+
+namespace twili {
+namespace util {
+
+// A ring of buffers for sending on one IN endpoint without waiting for each
+// transfer to finish. Post copies into the next free buffer and queues it, so
+// the caller can produce the next chunk while earlier ones are on the wire.
+// Transfers on an endpoint complete in the order they were posted, so we only
+// ever need to wait on the oldest one.
+//
+// Traits supplies the endpoint, so that the ring can be tested on a host:
+//   using Endpoint; using Buffer; using Error;
+//   static uint32_t PostBufferAsync(Endpoint&, uint8_t *data, size_t size);
+//     queues a transfer and returns its URB ID
+//   static bool WaitForTransfer(Endpoint&, uint32_t urb_id, size_t &transferred_size);
+//     waits for a transfer to finish, returning false if it failed
+//   static void PostBufferSync(Endpoint&, uint8_t *data, size_t size);
+// Buffer is constructed from a size and has data and size members. Error is
+// constructed from a result code and thrown.
+template<typename Traits>
+class TransferRing {
+ public:
+	using Endpoint = typename Traits::Endpoint;
+	using Error = typename Traits::Error;
+
+	TransferRing(size_t count, size_t buffer_size) {
+		for(size_t i = 0; i < count; i++) {
+			slots.emplace_back(std::make_unique<Slot>(buffer_size));
+		}
+	}
+
+	size_t GetBufferSize() const {
+		return slots[0]->buffer.size;
+	}
+
+	size_t GetInFlightCount() const {
+		return in_flight;
+	}
+
+	// size must not exceed GetBufferSize()
+	void Post(Endpoint &endpoint, const uint8_t *data, size_t size) {
+		if(in_flight == slots.size()) {
+			WaitForOldest(endpoint);
+		}
+
+		Slot &slot = *slots[head];
+		memcpy(slot.buffer.data, data, size);
+		slot.size = size;
+		slot.urb_id = Traits::PostBufferAsync(endpoint, slot.buffer.data, size);
+		head = (head + 1) % slots.size();
+		in_flight++;
+	}
+
+	// waits for every posted transfer to complete
+	void Flush(Endpoint &endpoint) {
+		while(in_flight > 0) {
+			WaitForOldest(endpoint);
+		}
+	}
+
+	// forgets about in-flight transfers, after the interface has been reset
+	void Reset() {
+		in_flight = 0;
+		head = 0;
+	}
+
+ private:
+	struct Slot {
+		Slot(size_t size) : buffer(size) {
+		}
+		typename Traits::Buffer buffer;
+		uint32_t urb_id;
+		size_t size;
+	};
+
+	Slot &Oldest() {
+		return *slots[(head + slots.size() - in_flight) % slots.size()];
+	}
+	
+	// Throws if the transfer failed, or if it came up short when it can't be
+	// finished without reordering the stream. Either way, the ring is empty
+	// afterwards.
+	void WaitForOldest(Endpoint &endpoint) {
+		Slot &slot = Oldest();
+		size_t transferred_size;
+		bool ok;
+		try {
+			ok = Traits::WaitForTransfer(endpoint, slot.urb_id, transferred_size);
+		} catch(...) {
+			// we can't tell what became of the queued transfers
+			Reset();
+			throw;
+		}
+		in_flight--;
+
+		if(!ok) {
+			Abandon(endpoint);
+			throw Error(TWILI_ERR_USB_TRANSFER);
+		}
+		if(transferred_size < slot.size) {
+			if(in_flight > 0) {
+				// later transfers are already queued behind this one, so we
+				// can't resend the remainder without reordering the stream
+				Abandon(endpoint);
+				throw Error(TWILI_ERR_FATAL_USB_TRANSFER);
+			}
+			Traits::PostBufferSync(endpoint, slot.buffer.data + transferred_size, slot.size - transferred_size);
+		}
+	}
+
+	// Waits out the rest of the queued transfers, however they end, so that
+	// no buffer gets reused while the endpoint might still be reading it, and
+	// then empties the ring.
+	void Abandon(Endpoint &endpoint) {
+		while(in_flight > 0) {
+			size_t transferred_size;
+			try {
+				Traits::WaitForTransfer(endpoint, Oldest().urb_id, transferred_size);
+			} catch(...) {
+				break;
+			}
+			in_flight--;
+		}
+		Reset();
+	}
+	
+	std::vector<std::unique_ptr<Slot>> slots;
+	size_t head = 0; // next slot to fill
+	size_t in_flight = 0;
+};
+
+} // namespace util
+} // namespace twili
@@ -57,6 +57,7 @@
 #define TWILI_ERR_NO_MODULES TWILI_RESULT(34)
 #define TWILI_ERR_UNKNOWN_FILESYSTEM TWILI_RESULT(35)
 #define TWILI_ERR_INVALID_PROCESS_STATE TWILI_RESULT(36)
+#define TWILI_ERR_LINK_BUSY TWILI_RESULT(37)
 
 #define TWILI_ERR_PROTOCOL_UNRECOGNIZED_OBJECT TWILI_RESULT(1001)
 #define TWILI_ERR_PROTOCOL_UNRECOGNIZED_FUNCTION TWILI_RESULT(1002)
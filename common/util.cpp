@@ -73,5 +73,33 @@ std::optional<std::vector<uint8_t>> ReadFile(const char *path) {
 	return buffer;
 }
 
+bool GlobMatch(const char *pattern, const char *name) {
+	if(*pattern == 0) {
+		return true;
+	}
+	
+	// where to resume from if the rest doesn't match
+	const char *star = nullptr;
+	const char *retry = nullptr;
+	while(*name) {
+		if(*pattern == '*') {
+			star = pattern++;
+			retry = name;
+		} else if(*pattern == '?' || *pattern == *name) {
+			pattern++;
+			name++;
+		} else if(star) {
+			pattern = star + 1;
+			name = ++retry;
+		} else {
+			return false;
+		}
+	}
+	while(*pattern == '*') {
+		pattern++;
+	}
+	return *pattern == 0;
+}
+
 }
 }
@@ -26,5 +26,10 @@ namespace util {
 
 std::optional<std::vector<uint8_t>> ReadFile(const char *path);
 
+// Matches a name against a shell-style pattern where '*' matches any run of
+// characters and '?' matches any one character. An empty pattern matches
+// everything.
+bool GlobMatch(const char *pattern, const char *name);
+
 }
 }
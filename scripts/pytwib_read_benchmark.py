@@ -0,0 +1,110 @@
+#!/usr/bin/env python3
+# Measures reads per second through pytwib, comparing blocking calls issued one
+# at a time, blocking calls spread over a thread pool, and asyncio futures with
+# several reads in flight.
+#
+# Against a simulated device:
+#   $ mkdir -p /tmp/simfs/sd && head -c 64M /dev/urandom > /tmp/simfs/sd/bench.bin
+#   $ twibd --no-tcp -P /tmp/twibd-bench.sock --sim-devices 1 --sim-fs-root /tmp/simfs --sim-latency 500
+#   $ PYTHONPATH=twib/tool/pybind11/build scripts/pytwib_read_benchmark.py \
+#         --unix-path /tmp/twibd-bench.sock --pid 0x81 --address 0x7100000000 --file /bench.bin
+
+import argparse
+import asyncio
+import concurrent.futures
+import time
+
+import pytwib
+
+
+def report(label, count, size, seconds):
+    print("{:<40} {:>10.0f} reads/s {:>10.2f} MiB/s".format(
+        label, count / seconds, count * size / seconds / (1024 * 1024)))
+
+
+def offsets(base, size, span, count):
+    return [base + (i * size) % span for i in range(count)]
+
+
+def run_sequential(read, addrs, size):
+    start = time.perf_counter()
+    for addr in addrs:
+        read(addr, size)
+    return time.perf_counter() - start
+
+
+def run_threads(read, addrs, size, jobs):
+    with concurrent.futures.ThreadPoolExecutor(max_workers=jobs) as pool:
+        start = time.perf_counter()
+        for _ in pool.map(lambda addr: read(addr, size), addrs):
+            pass
+        return time.perf_counter() - start
+
+
+async def run_async(read_async, addrs, size, jobs):
+    # keeps at most `jobs` futures outstanding
+    pending = iter(addrs)
+
+    async def worker():
+        for addr in pending:
+            await read_async(addr, size)
+
+    start = time.perf_counter()
+    await asyncio.gather(*(worker() for _ in range(jobs)))
+    return time.perf_counter() - start
+
+
+def bench(name, read, read_async, base, span, args):
+    addrs = offsets(base, args.size, span, args.count)
+    read(base, args.size)  # warm up caches on both ends
+
+    report("{} sequential".format(name), args.count, args.size,
+           run_sequential(read, addrs, args.size))
+    for jobs in args.jobs:
+        report("{} threads x{}".format(name, jobs), args.count, args.size,
+               run_threads(read, addrs, args.size, jobs))
+    loop = asyncio.get_event_loop()
+    for jobs in args.jobs:
+        report("{} asyncio x{}".format(name, jobs), args.count, args.size,
+               loop.run_until_complete(run_async(read_async, addrs, args.size, jobs)))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Measure pytwib reads per second")
+    parser.add_argument("--unix-path", help="twibd socket (default: the built-in path)")
+    parser.add_argument("--device", type=lambda s: int(s, 0), help="device ID")
+    parser.add_argument("--pid", type=lambda s: int(s, 0), help="process to read memory from")
+    parser.add_argument("--address", type=lambda s: int(s, 0), default=0x7100000000,
+                        help="start of the memory region to read")
+    parser.add_argument("--span", type=lambda s: int(s, 0), default=0x100000,
+                        help="bytes of memory or file to cycle through")
+    parser.add_argument("--file", help="file on the sd filesystem to read")
+    parser.add_argument("--size", type=lambda s: int(s, 0), default=0x1000, help="bytes per read")
+    parser.add_argument("--count", type=int, default=2000, help="reads per run")
+    parser.add_argument("--jobs", type=int, nargs="+", default=[4, 16, 64],
+                        help="reads in flight to try")
+    args = parser.parse_args()
+
+    if args.pid is None and args.file is None:
+        parser.error("nothing to read; pass --pid and/or --file")
+
+    client = pytwib.GetClient(args.unix_path) if args.unix_path else pytwib.GetClient()
+    device = pytwib.GetDeviceInterface(client, args.device)
+
+    if args.pid is not None:
+        debugger = device.OpenActiveDebugger(args.pid)
+        bench("ReadMemory", debugger.ReadMemory, debugger.ReadMemoryAsync,
+              args.address, args.span, args)
+
+    if args.file is not None:
+        accessor = device.OpenFilesystemAccessor("sd")
+        f = accessor.OpenFile(1, args.file)
+        span = min(args.span, f.GetSize())
+        if span < args.size:
+            parser.error("{} is smaller than --size".format(args.file))
+        span -= span % args.size
+        bench("File Read", f.Read, f.ReadAsync, 0, span, args)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,245 @@
+#!/usr/bin/env python3
+# Measures file read throughput from a TCP device through twibd for different
+# --tcp-connections counts, over a loopback link delayed with netem.
+#
+# The device is a minimal stand-in for Twili's TCP bridge, served from this
+# script: it identifies itself with a session token, lets extra connections
+# join the session, and serves one in-memory file from the "sd" filesystem.
+# Each connection handles one request at a time, like the real bridge.
+#
+# netem applies to all of lo while the benchmark runs, so this needs root:
+#   $ sudo PYTHONPATH=twib/tool/pybind11/build scripts/tcp_netem_benchmark.py \
+#         --twibd build/daemon/twibd --twib build/tool/twib --delay 20
+
+import argparse
+import os
+import random
+import socket
+import struct
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+
+import pytwib
+
+from pytwib_read_benchmark import bench
+
+HEADER = struct.Struct("<IIIIQI4x")
+CLOSE = 0xffffffff
+
+
+def result(code):
+    return (code << 9) | 0xef
+
+
+ERR_UNRECOGNIZED_OBJECT = result(1001)
+ERR_UNRECOGNIZED_FUNCTION = result(1002)
+ERR_BAD_REQUEST = result(1005)
+
+# ITwibDeviceInterface
+IDENTIFY = 16
+OPEN_FILESYSTEM_ACCESSOR = 23
+CLOSE_OBJECTS = 26
+JOIN_SESSION = 27
+# ITwibFilesystemAccessor
+OPEN_FILE = 18
+# ITwibFileAccessor
+READ = 10
+GET_SIZE = 14
+READ_STREAM = 15
+
+READ_LIMIT = 0x40000
+
+
+def msgpack_str(s):
+    b = s.encode()
+    assert len(b) < 32
+    return bytes([0xa0 | len(b)]) + b
+
+
+def msgpack_identification(nickname, serial, token):
+    return (b"\x83" +
+            msgpack_str("device_nickname") + msgpack_str(nickname) +
+            msgpack_str("serial_number") + msgpack_str(serial) +
+            msgpack_str("session_token") + b"\xcf" + struct.pack(">Q", token))
+
+
+def vector(data):
+    return struct.pack("<Q", len(data)) + data
+
+
+class Session:
+    def __init__(self):
+        self.token = random.getrandbits(63) | 1
+        self.objects = {0: "device"}
+        self.next_object_id = 1
+        self.members = 0
+
+
+class FakeDevice:
+    def __init__(self, contents):
+        self.contents = contents
+        self.lock = threading.Lock()
+        self.sessions = {}
+        self.listener = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+        self.listener.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+        self.listener.bind(("127.0.0.1", 0))
+        self.listener.listen(16)
+        self.port = self.listener.getsockname()[1]
+        threading.Thread(target=self.accept, daemon=True).start()
+
+    def largest_session(self):
+        with self.lock:
+            return max([s.members for s in self.sessions.values()] + [0])
+
+    def accept(self):
+        while True:
+            conn, _ = self.listener.accept()
+            conn.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+            threading.Thread(target=self.serve, args=(conn,), daemon=True).start()
+
+    def serve(self, conn):
+        session = Session()
+        with self.lock:
+            self.sessions[session.token] = session
+            session.members += 1
+        stream = conn.makefile("rb")
+        try:
+            while True:
+                header = stream.read(HEADER.size)
+                if len(header) < HEADER.size:
+                    return
+                client_id, object_id, command_id, tag, payload_size, object_count = HEADER.unpack(header)
+                payload = stream.read(payload_size)
+                stream.read(object_count * 4)
+                code, response, objects, session = self.dispatch(session, object_id, command_id, payload)
+                conn.sendall(
+                    HEADER.pack(client_id, object_id, code, tag, len(response), len(objects)) +
+                    response + b"".join(struct.pack("<I", o) for o in objects))
+        finally:
+            with self.lock:
+                session.members -= 1
+            conn.close()
+
+    def dispatch(self, session, object_id, command_id, payload):
+        with self.lock:
+            if object_id not in session.objects:
+                return ERR_UNRECOGNIZED_OBJECT, b"", [], session
+            kind = session.objects[object_id]
+            if command_id == CLOSE:
+                if object_id != 0:
+                    del session.objects[object_id]
+                return 0, b"", [], session
+
+            def new_object(kind):
+                object_id = session.next_object_id
+                session.next_object_id += 1
+                session.objects[object_id] = kind
+                return 0, struct.pack("<I", 0), [object_id], session
+
+            if kind == "device":
+                if command_id == IDENTIFY:
+                    return 0, vector(msgpack_identification("netem", "netem-bench", session.token)), [], session
+                if command_id == OPEN_FILESYSTEM_ACCESSOR:
+                    return new_object("filesystem")
+                if command_id == CLOSE_OBJECTS:
+                    count, = struct.unpack_from("<Q", payload)
+                    for closed, in struct.iter_unpack("<I", payload[8:8 + count * 4]):
+                        if closed != 0:
+                            session.objects.pop(closed, None)
+                    return 0, b"", [], session
+                if command_id == JOIN_SESSION:
+                    token, = struct.unpack_from("<Q", payload)
+                    target = self.sessions.get(token)
+                    if target is None:
+                        return ERR_BAD_REQUEST, b"", [], session
+                    session.members -= 1
+                    target.members += 1
+                    return 0, b"", [], target
+            elif kind == "filesystem":
+                if command_id == OPEN_FILE:
+                    return new_object("file")
+            elif kind == "file":
+                if command_id in (READ, READ_STREAM):
+                    offset, size = struct.unpack_from("<QQ", payload)
+                    if command_id == READ:
+                        size = min(size, READ_LIMIT)
+                    data = self.contents[offset:offset + size]
+                    if command_id == READ:
+                        return 0, vector(data), [], session
+                    return 0, vector(data) + struct.pack("<I", 0), [], session
+                if command_id == GET_SIZE:
+                    return 0, struct.pack("<Q", len(self.contents)), [], session
+            return ERR_UNRECOGNIZED_FUNCTION, b"", [], session
+
+
+def netem(args, action):
+    command = ["tc", "qdisc", action, "dev", "lo", "root"]
+    if action != "del":
+        command += ["netem", "delay", "{}ms".format(args.delay)]
+        if args.rate:
+            command += ["rate", args.rate]
+    subprocess.run(command, check=True)
+
+
+def run(args, device, connections, directory):
+    socket_path = os.path.join(directory, "twibd-{}.sock".format(connections))
+    twibd = subprocess.Popen(
+        [args.twibd, "--no-tcp", "-P", socket_path, "--tcp-connections", str(connections)],
+        stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+    try:
+        deadline = time.monotonic() + 10
+        while not os.path.exists(socket_path):
+            if time.monotonic() > deadline:
+                sys.exit("twibd didn't start")
+            time.sleep(0.05)
+        subprocess.run(
+            [args.twib, "-P", socket_path, "connect-tcp", "127.0.0.1", str(device.port)],
+            check=True, stdout=subprocess.DEVNULL)
+        while device.largest_session() < connections:
+            if time.monotonic() > deadline:
+                sys.exit("twibd didn't open {} connections".format(connections))
+            time.sleep(0.05)
+
+        client = pytwib.GetClient(socket_path)
+        itdi = pytwib.GetDeviceInterface(client)
+        f = itdi.OpenFilesystemAccessor("sd").OpenFile(1, "/bench.bin")
+        span = len(device.contents) - len(device.contents) % args.size
+        bench("{} connection(s) Read".format(connections), f.Read, f.ReadAsync, 0, span, args)
+        del f, itdi, client
+    finally:
+        twibd.terminate()
+        twibd.wait()
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Measure TCP striping over a netem-delayed loopback")
+    parser.add_argument("--twibd", default="twibd", help="twibd to test")
+    parser.add_argument("--twib", default="twib", help="twib to connect twibd to the device with")
+    parser.add_argument("--delay", type=float, default=20, help="one-way delay in milliseconds, or 0 for no netem")
+    parser.add_argument("--rate", help="netem rate limit, such as 100mbit")
+    parser.add_argument("--connections", type=int, nargs="+", default=[1, 2, 4, 8],
+                        help="--tcp-connections values to try")
+    parser.add_argument("--file-size", type=lambda s: int(s, 0), default=0x1000000,
+                        help="size of the file the device serves")
+    parser.add_argument("--size", type=lambda s: int(s, 0), default=0x40000, help="bytes per read")
+    parser.add_argument("--count", type=int, default=200, help="reads per run")
+    parser.add_argument("--jobs", type=int, nargs="+", default=[16], help="reads in flight to try")
+    args = parser.parse_args()
+
+    device = FakeDevice(os.urandom(args.file_size))
+    if args.delay > 0:
+        netem(args, "add")
+    try:
+        with tempfile.TemporaryDirectory() as directory:
+            for connections in args.connections:
+                run(args, device, connections, directory)
+    finally:
+        if args.delay > 0:
+            netem(args, "del")
+
+
+if __name__ == "__main__":
+    main()
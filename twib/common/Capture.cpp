@@ -0,0 +1,199 @@
+//
+// Twili - Homebrew debug monitor for the Nintendo Switch
+// Copyright (C) 2019 misson20000 <xenotoad@xenotoad.net>
+//
+// This file is part of Twili.
+//
+// Twili is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Twili is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Twili.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include "Capture.hpp"
+
+#include<string.h>
+#include<errno.h>
+
+#include "Logger.hpp"
+
+namespace twili {
+namespace twib {
+namespace common {
+
+namespace {
+
+const char CAPTURE_MAGIC[8] = {'T', 'W', 'I', 'B', 'C', 'A', 'P', '\0'};
+const uint32_t CAPTURE_VERSION = 1;
+
+struct CaptureHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t reserved;
+};
+
+struct RecordHeader {
+	uint64_t timestamp;
+	uint32_t point;
+	uint32_t client_id;
+	uint32_t device_id;
+	uint32_t object_id;
+	uint32_t command_id;
+	uint32_t tag;
+	uint64_t payload_size;
+	uint32_t object_count;
+	uint32_t flags;
+	// followed by payload_size bytes of payload if RECORD_HAS_PAYLOAD is
+	// set, then object_count object IDs
+};
+
+const uint32_t RECORD_HAS_PAYLOAD = 1;
+
+} // anonymous namespace
+
+const char *CapturePointName(CapturePoint point) {
+	switch(point) {
+	case CapturePoint::FrontendRequest:
+		return "frontend-request";
+	case CapturePoint::BackendRequest:
+		return "backend-request";
+	case CapturePoint::BackendResponse:
+		return "backend-response";
+	case CapturePoint::FrontendResponse:
+		return "frontend-response";
+	default:
+		return "unknown";
+	}
+}
+
+CaptureWriter::CaptureWriter(FILE *file) :
+	file(file),
+	start(std::chrono::steady_clock::now()) {
+}
+
+CaptureWriter::~CaptureWriter() {
+	fclose(file);
+}
+
+std::unique_ptr<CaptureWriter> CaptureWriter::Open(const char *path) {
+	FILE *f = fopen(path, "wb");
+	if(!f) {
+		LogMessage(Error, "could not open '%s': %s", path, strerror(errno));
+		return std::unique_ptr<CaptureWriter>();
+	}
+
+	CaptureHeader header;
+	memcpy(header.magic, CAPTURE_MAGIC, sizeof(header.magic));
+	header.version = CAPTURE_VERSION;
+	header.reserved = 0;
+	if(fwrite(&header, sizeof(header), 1, f) != 1) {
+		LogMessage(Error, "write error on '%s'", path);
+		fclose(f);
+		return std::unique_ptr<CaptureWriter>();
+	}
+	
+	return std::unique_ptr<CaptureWriter>(new CaptureWriter(f));
+}
+
+void CaptureWriter::Write(
+	CapturePoint point,
+	uint32_t client_id, uint32_t device_id, uint32_t object_id, uint32_t command_id, uint32_t tag,
+	const uint8_t *payload, size_t payload_size,
+	const std::vector<uint32_t> &object_ids) {
+	std::lock_guard<std::mutex> lock(mutex);
+	if(error_flag) {
+		return;
+	}
+	
+	RecordHeader header;
+	header.timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now() - start).count();
+	header.point = (uint32_t) point;
+	header.client_id = client_id;
+	header.device_id = device_id;
+	header.object_id = object_id;
+	header.command_id = command_id;
+	header.tag = tag;
+	header.payload_size = payload_size;
+	header.object_count = object_ids.size();
+	header.flags = payload != nullptr ? RECORD_HAS_PAYLOAD : 0;
+
+	bool ok =
+		fwrite(&header, sizeof(header), 1, file) == 1 &&
+		(payload == nullptr || fwrite(payload, 1, payload_size, file) == payload_size) &&
+		fwrite(object_ids.data(), sizeof(uint32_t), object_ids.size(), file) == object_ids.size();
+	if(!ok) {
+		LogMessage(Error, "write error on capture file; capture stopped");
+		error_flag = true;
+	}
+}
+
+CaptureReader::CaptureReader(FILE *file) :
+	file(file) {
+}
+
+CaptureReader::~CaptureReader() {
+	fclose(file);
+}
+
+std::unique_ptr<CaptureReader> CaptureReader::Open(const char *path) {
+	FILE *f = fopen(path, "rb");
+	if(!f) {
+		LogMessage(Error, "could not open '%s': %s", path, strerror(errno));
+		return std::unique_ptr<CaptureReader>();
+	}
+
+	CaptureHeader header;
+	if(fread(&header, sizeof(header), 1, f) != 1 ||
+		 memcmp(header.magic, CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC)) != 0) {
+		LogMessage(Error, "'%s' is not a twibd capture", path);
+		fclose(f);
+		return std::unique_ptr<CaptureReader>();
+	}
+	if(header.version != CAPTURE_VERSION) {
+		LogMessage(Error, "capture '%s' has unsupported version %d", path, header.version);
+		fclose(f);
+		return std::unique_ptr<CaptureReader>();
+	}
+
+	return std::unique_ptr<CaptureReader>(new CaptureReader(f));
+}
+
+bool CaptureReader::Next(CaptureRecord &record) {
+	RecordHeader header;
+	if(fread(&header, sizeof(header), 1, file) != 1) {
+		return false;
+	}
+
+	record.timestamp = header.timestamp;
+	record.point = (CapturePoint) header.point;
+	record.client_id = header.client_id;
+	record.device_id = header.device_id;
+	record.object_id = header.object_id;
+	record.command_id = header.command_id;
+	record.tag = header.tag;
+	record.payload_size = header.payload_size;
+	record.has_payload = header.flags & RECORD_HAS_PAYLOAD;
+	record.payload.resize(record.has_payload ? header.payload_size : 0);
+	record.object_ids.resize(header.object_count);
+	
+	if(fread(record.payload.data(), 1, record.payload.size(), file) != record.payload.size() ||
+		 fread(record.object_ids.data(), sizeof(uint32_t), record.object_ids.size(), file) != record.object_ids.size()) {
+		LogMessage(Warning, "capture is truncated");
+		return false;
+	}
+	return true;
+}
+
+} // namespace common
+} // namespace twib
+} // namespace twili
@@ -0,0 +1,98 @@
+//
+// Twili - Homebrew debug monitor for the Nintendo Switch
+// Copyright (C) 2019 misson20000 <xenotoad@xenotoad.net>
+//
+// This file is part of Twili.
+//
+// Twili is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Twili is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Twili.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#pragma once
+
+#include<mutex>
+#include<memory>
+#include<vector>
+#include<chrono>
+
+#include<stdio.h>
+#include<stdint.h>
+
+namespace twili {
+namespace twib {
+namespace common {
+
+// Where in twibd a captured message was observed.
+enum class CapturePoint : uint32_t {
+	FrontendRequest = 0, // client -> twibd
+	BackendRequest = 1, // twibd -> device
+	BackendResponse = 2, // device -> twibd
+	FrontendResponse = 3, // twibd -> client
+};
+
+const char *CapturePointName(CapturePoint point);
+
+class CaptureRecord {
+ public:
+	uint64_t timestamp; // nanoseconds since the capture was started
+	CapturePoint point;
+	uint32_t client_id;
+	uint32_t device_id;
+	uint32_t object_id;
+	uint32_t command_id; // result code, for responses
+	uint32_t tag;
+	uint64_t payload_size; // size of the message's payload, even if it wasn't recorded
+	bool has_payload;
+	std::vector<uint8_t> payload;
+	std::vector<uint32_t> object_ids;
+};
+
+// Appends records to a capture file. Safe to call from any thread; records
+// are written in the order Write() is called.
+class CaptureWriter {
+ public:
+	~CaptureWriter();
+	static std::unique_ptr<CaptureWriter> Open(const char *path);
+
+	// payload may be nullptr to record only the payload's size.
+	void Write(
+		CapturePoint point,
+		uint32_t client_id, uint32_t device_id, uint32_t object_id, uint32_t command_id, uint32_t tag,
+		const uint8_t *payload, size_t payload_size,
+		const std::vector<uint32_t> &object_ids);
+ private:
+	CaptureWriter(FILE *file);
+
+	std::mutex mutex;
+	FILE *file;
+	bool error_flag = false;
+	std::chrono::steady_clock::time_point start;
+};
+
+class CaptureReader {
+ public:
+	~CaptureReader();
+	static std::unique_ptr<CaptureReader> Open(const char *path);
+
+	// Returns false at the end of the capture, or if it is truncated.
+	bool Next(CaptureRecord &record);
+ private:
+	CaptureReader(FILE *file);
+
+	FILE *file;
+};
+
+} // namespace common
+} // namespace twib
+} // namespace twili
@@ -37,6 +37,12 @@ MessageConnection::Request *MessageConnection::Process() {
 				has_current_mh = true;
 				current_rq.payload.Clear();
 				has_current_payload = false;
+				if(current_rq.mh.payload_size >= IN_PLACE_PAYLOAD_SIZE && in_buffer.ReadAvailable() < current_rq.mh.payload_size) {
+					// Line the payload up with the start of the buffer, so that the
+					// rest of it is received in place and its storage can be handed
+					// over. This only moves what has arrived so far.
+					in_buffer.Compact();
+				}
 			} else {
 				in_buffer.Reserve(sizeof(protocol::MessageHeader));
 				if(RequestInput()) { continue; }
@@ -45,11 +51,14 @@ MessageConnection::Request *MessageConnection::Process() {
 		}
 
 		if(!has_current_payload) {
-			if(in_buffer.Read(current_rq.payload, current_rq.mh.payload_size)) {
+			if(in_buffer.ReadAvailable() >= current_rq.mh.payload_size) {
+				current_rq.payload = util::Buffer(in_buffer.TakeData(current_rq.mh.payload_size));
 				has_current_payload = true;
 				current_rq.object_ids.Clear();
 			} else {
-				in_buffer.Reserve(current_rq.mh.payload_size);
+				// leave room for one more read past the payload, so that finishing
+				// it doesn't grow the buffer and move the payload
+				in_buffer.Reserve(current_rq.mh.payload_size - in_buffer.ReadAvailable() + READ_SIZE);
 				if(RequestInput()) { continue; }
 				return nullptr;
 			}
@@ -78,6 +87,20 @@ void MessageConnection::SendMessage(const protocol::MessageHeader &mh, const std
 	RequestOutput();
 }
 
+void MessageConnection::SendMessage(const protocol::MessageHeader &mh, std::shared_ptr<const std::vector<uint8_t>> payload, const std::vector<uint32_t> &object_ids) {
+	{
+		std::lock_guard<Semaphore> lock(out_buffer_sema);
+		out_buffer.Write(mh);
+		if(payload && payload->size() >= IN_PLACE_PAYLOAD_SIZE) {
+			out_buffer.Write(std::move(payload));
+		} else if(payload) {
+			out_buffer.Write(*payload);
+		}
+		out_buffer.Write(object_ids);
+	}
+	RequestOutput();
+}
+
 } // namespace common
 } // namespace twib
 } // namespace twili
@@ -25,6 +25,7 @@
 #include<optional>
 
 #include "Semaphore.hpp"
+#include "OutputQueue.hpp"
 #include "Protocol.hpp"
 #include "Buffer.hpp"
 #include "Logger.hpp"
@@ -49,13 +50,23 @@ class MessageConnection {
 	Request *Process(); // NULL pointer means no message
 
 	void SendMessage(const protocol::MessageHeader &mh, const std::vector<uint8_t> &payload, const std::vector<uint32_t> &object_ids);
+	// Large payloads are sent from the shared vector instead of being copied,
+	// so it must not be modified afterwards.
+	void SendMessage(const protocol::MessageHeader &mh, std::shared_ptr<const std::vector<uint8_t>> payload, const std::vector<uint32_t> &object_ids);
+
+	// payloads smaller than this are copied rather than received in place or
+	// sent by reference, since copying them costs less than the bookkeeping
+	static const size_t IN_PLACE_PAYLOAD_SIZE = 0x4000;
 
 	bool error_flag = false;
  protected:
+	// how much room subclasses ask for in in_buffer before each read
+	static const size_t READ_SIZE = 8192;
+	
 	util::Buffer in_buffer;
 
 	Semaphore out_buffer_sema;
-	util::Buffer out_buffer;
+	OutputQueue out_buffer;
 
 	// these turn true if more data was obtained
 	virtual bool RequestInput() = 0;
@@ -125,7 +125,7 @@ bool NamedPipeMessageConnection::RequestInput() {
 	std::lock_guard<std::mutex> guard(state_mutex);
 	if(!is_reading) {
 		LogMessage(Debug, "was in idle state");
-		std::tuple<uint8_t*, size_t> target = in_buffer.Reserve(8192);
+		std::tuple<uint8_t*, size_t> target = in_buffer.Reserve(READ_SIZE);
 		DWORD bytes_read;
 		if(ReadFile(pipe.handle, (void*)std::get<0>(target), std::get<1>(target), &bytes_read, &input_member.overlap)) {
 			in_buffer.MarkWritten(bytes_read);
@@ -154,8 +154,11 @@ bool NamedPipeMessageConnection::RequestOutput() {
 		out_buffer_sema.wait();
 		LogMessage(Debug, "locked out_buffer_lock");
 		if(out_buffer.ReadAvailable() > 0) {
+			// overlapped WriteFile only takes one buffer
+			platform::SendBuffer buffer;
+			out_buffer.Gather(&buffer, 1);
 			DWORD bytes_written;
-			if(WriteFile(pipe.handle, (void*)out_buffer.Read(), out_buffer.ReadAvailable(), &bytes_written, &output_member.overlap)) {
+			if(WriteFile(pipe.handle, buffer.data, buffer.size, &bytes_written, &output_member.overlap)) {
 				out_buffer.MarkRead(bytes_written);
 				out_buffer_sema.notify();
 				LogMessage(Debug, "completed synchronously");
@@ -0,0 +1,89 @@
+//
+// Twili - Homebrew debug monitor for the Nintendo Switch
+// Copyright (C) 2019 misson20000 <xenotoad@xenotoad.net>
+//
+// This file is part of Twili.
+//
+// Twili is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Twili is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Twili.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include "OutputQueue.hpp"
+
+#include<algorithm>
+
+namespace twili {
+namespace twib {
+namespace common {
+
+const std::vector<uint8_t> &OutputQueue::Piece::Bytes() const {
+	return shared ? *shared : copied;
+}
+
+void OutputQueue::Write(const uint8_t *data, size_t size) {
+	if(size == 0) {
+		return;
+	}
+	// don't append to the front piece, since appending can move the bytes
+	// out from under a send that's been gathered but not marked yet
+	if(pieces.size() < 2 || pieces.back().shared) {
+		pieces.emplace_back();
+	}
+	pieces.back().copied.insert(pieces.back().copied.end(), data, data + size);
+	available+= size;
+}
+
+void OutputQueue::Write(std::shared_ptr<const std::vector<uint8_t>> data) {
+	if(!data || data->empty()) {
+		return;
+	}
+	available+= data->size();
+	pieces.emplace_back();
+	pieces.back().shared = std::move(data);
+}
+
+size_t OutputQueue::ReadAvailable() const {
+	return available;
+}
+
+size_t OutputQueue::Gather(platform::SendBuffer *buffers, size_t max) const {
+	size_t count = 0;
+	size_t offset = front_offset;
+	for(auto i = pieces.begin(); i != pieces.end() && count < max; i++) {
+		const std::vector<uint8_t> &bytes = i->Bytes();
+		buffers[count].data = bytes.data() + offset;
+		buffers[count].size = bytes.size() - offset;
+		count++;
+		offset = 0;
+	}
+	return count;
+}
+
+void OutputQueue::MarkRead(size_t size) {
+	available-= size;
+	while(size > 0) {
+		size_t remaining = pieces.front().Bytes().size() - front_offset;
+		if(size < remaining) {
+			front_offset+= size;
+			return;
+		}
+		size-= remaining;
+		pieces.pop_front();
+		front_offset = 0;
+	}
+}
+
+} // namespace common
+} // namespace twib
+} // namespace twili
@@ -0,0 +1,83 @@
+//
+// Twili - Homebrew debug monitor for the Nintendo Switch
+// Copyright (C) 2019 misson20000 <xenotoad@xenotoad.net>
+//
+// This file is part of Twili.
+//
+// Twili is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Twili is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Twili.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#pragma once
+
+#include "platform/platform.hpp"
+
+#include<deque>
+#include<memory>
+#include<type_traits>
+#include<vector>
+
+#include<stdint.h>
+
+namespace twili {
+namespace twib {
+namespace common {
+
+// Bytes waiting to be sent on a connection, kept as a list of pieces so that
+// large payloads can be sent from where they already are instead of being
+// copied in. Small writes are copied and coalesced.
+class OutputQueue {
+ public:
+	// copies the data
+	void Write(const uint8_t *data, size_t size);
+
+	template<typename T>
+	void Write(const std::vector<T> &data) {
+		static_assert(std::is_standard_layout<T>::value, "T must be standard layout");
+		Write((const uint8_t*) data.data(), sizeof(T) * data.size());
+	}
+
+	template<typename T>
+	void Write(const T &t) {
+		static_assert(std::is_standard_layout<T>::value, "T must be standard layout");
+		Write((const uint8_t*) &t, sizeof(T));
+	}
+
+	// queues the data without copying it, holding a reference until it has
+	// been sent
+	void Write(std::shared_ptr<const std::vector<uint8_t>> data);
+
+	size_t ReadAvailable() const;
+	// Fills in up to `max` buffers with the unsent data, in order. Returns
+	// how many were filled in.
+	size_t Gather(platform::SendBuffer *buffers, size_t max) const;
+	void MarkRead(size_t size);
+
+ private:
+	struct Piece {
+		// null if the bytes were copied into `copied`
+		std::shared_ptr<const std::vector<uint8_t>> shared;
+		std::vector<uint8_t> copied;
+
+		const std::vector<uint8_t> &Bytes() const;
+	};
+
+	std::deque<Piece> pieces;
+	size_t front_offset = 0; // bytes of the front piece that were already sent
+	size_t available = 0;
+};
+
+} // namespace common
+} // namespace twib
+} // namespace twili
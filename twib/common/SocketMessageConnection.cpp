@@ -24,7 +24,7 @@ namespace twili {
 namespace twib {
 namespace common {
 
-SocketMessageConnection::SocketMessageConnection(platform::Socket &&socket, const platform::EventLoop::Notifier &notifier) : member(*this, std::move(socket)), notifier(notifier) {
+SocketMessageConnection::SocketMessageConnection(platform::Socket &&socket, const platform::EventLoop::Notifier &notifier, std::function<void()> activity_cb) : member(*this, std::move(socket)), notifier(notifier), activity_cb(activity_cb) {
 }
 
 SocketMessageConnection::~SocketMessageConnection() {
@@ -43,22 +43,26 @@ bool SocketMessageConnection::ConnectionMember::WantsWrite() {
 }
 
 void SocketMessageConnection::ConnectionMember::SignalRead() {
-	std::tuple<uint8_t*, size_t> target = connection.in_buffer.Reserve(8192);
+	std::tuple<uint8_t*, size_t> target = connection.in_buffer.Reserve(READ_SIZE);
 	ssize_t r = socket.Recv(std::get<0>(target), std::get<1>(target), 0);
 	if(r <= 0) {
 		connection.error_flag = true;
 	} else {
 		connection.in_buffer.MarkWritten(r);
 	}
+	connection.SignalActivity();
 }
 
 void SocketMessageConnection::ConnectionMember::SignalWrite() {
 	LogMessage(Debug, "pumping out 0x%lx bytes", connection.out_buffer.ReadAvailable());
 	std::lock_guard<Semaphore> lock(connection.out_buffer_sema);
 	if(connection.out_buffer.ReadAvailable() > 0) {
-		ssize_t r = socket.Send(connection.out_buffer.Read(), connection.out_buffer.ReadAvailable(), 0);
+		platform::SendBuffer buffers[16];
+		size_t count = connection.out_buffer.Gather(buffers, 16);
+		ssize_t r = socket.Send(buffers, count, 0);
 		if(r < 0) {
 			connection.error_flag = true;
+			connection.SignalActivity();
 			return;
 		}
 		if(r > 0) {
@@ -70,6 +74,13 @@ void SocketMessageConnection::ConnectionMember::SignalWrite() {
 void SocketMessageConnection::ConnectionMember::SignalError() {
 	LogMessage(Debug, "error signalled on socket");
 	connection.error_flag = true;
+	connection.SignalActivity();
+}
+
+void SocketMessageConnection::SignalActivity() {
+	if(activity_cb) {
+		activity_cb();
+	}
 }
 
 bool SocketMessageConnection::RequestInput() {
@@ -23,6 +23,8 @@
 #include "platform/platform.hpp"
 #include "platform/EventLoop.hpp" // from platform
 
+#include<functional>
+
 #include "MessageConnection.hpp"
 
 namespace twili {
@@ -31,7 +33,9 @@ namespace common {
 
 class SocketMessageConnection : public MessageConnection {
  public:
-	SocketMessageConnection(platform::Socket &&socket, const platform::EventLoop::Notifier &notifier);
+	// activity_cb is called on the event thread whenever input arrives or the
+	// connection fails, so owners can process only the connections that need it
+	SocketMessageConnection(platform::Socket &&socket, const platform::EventLoop::Notifier &notifier, std::function<void()> activity_cb = std::function<void()>());
 	virtual ~SocketMessageConnection() override;
 
 	class ConnectionMember : public platform::EventLoop::SocketMember {
@@ -52,6 +56,9 @@ class SocketMessageConnection : public MessageConnection {
 	virtual bool RequestOutput() override;
  private:
 	const platform::EventLoop::Notifier &notifier;
+	std::function<void()> activity_cb;
+
+	void SignalActivity();
 };
 
 } // namespace common
@@ -36,15 +36,8 @@ BridgeObject::BridgeObject(Daemon &daemon, uint32_t device_id, uint32_t object_i
 BridgeObject::~BridgeObject() {
 	// try to close object if valid
 	if(valid) {
-		LogMessage(Debug, "cleaning up lost object 0x%x", object_id);
-		daemon.local_client->SendRequest(
-			Request(
-				nullptr, // local client overwrites this
-				device_id,
-				object_id,
-				0xffffffff,
-				0 // local client generates this
-				)); // we don't care about the response
+		LogMessage(Debug, "cleaning up object 0x%x", object_id);
+		daemon.CloseObject(device_id, object_id);
 	}
 }
 
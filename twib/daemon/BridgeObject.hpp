@@ -33,7 +33,7 @@ class BridgeObject {
 	BridgeObject(Daemon &daemon, uint32_t device_id, uint32_t object_id);
 	~BridgeObject();
 
-	const Daemon &daemon;
+	Daemon &daemon;
 	const uint32_t device_id;
 	const uint32_t object_id;
 	bool valid = true;
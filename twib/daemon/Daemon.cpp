@@ -51,17 +51,21 @@ namespace twili {
 namespace twib {
 namespace daemon {
 
-Daemon::Daemon() :
-	local_client(std::make_shared<LocalClient>(*this))
+Daemon::Daemon(const Config &config) :
+	local_client(std::make_shared<LocalClient>(*this)),
+	device_log_config(config.device_log)
 // this comma placement is really gross, but for some reason C++ doesn't seem to allow commas at the end of member initializer lists
 #if TWIBD_TCP_BACKEND_ENABLED
-	, tcp(*this)
+	, tcp(*this, config.tcp)
 #endif
 #if TWIBD_LIBUSB_BACKEND_ENABLED
-	, usb(*this)
+	, usb(*this, config.usb)
 #endif
 #if TWIBD_LIBUSBK_BACKEND_ENABLED
 	, usbk(*this)
+#endif
+#if TWIBD_SIMULATED_BACKEND_ENABLED
+	, simulated(*this)
 #endif
 	{
 	AddClient(local_client);
@@ -85,6 +89,10 @@ void Daemon::AddDevice(std::shared_ptr<Device> device) {
 	
 	if(!entry_lock || entry_lock->GetPriority() <= device->GetPriority()) { // don't let tcp devices clobber usb devices
 		entry = device;
+		{
+			std::lock_guard<std::mutex> lock(close_mutex);
+			devices_without_batch_close.erase(device->device_id);
+		}
 	
 		LogMessage(Debug, "resetting objects on new device");
 		local_client->SendRequest(
@@ -92,6 +100,12 @@ void Daemon::AddDevice(std::shared_ptr<Device> device) {
 	}
 }
 
+#if TWIBD_SIMULATED_BACKEND_ENABLED
+void Daemon::StartSimulatedDevices(const backend::SimulatedBackend::Config &config) {
+	simulated.Start(config);
+}
+#endif
+
 void Daemon::AddClient(std::shared_ptr<Client> client) {
 	std::lock_guard<std::mutex> lock(client_map_mutex);
 
@@ -109,18 +123,63 @@ void Daemon::Awaken() {
 	dispatch_queue.enqueue(std::monostate {});
 }
 
+bool Daemon::StartCapture(const char *path) {
+	capture = common::CaptureWriter::Open(path);
+	if(!capture) {
+		return false;
+	}
+	LogMessage(Info, "capturing traffic to %s", path);
+	return true;
+}
+
 void Daemon::PostRequest(Request &&request) {
-	dispatch_queue.enqueue(request);
+	// requests from the local client are twibd's own bookkeeping, not client traffic
+	if(capture && request.client != local_client) {
+		capture->Write(
+			common::CapturePoint::FrontendRequest,
+			request.client->client_id, request.device_id, request.object_id, request.command_id, request.tag,
+			request.payload.data(), request.payload.size(),
+			std::vector<uint32_t>());
+	}
+	dispatch_queue.enqueue(std::move(request));
 }
 
 void Daemon::PostResponse(Response &&response) {
-	dispatch_queue.enqueue(response);
+	if(capture) {
+		std::vector<uint32_t> object_ids;
+		for(auto &o : response.objects) {
+			object_ids.push_back(o->object_id);
+		}
+		capture->Write(
+			common::CapturePoint::BackendResponse,
+			response.client_id, response.device_id, response.object_id, response.result_code, response.tag,
+			response.payload.data(), response.payload.size(),
+			object_ids);
+	}
+
+	// Responses for frontend clients are delivered straight from the
+	// backend's thread, and get written out by the event loop that owns the
+	// client's connection. twibd's own requests still have their callbacks
+	// run on the dispatch thread.
+	std::shared_ptr<Client> client = GetClient(response.client_id);
+	if(client && client != local_client) {
+		DeliverResponse(response, client, true);
+	} else {
+		dispatch_queue.enqueue(std::move(response));
+	}
 }
 
 void Daemon::RemoveClient(std::shared_ptr<Client> client) {
-	std::lock_guard<std::mutex> lock(client_map_mutex);
-	clients.erase(clients.find(client->client_id));
-	LogMessage(Info, "removing client %08x", client->client_id);
+	{
+		std::lock_guard<std::mutex> lock(client_map_mutex);
+		clients.erase(clients.find(client->client_id));
+		LogMessage(Info, "removing client %08x", client->client_id);
+	}
+
+	std::lock_guard<std::mutex> lock(device_log_mutex);
+	device_log_readers.remove_if([&](DeviceLogReader &reader) {
+			return reader.request.client_id == client->client_id;
+		});
 }
 
 void Daemon::RemoveDevice(std::shared_ptr<Device> device) {
@@ -144,81 +203,279 @@ void Daemon::Process() {
 				// just a wake-up signal
 			},
 			[&](Request &rq) {
-				LogMessage(Debug, "dispatching request");
-				LogMessage(Debug, "  client id: %08x", rq.client->client_id);
-				LogMessage(Debug, "  device id: %08x", rq.device_id);
-				LogMessage(Debug, "  object id: %08x", rq.object_id);
-				LogMessage(Debug, "  command id: %08x", rq.command_id);
-				LogMessage(Debug, "  tag: %08x", rq.tag);
+				DispatchRequest(rq);
+			},
+			[&](Response &rs) {
+				DeliverResponse(rs, GetClient(rs.client_id), false);
+			}
+		}, v);
+
+	// Let closes pile up while there is more to do, so that a burst of them
+	// goes out as one batch. DispatchRequest flushes them before anything
+	// else reaches a device, so they still arrive in order.
+	if(dispatch_queue.size_approx() == 0) {
+		FlushObjectCloses();
+	}
+
+	LogMessage(Debug, "finished process loop");
+}
+
+void Daemon::DeliverResponse(Response &rs, std::shared_ptr<Client> client, bool from_backend) {
+	LogMessage(Debug, "dispatching response");
+	LogMessage(Debug, "  client id: %08x", rs.client_id);
+	LogMessage(Debug, "  object id: %08x", rs.object_id);
+	LogMessage(Debug, "  result code: %08x", rs.result_code);
+	LogMessage(Debug, "  tag: %08x", rs.tag);
+	LogMessage(Debug, "  objects:");
+	for(auto o : rs.objects) {
+		LogMessage(Debug, "    0x%x", o->object_id);
+	}
 		
-				if(rq.device_id == 0) {
-					PostResponse(HandleRequest(rq));
-				} else {
-					std::shared_ptr<Device> device;
-					{
-						std::lock_guard<std::mutex> lock(device_map_mutex);
-						auto i = devices.find(rq.device_id);
-						if(i == devices.end()) {
-							PostResponse(rq.RespondError(TWILI_ERR_PROTOCOL_UNRECOGNIZED_DEVICE));
-							return;
-						}
-						device = i->second.lock();
-						if(!device || device->deletion_flag) {
-							PostResponse(rq.RespondError(TWILI_ERR_PROTOCOL_UNRECOGNIZED_DEVICE));
-							return;
-						}
-					}
-					if(rq.command_id == 0xffffffff) {
-						LogMessage(Debug, "detected close request for 0x%x", rq.object_id);
-						std::shared_ptr<Client> client = rq.client;
-						if(client) {
-							// disown the object that's being closed
-							for(auto i = client->owned_objects.begin(); i != client->owned_objects.end(); ){
-								if((*i)->object_id == rq.object_id) {
-									// need to mark this so that it doesn't send another close request
-									(*i)->valid = false;
-									i = client->owned_objects.erase(i);
-									LogMessage(Debug, "  disowned from client");
-								} else {
-									i++;
-								}
-							}
+	if(!client) {
+		LogMessage(Info, "dropping response for bad client: 0x%x", rs.client_id);
+		return;
+	}
+	{ // scope for lock
+		// add any objects this response included to the client's
+		// owned object list, to keep the BridgeObject object alive
+		std::lock_guard<std::mutex> lock(client->owned_objects_mutex);
+		client->owned_objects.insert(
+			client->owned_objects.end(),
+			rs.objects.begin(),
+			rs.objects.end());
+	}
+	if(capture && client != local_client) {
+		std::vector<uint32_t> object_ids;
+		for(auto &o : rs.objects) {
+			object_ids.push_back(o->object_id);
+		}
+		// responses twibd made itself, like ListDevices, have no backend
+		// record to take their payload from
+		capture->Write(
+			common::CapturePoint::FrontendResponse,
+			rs.client_id, rs.device_id, rs.object_id, rs.result_code, rs.tag,
+			from_backend ? nullptr : rs.payload.data(), rs.payload.size(),
+			object_ids);
+	}
+	client->PostResponse(rs);
+}
+
+void Daemon::DispatchRequest(Request &rq) {
+	LogMessage(Debug, "dispatching request");
+	LogMessage(Debug, "  client id: %08x", rq.client->client_id);
+	LogMessage(Debug, "  device id: %08x", rq.device_id);
+	LogMessage(Debug, "  object id: %08x", rq.object_id);
+	LogMessage(Debug, "  command id: %08x", rq.command_id);
+	LogMessage(Debug, "  tag: %08x", rq.tag);
+		
+	if(rq.device_id == 0) {
+		if(rq.object_id == 0 && rq.command_id == (uint32_t) protocol::ITwibMetaInterface::Command::READ_DEVICE_LOG) {
+			// may hold on to the request until the device logs something
+			ReadDeviceLog(rq);
+		} else {
+			// enqueue directly so this isn't captured as backend traffic
+			dispatch_queue.enqueue(HandleRequest(rq));
+		}
+	} else {
+		std::shared_ptr<Device> device;
+		{
+			std::lock_guard<std::mutex> lock(device_map_mutex);
+			auto i = devices.find(rq.device_id);
+			if(i == devices.end()) {
+				dispatch_queue.enqueue(rq.RespondError(TWILI_ERR_PROTOCOL_UNRECOGNIZED_DEVICE));
+				return;
+			}
+			device = i->second.lock();
+			if(!device || device->deletion_flag) {
+				dispatch_queue.enqueue(rq.RespondError(TWILI_ERR_PROTOCOL_UNRECOGNIZED_DEVICE));
+				return;
+			}
+		}
+		if(rq.command_id == 0xffffffff) {
+			LogMessage(Debug, "detected close request for 0x%x", rq.object_id);
+			std::shared_ptr<Client> client = rq.client;
+			if(client && client != local_client && rq.object_id != 0) {
+				// Disown the object and answer right away. Dropping the
+				// BridgeObject queues the close, which is flushed to the device
+				// along with any others at the end of this pass.
+				std::vector<std::shared_ptr<BridgeObject>> disowned;
+				{ // scope for lock
+					std::lock_guard<std::mutex> lock(client->owned_objects_mutex);
+					for(auto i = client->owned_objects.begin(); i != client->owned_objects.end(); ){
+						if((*i)->device_id == rq.device_id && (*i)->object_id == rq.object_id) {
+							disowned.push_back(std::move(*i));
+							i = client->owned_objects.erase(i);
+							LogMessage(Debug, "  disowned from client");
 						} else {
-							LogMessage(Warning, "failed to locate client for disownership");
+							i++;
 						}
 					}
-					LogMessage(Debug, "sending request via device");
-					device->SendRequest(std::move(rq));
-					LogMessage(Debug, "sent request via device");
-				}
-			},
-			[&](Response &rs) {
-				LogMessage(Debug, "dispatching response");
-				LogMessage(Debug, "  client id: %08x", rs.client_id);
-				LogMessage(Debug, "  object id: %08x", rs.object_id);
-				LogMessage(Debug, "  result code: %08x", rs.result_code);
-				LogMessage(Debug, "  tag: %08x", rs.tag);
-				LogMessage(Debug, "  objects:");
-				for(auto o : rs.objects) {
-					LogMessage(Debug, "    0x%x", o->object_id);
 				}
-		
-				std::shared_ptr<Client> client = GetClient(rs.client_id);
-				if(!client) {
-					LogMessage(Info, "dropping response for bad client: 0x%x", rs.client_id);
+				// the close gets queued as these are released, outside the lock
+				if(!disowned.empty()) {
+					disowned.clear();
+					dispatch_queue.enqueue(rq.RespondOk());
 					return;
 				}
-				// add any objects this response included to the client's
-				// owned object list, to keep the BridgeObject object alive
-				client->owned_objects.insert(
-					client->owned_objects.end(),
-					rs.objects.begin(),
-					rs.objects.end());
-				client->PostResponse(rs);
+			} else if(!client) {
+				LogMessage(Warning, "failed to locate client for disownership");
 			}
-		}, v);
+		}
+		FlushObjectCloses();
+		if(capture) {
+			capture->Write(
+				common::CapturePoint::BackendRequest,
+				rq.client ? rq.client->client_id : 0, rq.device_id, rq.object_id, rq.command_id, rq.tag,
+				nullptr, rq.payload.size(),
+				std::vector<uint32_t>());
+		}
+		LogMessage(Debug, "sending request via device");
+		device->SendRequest(std::move(rq));
+		LogMessage(Debug, "sent request via device");
+	}
+}
 
-	LogMessage(Debug, "finished process loop");
+void Daemon::CloseObject(uint32_t device_id, uint32_t object_id) {
+	bool was_empty;
+	{
+		std::lock_guard<std::mutex> lock(close_mutex);
+		was_empty = pending_closes.empty();
+		pending_closes[device_id].push_back(object_id);
+	}
+	if(was_empty) {
+		// make sure the dispatch thread gets around to flushing it
+		Awaken();
+	}
+}
+
+void Daemon::FlushObjectCloses() {
+	std::map<uint32_t, std::vector<uint32_t>> closes;
+	{
+		std::lock_guard<std::mutex> lock(close_mutex);
+		closes.swap(pending_closes);
+	}
+	for(auto &entry : closes) {
+		SendObjectCloses(entry.first, entry.second);
+	}
+}
+
+void Daemon::SendObjectCloses(uint32_t device_id, const std::vector<uint32_t> &object_ids) {
+	bool batch;
+	{
+		std::lock_guard<std::mutex> lock(close_mutex);
+		batch = object_ids.size() > 1 && devices_without_batch_close.count(device_id) == 0;
+	}
+	
+	// these are dispatched immediately instead of going through the queue,
+	// so that they reach the device before any request that was queued
+	// after the objects were closed
+	if(!batch) {
+		for(uint32_t object_id : object_ids) {
+			Request rq = local_client->PrepareRequest(
+				Request(nullptr, device_id, object_id, 0xffffffff, 0),
+				[](Response r) {}); // we don't care about the response
+			DispatchRequest(rq);
+		}
+		return;
+	}
+
+	LogMessage(Debug, "closing %zu objects on device %08x", object_ids.size(), device_id);
+	util::Buffer payload;
+	payload.Write<uint64_t>(object_ids.size());
+	payload.Write(object_ids);
+	Request rq = local_client->PrepareRequest(
+		Request(nullptr, device_id, 0, (uint32_t) protocol::ITwibDeviceInterface::Command::CLOSE_OBJECTS, 0, payload.TakeData()),
+		[this, device_id, object_ids](Response r) {
+			if(r.result_code == TWILI_ERR_PROTOCOL_UNRECOGNIZED_FUNCTION) {
+				LogMessage(Info, "device %08x can't close objects in batches; closing them one at a time", device_id);
+				{
+					std::lock_guard<std::mutex> lock(close_mutex);
+					devices_without_batch_close.insert(device_id);
+				}
+				SendObjectCloses(device_id, object_ids);
+			}
+		});
+	DispatchRequest(rq);
+}
+
+void Daemon::AppendDeviceLog(uint32_t device_id, std::vector<std::string> &&lines) {
+	std::lock_guard<std::mutex> lock(device_log_mutex);
+	std::unique_ptr<DeviceLog> &log = device_logs[device_id];
+	if(!log) {
+		log = std::make_unique<DeviceLog>(device_id, device_log_config);
+	}
+	for(std::string &line : lines) {
+		LogMessage(Debug, "[%08x] %s", device_id, line.c_str());
+		log->Append(std::move(line));
+	}
+	log->Flush();
+
+	for(auto i = device_log_readers.begin(); i != device_log_readers.end(); ) {
+		if(i->device_id == device_id) {
+			dispatch_queue.enqueue(RespondWithDeviceLog(i->request, *log, i->sequence));
+			i = device_log_readers.erase(i);
+		} else {
+			i++;
+		}
+	}
+}
+
+void Daemon::ReadDeviceLog(Request &rq) {
+	LogMessage(Debug, "command 12 issued to twibd meta object: READ_DEVICE_LOG");
+	
+	util::Buffer buffer(rq.payload.GetVector());
+	uint32_t device_id;
+	uint64_t sequence;
+	uint8_t wait;
+	if(!buffer.Read(device_id) ||
+		 !buffer.Read(sequence) ||
+		 !buffer.Read(wait)) {
+		dispatch_queue.enqueue(rq.RespondError(TWILI_ERR_PROTOCOL_BAD_REQUEST));
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(device_log_mutex);
+	auto i = device_logs.find(device_id);
+	if(i == device_logs.end()) {
+		// logs outlive their devices, but don't make them up for devices
+		// that we've never heard from
+		bool connected;
+		{
+			std::lock_guard<std::mutex> lock(device_map_mutex);
+			connected = devices.find(device_id) != devices.end();
+		}
+		if(!connected) {
+			dispatch_queue.enqueue(rq.RespondError(TWILI_ERR_PROTOCOL_UNRECOGNIZED_DEVICE));
+			return;
+		}
+		i = device_logs.emplace(device_id, std::make_unique<DeviceLog>(device_id, device_log_config)).first;
+	}
+
+	WeakRequest weak = rq.Weak();
+	if(wait && sequence == i->second->GetEndSequence()) {
+		device_log_readers.push_back(DeviceLogReader {std::move(weak), device_id, sequence});
+	} else {
+		dispatch_queue.enqueue(RespondWithDeviceLog(weak, *i->second, sequence));
+	}
+}
+
+Response Daemon::RespondWithDeviceLog(WeakRequest &rq, DeviceLog &log, uint64_t sequence) {
+	std::vector<std::string> lines;
+	uint64_t dropped;
+	uint64_t next_sequence = log.Read(sequence, 0x40000, lines, dropped);
+	
+	util::Buffer payload;
+	payload.Write<uint64_t>(next_sequence);
+	payload.Write<uint64_t>(dropped);
+	payload.Write<uint64_t>(lines.size());
+	for(std::string &line : lines) {
+		payload.Write<uint64_t>(line.size());
+		payload.Write(line);
+	}
+	
+	Response r = rq.RespondOk();
+	r.payload = payload.TakeData();
+	return r;
 }
 
 Response Daemon::HandleRequest(Request &rq) {
@@ -256,7 +513,7 @@ Response Daemon::HandleRequest(Request &rq) {
 		case protocol::ITwibMetaInterface::Command::CONNECT_TCP: {
 			LogMessage(Debug, "command 1 issued to twibd meta object: CONNECT_TCP");
 
-			util::Buffer buffer(rq.payload);
+			util::Buffer buffer(rq.payload.GetVector());
 			uint64_t hostname_len, port_len;
 			std::string hostname, port;
 			if(!buffer.Read<uint64_t>(hostname_len) ||
@@ -305,23 +562,23 @@ std::shared_ptr<Client> Daemon::GetClient(uint32_t client_id) {
 }
 
 #if TWIB_TCP_FRONTEND_ENABLED == 1
-static std::shared_ptr<frontend::SocketFrontend> CreateTCPFrontend(Daemon &daemon, uint16_t port) {
+static std::shared_ptr<frontend::SocketFrontend> CreateTCPFrontend(Daemon &daemon, uint16_t port, size_t thread_count) {
 	struct sockaddr_in6 addr;
 	memset(&addr, 0, sizeof(addr));
 	addr.sin6_family = AF_INET6;
 	addr.sin6_port = htons(port);
 	addr.sin6_addr = in6addr_any;
-	return std::make_shared<frontend::SocketFrontend>(daemon, AF_INET6, SOCK_STREAM, (struct sockaddr*) &addr, sizeof(addr));
+	return std::make_shared<frontend::SocketFrontend>(daemon, AF_INET6, SOCK_STREAM, (struct sockaddr*) &addr, sizeof(addr), thread_count);
 }
 #endif
 
 #if TWIB_UNIX_FRONTEND_ENABLED == 1
-static std::shared_ptr<frontend::SocketFrontend> CreateUNIXFrontend(Daemon &daemon, std::string path) {
+static std::shared_ptr<frontend::SocketFrontend> CreateUNIXFrontend(Daemon &daemon, std::string path, size_t thread_count) {
 	struct sockaddr_un addr;
 	memset(&addr, 0, sizeof(addr));
 	addr.sun_family = AF_UNIX;
 	strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path)-1);
-	return std::make_shared<frontend::SocketFrontend>(daemon, AF_UNIX, SOCK_STREAM, (struct sockaddr*) &addr, sizeof(addr));
+	return std::make_shared<frontend::SocketFrontend>(daemon, AF_UNIX, SOCK_STREAM, (struct sockaddr*) &addr, sizeof(addr), thread_count);
 }
 #endif
 
@@ -386,6 +643,11 @@ int main(int argc, char *argv[]) {
 		->envname("TWIB_UNIX_FRONTEND_PATH");
 #endif
 
+	size_t frontend_threads = 1;
+	app.add_option(
+		"--frontend-threads", frontend_threads,
+		"How many threads each socket frontend spreads its clients across");
+
 #if TWIB_TCP_FRONTEND_ENABLED == 1
 	bool tcp_frontend_enabled = true;
 	app.add_flag_function(
@@ -419,6 +681,68 @@ int main(int argc, char *argv[]) {
 		}, "Disable named pipe frontend");
 #endif
 
+	std::string capture_path;
+	app.add_option(
+		"--capture", capture_path,
+		"Record all traffic passing through twibd to a capture file, for twib-replay");
+
+	daemon::Daemon::Config daemon_config;
+	app.add_option(
+		"--device-log-capacity", daemon_config.device_log.capacity,
+		"How many bytes of each device's log to keep in memory for twib logs");
+	app.add_option(
+		"--device-log-dir", daemon_config.device_log.directory,
+		"Also write each device's log to a file in this directory")
+		->check(CLI::ExistingDirectory);
+	app.add_option(
+		"--device-log-file-size", daemon_config.device_log.file_size,
+		"Size in bytes at which device log files are rotated");
+	app.add_option(
+		"--device-log-files", daemon_config.device_log.file_count,
+		"How many rotated log files to keep for each device");
+
+#if TWIBD_TCP_BACKEND_ENABLED == 1
+	app.add_option(
+		"--tcp-connections", daemon_config.tcp.connections,
+		"How many connections to open to each device over TCP, for devices that support it");
+#endif
+
+#if TWIBD_LIBUSB_BACKEND_ENABLED == 1
+	app.add_option(
+		"--usb-read-ahead", daemon_config.usb.read_ahead,
+		"How many USB transfers to keep queued while receiving a response from a device");
+	app.add_option(
+		"--usb-transfer-size", daemon_config.usb.transfer_size,
+		"Size in bytes of each USB transfer used to receive responses");
+#endif
+
+#if TWIBD_SIMULATED_BACKEND_ENABLED == 1
+	daemon::backend::SimulatedBackend::Config sim_config;
+	uint64_t sim_latency = 0;
+	bool sim_no_walk_directory = false;
+	app.add_option(
+		"--sim-devices", sim_config.device_count,
+		"Number of simulated devices to register");
+	app.add_option(
+		"--sim-bandwidth", sim_config.bandwidth,
+		"Simulated link bandwidth in bytes per second, or 0 for unlimited");
+	app.add_option(
+		"--sim-latency", sim_latency,
+		"Simulated link latency in microseconds, added to each request and response");
+	app.add_option(
+		"--sim-fs-root", sim_config.filesystem_root,
+		"Host directory whose subdirectories back the simulated filesystems");
+	app.add_option(
+		"--sim-memory-size", sim_config.memory_size,
+		"Size of each simulated process's memory");
+	app.add_option(
+		"--sim-failing-devices", sim_config.failing_device_count,
+		"Number of simulated devices that fail every request");
+	app.add_flag(
+		"--sim-no-walk-directory", sim_no_walk_directory,
+		"Simulate devices that don't support WALK_DIRECTORY");
+#endif
+
 	try {
 		app.parse(argc, argv);
 	} catch(const CLI::ParseError &e) {
@@ -444,20 +768,30 @@ int main(int argc, char *argv[]) {
 	}
 
 	LogMessage(Message, "starting twibd");
-	daemon::Daemon daemon;
+	daemon::Daemon daemon(daemon_config);
 	g_Daemon = &daemon;
 	g_Running = true;
+
+	if(!capture_path.empty() && !daemon.StartCapture(capture_path.c_str())) {
+		return 1;
+	}
+
+#if TWIBD_SIMULATED_BACKEND_ENABLED == 1
+	sim_config.latency = std::chrono::microseconds(sim_latency);
+	sim_config.walk_directory = !sim_no_walk_directory;
+	daemon.StartSimulatedDevices(sim_config);
+#endif
 	
 	std::vector<std::shared_ptr<daemon::frontend::Frontend>> frontends;
 	if(!systemd_mode) {
 #if TWIB_TCP_FRONTEND_ENABLED == 1
 		if(tcp_frontend_enabled) {
-			frontends.push_back(daemon::CreateTCPFrontend(daemon, tcp_frontend_port));
+			frontends.push_back(daemon::CreateTCPFrontend(daemon, tcp_frontend_port, frontend_threads));
 		}
 #endif
 #if TWIB_UNIX_FRONTEND_ENABLED == 1
 		if(unix_frontend_enabled) {
-			frontends.push_back(daemon::CreateUNIXFrontend(daemon, unix_frontend_path));
+			frontends.push_back(daemon::CreateUNIXFrontend(daemon, unix_frontend_path, frontend_threads));
 		}
 #endif
 #if TWIB_NAMED_PIPE_FRONTEND_ENABLED == 1
@@ -476,7 +810,7 @@ int main(int argc, char *argv[]) {
 			LogMessage(Info, "got %d sockets from systemd", num_fds);
 			for(int fd = SD_LISTEN_FDS_START; fd < SD_LISTEN_FDS_START + num_fds; fd++) {
 				if(sd_is_socket(fd, 0, SOCK_STREAM, 1) == 1) {
-					frontends.push_back(std::make_shared<daemon::frontend::SocketFrontend>(daemon, platform::Socket(fd)));
+					frontends.push_back(std::make_shared<daemon::frontend::SocketFrontend>(daemon, platform::Socket(fd), frontend_threads));
 				} else {
 					LogMessage(Warning, "got an FD from systemd that wasn't a SOCK_STREAM: %d", fd);
 				}
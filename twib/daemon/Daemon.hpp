@@ -27,12 +27,14 @@
 #include<mutex>
 #include<variant>
 #include<map>
+#include<set>
 #include<random>
 #include<condition_variable>
 
 #include "common/blockingconcurrentqueue.h"
 #include "common/config.hpp"
 #include "common/Logger.hpp"
+#include "common/Capture.hpp"
 
 #if TWIBD_TCP_BACKEND_ENABLED
 #include "TCPBackend.hpp"
@@ -43,11 +45,15 @@
 #if TWIBD_LIBUSBK_BACKEND_ENABLED
 #include "USBKBackend.hpp"
 #endif
+#if TWIBD_SIMULATED_BACKEND_ENABLED
+#include "SimulatedBackend.hpp"
+#endif
 
 #include "Messages.hpp"
 #include "Device.hpp"
 #include "LocalClient.hpp"
 #include "InitialScanLock.hpp"
+#include "DeviceLog.hpp"
 
 namespace twili {
 namespace twib {
@@ -55,7 +61,17 @@ namespace daemon {
 
 class Daemon {
  public:
-	Daemon();
+	struct Config {
+		DeviceLog::Config device_log;
+#if TWIBD_TCP_BACKEND_ENABLED
+		backend::TCPBackend::Config tcp;
+#endif
+#if TWIBD_LIBUSB_BACKEND_ENABLED
+		backend::USBBackend::Config usb;
+#endif
+	};
+	
+	Daemon(const Config &config);
 	~Daemon();
 
 	void AddDevice(std::shared_ptr<Device> device);
@@ -65,16 +81,50 @@ class Daemon {
 	void PostResponse(Response &&response);
 	void RemoveDevice(std::shared_ptr<Device> device);
 	void RemoveClient(std::shared_ptr<Client> client);
+	// Queues a close request for an object. Closes are sent to each device
+	// in batches from the dispatch thread.
+	void CloseObject(uint32_t device_id, uint32_t object_id);
+	bool StartCapture(const char *path);
+	// Records lines a device wrote over its stdio interface and passes them
+	// along to any clients that are following that device's log.
+	void AppendDeviceLog(uint32_t device_id, std::vector<std::string> &&lines);
 	
 	void Process();
 	Response HandleRequest(Request &request);
 	std::shared_ptr<Client> GetClient(uint32_t client_id);
+#if TWIBD_SIMULATED_BACKEND_ENABLED
+	void StartSimulatedDevices(const backend::SimulatedBackend::Config &config);
+#endif
 
 	std::shared_ptr<LocalClient> local_client;
 
 	InitialScanLock initial_scan_lock;
  private:
+	void DispatchRequest(Request &rq);
+	// from_backend says whether the payload was already captured as a backend response
+	void DeliverResponse(Response &rs, std::shared_ptr<Client> client, bool from_backend);
+	void FlushObjectCloses();
+	void SendObjectCloses(uint32_t device_id, const std::vector<uint32_t> &object_ids);
+	void ReadDeviceLog(Request &rq);
+	Response RespondWithDeviceLog(WeakRequest &rq, DeviceLog &log, uint64_t sequence);
+	
 	moodycamel::BlockingConcurrentQueue<std::variant<std::monostate, Request, Response>> dispatch_queue;
+
+	std::mutex close_mutex;
+	std::map<uint32_t, std::vector<uint32_t>> pending_closes;
+	std::set<uint32_t> devices_without_batch_close;
+
+	struct DeviceLogReader {
+		WeakRequest request;
+		uint32_t device_id;
+		uint64_t sequence;
+	};
+	
+	std::mutex device_log_mutex;
+	DeviceLog::Config device_log_config;
+	std::map<uint32_t, std::unique_ptr<DeviceLog>> device_logs;
+	// READ_DEVICE_LOG requests waiting for new lines
+	std::list<DeviceLogReader> device_log_readers;
 	
 	std::mutex device_map_mutex;
 	std::map<uint32_t, std::weak_ptr<Device>> devices;
@@ -84,6 +134,9 @@ class Daemon {
 
 	std::random_device rng;
 
+	// declared before the backends so that it outlives their threads
+	std::unique_ptr<common::CaptureWriter> capture;
+
 #if TWIBD_TCP_BACKEND_ENABLED
 	backend::TCPBackend tcp;
 #endif
@@ -93,6 +146,9 @@ class Daemon {
 #if TWIBD_LIBUSBK_BACKEND_ENABLED
 	backend::USBKBackend usbk;
 #endif
+#if TWIBD_SIMULATED_BACKEND_ENABLED
+	backend::SimulatedBackend simulated;
+#endif
 };
 
 } // namespace daemon
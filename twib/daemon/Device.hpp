@@ -32,7 +32,7 @@ namespace daemon {
 
 class Device {
  public:
-	virtual void SendRequest(const Request &&r) = 0;
+	virtual void SendRequest(Request &&r) = 0;
 	virtual int GetPriority() = 0;
 	virtual std::string GetBridgeType() = 0;
 	
@@ -0,0 +1,172 @@
+//
+// Twili - Homebrew debug monitor for the Nintendo Switch
+// Copyright (C) 2019 misson20000 <xenotoad@xenotoad.net>
+//
+// This file is part of Twili.
+//
+// Twili is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Twili is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Twili.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "DeviceLog.hpp"
+
+#include<string.h>
+#include<errno.h>
+
+#include "common/Logger.hpp"
+
+namespace twili {
+namespace twib {
+namespace daemon {
+
+DeviceLog::DeviceLog(uint32_t device_id, const Config &config) :
+	device_id(device_id),
+	config(config) {
+	if(!config.directory.empty()) {
+		OpenFile();
+	}
+}
+
+DeviceLog::~DeviceLog() {
+	if(file) {
+		fclose(file);
+	}
+}
+
+void DeviceLog::Append(std::string &&line) {
+	if(file) {
+		Persist(line);
+	}
+	
+	size+= line.size();
+	lines.emplace_back(std::move(line));
+	while(size > config.capacity && lines.size() > 1) {
+		size-= lines.front().size();
+		lines.pop_front();
+		begin_sequence++;
+	}
+}
+
+uint64_t DeviceLog::Read(uint64_t sequence, size_t max_size, std::vector<std::string> &out, uint64_t &dropped) {
+	dropped = 0;
+	if(sequence < begin_sequence) {
+		dropped = begin_sequence - sequence;
+		sequence = begin_sequence;
+	}
+
+	size_t copied = 0;
+	for(auto i = lines.begin() + std::min<uint64_t>(sequence - begin_sequence, lines.size()); i != lines.end(); i++) {
+		// always make progress, even if a single line is over the limit
+		if(copied > 0 && copied + i->size() > max_size) {
+			break;
+		}
+		copied+= i->size();
+		out.push_back(*i);
+		sequence++;
+	}
+	return std::min(sequence, GetEndSequence());
+}
+
+uint64_t DeviceLog::GetEndSequence() {
+	return begin_sequence + lines.size();
+}
+
+void DeviceLog::SplitLines(util::Buffer &buffer, std::vector<std::string> &lines, size_t max_line) {
+	while(buffer.ReadAvailable() > 0) {
+		const char *begin = (const char*) buffer.Read();
+		size_t available = buffer.ReadAvailable();
+		// memchr is vectorized by every libc we care about, which makes this
+		// much faster than checking each byte ourselves
+		const char *newline = (const char*) memchr(begin, '\n', available);
+		size_t length;
+		size_t consumed;
+		if(newline != nullptr) {
+			length = newline - begin;
+			consumed = length + 1;
+		} else if(available >= max_line) {
+			length = available;
+			consumed = available;
+		} else {
+			break;
+		}
+		if(length > 0 && begin[length - 1] == '\r') {
+			length--;
+		}
+		lines.emplace_back(begin, length);
+		buffer.MarkRead(consumed);
+	}
+}
+
+void DeviceLog::Persist(const std::string &line) {
+	if(file_written + line.size() + 1 > config.file_size && file_written > 0) {
+		RotateFiles();
+		if(!file) {
+			return;
+		}
+	}
+	if(fwrite(line.data(), 1, line.size(), file) != line.size() || fputc('\n', file) == EOF) {
+		LogMessage(Error, "failed to write log for device %08x: %s", device_id, strerror(errno));
+		fclose(file);
+		file = nullptr;
+		return;
+	}
+	file_written+= line.size() + 1;
+}
+
+void DeviceLog::Flush() {
+	if(file && fflush(file) != 0) {
+		LogMessage(Error, "failed to flush log for device %08x: %s", device_id, strerror(errno));
+	}
+}
+
+void DeviceLog::OpenFile() {
+	std::string path = FilePath(0);
+	file = fopen(path.c_str(), "ab");
+	if(!file) {
+		LogMessage(Error, "failed to open %s: %s", path.c_str(), strerror(errno));
+		return;
+	}
+	fseek(file, 0, SEEK_END);
+	long position = ftell(file);
+	file_written = position > 0 ? position : 0;
+}
+
+void DeviceLog::RotateFiles() {
+	fclose(file);
+	file = nullptr;
+	
+	if(config.file_count > 1) {
+		remove(FilePath(config.file_count - 1).c_str());
+		for(size_t i = config.file_count - 1; i > 0; i--) {
+			rename(FilePath(i - 1).c_str(), FilePath(i).c_str());
+		}
+	} else {
+		remove(FilePath(0).c_str());
+	}
+	
+	OpenFile();
+}
+
+std::string DeviceLog::FilePath(size_t index) {
+	char id[9];
+	snprintf(id, sizeof(id), "%08x", device_id);
+	std::string path = config.directory + "/" + id + ".log";
+	if(index > 0) {
+		path+= "." + std::to_string(index);
+	}
+	return path;
+}
+
+} // namespace daemon
+} // namespace twib
+} // namespace twili
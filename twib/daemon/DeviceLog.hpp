@@ -0,0 +1,89 @@
+//
+// Twili - Homebrew debug monitor for the Nintendo Switch
+// Copyright (C) 2019 misson20000 <xenotoad@xenotoad.net>
+//
+// This file is part of Twili.
+//
+// Twili is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Twili is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Twili.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#pragma once
+
+#include<deque>
+#include<string>
+#include<vector>
+
+#include<stdio.h>
+#include<stdint.h>
+
+#include "Buffer.hpp"
+
+namespace twili {
+namespace twib {
+namespace daemon {
+
+// Bounded in-memory record of the lines a device has written over its stdio
+// interface, optionally persisted to a set of rotating files on disk. Every
+// line is assigned a sequence number so that readers can pick up where they
+// left off. Not thread-safe; the Daemon serializes access.
+class DeviceLog {
+ public:
+	struct Config {
+		size_t capacity = 1024 * 1024; // bytes of lines to keep in memory
+		std::string directory; // where to persist logs, or empty to not persist them
+		size_t file_size = 4 * 1024 * 1024; // bytes per file before rotating
+		size_t file_count = 4; // files to keep, including the current one
+	};
+	
+	DeviceLog(uint32_t device_id, const Config &config);
+	~DeviceLog();
+
+	// Lines are written to disk as they're appended, but only flushed on
+	// rotation or by Flush, which should be called once a batch is done.
+	void Append(std::string &&line);
+	void Flush();
+	
+	// Copies out lines starting at sequence number `sequence`, stopping once
+	// `max_size` bytes have been copied. `dropped` is set to how many lines
+	// after `sequence` have already fallen out of the ring. Returns the
+	// sequence number to continue reading from.
+	uint64_t Read(uint64_t sequence, size_t max_size, std::vector<std::string> &out, uint64_t &dropped);
+	// Sequence number that the next appended line will be assigned.
+	uint64_t GetEndSequence();
+
+	// Moves every complete line in `buffer` onto the end of `lines`. If the
+	// buffer fills up past `max_line` bytes without a newline, the partial
+	// line is split off anyway so that a misbehaving device can't make it
+	// grow without bound.
+	static void SplitLines(util::Buffer &buffer, std::vector<std::string> &lines, size_t max_line = 0x10000);
+ private:
+	void Persist(const std::string &line);
+	void OpenFile();
+	void RotateFiles();
+	std::string FilePath(size_t index);
+
+	uint32_t device_id;
+	Config config;
+	
+	std::deque<std::string> lines;
+	uint64_t begin_sequence = 0; // sequence number of lines.front()
+	size_t size = 0;
+
+	FILE *file = nullptr;
+	size_t file_written = 0;
+};
+
+} // namespace daemon
+} // namespace twib
+} // namespace twili
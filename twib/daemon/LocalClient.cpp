@@ -30,27 +30,33 @@ LocalClient::LocalClient(Daemon &daemon) : daemon(daemon) {
 }
 
 std::future<Response> LocalClient::SendRequest(Request rq) {
-	std::future<Response> future;
-	{
-		std::lock_guard<std::mutex> lock(response_map_mutex);
-		static std::random_device rng;
-		
-		uint32_t tag = rng();
-		rq.tag = tag;
-		rq.client = shared_from_this();
-		
-		std::promise<Response> promise;
-		future = promise.get_future();
-		response_map[tag] = std::move(promise);
-	}
+	std::shared_ptr<std::promise<Response>> promise = std::make_shared<std::promise<Response>>();
+	std::future<Response> future = promise->get_future();
 
-	daemon.PostRequest(std::move(rq));
+	daemon.PostRequest(
+		PrepareRequest(
+			std::move(rq),
+			[promise](Response r) {
+				promise->set_value(std::move(r));
+			}));
 	
 	return future;
 }
 
+Request LocalClient::PrepareRequest(Request rq, std::function<void(Response)> &&callback) {
+	std::lock_guard<std::mutex> lock(response_map_mutex);
+	static std::random_device rng;
+	
+	uint32_t tag = rng();
+	rq.tag = tag;
+	rq.client = shared_from_this();
+	
+	response_map[tag] = std::move(callback);
+	return rq;
+}
+
 void LocalClient::PostResponse(Response &r) {
-	std::promise<Response> promise;
+	std::function<void(Response)> callback;
 	{
 		std::lock_guard<std::mutex> lock(response_map_mutex);
 		auto it = response_map.find(r.tag);
@@ -58,10 +64,10 @@ void LocalClient::PostResponse(Response &r) {
 			LogMessage(Warning, "dropping response for unknown tag 0x%x", r.tag);
 			return;
 		}
-		promise.swap(it->second);
+		callback = std::move(it->second);
 		response_map.erase(it);
 	}
-	promise.set_value(r);
+	callback(std::move(r));
 }
 
 } // namespace daemon
@@ -21,6 +21,7 @@
 #pragma once
 
 #include<future>
+#include<functional>
 #include<map>
 #include<mutex>
 #include<memory>
@@ -38,11 +39,15 @@ class LocalClient : public daemon::Client {
 	LocalClient(Daemon &daemon);
 
 	std::future<Response> SendRequest(Request rq);
+	// Assigns the request a tag and registers a callback for its response,
+	// which will be invoked on the dispatch thread. The caller is
+	// responsible for dispatching the returned request.
+	Request PrepareRequest(Request rq, std::function<void(Response)> &&callback);
 	virtual void PostResponse(Response &r);
 
 	Daemon &daemon;
 
-	std::map<uint32_t, std::promise<Response>> response_map;
+	std::map<uint32_t, std::function<void(Response)>> response_map;
 	std::mutex response_map_mutex;
 };
 
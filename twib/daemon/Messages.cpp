@@ -24,12 +24,58 @@ namespace twili {
 namespace twib {
 namespace daemon {
 
+Payload::Payload() {
+}
+
+Payload::Payload(std::vector<uint8_t> &&data) :
+	buffer(std::make_shared<std::vector<uint8_t>>(std::move(data))) {
+}
+
+Payload::Payload(size_t size) :
+	buffer(std::make_shared<std::vector<uint8_t>>(size)) {
+}
+
+Payload Payload::Share() const {
+	Payload other;
+	other.buffer = buffer;
+	return other;
+}
+
+const std::vector<uint8_t> &Payload::GetVector() const {
+	static const std::vector<uint8_t> empty;
+	return buffer ? *buffer : empty;
+}
+
+std::shared_ptr<const std::vector<uint8_t>> Payload::GetShared() const {
+	return buffer;
+}
+
+size_t Payload::size() const {
+	return GetVector().size();
+}
+
+const uint8_t *Payload::data() const {
+	return GetVector().data();
+}
+
+uint8_t *Payload::data() {
+	return buffer ? buffer->data() : nullptr;
+}
+
+std::vector<uint8_t>::const_iterator Payload::begin() const {
+	return GetVector().begin();
+}
+
+std::vector<uint8_t>::const_iterator Payload::end() const {
+	return GetVector().end();
+}
+
 Response::Response() {
 }
 
-Response::Response(uint32_t client_id, uint32_t device_id, uint32_t object_id, uint32_t result_code, uint32_t tag, std::vector<uint8_t> payload) :
+Response::Response(uint32_t client_id, uint32_t device_id, uint32_t object_id, uint32_t result_code, uint32_t tag, Payload payload) :
 	client_id(client_id), device_id(device_id), object_id(object_id),
-	result_code(result_code), tag(tag), payload(payload) {
+	result_code(result_code), tag(tag), payload(std::move(payload)) {
 }
 
 Response::Response(uint32_t client_id, uint32_t device_id, uint32_t object_id, uint32_t result_code, uint32_t tag) :
@@ -40,9 +86,9 @@ Response::Response(uint32_t client_id, uint32_t device_id, uint32_t object_id, u
 WeakRequest::WeakRequest() {
 }
 
-WeakRequest::WeakRequest(uint32_t client_id, uint32_t device_id, uint32_t object_id, uint32_t command_id, uint32_t tag, std::vector<uint8_t> payload) :
+WeakRequest::WeakRequest(uint32_t client_id, uint32_t device_id, uint32_t object_id, uint32_t command_id, uint32_t tag, Payload payload) :
 	client_id(client_id), device_id(device_id), object_id(object_id),
-	command_id(command_id), tag(tag), payload(payload) {
+	command_id(command_id), tag(tag), payload(std::move(payload)) {
 }
 
 WeakRequest::WeakRequest(uint32_t client_id, uint32_t device_id, uint32_t object_id, uint32_t command_id, uint32_t tag) :
@@ -51,7 +97,7 @@ WeakRequest::WeakRequest(uint32_t client_id, uint32_t device_id, uint32_t object
 }
 
 Response WeakRequest::RespondError(uint32_t code) {
-	return Response(client_id, device_id, object_id, code, tag, std::vector<uint8_t>());
+	return Response(client_id, device_id, object_id, code, tag);
 }
 
 Response WeakRequest::RespondOk() {
@@ -61,9 +107,9 @@ Response WeakRequest::RespondOk() {
 Request::Request() {
 }
 
-Request::Request(std::shared_ptr<Client> client, uint32_t device_id, uint32_t object_id, uint32_t command_id, uint32_t tag, std::vector<uint8_t> payload) :
+Request::Request(std::shared_ptr<Client> client, uint32_t device_id, uint32_t object_id, uint32_t command_id, uint32_t tag, Payload payload) :
 	client(client), device_id(device_id), object_id(object_id),
-	command_id(command_id), tag(tag), payload(payload) {
+	command_id(command_id), tag(tag), payload(std::move(payload)) {
 }
 
 Request::Request(std::shared_ptr<Client> client, uint32_t device_id, uint32_t object_id, uint32_t command_id, uint32_t tag) :
@@ -72,7 +118,7 @@ Request::Request(std::shared_ptr<Client> client, uint32_t device_id, uint32_t ob
 }
 
 Response Request::RespondError(uint32_t code) {
-	return Response(client->client_id, device_id, object_id, code, tag, std::vector<uint8_t>());
+	return Response(client->client_id, device_id, object_id, code, tag);
 }
 
 Response Request::RespondOk() {
@@ -80,7 +126,7 @@ Response Request::RespondOk() {
 }
 
 WeakRequest Request::Weak() const {
-	return WeakRequest(client ? client->client_id : 0xffffffff, device_id, object_id, command_id, tag, payload);
+	return WeakRequest(client ? client->client_id : 0xffffffff, device_id, object_id, command_id, tag);
 }
 
 } // namespace daemon
@@ -22,6 +22,7 @@
 
 #include<vector>
 #include<memory>
+#include<mutex>
 
 #include<stdint.h>
 
@@ -31,10 +32,42 @@ namespace twili {
 namespace twib {
 namespace daemon {
 
+// Reference-counted, move-only message payload. Payloads are handed from the
+// frontend's receive buffer through the Daemon to the backend's transfer
+// buffer without copying the bytes. Copying is deliberately disabled; use
+// Share() when a second read-only reference is really needed.
+class Payload {
+ public:
+	Payload();
+	Payload(std::vector<uint8_t> &&data);
+	explicit Payload(size_t size);
+
+	Payload(Payload &&other) = default;
+	Payload &operator=(Payload &&other) = default;
+	Payload(const Payload &other) = delete;
+	Payload &operator=(const Payload &other) = delete;
+
+	// Returns another reference to the same bytes. Holders of shared
+	// references must not write through data().
+	Payload Share() const;
+
+	const std::vector<uint8_t> &GetVector() const;
+	// another reference to the bytes, for sending them without copying;
+	// null if there are none
+	std::shared_ptr<const std::vector<uint8_t>> GetShared() const;
+	size_t size() const;
+	const uint8_t *data() const;
+	uint8_t *data();
+	std::vector<uint8_t>::const_iterator begin() const;
+	std::vector<uint8_t>::const_iterator end() const;
+ private:
+	std::shared_ptr<std::vector<uint8_t>> buffer;
+};
+
 class Response {
  public:
 	Response();
-	Response(uint32_t client_id, uint32_t device_id, uint32_t object_id, uint32_t result_code, uint32_t tag, std::vector<uint8_t> payload);
+	Response(uint32_t client_id, uint32_t device_id, uint32_t object_id, uint32_t result_code, uint32_t tag, Payload payload);
 	Response(uint32_t client_id, uint32_t device_id, uint32_t object_id, uint32_t result_code, uint32_t tag);
 	
 	uint32_t client_id;
@@ -42,7 +75,7 @@ class Response {
 	uint32_t object_id;
 	uint32_t result_code;
 	uint32_t tag;
-	std::vector<uint8_t> payload;
+	Payload payload;
 	std::vector<std::shared_ptr<BridgeObject>> objects;
 };
 
@@ -51,13 +84,15 @@ class Client : public std::enable_shared_from_this<Client> {
 	uint32_t client_id;
 	bool deletion_flag = false;
 	virtual void PostResponse(Response &r) = 0;
+	// responses can be delivered from several threads at once
+	std::mutex owned_objects_mutex;
 	std::vector<std::shared_ptr<BridgeObject>> owned_objects;
 };
 
 class WeakRequest {
  public:
 	WeakRequest();
-	WeakRequest(uint32_t client, uint32_t device_id, uint32_t object_id, uint32_t command_id, uint32_t tag, std::vector<uint8_t> payload);
+	WeakRequest(uint32_t client, uint32_t device_id, uint32_t object_id, uint32_t command_id, uint32_t tag, Payload payload);
 	WeakRequest(uint32_t client, uint32_t device_id, uint32_t object_id, uint32_t command_id, uint32_t tag);
 	Response RespondError(uint32_t code);
 	Response RespondOk();
@@ -67,17 +102,19 @@ class WeakRequest {
 	uint32_t object_id;
 	uint32_t command_id;
 	uint32_t tag;
-	std::vector<uint8_t> payload;
+	Payload payload;
  private:
 };
 
 class Request {
  public:
 	Request();
-	Request(std::shared_ptr<Client> client, uint32_t device_id, uint32_t object_id, uint32_t command_id, uint32_t tag, std::vector<uint8_t> payload);
+	Request(std::shared_ptr<Client> client, uint32_t device_id, uint32_t object_id, uint32_t command_id, uint32_t tag, Payload payload);
 	Request(std::shared_ptr<Client> client, uint32_t device_id, uint32_t object_id, uint32_t command_id, uint32_t tag);
 	Response RespondError(uint32_t code);
 	Response RespondOk();
+	// Does not carry the payload; backends that need it should move it
+	// out of the request themselves.
 	WeakRequest Weak() const;
 	
 	std::shared_ptr<Client> client;
@@ -85,7 +122,7 @@ class Request {
 	uint32_t object_id;
 	uint32_t command_id;
 	uint32_t tag;
-	std::vector<uint8_t> payload;
+	Payload payload;
  private:
 };
 
@@ -66,7 +66,7 @@ void NamedPipeFrontend::Client::PostResponse(Response &r) {
 			return object->object_id;
 		});
 
-	connection.SendMessage(mh, r.payload, object_ids);
+	connection.SendMessage(mh, r.payload.GetShared(), object_ids);
 }
 
 NamedPipeFrontend::Logic::Logic(NamedPipeFrontend &frontend) : frontend(frontend) {
@@ -89,7 +89,7 @@ void NamedPipeFrontend::Logic::Prepare(platform::EventLoop &loop) {
 					rq->mh.object_id,
 					rq->mh.command_id,
 					rq->mh.tag,
-					std::vector<uint8_t>(rq->payload.Read(), rq->payload.Read() + rq->payload.ReadAvailable())));
+					rq->payload.TakeData()));
 			LogMessage(Debug, "posted request");
 		}
 
@@ -0,0 +1,1202 @@
+//
+// Twili - Homebrew debug monitor for the Nintendo Switch
+// Copyright (C) 2019 misson20000 <xenotoad@xenotoad.net>
+//
+// This file is part of Twili.
+//
+// Twili is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Twili is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Twili.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include "SimulatedBackend.hpp"
+
+#include<stdio.h>
+#include<string.h>
+#include<errno.h>
+#include<dirent.h>
+#include<unistd.h>
+#include<sys/types.h>
+#include<sys/stat.h>
+
+#include<msgpack11.hpp>
+
+#include "common/ResultError.hpp"
+#include "PageHash.hpp"
+#include "Hash.hpp"
+#include "PatternSearch.hpp"
+#include "util.hpp"
+#include "Daemon.hpp"
+#include "err.hpp"
+
+namespace twili {
+namespace twib {
+namespace daemon {
+namespace backend {
+
+namespace {
+
+const uint64_t SIM_MEMORY_BASE = 0x7100000000;
+const uint64_t SIM_THREAD_ID = 0x100;
+const char *SIM_PIPE_NAME = "sim-stream";
+const size_t SIM_PIPE_CHUNK_SIZE = 0x4000;
+// largest READ twili will answer, and the chunk size for streamed reads
+const size_t SIM_FILE_READ_LIMIT = 0x40000;
+// most WALK_DIRECTORY will pack into one response before giving up, like twili
+const size_t SIM_WALK_LIMIT = 0x400000;
+
+// results the real console would pass through from the kernel and fs
+const uint32_t KERNEL_ERR_INVALID_MEMORY_STATE = 0xd401;
+const uint32_t KERNEL_ERR_NO_DEBUG_EVENTS = 0x8c01;
+const uint32_t FS_ERR_PATH_NOT_FOUND = 0x202;
+const uint32_t FS_ERR_PATH_ALREADY_EXISTS = 0x402;
+
+struct SimulatedProcess {
+	uint64_t process_id;
+	uint64_t title_id;
+	const char *name;
+};
+
+const SimulatedProcess SIM_PROCESSES[] = {
+	{0x81, 0x0100000000001000, "simapplet"},
+	{0x82, 0x01006a800016e000, "simapp"},
+};
+
+// these mirror the layouts that the console sends
+
+struct ProcessReport {
+	uint64_t process_id;
+	uint32_t result;
+	uint64_t title_id;
+	char process_name[12];
+	uint32_t mmu_flags;
+};
+
+struct DirectoryEntry {
+	char path[0x301];
+	uint8_t attributes;
+	uint32_t entry_type;
+	uint64_t file_size;
+};
+
+struct MemoryInfo {
+	uint64_t base_addr;
+	uint64_t size;
+	uint32_t memory_type;
+	uint32_t memory_attribute;
+	uint32_t permission;
+	uint32_t device_ref_count;
+	uint32_t ipc_ref_count;
+	uint32_t padding;
+};
+
+struct DebugEventInfo {
+	uint32_t event_type;
+	uint32_t flags;
+	uint64_t thread_id;
+	union {
+		struct {
+			uint64_t title_id;
+			uint64_t process_id;
+			char process_name[12];
+			uint32_t mmu_flags;
+			uint64_t user_exception_context_addr;
+		} attach_process;
+		struct {
+			uint64_t thread_id;
+			uint64_t tls_pointer;
+			uint64_t entrypoint;
+		} attach_thread;
+		struct {
+			uint32_t exception_type;
+			uint64_t fault_register;
+		} exception;
+		uint8_t padding[0x80];
+	};
+};
+
+struct ThreadContext {
+	uint64_t regs[100];
+};
+
+struct LoadedModuleInfo {
+	uint8_t build_id[0x20];
+	uint64_t base_addr;
+	uint64_t size;
+};
+
+template<typename T>
+T ReadIn(util::Buffer &in) {
+	T value;
+	if(!in.Read<T>(value)) {
+		throw ResultError(TWILI_ERR_PROTOCOL_BAD_REQUEST);
+	}
+	return value;
+}
+
+std::string ReadString(util::Buffer &in) {
+	uint64_t size = ReadIn<uint64_t>(in);
+	std::string str;
+	if(!in.Read(str, size)) {
+		throw ResultError(TWILI_ERR_PROTOCOL_BAD_REQUEST);
+	}
+	return str;
+}
+
+std::vector<uint8_t> ReadBytes(util::Buffer &in) {
+	uint64_t size = ReadIn<uint64_t>(in);
+	if(in.ReadAvailable() < size) {
+		throw ResultError(TWILI_ERR_PROTOCOL_BAD_REQUEST);
+	}
+	std::vector<uint8_t> bytes(in.Read(), in.Read() + size);
+	in.MarkRead(size);
+	return bytes;
+}
+
+template<typename T>
+std::vector<T> ReadVector(util::Buffer &in) {
+	uint64_t count = ReadIn<uint64_t>(in);
+	if(in.ReadAvailable() / sizeof(T) < count) {
+		throw ResultError(TWILI_ERR_PROTOCOL_BAD_REQUEST);
+	}
+	std::vector<T> vec(count);
+	in.Read(vec);
+	return vec;
+}
+
+template<typename T>
+void WriteVector(util::Buffer &out, const std::vector<T> &vec) {
+	out.Write<uint64_t>(vec.size());
+	out.Write(vec);
+}
+
+void WriteString(util::Buffer &out, std::string str) {
+	out.Write<uint64_t>(str.size());
+	out.Write(str);
+}
+
+void WriteMsgPack(util::Buffer &out, const msgpack11::MsgPack &pack) {
+	WriteString(out, pack.dump());
+}
+
+// copies as much of `source` as fits into a fixed-size name field, leaving
+// room for the terminator
+template<size_t N>
+void CopyName(char (&field)[N], const char *source) {
+	size_t length = strnlen(source, N - 1);
+	memcpy(field, source, length);
+	field[length] = 0;
+}
+
+[[noreturn]] void ThrowErrno() {
+	switch(errno) {
+	case ENOENT:
+		throw ResultError(FS_ERR_PATH_NOT_FOUND);
+	case EEXIST:
+	case ENOTEMPTY:
+		throw ResultError(FS_ERR_PATH_ALREADY_EXISTS);
+	default:
+		throw ResultError(TWILI_ERR_IO_ERROR);
+	}
+}
+
+const SimulatedProcess &FindProcess(uint64_t pid) {
+	for(const SimulatedProcess &proc : SIM_PROCESSES) {
+		if(proc.process_id == pid) {
+			return proc;
+		}
+	}
+	throw ResultError(TWILI_ERR_UNRECOGNIZED_PID);
+}
+
+std::vector<std::string> ListDirectory(const std::string &path) {
+	DIR *dir = opendir(path.c_str());
+	if(dir == nullptr) {
+		ThrowErrno();
+	}
+	std::vector<std::string> names;
+	struct dirent *ent;
+	while((ent = readdir(dir)) != nullptr) {
+		if(!strcmp(ent->d_name, ".") || !strcmp(ent->d_name, "..")) {
+			continue;
+		}
+		names.push_back(ent->d_name);
+	}
+	closedir(dir);
+	return names;
+}
+
+void RemoveRecursively(const std::string &path) {
+	for(std::string &name : ListDirectory(path)) {
+		std::string child = path + "/" + name;
+		struct stat st;
+		if(lstat(child.c_str(), &st) != 0) {
+			ThrowErrno();
+		}
+		if(S_ISDIR(st.st_mode)) {
+			RemoveRecursively(child);
+		} else if(unlink(child.c_str()) != 0) {
+			ThrowErrno();
+		}
+	}
+	if(rmdir(path.c_str()) != 0) {
+		ThrowErrno();
+	}
+}
+
+// packs entries the way ITwibFilesystemAccessor's WALK_DIRECTORY does,
+// skipping subdirectories that can't be read. Sets truncated and stops once
+// the next entry wouldn't fit in SIM_WALK_LIMIT.
+void WalkDirectory(const std::string &path, const std::string &relative, uint32_t depth, uint32_t max_depth, const std::string &pattern, std::vector<uint8_t> &packed, bool &truncated) {
+	std::vector<std::string> names;
+	try {
+		names = ListDirectory(relative.empty() ? path : path + "/" + relative);
+	} catch(ResultError&) {
+		if(relative.empty()) {
+			throw;
+		}
+		return;
+	}
+	for(std::string &name : names) {
+		if(truncated) {
+			return;
+		}
+		std::string entry_path = relative.empty() ? name : relative + "/" + name;
+		struct stat st;
+		// lstat, so symlinks can't send us around in circles
+		if(lstat((path + "/" + entry_path).c_str(), &st) != 0) {
+			continue;
+		}
+		if(util::GlobMatch(pattern.c_str(), name.c_str())) {
+			protocol::ITwibFilesystemAccessor::WalkEntry we;
+			if(packed.size() + sizeof(we) + entry_path.size() > SIM_WALK_LIMIT) {
+				truncated = true;
+				return;
+			}
+			we.file_size = S_ISDIR(st.st_mode) ? 0 : st.st_size;
+			we.entry_type = S_ISDIR(st.st_mode) ? 0 : 1;
+			we.path_size = entry_path.size();
+			packed.insert(packed.end(), (uint8_t*) &we, (uint8_t*) (&we + 1));
+			packed.insert(packed.end(), entry_path.begin(), entry_path.end());
+		}
+		if(S_ISDIR(st.st_mode) && (max_depth == 0 || depth < max_depth)) {
+			WalkDirectory(path, entry_path, depth + 1, max_depth, pattern, packed, truncated);
+		}
+	}
+}
+
+class SimulatedPipeReader : public SimulatedBackend::Object {
+ public:
+	virtual bool Dispatch(SimulatedBackend::Device &device, uint32_t command_id, util::Buffer &in, util::Buffer &out, Response &r) override {
+		switch((protocol::ITwibPipeReader::Command) command_id) {
+		case protocol::ITwibPipeReader::Command::READ: {
+			// an endless stream of counter bytes
+			std::vector<uint8_t> chunk(SIM_PIPE_CHUNK_SIZE);
+			for(uint8_t &byte : chunk) {
+				byte = (uint8_t) position++;
+			}
+			WriteVector(out, chunk);
+			return true; }
+		default:
+			throw ResultError(TWILI_ERR_PROTOCOL_UNRECOGNIZED_FUNCTION);
+		}
+	}
+ private:
+	uint64_t position = 0;
+};
+
+class SimulatedFileAccessor : public SimulatedBackend::Object {
+ public:
+	SimulatedFileAccessor(FILE *file) : file(file) {
+	}
+
+	virtual ~SimulatedFileAccessor() override {
+		fclose(file);
+	}
+	
+	virtual bool Dispatch(SimulatedBackend::Device &device, uint32_t command_id, util::Buffer &in, util::Buffer &out, Response &r) override {
+		switch((protocol::ITwibFileAccessor::Command) command_id) {
+		case protocol::ITwibFileAccessor::Command::READ: {
+			uint64_t offset = ReadIn<uint64_t>(in);
+			uint64_t size = ReadIn<uint64_t>(in);
+			std::vector<uint8_t> data(std::min<uint64_t>(size, SIM_FILE_READ_LIMIT));
+			if(fseeko(file, offset, SEEK_SET) != 0) {
+				ThrowErrno();
+			}
+			data.resize(fread(data.data(), 1, data.size(), file));
+			if(ferror(file)) {
+				clearerr(file);
+				throw ResultError(TWILI_ERR_IO_ERROR);
+			}
+			WriteVector(out, data);
+			return true; }
+		case protocol::ITwibFileAccessor::Command::READ_STREAM: {
+			uint64_t offset = ReadIn<uint64_t>(in);
+			uint64_t size = ReadIn<uint64_t>(in);
+			struct stat st;
+			if(fflush(file) != 0 || fstat(fileno(file), &st) != 0) {
+				ThrowErrno();
+			}
+			if(offset > (uint64_t) st.st_size) {
+				size = 0;
+			} else if(size > st.st_size - offset) {
+				size = st.st_size - offset;
+			}
+			out.Write<uint64_t>(size);
+			std::vector<uint8_t> buffer(std::min<uint64_t>(size, SIM_FILE_READ_LIMIT));
+			uint32_t result = 0;
+			if(fseeko(file, offset, SEEK_SET) != 0) {
+				result = TWILI_ERR_IO_ERROR;
+			}
+			for(uint64_t done = 0; done < size; ) {
+				size_t chunk_size = std::min<uint64_t>(buffer.size(), size - done);
+				size_t actual_size = 0;
+				if(result == 0) {
+					actual_size = fread(buffer.data(), 1, chunk_size, file);
+					if(actual_size < chunk_size) {
+						clearerr(file);
+						result = TWILI_ERR_IO_ERROR;
+					}
+				}
+				// the size is already promised, so pad out the rest after an error
+				std::fill(buffer.begin() + actual_size, buffer.begin() + chunk_size, 0);
+				out.Write(buffer.data(), chunk_size);
+				done+= chunk_size;
+			}
+			out.Write<uint32_t>(result);
+			return true; }
+		case protocol::ITwibFileAccessor::Command::HASH: {
+			uint32_t algorithm = ReadIn<uint32_t>(in);
+			uint64_t offset = ReadIn<uint64_t>(in);
+			uint64_t size = ReadIn<uint64_t>(in);
+			uint64_t block_size = ReadIn<uint64_t>(in);
+			if(algorithm > (uint32_t) util::HashAlgorithm::Sha256) {
+				throw ResultError(TWILI_ERR_PROTOCOL_BAD_REQUEST);
+			}
+			struct stat st;
+			if(fflush(file) != 0 || fstat(fileno(file), &st) != 0) {
+				ThrowErrno();
+			}
+			if(offset > (uint64_t) st.st_size) {
+				size = 0;
+			} else if(size > st.st_size - offset) {
+				size = st.st_size - offset;
+			}
+			if(block_size != 0 && (block_size < 0x1000 || size / block_size >= 0x10000)) {
+				throw ResultError(TWILI_ERR_PROTOCOL_BAD_REQUEST);
+			}
+			if(fseeko(file, offset, SEEK_SET) != 0) {
+				ThrowErrno();
+			}
+			util::BlockHasher hasher((util::HashAlgorithm) algorithm, block_size);
+			std::vector<uint8_t> buffer(SIM_FILE_READ_LIMIT);
+			for(uint64_t done = 0; done < size; ) {
+				size_t r = fread(buffer.data(), 1, std::min<uint64_t>(buffer.size(), size - done), file);
+				if(r == 0) {
+					clearerr(file);
+					throw ResultError(TWILI_ERR_IO_ERROR);
+				}
+				hasher.Update(buffer.data(), r);
+				done+= r;
+			}
+			WriteVector(out, hasher.Finish());
+			return true; }
+		case protocol::ITwibFileAccessor::Command::WRITE: {
+			uint64_t offset = ReadIn<uint64_t>(in);
+			std::vector<uint8_t> data = ReadBytes(in);
+			if(fseeko(file, offset, SEEK_SET) != 0) {
+				ThrowErrno();
+			}
+			if(fwrite(data.data(), 1, data.size(), file) != data.size()) {
+				clearerr(file);
+				throw ResultError(TWILI_ERR_IO_ERROR);
+			}
+			return true; }
+		case protocol::ITwibFileAccessor::Command::FLUSH:
+			if(fflush(file) != 0) {
+				ThrowErrno();
+			}
+			return true;
+		case protocol::ITwibFileAccessor::Command::SET_SIZE: {
+			uint64_t size = ReadIn<uint64_t>(in);
+			if(fflush(file) != 0 || ftruncate(fileno(file), size) != 0) {
+				ThrowErrno();
+			}
+			return true; }
+		case protocol::ITwibFileAccessor::Command::GET_SIZE: {
+			struct stat st;
+			if(fflush(file) != 0 || fstat(fileno(file), &st) != 0) {
+				ThrowErrno();
+			}
+			out.Write<uint64_t>(st.st_size);
+			return true; }
+		default:
+			throw ResultError(TWILI_ERR_PROTOCOL_UNRECOGNIZED_FUNCTION);
+		}
+	}
+ private:
+	FILE *file;
+};
+
+class SimulatedDirectoryAccessor : public SimulatedBackend::Object {
+ public:
+	SimulatedDirectoryAccessor(std::vector<DirectoryEntry> &&entries) : entries(std::move(entries)) {
+	}
+
+	virtual bool Dispatch(SimulatedBackend::Device &device, uint32_t command_id, util::Buffer &in, util::Buffer &out, Response &r) override {
+		switch((protocol::ITwibDirectoryAccessor::Command) command_id) {
+		case protocol::ITwibDirectoryAccessor::Command::READ: {
+			// the console hands out at most 32 entries per read
+			size_t count = std::min(entries.size() - position, (size_t) 32);
+			std::vector<DirectoryEntry> batch(entries.begin() + position, entries.begin() + position + count);
+			position+= count;
+			WriteVector(out, batch);
+			return true; }
+		case protocol::ITwibDirectoryAccessor::Command::GET_ENTRY_COUNT:
+			out.Write<uint64_t>(entries.size());
+			return true;
+		default:
+			throw ResultError(TWILI_ERR_PROTOCOL_UNRECOGNIZED_FUNCTION);
+		}
+	}
+ private:
+	std::vector<DirectoryEntry> entries;
+	size_t position = 0;
+};
+
+class SimulatedFilesystemAccessor : public SimulatedBackend::Object {
+ public:
+	SimulatedFilesystemAccessor(std::string root) : root(root) {
+	}
+
+	virtual bool Dispatch(SimulatedBackend::Device &device, uint32_t command_id, util::Buffer &in, util::Buffer &out, Response &r) override {
+		switch((protocol::ITwibFilesystemAccessor::Command) command_id) {
+		case protocol::ITwibFilesystemAccessor::Command::CREATE_FILE: {
+			ReadIn<uint32_t>(in); // mode
+			uint64_t size = ReadIn<uint64_t>(in);
+			std::string path = Resolve(ReadString(in));
+			struct stat st;
+			if(stat(path.c_str(), &st) == 0) {
+				throw ResultError(FS_ERR_PATH_ALREADY_EXISTS);
+			}
+			FILE *file = fopen(path.c_str(), "wb");
+			if(file == nullptr) {
+				ThrowErrno();
+			}
+			int ret = ftruncate(fileno(file), size);
+			fclose(file);
+			if(ret != 0) {
+				ThrowErrno();
+			}
+			return true; }
+		case protocol::ITwibFilesystemAccessor::Command::DELETE_FILE:
+			if(unlink(Resolve(ReadString(in)).c_str()) != 0) {
+				ThrowErrno();
+			}
+			return true;
+		case protocol::ITwibFilesystemAccessor::Command::CREATE_DIRECTORY:
+			if(mkdir(Resolve(ReadString(in)).c_str(), 0777) != 0) {
+				ThrowErrno();
+			}
+			return true;
+		case protocol::ITwibFilesystemAccessor::Command::DELETE_DIRECTORY:
+			if(rmdir(Resolve(ReadString(in)).c_str()) != 0) {
+				ThrowErrno();
+			}
+			return true;
+		case protocol::ITwibFilesystemAccessor::Command::DELETE_DIRECTORY_RECURSIVELY:
+			RemoveRecursively(Resolve(ReadString(in)));
+			return true;
+		case protocol::ITwibFilesystemAccessor::Command::RENAME_FILE:
+		case protocol::ITwibFilesystemAccessor::Command::RENAME_DIRECTORY: {
+			std::string src = Resolve(ReadString(in));
+			std::string dst = Resolve(ReadString(in));
+			if(rename(src.c_str(), dst.c_str()) != 0) {
+				ThrowErrno();
+			}
+			return true; }
+		case protocol::ITwibFilesystemAccessor::Command::GET_ENTRY_TYPE: {
+			struct stat st;
+			if(stat(Resolve(ReadString(in)).c_str(), &st) != 0) {
+				ThrowErrno();
+			}
+			out.Write<uint32_t>(S_ISDIR(st.st_mode) ? 0 : 1);
+			return true; }
+		case protocol::ITwibFilesystemAccessor::Command::OPEN_FILE: {
+			uint32_t mode = ReadIn<uint32_t>(in);
+			std::string path = Resolve(ReadString(in));
+			FILE *file = fopen(path.c_str(), (mode & 2) ? "r+b" : "rb");
+			if(file == nullptr) {
+				ThrowErrno();
+			}
+			device.RespondObject(r, out, std::make_shared<SimulatedFileAccessor>(file));
+			return true; }
+		case protocol::ITwibFilesystemAccessor::Command::OPEN_DIRECTORY: {
+			std::string path = Resolve(ReadString(in));
+			std::vector<DirectoryEntry> entries;
+			for(std::string &name : ListDirectory(path)) {
+				struct stat st;
+				if(stat((path + "/" + name).c_str(), &st) != 0) {
+					continue;
+				}
+				DirectoryEntry entry;
+				memset(&entry, 0, sizeof(entry));
+				CopyName(entry.path, name.c_str());
+				entry.entry_type = S_ISDIR(st.st_mode) ? 0 : 1;
+				entry.file_size = S_ISDIR(st.st_mode) ? 0 : st.st_size;
+				entries.push_back(entry);
+			}
+			device.RespondObject(r, out, std::make_shared<SimulatedDirectoryAccessor>(std::move(entries)));
+			return true; }
+		case protocol::ITwibFilesystemAccessor::Command::WALK_DIRECTORY: {
+			if(!device.backend.config.walk_directory) {
+				throw ResultError(TWILI_ERR_PROTOCOL_UNRECOGNIZED_FUNCTION);
+			}
+			std::string path = Resolve(ReadString(in));
+			uint32_t max_depth = ReadIn<uint32_t>(in);
+			std::string pattern = ReadString(in);
+			std::vector<uint8_t> packed;
+			bool truncated = false;
+			WalkDirectory(path, "", 1, max_depth, pattern, packed, truncated);
+			WriteVector(out, packed);
+			out.Write<uint8_t>(truncated);
+			return true; }
+		default:
+			throw ResultError(TWILI_ERR_PROTOCOL_UNRECOGNIZED_FUNCTION);
+		}
+	}
+ private:
+	// keeps requests from escaping the filesystem's directory
+	std::string Resolve(const std::string &path) {
+		size_t begin = 0;
+		while(begin <= path.size()) {
+			size_t end = path.find('/', begin);
+			if(end == std::string::npos) {
+				end = path.size();
+			}
+			if(path.compare(begin, end - begin, "..") == 0) {
+				throw ResultError(FS_ERR_PATH_NOT_FOUND);
+			}
+			begin = end + 1;
+		}
+		return root + (path.empty() || path[0] != '/' ? "/" : "") + path;
+	}
+	
+	std::string root;
+};
+
+// The simulated process never runs, so its memory only changes through
+// WRITE_MEMORY. Holding READ until that happens would stall the device's
+// request queue, so instead each READ is answered at the next sample time
+// with whatever changed, which may be nothing. The device keeps serving other
+// requests in the meantime.
+class SimulatedMemoryWatch : public SimulatedBackend::Object, public std::enable_shared_from_this<SimulatedMemoryWatch> {
+ public:
+	SimulatedMemoryWatch(std::vector<uint8_t> &memory, std::vector<protocol::ITwibMemoryWatch::Range> ranges, uint64_t interval_ns) :
+		memory(memory),
+		ranges(ranges),
+		last_contents(ranges.size()),
+		interval(interval_ns),
+		next_sample(std::chrono::steady_clock::now()) {
+	}
+
+	virtual bool Dispatch(SimulatedBackend::Device &device, uint32_t command_id, util::Buffer &in, util::Buffer &out, Response &r) override {
+		switch((protocol::ITwibMemoryWatch::Command) command_id) {
+		case protocol::ITwibMemoryWatch::Command::READ:
+			if(waiting) {
+				throw ResultError(TWILI_ERR_ALREADY_WAITING);
+			}
+			if(std::chrono::steady_clock::now() < next_sample) {
+				waiting.emplace(std::move(r));
+				device.WakeAt(next_sample, weak_from_this());
+				return false;
+			}
+			Sample(out);
+			return true;
+		default:
+			throw ResultError(TWILI_ERR_PROTOCOL_UNRECOGNIZED_FUNCTION);
+		}
+	}
+
+	virtual void Wake(SimulatedBackend::Device &device) override {
+		if(!waiting) {
+			return;
+		}
+		util::Buffer out;
+		Sample(out);
+		waiting->payload = out.TakeData();
+		device.SendDeferredResponse(std::move(*waiting));
+		waiting.reset();
+	}
+ private:
+	void Sample(util::Buffer &out) {
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		next_sample = std::max(next_sample + interval, now);
+		
+		// system ticks run at 19.2 MHz
+		uint64_t timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch()).count() * 24 / 1250;
+		std::vector<protocol::ITwibMemoryWatch::Change> changes;
+		std::vector<uint8_t> data;
+		for(size_t i = 0; i < ranges.size(); i++) {
+			uint64_t address = ranges[i].address;
+			uint64_t size = ranges[i].size;
+			if(address < SIM_MEMORY_BASE || address - SIM_MEMORY_BASE > memory.size() || size > memory.size() - (address - SIM_MEMORY_BASE)) {
+				continue; // unmapped
+			}
+			std::vector<uint8_t> contents(
+				memory.begin() + (address - SIM_MEMORY_BASE),
+				memory.begin() + (address - SIM_MEMORY_BASE + size));
+			if(last_contents[i] && *last_contents[i] == contents) {
+				continue;
+			}
+			changes.push_back({timestamp, address, size});
+			data.insert(data.end(), contents.begin(), contents.end());
+			last_contents[i] = std::move(contents);
+		}
+		WriteVector(out, changes);
+		WriteVector(out, data);
+		out.Write<uint64_t>(0); // dropped
+	}
+	
+	std::vector<uint8_t> &memory;
+	std::vector<protocol::ITwibMemoryWatch::Range> ranges;
+	std::vector<std::optional<std::vector<uint8_t>>> last_contents;
+	std::chrono::nanoseconds interval;
+	std::chrono::steady_clock::time_point next_sample;
+	std::optional<Response> waiting;
+};
+
+class SimulatedDebugger : public SimulatedBackend::Object {
+ public:
+	SimulatedDebugger(const SimulatedProcess &process, std::vector<uint8_t> &memory) :
+		memory(memory) {
+		memset(&context, 0, sizeof(context));
+		context.regs[31] = SIM_MEMORY_BASE + memory.size(); // sp
+		context.regs[32] = SIM_MEMORY_BASE; // pc
+
+		// the kernel reports these when a debugger attaches
+		DebugEventInfo event;
+		memset(&event, 0, sizeof(event));
+		event.event_type = 0; // AttachProcess
+		event.attach_process.title_id = process.title_id;
+		event.attach_process.process_id = process.process_id;
+		CopyName(event.attach_process.process_name, process.name);
+		events.push_back(event);
+
+		memset(&event, 0, sizeof(event));
+		event.event_type = 1; // AttachThread
+		event.thread_id = SIM_THREAD_ID;
+		event.attach_thread.thread_id = SIM_THREAD_ID;
+		event.attach_thread.entrypoint = SIM_MEMORY_BASE;
+		events.push_back(event);
+
+		PushException(4); // DebuggerAttached
+	}
+
+	virtual bool Dispatch(SimulatedBackend::Device &device, uint32_t command_id, util::Buffer &in, util::Buffer &out, Response &r) override {
+		switch((protocol::ITwibDebugger::Command) command_id) {
+		case protocol::ITwibDebugger::Command::QUERY_MEMORY: {
+			out.Write(Query(ReadIn<uint64_t>(in)));
+			out.Write<uint32_t>(0); // page info
+			return true; }
+		case protocol::ITwibDebugger::Command::CREATE_MEMORY_WATCH: {
+			uint64_t interval_ns = ReadIn<uint64_t>(in);
+			std::vector<protocol::ITwibMemoryWatch::Range> ranges = ReadVector<protocol::ITwibMemoryWatch::Range>(in);
+			if(ranges.empty() || interval_ns < 1000000) {
+				throw ResultError(TWILI_ERR_PROTOCOL_BAD_REQUEST);
+			}
+			device.RespondObject(r, out, std::make_shared<SimulatedMemoryWatch>(memory, ranges, interval_ns));
+			return true; }
+		case protocol::ITwibDebugger::Command::QUERY_MEMORY_MAP: {
+			std::vector<MemoryInfo> regions;
+			uint64_t addr = 0;
+			do {
+				regions.push_back(Query(addr));
+				addr = regions.back().base_addr + regions.back().size;
+			} while(addr > 0);
+			WriteVector(out, regions);
+			return true; }
+		case protocol::ITwibDebugger::Command::READ_MEMORY: {
+			uint64_t addr = ReadIn<uint64_t>(in);
+			uint64_t size = ReadIn<uint64_t>(in);
+			uint8_t *data = Translate(addr, size);
+			out.Write<uint64_t>(size);
+			out.Write(data, size);
+			return true; }
+		case protocol::ITwibDebugger::Command::WRITE_MEMORY: {
+			uint64_t addr = ReadIn<uint64_t>(in);
+			std::vector<uint8_t> data = ReadBytes(in);
+			std::copy(data.begin(), data.end(), Translate(addr, data.size()));
+			return true; }
+		case protocol::ITwibDebugger::Command::GET_DEBUG_EVENT: {
+			if(events.empty()) {
+				throw ResultError(KERNEL_ERR_NO_DEBUG_EVENTS);
+			}
+			out.Write(events.front());
+			events.pop_front();
+			return true; }
+		case protocol::ITwibDebugger::Command::GET_DEBUG_EVENTS: {
+			std::vector<DebugEventInfo> drained;
+			while(!events.empty() && drained.size() < 256) {
+				drained.push_back(events.front());
+				events.pop_front();
+			}
+			WriteVector(out, drained);
+			return true; }
+		case protocol::ITwibDebugger::Command::GET_THREAD_CONTEXT: {
+			if(ReadIn<uint64_t>(in) != SIM_THREAD_ID) {
+				throw ResultError(TWILI_ERR_PROTOCOL_BAD_REQUEST);
+			}
+			out.Write(context);
+			return true; }
+		case protocol::ITwibDebugger::Command::SET_THREAD_CONTEXT: {
+			if(ReadIn<uint64_t>(in) != SIM_THREAD_ID) {
+				throw ResultError(TWILI_ERR_PROTOCOL_BAD_REQUEST);
+			}
+			ReadIn<uint32_t>(in); // flags
+			context = ReadIn<ThreadContext>(in);
+			return true; }
+		case protocol::ITwibDebugger::Command::BREAK_PROCESS:
+			PushException(7); // DebuggerBreak
+			if(waiting) {
+				device.SendDeferredResponse(std::move(*waiting));
+				waiting.reset();
+			}
+			return true;
+		case protocol::ITwibDebugger::Command::CONTINUE_DEBUG_EVENT:
+		case protocol::ITwibDebugger::Command::LAUNCH_DEBUG_PROCESS:
+			return true;
+		case protocol::ITwibDebugger::Command::WAIT_EVENT:
+			if(waiting) {
+				throw ResultError(TWILI_ERR_ALREADY_WAITING);
+			}
+			if(events.empty()) {
+				// respond once there is an event to report
+				waiting.emplace(std::move(r));
+				return false;
+			}
+			return true;
+		case protocol::ITwibDebugger::Command::GET_TARGET_ENTRY:
+			out.Write<uint64_t>(SIM_MEMORY_BASE);
+			return true;
+		case protocol::ITwibDebugger::Command::GET_NSO_INFOS: {
+			LoadedModuleInfo info;
+			memset(&info, 0, sizeof(info));
+			info.base_addr = SIM_MEMORY_BASE;
+			info.size = memory.size();
+			WriteVector(out, std::vector<LoadedModuleInfo> {info});
+			return true; }
+		case protocol::ITwibDebugger::Command::GET_NRO_INFOS:
+			WriteVector(out, std::vector<LoadedModuleInfo>());
+			return true;
+		case protocol::ITwibDebugger::Command::SEARCH_MEMORY: {
+			uint64_t address = ReadIn<uint64_t>(in);
+			uint64_t size = ReadIn<uint64_t>(in);
+			std::vector<uint8_t> pattern = ReadBytes(in);
+			std::vector<uint8_t> mask = ReadBytes(in);
+			uint64_t alignment = ReadIn<uint64_t>(in);
+			uint32_t max_results = ReadIn<uint32_t>(in);
+			util::PatternMatcher matcher(std::move(pattern), std::move(mask), alignment);
+			if(!matcher.IsValid() || address + size < address) {
+				throw ResultError(TWILI_ERR_PROTOCOL_BAD_REQUEST);
+			}
+			if(max_results == 0 || max_results > protocol::ITwibDebugger::SEARCH_MEMORY_MAX_RESULTS) {
+				max_results = protocol::ITwibDebugger::SEARCH_MEMORY_MAX_RESULTS;
+			}
+			
+			// only the one region is mapped, so clamp the search to it
+			std::vector<uint64_t> matches;
+			uint64_t begin = std::max(address, SIM_MEMORY_BASE);
+			uint64_t end = std::min(address + size, SIM_MEMORY_BASE + memory.size());
+			if(begin < end) {
+				matcher.Search(memory.data() + (begin - SIM_MEMORY_BASE), end - begin, end - begin, begin, matches, max_results);
+			}
+			WriteVector(out, matches);
+			return true; }
+		case protocol::ITwibDebugger::Command::HASH_PAGES: {
+			uint64_t address = ReadIn<uint64_t>(in);
+			uint64_t size = ReadIn<uint64_t>(in);
+			const size_t page_size = util::PAGE_HASH_PAGE_SIZE;
+			if(address % page_size != 0 || size % page_size != 0 || address + size < address) {
+				throw ResultError(TWILI_ERR_PROTOCOL_BAD_REQUEST);
+			}
+			size = std::min(size, protocol::ITwibDebugger::HASH_PAGES_MAX_SIZE);
+			std::vector<uint64_t> hashes(size / page_size, util::PAGE_HASH_UNREADABLE);
+			for(size_t i = 0; i < hashes.size(); i++) {
+				uint64_t page = address + i * page_size;
+				if(page >= SIM_MEMORY_BASE && page - SIM_MEMORY_BASE + page_size <= memory.size()) {
+					hashes[i] = util::HashPage(memory.data() + (page - SIM_MEMORY_BASE), page_size);
+				}
+			}
+			WriteVector(out, hashes);
+			return true; }
+		default:
+			throw ResultError(TWILI_ERR_PROTOCOL_UNRECOGNIZED_FUNCTION);
+		}
+	}
+ private:
+	void PushException(uint32_t exception_type) {
+		DebugEventInfo event;
+		memset(&event, 0, sizeof(event));
+		event.event_type = 4; // Exception
+		event.thread_id = SIM_THREAD_ID;
+		event.exception.exception_type = exception_type;
+		events.push_back(event);
+	}
+	
+	MemoryInfo Query(uint64_t addr) {
+		MemoryInfo mi;
+		memset(&mi, 0, sizeof(mi));
+		uint64_t end = SIM_MEMORY_BASE + memory.size();
+		if(addr < SIM_MEMORY_BASE) {
+			mi.base_addr = 0;
+			mi.size = SIM_MEMORY_BASE;
+		} else if(addr < end) {
+			mi.base_addr = SIM_MEMORY_BASE;
+			mi.size = memory.size();
+			mi.memory_type = 5; // heap
+			mi.permission = 3; // rw-
+		} else {
+			// the rest of the address space
+			mi.base_addr = end;
+			mi.size = 0 - end;
+		}
+		return mi;
+	}
+
+	uint8_t *Translate(uint64_t addr, uint64_t size) {
+		if(addr < SIM_MEMORY_BASE ||
+			 addr - SIM_MEMORY_BASE > memory.size() ||
+			 size > memory.size() - (addr - SIM_MEMORY_BASE)) {
+			throw ResultError(KERNEL_ERR_INVALID_MEMORY_STATE);
+		}
+		return memory.data() + (addr - SIM_MEMORY_BASE);
+	}
+	
+	std::vector<uint8_t> &memory;
+	ThreadContext context;
+	std::deque<DebugEventInfo> events;
+	std::optional<Response> waiting;
+};
+
+class SimulatedDeviceInterface : public SimulatedBackend::Object {
+ public:
+	virtual bool Dispatch(SimulatedBackend::Device &device, uint32_t command_id, util::Buffer &in, util::Buffer &out, Response &r) override {
+		switch((protocol::ITwibDeviceInterface::Command) command_id) {
+		case protocol::ITwibDeviceInterface::Command::REBOOT:
+			return true;
+		case protocol::ITwibDeviceInterface::Command::TERMINATE:
+			FindProcess(ReadIn<uint64_t>(in));
+			return true;
+		case protocol::ITwibDeviceInterface::Command::LIST_PROCESSES: {
+			std::vector<ProcessReport> reports;
+			for(const SimulatedProcess &proc : SIM_PROCESSES) {
+				ProcessReport report;
+				memset(&report, 0, sizeof(report));
+				report.process_id = proc.process_id;
+				report.title_id = proc.title_id;
+				CopyName(report.process_name, proc.name);
+				reports.push_back(report);
+			}
+			WriteVector(out, reports);
+			return true; }
+		case protocol::ITwibDeviceInterface::Command::IDENTIFY:
+			WriteMsgPack(out, device.identification);
+			return true;
+		case protocol::ITwibDeviceInterface::Command::LIST_NAMED_PIPES:
+			out.Write<uint64_t>(1);
+			WriteString(out, SIM_PIPE_NAME);
+			return true;
+		case protocol::ITwibDeviceInterface::Command::OPEN_NAMED_PIPE:
+			if(ReadString(in) != SIM_PIPE_NAME) {
+				throw ResultError(TWILI_ERR_NO_SUCH_PIPE);
+			}
+			device.RespondObject(r, out, std::make_shared<SimulatedPipeReader>());
+			return true;
+		case protocol::ITwibDeviceInterface::Command::OPEN_ACTIVE_DEBUGGER: {
+			const SimulatedProcess &proc = FindProcess(ReadIn<uint64_t>(in));
+			device.RespondObject(r, out, std::make_shared<SimulatedDebugger>(proc, device.GetProcessMemory(proc.process_id)));
+			return true; }
+		case protocol::ITwibDeviceInterface::Command::GET_MEMORY_INFO: {
+			msgpack11::MsgPack::array limits;
+			for(int i = 0; i < 3; i++) {
+				limits.push_back(
+					msgpack11::MsgPack::object {
+						{"category", i},
+						{"current_value", (uint64_t) 0x1000000},
+						{"limit_value", (uint64_t) 0x10000000}});
+			}
+			WriteMsgPack(
+				out,
+				msgpack11::MsgPack::object {
+					{"total_memory_available", (uint64_t) 0x4000000},
+					{"total_memory_usage", (uint64_t) 0x1000000},
+					{"limits", limits},
+				});
+			return true; }
+		case protocol::ITwibDeviceInterface::Command::PRINT_DEBUG_INFO:
+			LogMessage(Info, "simulated device %u has nothing to report", device.index);
+			return true;
+		case protocol::ITwibDeviceInterface::Command::OPEN_FILESYSTEM_ACCESSOR: {
+			std::string fs = ReadString(in);
+			std::string root = device.backend.config.filesystem_root + "/" + fs;
+			struct stat st;
+			if(fs.empty() || fs.find('/') != std::string::npos || fs == ".." ||
+				 stat(root.c_str(), &st) != 0 || !S_ISDIR(st.st_mode)) {
+				throw ResultError(TWILI_ERR_UNKNOWN_FILESYSTEM);
+			}
+			device.RespondObject(r, out, std::make_shared<SimulatedFilesystemAccessor>(root));
+			return true; }
+		case protocol::ITwibDeviceInterface::Command::CLOSE_OBJECTS: {
+			uint64_t count = ReadIn<uint64_t>(in);
+			for(uint64_t i = 0; i < count; i++) {
+				device.CloseObject(ReadIn<uint32_t>(in));
+			}
+			return true; }
+		default:
+			throw ResultError(TWILI_ERR_PROTOCOL_UNRECOGNIZED_FUNCTION);
+		}
+	}
+};
+
+} // anonymous namespace
+
+SimulatedBackend::SimulatedBackend(Daemon &daemon) :
+	daemon(daemon) {
+}
+
+SimulatedBackend::~SimulatedBackend() {
+	for(std::shared_ptr<Device> &device : devices) {
+		device->Stop();
+	}
+}
+
+void SimulatedBackend::Start(const Config &config) {
+	this->config = config;
+	for(uint32_t i = 0; i < config.device_count; i++) {
+		std::shared_ptr<Device> device = std::make_shared<Device>(*this, i);
+		devices.push_back(device);
+		device->Begin();
+		daemon.AddDevice(device);
+	}
+}
+
+SimulatedBackend::Object::~Object() {
+}
+
+void SimulatedBackend::Object::Wake(Device &device) {
+}
+
+SimulatedBackend::Device::Device(SimulatedBackend &backend, uint32_t index) :
+	backend(backend),
+	index(index),
+	failing(index + backend.config.failing_device_count >= backend.config.device_count) {
+	char buffer[32];
+	snprintf(buffer, sizeof(buffer), "SIM%08x", index);
+	serial_number = buffer;
+	snprintf(buffer, sizeof(buffer), "sim-%u", index);
+	device_nickname = buffer;
+	device_id = std::hash<std::string>()(serial_number);
+
+	// firmware_version is a SystemVersion structure, with the display
+	// version string at 0x68
+	std::vector<uint8_t> firmware_version(0x100, 0);
+	strcpy((char*) firmware_version.data() + 0x68, "sim");
+	identification = msgpack11::MsgPack::object {
+		{"service", "twili"},
+		{"protocol", protocol::VERSION},
+		{"firmware_version", firmware_version},
+		{"serial_number", serial_number},
+		{"bluetooth_bd_address", std::vector<uint8_t>(6, 0)},
+		{"wireless_lan_mac_address", std::vector<uint8_t>(6, 0)},
+		{"device_nickname", device_nickname},
+		{"mii_author_id", std::vector<uint8_t>(16, 0)},
+	};
+	
+	ResetObjects();
+}
+
+SimulatedBackend::Device::~Device() {
+	Stop();
+}
+
+void SimulatedBackend::Device::Begin() {
+	running = true;
+	thread = std::thread(&Device::Run, this);
+}
+
+void SimulatedBackend::Device::Stop() {
+	{
+		std::lock_guard<std::mutex> lock(queue_mutex);
+		running = false;
+	}
+	queue_cv.notify_one();
+	if(thread.joinable()) {
+		thread.join();
+	}
+}
+
+void SimulatedBackend::Device::SendRequest(Request &&r) {
+	{
+		std::lock_guard<std::mutex> lock(queue_mutex);
+		queue.push_back(std::move(r));
+	}
+	queue_cv.notify_one();
+}
+
+int SimulatedBackend::Device::GetPriority() {
+	return 0; // real devices always win
+}
+
+std::string SimulatedBackend::Device::GetBridgeType() {
+	return "sim";
+}
+
+void SimulatedBackend::Device::RespondObject(Response &r, util::Buffer &out, std::shared_ptr<Object> object) {
+	uint32_t object_id = next_object_id++;
+	objects[object_id] = std::move(object);
+	out.Write<uint32_t>(r.objects.size());
+	r.objects.push_back(std::make_shared<BridgeObject>(backend.daemon, device_id, object_id));
+}
+
+void SimulatedBackend::Device::SendDeferredResponse(Response &&r) {
+	SimulateTransfer(r.payload.size());
+	backend.daemon.PostResponse(std::move(r));
+}
+
+std::vector<uint8_t> &SimulatedBackend::Device::GetProcessMemory(uint64_t pid) {
+	auto i = process_memory.find(pid);
+	if(i != process_memory.end()) {
+		return i->second;
+	}
+
+	// fill with deterministic noise so searches and hashes have something
+	// to work with
+	std::vector<uint8_t> &memory = process_memory[pid];
+	memory.resize(backend.config.memory_size);
+	uint64_t state = pid * 0x9e3779b97f4a7c15 + 1;
+	for(uint8_t &byte : memory) {
+		state^= state << 13;
+		state^= state >> 7;
+		state^= state << 17;
+		byte = (uint8_t) state;
+	}
+	return memory;
+}
+
+void SimulatedBackend::Device::WakeAt(std::chrono::steady_clock::time_point time, std::weak_ptr<Object> object) {
+	wakeups.emplace(time, std::move(object));
+}
+
+void SimulatedBackend::Device::Run() {
+	std::unique_lock<std::mutex> lock(queue_mutex);
+	while(true) {
+		auto ready = [this]() { return !running || !queue.empty(); };
+		if(wakeups.empty()) {
+			queue_cv.wait(lock, ready);
+		} else {
+			queue_cv.wait_until(lock, wakeups.begin()->first, ready);
+		}
+		if(!running) {
+			return;
+		}
+		if(!wakeups.empty() && wakeups.begin()->first <= std::chrono::steady_clock::now()) {
+			std::shared_ptr<Object> object = wakeups.begin()->second.lock();
+			wakeups.erase(wakeups.begin());
+			lock.unlock();
+			if(object) { // unless it has been closed since
+				object->Wake(*this);
+			}
+			lock.lock();
+			continue;
+		}
+		if(queue.empty()) {
+			continue;
+		}
+		Request rq = std::move(queue.front());
+		queue.pop_front();
+		lock.unlock();
+
+		// like the real bridges, a device handles one request at a time
+		SimulateTransfer(rq.payload.size());
+		std::optional<Response> r = Dispatch(rq);
+		if(r) {
+			SendDeferredResponse(std::move(*r));
+		}
+		
+		lock.lock();
+	}
+}
+
+void SimulatedBackend::Device::SimulateTransfer(size_t payload_size) {
+	std::chrono::microseconds delay = backend.config.latency;
+	if(backend.config.bandwidth > 0) {
+		uint64_t size = sizeof(protocol::MessageHeader) + payload_size;
+		delay+= std::chrono::microseconds(size * 1000000 / backend.config.bandwidth);
+	}
+	if(delay.count() > 0) {
+		std::this_thread::sleep_for(delay);
+	}
+}
+
+std::optional<Response> SimulatedBackend::Device::Dispatch(Request &rq) {
+	WeakRequest weak = rq.Weak();
+	if(rq.command_id == 0xffffffff) {
+		if(rq.object_id == 0) {
+			// a fresh twibd is cleaning up after an old one
+			ResetObjects();
+		} else {
+			CloseObject(rq.object_id);
+		}
+		return weak.RespondOk();
+	}
+
+	if(failing) {
+		return weak.RespondError(TWILI_ERR_IO_ERROR);
+	}
+
+	auto i = objects.find(rq.object_id);
+	if(i == objects.end()) {
+		return weak.RespondError(TWILI_ERR_PROTOCOL_UNRECOGNIZED_OBJECT);
+	}
+	std::shared_ptr<Object> object = i->second;
+	
+	Response r = weak.RespondOk();
+	util::Buffer in(rq.payload.GetVector());
+	util::Buffer out;
+	try {
+		if(!object->Dispatch(*this, rq.command_id, in, out, r)) {
+			return std::nullopt;
+		}
+	} catch(ResultError &e) {
+		return weak.RespondError(e.code);
+	}
+	r.payload = out.TakeData();
+	return r;
+}
+
+void SimulatedBackend::Device::CloseObject(uint32_t object_id) {
+	if(object_id != 0) {
+		objects.erase(object_id);
+	}
+}
+
+void SimulatedBackend::Device::ResetObjects() {
+	objects.clear();
+	objects[0] = std::make_shared<SimulatedDeviceInterface>();
+}
+
+} // namespace backend
+} // namespace daemon
+} // namespace twib
+} // namespace twili
@@ -0,0 +1,143 @@
+//
+// Twili - Homebrew debug monitor for the Nintendo Switch
+// Copyright (C) 2019 misson20000 <xenotoad@xenotoad.net>
+//
+// This file is part of Twili.
+//
+// Twili is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Twili is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Twili.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#pragma once
+
+#include<thread>
+#include<list>
+#include<deque>
+#include<map>
+#include<memory>
+#include<optional>
+#include<mutex>
+#include<chrono>
+#include<condition_variable>
+
+#include "Buffer.hpp"
+#include "Device.hpp"
+#include "Messages.hpp"
+#include "Protocol.hpp"
+
+namespace twili {
+namespace twib {
+namespace daemon {
+
+class Daemon;
+
+namespace backend {
+
+// Virtual devices that speak the twili protocol without any hardware, so that
+// twibd, twib, and the gdb stub can be exercised and benchmarked on a plain
+// host. Each device serves ITwibDeviceInterface along with filesystem, file,
+// directory, pipe, and debugger objects backed by host files and synthetic
+// process memory.
+class SimulatedBackend {
+ public:
+	struct Config {
+		uint32_t device_count = 0;
+		// bytes per second in each direction, or 0 for unlimited
+		uint64_t bandwidth = 0;
+		// added once to every request and once to every response
+		std::chrono::microseconds latency = std::chrono::microseconds(0);
+		// each filesystem is a subdirectory of this directory
+		std::string filesystem_root = ".";
+		// size of each simulated process's memory region
+		uint64_t memory_size = 0x100000;
+		// how many of the devices (counting from the last) answer every
+		// request with an error, for testing how clients cope
+		uint32_t failing_device_count = 0;
+		// whether filesystems answer WALK_DIRECTORY, or act like a Twili from
+		// before it and leave clients to open each directory themselves
+		bool walk_directory = true;
+	};
+
+	SimulatedBackend(Daemon &daemon);
+	~SimulatedBackend();
+
+	void Start(const Config &config);
+
+	class Object;
+	
+	class Device : public daemon::Device {
+	 public:
+		Device(SimulatedBackend &backend, uint32_t index);
+		~Device();
+
+		void Begin();
+		void Stop();
+		virtual void SendRequest(Request &&r) override;
+		virtual int GetPriority() override;
+		virtual std::string GetBridgeType() override;
+
+		// adds the object to this device's object table and writes a reference
+		// to it into the response payload
+		void RespondObject(Response &r, util::Buffer &out, std::shared_ptr<Object> object);
+		// for objects that hold on to a response and answer it later
+		void SendDeferredResponse(Response &&r);
+		// calls Wake on the object from the device thread once the time
+		// comes, unless the object has been closed by then
+		void WakeAt(std::chrono::steady_clock::time_point time, std::weak_ptr<Object> object);
+		void CloseObject(uint32_t object_id);
+		std::vector<uint8_t> &GetProcessMemory(uint64_t pid);
+		
+		SimulatedBackend &backend;
+		const uint32_t index;
+		const bool failing;
+	 private:
+		void Run();
+		void SimulateTransfer(size_t payload_size);
+		std::optional<Response> Dispatch(Request &rq);
+		void ResetObjects();
+
+		std::map<uint32_t, std::shared_ptr<Object>> objects;
+		uint32_t next_object_id = 1;
+		std::map<uint64_t, std::vector<uint8_t>> process_memory;
+		// only touched from the device thread
+		std::multimap<std::chrono::steady_clock::time_point, std::weak_ptr<Object>> wakeups;
+		
+		std::mutex queue_mutex;
+		std::condition_variable queue_cv;
+		std::deque<Request> queue;
+		bool running = false;
+		std::thread thread;
+	};
+
+	class Object {
+	 public:
+		virtual ~Object();
+		// Reads arguments from `in` and writes results to `out`. Errors are
+		// reported by throwing ResultError. Returns false if the object took
+		// the response to send later with SendDeferredResponse.
+		virtual bool Dispatch(Device &device, uint32_t command_id, util::Buffer &in, util::Buffer &out, Response &r) = 0;
+		// called for wakeups scheduled with Device::WakeAt
+		virtual void Wake(Device &device);
+	};
+
+	Config config;
+ private:
+	Daemon &daemon;
+	std::list<std::shared_ptr<Device>> devices;
+};
+
+} // namespace backend
+} // namespace daemon
+} // namespace twib
+} // namespace twili
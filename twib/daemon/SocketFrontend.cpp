@@ -36,14 +36,12 @@ namespace twib {
 namespace daemon {
 namespace frontend {
 
-SocketFrontend::SocketFrontend(Daemon &daemon, int address_family, int socktype, struct sockaddr *bind_addr, size_t bind_addrlen) :
+SocketFrontend::SocketFrontend(Daemon &daemon, int address_family, int socktype, struct sockaddr *bind_addr, size_t bind_addrlen, size_t thread_count) :
 	daemon(daemon),
+	server_member(*this, platform::Socket(address_family, socktype, 0)),
 	address_family(address_family),
 	socktype(socktype),
-	bind_addrlen(bind_addrlen),
-	server_member(*this, platform::Socket(address_family, socktype, 0)),
-	server_logic(*this),
-	event_loop(server_logic) {
+	bind_addrlen(bind_addrlen) {
 
 	if(bind_addr == NULL) {
 		LogMessage(Fatal, "failed to allocate bind_addr");
@@ -59,25 +57,39 @@ SocketFrontend::SocketFrontend(Daemon &daemon, int address_family, int socktype,
 	}
 
 	server_member.socket.Bind(bind_addr, bind_addrlen);
-	server_member.socket.Listen(20);
-	event_loop.Begin();
+	// clients tend to connect in bursts, such as a fleet command or a script
+	// with many workers, and unix sockets refuse connections past the backlog
+	// instead of retrying them
+	server_member.socket.Listen(SOMAXCONN);
+	StartWorkers(thread_count);
 }
 
-SocketFrontend::SocketFrontend(Daemon &daemon, platform::Socket &&socket) :
+SocketFrontend::SocketFrontend(Daemon &daemon, platform::Socket &&socket, size_t thread_count) :
 	daemon(daemon),
 	server_member(*this, std::move(socket)),
 	address_family(0),
-	socktype(SOCK_STREAM),
-	server_logic(*this),
-	event_loop(server_logic) {
-	event_loop.Begin();
+	socktype(SOCK_STREAM) {
+	StartWorkers(thread_count);
 }
 
 SocketFrontend::~SocketFrontend() {
-	event_loop.Destroy();
+	workers.clear(); // stops event threads
 	server_member.socket.Close();
 }
 
+void SocketFrontend::StartWorkers(size_t thread_count) {
+	if(thread_count < 1) {
+		thread_count = 1;
+	}
+	for(size_t i = 0; i < thread_count; i++) {
+		workers.emplace_back(std::make_unique<Worker>(*this));
+	}
+	workers[0]->event_loop.Register(server_member);
+	for(auto &worker : workers) {
+		worker->Begin();
+	}
+}
+
 // TODO
 /*
 void SocketFrontend::UnlinkIfUnix() {
@@ -98,11 +110,15 @@ bool SocketFrontend::ServerMember::WantsRead() {
 
 void SocketFrontend::ServerMember::SignalRead() {
 	LogMessage(Debug, "incoming connection detected");
-	
-	platform::Socket client_socket = socket.Accept(nullptr, nullptr);
-	std::shared_ptr<Client> c = std::make_shared<Client>(std::move(client_socket), frontend);
-	frontend.clients.push_back(c);
-	frontend.daemon.AddClient(c);
+
+	// hand the connection to whichever worker has the fewest clients
+	Worker *worker = frontend.workers[0].get();
+	for(auto &w : frontend.workers) {
+		if(w->client_count < worker->client_count) {
+			worker = w.get();
+		}
+	}
+	worker->QueueClient(socket.Accept(nullptr, nullptr));
 }
 
 void SocketFrontend::ServerMember::SignalError() {
@@ -110,53 +126,105 @@ void SocketFrontend::ServerMember::SignalError() {
 	exit(1);
 }
 
-SocketFrontend::ServerLogic::ServerLogic(SocketFrontend &frontend) : frontend(frontend) {
+SocketFrontend::Worker::Worker(SocketFrontend &frontend) :
+	frontend(frontend),
+	client_count(0),
+	logic(*this),
+	event_loop(logic) {
+}
+
+SocketFrontend::Worker::~Worker() {
+	event_loop.Destroy();
+}
+
+void SocketFrontend::Worker::Begin() {
+	event_loop.Begin();
+}
+
+void SocketFrontend::Worker::QueueClient(platform::Socket &&socket) {
+	client_count++;
+	{
+		std::lock_guard<std::mutex> lock(new_sockets_mutex);
+		new_sockets.emplace_back(std::move(socket));
+	}
+	event_loop.GetNotifier().Notify();
+}
+
+void SocketFrontend::Worker::AddClient(platform::Socket &&socket) {
+	std::shared_ptr<Client> c = std::make_shared<Client>(std::move(socket), *this);
+	clients.push_back(c);
+	event_loop.Register(c->connection.member);
+	frontend.daemon.AddClient(c);
+}
+
+void SocketFrontend::Worker::RemoveClient(std::shared_ptr<Client> client) {
+	event_loop.Unregister(client->connection.member);
+	frontend.daemon.RemoveClient(client);
+	clients.remove(client);
+	client_count--;
+}
+
+SocketFrontend::Worker::Logic::Logic(Worker &worker) : worker(worker) {
 }
 
-void SocketFrontend::ServerLogic::Prepare(platform::EventLoop &loop) {
-	loop.Clear();
-	loop.AddMember(frontend.server_member);
-	for(auto i = frontend.clients.begin(); i != frontend.clients.end(); ) {
+void SocketFrontend::Worker::Logic::Prepare(platform::EventLoop &loop) {
+	std::vector<platform::Socket> new_sockets;
+	{ // scope for lock
+		std::lock_guard<std::mutex> lock(worker.new_sockets_mutex);
+		std::swap(new_sockets, worker.new_sockets);
+	}
+	for(auto &socket : new_sockets) {
+		worker.AddClient(std::move(socket));
+	}
+	
+	// Members stay registered between iterations, so we only need to look at
+	// clients that have received input or failed since last time.
+	std::vector<std::shared_ptr<Client>> ready;
+	std::swap(ready, worker.ready_clients);
+	for(auto &c : ready) {
+		c->is_ready = false;
+		
 		common::MessageConnection::Request *rq;
-		while((rq = (*i)->connection.Process()) != nullptr) {
+		while((rq = c->connection.Process()) != nullptr) {
 			LogMessage(Debug, "posting request");
-			frontend.daemon.PostRequest(
+			worker.frontend.daemon.PostRequest(
 				Request(
-					*i,
+					c,
 					rq->mh.device_id,
 					rq->mh.object_id,
 					rq->mh.command_id,
 					rq->mh.tag,
-					std::vector<uint8_t>(rq->payload.Read(), rq->payload.Read() + rq->payload.ReadAvailable())));
+					rq->payload.TakeData()));
 			LogMessage(Debug, "posted request");
 		}
 
-		if((*i)->connection.error_flag) {
-			(*i)->deletion_flag = true;
+		if(c->connection.error_flag) {
+			c->deletion_flag = true;
 		}
 		
-		if((*i)->deletion_flag) {
-			frontend.daemon.RemoveClient(*i);
-			i = frontend.clients.erase(i);
-			continue;
+		if(c->deletion_flag) {
+			worker.RemoveClient(c);
 		}
-
-		loop.AddMember((*i)->connection.member);
-		
-		i++;
 	}
 }
 
-SocketFrontend::Client::Client(platform::Socket &&socket, SocketFrontend &frontend) :
-	connection(std::move(socket), frontend.event_loop.GetNotifier()),
-	frontend(frontend),
-	daemon(frontend.daemon) {
+SocketFrontend::Client::Client(platform::Socket &&socket, Worker &worker) :
+	connection(std::move(socket), worker.event_loop.GetNotifier(), [this]() { MarkReady(); }),
+	worker(worker),
+	daemon(worker.frontend.daemon) {
 }
 
 SocketFrontend::Client::~Client() {
 	LogMessage(Debug, "destroying client 0x%x", client_id);
 }
 
+void SocketFrontend::Client::MarkReady() {
+	if(!is_ready) {
+		is_ready = true;
+		worker.ready_clients.push_back(std::static_pointer_cast<Client>(shared_from_this()));
+	}
+}
+
 void SocketFrontend::Client::PostResponse(Response &r) {
 	protocol::MessageHeader mh;
 	mh.device_id = r.device_id;
@@ -173,7 +241,7 @@ void SocketFrontend::Client::PostResponse(Response &r) {
 			return object->object_id;
 		});
 
-	connection.SendMessage(mh, r.payload, object_ids);
+	connection.SendMessage(mh, r.payload.GetShared(), object_ids);
 }
 
 } // namespace frontend
@@ -26,6 +26,8 @@
 #include<vector>
 #include<thread>
 #include<mutex>
+#include<atomic>
+#include<memory>
 
 #include<stdint.h>
 
@@ -46,20 +48,64 @@ namespace frontend {
 
 class SocketFrontend : public Frontend {
 	public:
-	SocketFrontend(Daemon &daemon, int address_family, int socktype, struct sockaddr *bind_addr, size_t bind_addrlen);
-	SocketFrontend(Daemon &daemon, platform::Socket &&socket);
+	// thread_count is how many event loop threads to spread clients across
+	SocketFrontend(Daemon &daemon, int address_family, int socktype, struct sockaddr *bind_addr, size_t bind_addrlen, size_t thread_count = 1);
+	SocketFrontend(Daemon &daemon, platform::Socket &&socket, size_t thread_count = 1);
 	~SocketFrontend();
 
+	class Worker;
+
 	class Client : public daemon::Client {
 		public:
-		Client(platform::Socket &&socket, SocketFrontend &frontend);
+		Client(platform::Socket &&socket, Worker &worker);
 		~Client();
 
 		virtual void PostResponse(Response &r) override;
 
 		common::SocketMessageConnection connection;
-		SocketFrontend &frontend;
+		Worker &worker;
 		Daemon &daemon;
+		bool is_ready = false; // whether we're in ready_clients
+	 private:
+		void MarkReady();
+	};
+
+	// Each worker services its share of the clients on its own event loop
+	// thread. Responses are written straight into the client's connection,
+	// which wakes up the loop of the worker that owns it.
+	class Worker {
+	 public:
+		Worker(SocketFrontend &frontend);
+		~Worker();
+
+		void Begin();
+		// can be called from any thread
+		void QueueClient(platform::Socket &&socket);
+		
+		SocketFrontend &frontend;
+		std::atomic<size_t> client_count;
+	 private:
+		void AddClient(platform::Socket &&socket);
+		void RemoveClient(std::shared_ptr<Client> client);
+		
+		class Logic : public platform::EventLoop::Logic {
+		 public:
+			Logic(Worker &worker);
+			virtual void Prepare(platform::EventLoop &loop) override;
+		 private:
+			Worker &worker;
+		} logic;
+
+		std::mutex new_sockets_mutex;
+		std::vector<platform::Socket> new_sockets;
+		
+		std::list<std::shared_ptr<Client>> clients;
+		// clients that have received input or failed since the last Prepare
+		std::vector<std::shared_ptr<Client>> ready_clients;
+		platform::EventLoop event_loop;
+
+		friend class Client;
+		friend class SocketFrontend;
 	};
 
  private:
@@ -75,21 +121,14 @@ class SocketFrontend : public Frontend {
 		SocketFrontend &frontend;
 	} server_member;
 
-	class ServerLogic : public platform::EventLoop::Logic {
-	 public:
-		ServerLogic(SocketFrontend &frontend);
-		virtual void Prepare(platform::EventLoop &loop) override;
-	 private:
-		SocketFrontend &frontend;
-	} server_logic;
-
 	int address_family;
 	int socktype;
 	struct sockaddr_storage bind_addr;
 	size_t bind_addrlen;
-	
-	std::list<std::shared_ptr<Client>> clients;
-	platform::EventLoop event_loop;
+
+	void StartWorkers(size_t thread_count);
+	// the server socket is serviced by the first worker
+	std::vector<std::unique_ptr<Worker>> workers;
 };
 
 } // namespace frontend
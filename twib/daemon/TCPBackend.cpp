@@ -20,6 +20,10 @@
 
 #include "TCPBackend.hpp"
 
+#include<algorithm>
+
+#include<string.h>
+
 #include "platform/platform.hpp"
 
 #include "Daemon.hpp"
@@ -29,11 +33,16 @@ namespace twib {
 namespace daemon {
 namespace backend {
 
-TCPBackend::TCPBackend(Daemon &daemon) :
+// JOIN_SESSION goes out from the meta-client with this tag, which Identify
+// doesn't use
+static const uint32_t JOIN_SESSION_TAG = 0xFFFFFFFE;
+
+TCPBackend::TCPBackend(Daemon &daemon, const Config &config) :
 	daemon(daemon),
+	config(config),
+	listen_member(*this, platform::Socket(AF_INET, SOCK_DGRAM, 0)),
 	server_logic(*this),
-	event_loop(server_logic),
-	listen_member(*this, platform::Socket(AF_INET, SOCK_DGRAM, 0)) {
+	event_loop(server_logic) {
 	sockaddr_in addr;
 	memset(&addr, 0, sizeof(addr));
 	addr.sin_family = AF_INET;
@@ -48,10 +57,18 @@ TCPBackend::TCPBackend(Daemon &daemon) :
 		exit(1);
 	}
 
+	event_loop.Register(listen_member);
 	event_loop.Begin();
+	connect_thread = std::thread(&TCPBackend::ConnectThread, this);
 }
 
 TCPBackend::~TCPBackend() {
+	{
+		std::lock_guard<std::mutex> lock(connect_mutex);
+		connect_thread_running = false;
+	}
+	connect_cv.notify_one();
+	connect_thread.join();
 	event_loop.Destroy();
 	listen_member.socket.Close();
 }
@@ -78,8 +95,7 @@ std::string TCPBackend::Connect(std::string hostname, std::string port) {
 		platform::Socket socket(res->ai_family, res->ai_socktype, res->ai_protocol);
 		socket.Connect(res->ai_addr, res->ai_addrlen);
 
-		devices.emplace_back(std::make_shared<Device>(std::move(socket), *this))->Begin();
-		event_loop.GetNotifier().Notify();
+		QueueDevice(std::make_shared<Device>(std::move(socket), res->ai_addr, res->ai_addrlen, *this));
 		return "Ok"; 
 	} catch(platform::NetworkError &e) {
 		return e.what();
@@ -95,17 +111,76 @@ void TCPBackend::Connect(sockaddr *addr, socklen_t addr_len) {
 		platform::Socket socket(addr->sa_family, SOCK_STREAM, IPPROTO_TCP);
 		socket.Connect(addr, addr_len);
 
-		devices.emplace_back(std::make_shared<Device>(std::move(socket), *this))->Begin();
+		QueueDevice(std::make_shared<Device>(std::move(socket), addr, addr_len, *this));
 		LogMessage(Info, "connected to %s", inet_ntoa(addr_in->sin_addr));
-		event_loop.GetNotifier().Notify();
 	} else {
 		LogMessage(Info, "not an IPv4 address");
 	}
 }
 
-TCPBackend::Device::Device(platform::Socket &&socket, TCPBackend &backend) :
+void TCPBackend::QueueDevice(std::shared_ptr<Device> device) {
+	device->Begin();
+	
+	std::lock_guard<std::mutex> lock(new_devices_mutex);
+	new_devices.push_back(device);
+	event_loop.GetNotifier().Notify();
+}
+
+void TCPBackend::QueueExtraLinks(std::shared_ptr<Device> device) {
+	{
+		std::lock_guard<std::mutex> lock(connect_mutex);
+		connect_queue.push_back(device);
+	}
+	connect_cv.notify_one();
+}
+
+void TCPBackend::ConnectThread() {
+	std::unique_lock<std::mutex> lock(connect_mutex);
+	while(true) {
+		connect_cv.wait(lock, [this]() { return !connect_thread_running || !connect_queue.empty(); });
+		if(!connect_thread_running) {
+			return;
+		}
+		std::weak_ptr<Device> weak = connect_queue.front();
+		connect_queue.pop_front();
+		lock.unlock();
+
+		sockaddr_storage addr;
+		socklen_t addr_len = 0;
+		if(std::shared_ptr<Device> device = weak.lock()) {
+			addr = device->addr;
+			addr_len = device->addr_len;
+		}
+		for(size_t i = 1; addr_len > 0 && i < config.connections; i++) {
+			try {
+				platform::Socket socket(addr.ss_family, SOCK_STREAM, IPPROTO_TCP);
+				socket.Connect((sockaddr*) &addr, addr_len);
+
+				std::lock_guard<std::mutex> new_lock(new_devices_mutex);
+				new_links.emplace_back(weak, std::move(socket));
+			} catch(platform::NetworkError &e) {
+				LogMessage(Warning, "failed to open extra connection to device: %s", e.what());
+				break;
+			}
+			event_loop.GetNotifier().Notify();
+		}
+		
+		lock.lock();
+	}
+}
+
+TCPBackend::Device::Link::Link(platform::Socket &&socket, Device &device) :
+	connection(
+		std::move(socket), device.backend.event_loop.GetNotifier(),
+		[&device]() { device.MarkReady(); }) {
+}
+
+TCPBackend::Device::Device(platform::Socket &&socket, const sockaddr *addr, socklen_t addr_len, TCPBackend &backend) :
 	backend(backend),
-	connection(std::move(socket), backend.event_loop.GetNotifier()) {
+	addr_len(addr_len) {
+	memcpy(&this->addr, addr, addr_len);
+	links.emplace_back(std::make_unique<Link>(std::move(socket), *this));
+	links[0]->joined = true;
 }
 
 TCPBackend::Device::~Device() {
@@ -115,15 +190,67 @@ void TCPBackend::Device::Begin() {
 	SendRequest(Request(std::shared_ptr<Client>(), 0x0, 0x0, (uint32_t) protocol::ITwibDeviceInterface::Command::IDENTIFY, 0xFFFFFFFF, std::vector<uint8_t>()));
 }
 
-void TCPBackend::Device::IncomingMessage(protocol::MessageHeader &mh, util::Buffer &payload, util::Buffer &object_ids) {
+void TCPBackend::Device::Process() {
+	for(size_t i = 0; i < links.size(); i++) {
+		if(!links[i]) {
+			continue;
+		}
+		
+		common::MessageConnection::Request *rq;
+		while(!links[i]->failed && (rq = links[i]->connection.Process()) != nullptr) {
+			IncomingMessage(i, rq->mh, rq->payload, rq->object_ids);
+		}
+
+		if(links[i]->connection.error_flag) {
+			if(links[i]->joined) {
+				// we may have lost responses along with this link
+				deletion_flag = true;
+			} else {
+				links[i]->failed = true;
+			}
+		}
+
+		if(links[i]->failed) {
+			backend.event_loop.Unregister(links[i]->connection.member);
+			std::lock_guard<std::mutex> lock(routing_mutex);
+			links[i].reset();
+		}
+	}
+}
+
+void TCPBackend::Device::RegisterLinks() {
+	for(auto &link : links) {
+		if(link) {
+			backend.event_loop.Register(link->connection.member);
+		}
+	}
+}
+
+void TCPBackend::Device::UnregisterLinks() {
+	for(auto &link : links) {
+		if(link) {
+			backend.event_loop.Unregister(link->connection.member);
+		}
+	}
+}
+
+void TCPBackend::Device::MarkReady() {
+	if(!is_ready) {
+		is_ready = true;
+		backend.ready_devices.push_back(shared_from_this());
+	}
+}
+
+void TCPBackend::Device::IncomingMessage(size_t link_index, protocol::MessageHeader &mh, util::Buffer &payload, util::Buffer &object_ids) {
 	response_in.device_id = device_id;
 	response_in.client_id = mh.client_id;
 	response_in.object_id = mh.object_id;
 	response_in.result_code = mh.result_code;
 	response_in.tag = mh.tag;
-	response_in.payload = std::vector<uint8_t>(payload.Read(), payload.Read() + payload.ReadAvailable());
+	response_in.payload = payload.TakeData();
 	
 	// create BridgeObjects
+	std::vector<uint32_t> new_object_ids(mh.object_count);
 	response_in.objects.resize(mh.object_count);
 	for(uint32_t i = 0; i < mh.object_count; i++) {
 		uint32_t id;
@@ -131,15 +258,51 @@ void TCPBackend::Device::IncomingMessage(protocol::MessageHeader &mh, util::Buff
 			LogMessage(Error, "not enough object IDs");
 			return;
 		}
+		new_object_ids[i] = id;
 		response_in.objects[i] = std::make_shared<BridgeObject>(backend.daemon, mh.device_id, id);
 	}
 
-	// remove from pending requests
-	pending_requests.remove_if([this](WeakRequest &r) {
-			return r.tag == response_in.tag;
-		});
+	if(response_in.client_id == 0xFFFFFFFF && response_in.tag == JOIN_SESSION_TAG) {
+		// not a pending request; see AddLink
+		Joined(link_index, response_in);
+		return;
+	}
+
+	{ // scope for lock
+		std::lock_guard<std::mutex> lock(routing_mutex);
+		
+		// remove from pending requests
+		auto i = std::find_if(
+			pending_requests.begin(), pending_requests.end(),
+			[this](PendingRequest &p) {
+				return p.request.client_id == response_in.client_id && p.request.tag == response_in.tag;
+			});
+		if(i != pending_requests.end()) {
+			if(links[i->link_index]) {
+				links[i->link_index]->in_flight--;
+			}
+
+			// remember which objects we can stripe bulk reads on
+			const WeakRequest &rq = i->request;
+			ObjectKind kind = ObjectKind::Other;
+			if(rq.object_id == 0 && rq.command_id == (uint32_t) protocol::ITwibDeviceInterface::Command::OPEN_FILESYSTEM_ACCESSOR) {
+				kind = ObjectKind::FilesystemAccessor;
+			} else if(rq.object_id == 0 && rq.command_id == (uint32_t) protocol::ITwibDeviceInterface::Command::OPEN_ACTIVE_DEBUGGER) {
+				kind = ObjectKind::Debugger;
+			} else if(object_kinds[rq.object_id] == ObjectKind::FilesystemAccessor && rq.command_id == (uint32_t) protocol::ITwibFilesystemAccessor::Command::OPEN_FILE) {
+				kind = ObjectKind::FileAccessor;
+			}
+			if(kind != ObjectKind::Other) {
+				for(uint32_t id : new_object_ids) {
+					object_kinds[id] = kind;
+				}
+			}
+			
+			pending_requests.erase(i);
+		}
+	}
 	
-	if(response_in.client_id == 0xFFFFFFFF) { // identification meta-client
+	if(response_in.client_id == 0xFFFFFFFF) { // meta-client
 		Identified(response_in);
 	} else {
 		backend.daemon.PostResponse(std::move(response_in));
@@ -166,9 +329,110 @@ void TCPBackend::Device::Identified(Response &r) {
 	device_id = std::hash<std::string>()(serial_number);
 	LogMessage(Info, "assigned device id: %08x", device_id);
 	ready_flag = true;
+
+	// older versions of Twili don't give us a session token
+	session_token = obj["session_token"].uint64_value();
+	if(session_token != 0 && backend.config.connections > 1) {
+		backend.QueueExtraLinks(shared_from_this());
+	}
+}
+
+void TCPBackend::Device::AddLink(platform::Socket &&socket) {
+	std::vector<uint8_t> payload(sizeof(session_token));
+	memcpy(payload.data(), &session_token, sizeof(session_token));
+	
+	Link *link;
+	{ // scope for lock
+		std::lock_guard<std::mutex> lock(routing_mutex);
+		links.emplace_back(std::make_unique<Link>(std::move(socket), *this));
+		link = links.back().get();
+	}
+
+	// the link isn't used for requests until the device lets it join
+	protocol::MessageHeader mhdr;
+	mhdr.client_id = 0xffffffff;
+	mhdr.object_id = 0;
+	mhdr.command_id = (uint32_t) protocol::ITwibDeviceInterface::Command::JOIN_SESSION;
+	mhdr.tag = JOIN_SESSION_TAG;
+	mhdr.payload_size = payload.size();
+	mhdr.object_count = 0;
+	link->connection.SendMessage(mhdr, payload, std::vector<uint32_t>());
+	backend.event_loop.Register(link->connection.member);
+}
+
+void TCPBackend::Device::Joined(size_t link_index, Response &r) {
+	std::lock_guard<std::mutex> lock(routing_mutex);
+	if(!links[link_index]) {
+		return;
+	}
+	
+	if(r.result_code != 0) {
+		LogMessage(Warning, "device refused extra connection: 0x%x", r.result_code);
+		links[link_index]->failed = true;
+		return;
+	}
+
+	LogMessage(Debug, "extra connection %zu joined session", link_index);
+	links[link_index]->joined = true;
+}
+
+void TCPBackend::Device::ForgetObjects(const Request &r) {
+	if(r.command_id == 0xffffffff) {
+		object_kinds.erase(r.object_id);
+	} else if(r.object_id == 0 && r.command_id == (uint32_t) protocol::ITwibDeviceInterface::Command::CLOSE_OBJECTS) {
+		const std::vector<uint8_t> &payload = r.payload.GetVector();
+		uint64_t count;
+		if(payload.size() < sizeof(count)) {
+			return;
+		}
+		memcpy(&count, payload.data(), sizeof(count));
+		for(uint64_t i = 0; i < count && sizeof(count) + (i + 1) * sizeof(uint32_t) <= payload.size(); i++) {
+			uint32_t id;
+			memcpy(&id, payload.data() + sizeof(count) + i * sizeof(uint32_t), sizeof(id));
+			object_kinds.erase(id);
+		}
+	}
 }
 
-void TCPBackend::Device::SendRequest(const Request &&r) {
+bool TCPBackend::Device::IsStriped(const Request &r) {
+	// bulk reads don't depend on the order they're serviced in
+	auto i = object_kinds.find(r.object_id);
+	if(i == object_kinds.end()) {
+		return false;
+	}
+	switch(i->second) {
+	case ObjectKind::FileAccessor:
+		return r.command_id == (uint32_t) protocol::ITwibFileAccessor::Command::READ;
+	case ObjectKind::Debugger:
+		return
+			r.command_id == (uint32_t) protocol::ITwibDebugger::Command::READ_MEMORY ||
+			r.command_id == (uint32_t) protocol::ITwibDebugger::Command::HASH_PAGES;
+	default:
+		return false;
+	}
+}
+
+size_t TCPBackend::Device::PickLink(const Request &r, bool striped) {
+	if(!striped) {
+		// keep requests to the same object in order
+		for(auto &p : pending_requests) {
+			if(!p.striped && p.request.object_id == r.object_id && links[p.link_index]) {
+				return p.link_index;
+			}
+		}
+	}
+
+	// otherwise, use whichever link has the least outstanding
+	size_t best = 0;
+	for(size_t i = 1; i < links.size(); i++) {
+		if(links[i] && links[i]->joined && links[i]->in_flight < links[best]->in_flight) {
+			best = i;
+		}
+	}
+	return best;
+}
+
+void TCPBackend::Device::SendRequest(Request &&r) {
 	protocol::MessageHeader mhdr;
 	mhdr.client_id = r.client ? r.client->client_id : 0xffffffff;
 	mhdr.object_id = r.object_id;
@@ -177,7 +441,16 @@ void TCPBackend::Device::SendRequest(const Request &&r) {
 	mhdr.payload_size = r.payload.size();
 	mhdr.object_count = 0;
 
-	pending_requests.push_back(r.Weak());
+	Link *link;
+	{ // scope for lock
+		std::lock_guard<std::mutex> lock(routing_mutex);
+		ForgetObjects(r);
+		bool striped = IsStriped(r);
+		size_t link_index = PickLink(r, striped);
+		link = links[link_index].get();
+		link->in_flight++;
+		pending_requests.push_back(PendingRequest {r.Weak(), link_index, striped});
+	}
 
 	/* TODO: request objects
 	std::vector<uint32_t> object_ids(r.objects.size(), 0);
@@ -187,7 +460,7 @@ void TCPBackend::Device::SendRequest(const Request &&r) {
 			return object->object_id;
 		});
 	connection.out_buffer.Write(object_ids); */
-	connection.SendMessage(mhdr, r.payload, std::vector<uint32_t>());
+	link->connection.SendMessage(mhdr, r.payload.GetShared(), std::vector<uint32_t>());
 }
 
 int TCPBackend::Device::GetPriority() {
@@ -233,34 +506,44 @@ TCPBackend::ServerLogic::ServerLogic(TCPBackend &backend) : backend(backend) {
 }
 
 void TCPBackend::ServerLogic::Prepare(platform::EventLoop &loop) {
-	loop.Clear();
-	loop.AddMember(backend.listen_member);
-	for(auto i = backend.devices.begin(); i != backend.devices.end(); ) {
-		common::MessageConnection::Request *rq;
-		while((rq = (*i)->connection.Process()) != nullptr) {
-			(*i)->IncomingMessage(rq->mh, rq->payload, rq->object_ids);
+	{ // scope for lock
+		std::lock_guard<std::mutex> lock(backend.new_devices_mutex);
+		for(auto &device : backend.new_devices) {
+			device->RegisterLinks();
+			backend.devices.push_back(device);
 		}
+		backend.new_devices.clear();
 
-		if((*i)->connection.error_flag) {
-			(*i)->deletion_flag = true;
+		for(auto &link : backend.new_links) {
+			std::shared_ptr<Device> device = link.first.lock();
+			if(device && !device->deletion_flag) {
+				device->AddLink(std::move(link.second));
+			}
 		}
+		backend.new_links.clear();
+	}
+
+	// Members stay registered between iterations, so we only need to look at
+	// devices that have received input or failed since last time.
+	std::vector<std::shared_ptr<Device>> ready;
+	std::swap(ready, backend.ready_devices);
+	for(auto &device : ready) {
+		device->is_ready = false;
+		device->Process();
 		
-		if((*i)->deletion_flag) {
-			if((*i)->added_flag) {
-				backend.daemon.RemoveDevice(*i);
+		if(device->deletion_flag) {
+			device->UnregisterLinks();
+			if(device->added_flag) {
+				backend.daemon.RemoveDevice(device);
 			}
-			i = backend.devices.erase(i);
+			backend.devices.remove(device);
 			continue;
-		} else {
-			if((*i)->ready_flag && !(*i)->added_flag) {
-				backend.daemon.AddDevice((*i));
-				(*i)->added_flag = true;
-			}
 		}
-
-		loop.AddMember((*i)->connection.member);
 		
-		i++;
+		if(device->ready_flag && !device->added_flag) {
+			backend.daemon.AddDevice(device);
+			device->added_flag = true;
+		}
 	}
 }
 
@@ -24,6 +24,9 @@
 
 #include<thread>
 #include<list>
+#include<map>
+#include<vector>
+#include<memory>
 #include<queue>
 #include<mutex>
 #include<condition_variable>
@@ -45,7 +48,12 @@ namespace backend {
 
 class TCPBackend {
  public:
-	TCPBackend(Daemon &daemon);
+	struct Config {
+		// how many connections to open to each device that supports sessions
+		size_t connections = 4;
+	};
+	
+	TCPBackend(Daemon &daemon, const Config &config);
 	~TCPBackend();
 
 	std::string Connect(std::string hostname, std::string port);
@@ -53,27 +61,97 @@ class TCPBackend {
 	
 	class Device : public daemon::Device, public std::enable_shared_from_this<Device> {
 	 public:
-		Device(platform::Socket &&socket, TCPBackend &backend);
+		Device(platform::Socket &&socket, const sockaddr *addr, socklen_t addr_len, TCPBackend &backend);
 		~Device();
 
 		void Begin();
+		// reads messages from every link
+		void Process();
+		void RegisterLinks();
+		void UnregisterLinks();
+		void MarkReady();
 		void Identified(Response &r);
-		void IncomingMessage(protocol::MessageHeader &mh, util::Buffer &payload, util::Buffer &object_ids);
-		virtual void SendRequest(const Request &&r) override;
+		void Joined(size_t link_index, Response &r);
+		// takes an extra connection opened on the backend's connect thread and
+		// asks the device to let it join the session
+		void AddLink(platform::Socket &&socket);
+		void IncomingMessage(size_t link_index, protocol::MessageHeader &mh, util::Buffer &payload, util::Buffer &object_ids);
+		virtual void SendRequest(Request &&r) override;
 		virtual int GetPriority() override;
 		virtual std::string GetBridgeType() override;
+
+		// One TCP connection to the device. Twili puts every connection in a
+		// session, and connections that have joined the same session share
+		// objects, so requests can go out over any joined link.
+		class Link {
+		 public:
+			Link(platform::Socket &&socket, Device &device);
+
+			common::SocketMessageConnection connection;
+			bool joined = false;
+			bool failed = false;
+			size_t in_flight = 0;
+		};
+
+		enum class ObjectKind {
+			Other,
+			FilesystemAccessor,
+			FileAccessor,
+			Debugger,
+		};
+
+		class PendingRequest {
+		 public:
+			WeakRequest request;
+			size_t link_index;
+			bool striped;
+		};
 		
 		TCPBackend &backend;
-		common::SocketMessageConnection connection;
-		std::list<WeakRequest> pending_requests;
+		sockaddr_storage addr;
+		socklen_t addr_len;
+		// links[0] is the connection that the device was identified over
+		std::vector<std::unique_ptr<Link>> links;
 		Response response_in;
 		bool ready_flag = false;
 		bool added_flag = false;
+		bool is_ready = false; // whether we're in ready_devices
+	 private:
+		void ForgetObjects(const Request &r);
+		bool IsStriped(const Request &r);
+		size_t PickLink(const Request &r, bool striped);
+
+		// SendRequest is called from the daemon's thread, responses come in on
+		// the backend's event loop thread
+		std::mutex routing_mutex;
+		std::list<PendingRequest> pending_requests;
+		std::map<uint32_t, ObjectKind> object_kinds;
+		uint64_t session_token = 0;
 	};
 
  private:
 	Daemon &daemon;
+	const Config config;
 	std::list<std::shared_ptr<Device>> devices;
+	// devices that have received input or failed since the last Prepare
+	std::vector<std::shared_ptr<Device>> ready_devices;
+
+	// devices are connected to from other threads, and get picked up by the
+	// event thread
+	void QueueDevice(std::shared_ptr<Device> device);
+	std::mutex new_devices_mutex;
+	std::list<std::shared_ptr<Device>> new_devices;
+
+	// Extra links are connected on their own thread, so that a device that is
+	// slow to accept them doesn't hold up the event thread. They get picked up
+	// by the event thread like new devices.
+	void QueueExtraLinks(std::shared_ptr<Device> device);
+	void ConnectThread();
+	std::mutex connect_mutex;
+	std::condition_variable connect_cv;
+	std::list<std::weak_ptr<Device>> connect_queue;
+	bool connect_thread_running = true;
+	std::list<std::pair<std::weak_ptr<Device>, platform::Socket>> new_links; // guarded by new_devices_mutex
 
 	class ListenMember : public platform::EventLoop::SocketMember {
 	 public:
@@ -95,6 +173,7 @@ class TCPBackend {
 	} server_logic;
 	
 	platform::EventLoop event_loop;
+	std::thread connect_thread;
 };
 
 } // namespace backend
@@ -22,6 +22,10 @@
 
 #include "common/config.hpp"
 
+#include<algorithm>
+
+#include<string.h>
+
 #include<msgpack11.hpp>
 
 #include "Daemon.hpp"
@@ -56,7 +60,18 @@ USBBackend::LibusbContext::~LibusbContext() {
 	libusb_exit(ctx);
 }
 
-USBBackend::USBBackend(Daemon &daemon) : daemon(daemon), isl_lock(daemon.initial_scan_lock) {
+USBBackend::USBBackend(Daemon &daemon, const Config &config) : daemon(daemon), config(config), isl_lock(daemon.initial_scan_lock) {
+	if(this->config.read_ahead < 1) {
+		this->config.read_ahead = 1;
+	}
+	// a data IN transfer that isn't a whole number of max-size packets
+	// overflows when the device sends a full packet into its tail
+	const size_t packet_size = 512;
+	size_t transfer_size = std::max(this->config.transfer_size - this->config.transfer_size % packet_size, packet_size);
+	if(transfer_size != this->config.transfer_size) {
+		LogMessage(Warning, "USB transfer size must be a nonzero multiple of %zu; using %zu instead of %zu", packet_size, transfer_size, this->config.transfer_size);
+		this->config.transfer_size = transfer_size;
+	}
 	std::thread event_thread(&USBBackend::event_thread_func, this);
 	this->event_thread = std::move(event_thread);
 }
@@ -82,24 +97,31 @@ USBBackend::Device::Device(USBBackend *backend, libusb_device_handle *handle, ui
 	endp_meta_out(endp_addrs[0]), endp_meta_in(endp_addrs[2]),
 	endp_data_out(endp_addrs[1]), endp_data_in(endp_addrs[3]),
 	interface_number(interface_number),
+	tfer_data_in(backend->config.read_ahead),
 	isl_lock(backend->daemon.initial_scan_lock) {
 	
-	tfer_meta_out = libusb_alloc_transfer(0);
-	tfer_data_out = libusb_alloc_transfer(0);
-	tfer_meta_in = libusb_alloc_transfer(0);
-	tfer_data_in = libusb_alloc_transfer(0);
+	tfer_meta_out.tfer = libusb_alloc_transfer(0);
+	tfer_data_out.tfer = libusb_alloc_transfer(0);
+	tfer_meta_in.tfer = libusb_alloc_transfer(0);
+	tfer_object_in.tfer = libusb_alloc_transfer(0);
+	for(Transfer &t : tfer_data_in) {
+		t.tfer = libusb_alloc_transfer(0);
+	}
 }
 
 USBBackend::Device::~Device() {
-	for(auto r : pending_requests) {
+	for(auto &r : pending_requests) {
 		if(r.client_id != 0xffffffff) {
 			backend->daemon.PostResponse(r.RespondError(TWILI_ERR_PROTOCOL_TRANSFER_ERROR));
 		}
 	}
-	libusb_free_transfer(tfer_meta_out);
-	libusb_free_transfer(tfer_data_out);
-	libusb_free_transfer(tfer_meta_in);
-	libusb_free_transfer(tfer_data_in);
+	libusb_free_transfer(tfer_meta_out.tfer);
+	libusb_free_transfer(tfer_data_out.tfer);
+	libusb_free_transfer(tfer_meta_in.tfer);
+	libusb_free_transfer(tfer_object_in.tfer);
+	for(Transfer &t : tfer_data_in) {
+		libusb_free_transfer(t.tfer);
+	}
 	libusb_release_interface(handle, interface_number);
 	libusb_close(handle);
 }
@@ -112,10 +134,13 @@ void USBBackend::Device::Begin() {
 }
 
 void USBBackend::Device::Destroy() {
-	libusb_cancel_transfer(tfer_meta_out);
-	libusb_cancel_transfer(tfer_data_out);
-	libusb_cancel_transfer(tfer_meta_in);
-	libusb_cancel_transfer(tfer_data_in);
+	libusb_cancel_transfer(tfer_meta_out.tfer);
+	libusb_cancel_transfer(tfer_data_out.tfer);
+	libusb_cancel_transfer(tfer_meta_in.tfer);
+	libusb_cancel_transfer(tfer_object_in.tfer);
+	for(Transfer &t : tfer_data_in) {
+		libusb_cancel_transfer(t.tfer);
+	}
 	if(isl_lock) { isl_lock.unlock(); }
 }
 
@@ -126,7 +151,7 @@ void USBBackend::Device::MarkAdded() {
 	added_flag = true;
 }
 
-void USBBackend::Device::SendRequest(const Request &&request) {
+void USBBackend::Device::SendRequest(Request &&request) {
 	std::unique_lock<std::mutex> lock(state_mutex);
 	while(state != State::AVAILABLE) {
 		state_cv.wait(lock);
@@ -150,13 +175,15 @@ void USBBackend::Device::SendRequest(const Request &&request) {
 	mhdr.object_count = 0;
 
 	request_out = request.Weak();
-	pending_requests.push_back(request_out);
+	request_out.payload = std::move(request.payload);
+	pending_requests.push_back(request.Weak());
 
-	libusb_fill_bulk_transfer(tfer_meta_out, handle, endp_meta_out, (uint8_t*) &mhdr, sizeof(mhdr), &Device::MetaOutTransferShim, SharedPtrForTransfer(), 5000);
+	libusb_fill_bulk_transfer(tfer_meta_out.tfer, handle, endp_meta_out, (uint8_t*) &mhdr, sizeof(mhdr), &Device::MetaOutTransferShim, ClaimTransfer(tfer_meta_out), 5000);
 	transferring_meta = true;
-	int r = libusb_submit_transfer(tfer_meta_out);
+	int r = libusb_submit_transfer(tfer_meta_out.tfer);
 	if(r != 0) {
 		LogMessage(Debug, "transfer failed: %s", libusb_error_name(r));
+		tfer_meta_out.self.reset();
 		deletion_flag = true;
 		return;
 	}
@@ -170,8 +197,13 @@ std::string USBBackend::Device::GetBridgeType() {
 	return "usb";
 }
 
-std::shared_ptr<USBBackend::Device> *USBBackend::Device::SharedPtrForTransfer() {
-	return new std::shared_ptr<Device>(shared_from_this());
+libusb_device *USBBackend::Device::GetUsbDevice() {
+	return libusb_get_device(handle);
+}
+
+void *USBBackend::Device::ClaimTransfer(Transfer &transfer) {
+	transfer.self = shared_from_this();
+	return &transfer;
 }
 
 void USBBackend::Device::MetaOutTransferCompleted() {
@@ -180,11 +212,12 @@ void USBBackend::Device::MetaOutTransferCompleted() {
 
 	if(request_out.payload.size() > 0) {
 		LogMessage(Debug, "transferring data");
-		libusb_fill_bulk_transfer(tfer_data_out, handle, endp_data_out, (uint8_t*) request_out.payload.data(), LimitTransferSize(request_out.payload.size()), &Device::DataOutTransferShim, SharedPtrForTransfer(), 5000);
+		libusb_fill_bulk_transfer(tfer_data_out.tfer, handle, endp_data_out, (uint8_t*) request_out.payload.data(), LimitTransferSize(request_out.payload.size()), &Device::DataOutTransferShim, ClaimTransfer(tfer_data_out), 5000);
 		transferring_data = true;
-		int r = libusb_submit_transfer(tfer_data_out);
+		int r = libusb_submit_transfer(tfer_data_out.tfer);
 		if(r != 0) {
 			LogMessage(Debug, "transfer failed: %s", libusb_error_name(r));
+			tfer_data_out.self.reset();
 			deletion_flag = true;
 			return;
 		}
@@ -199,20 +232,21 @@ void USBBackend::Device::MetaOutTransferCompleted() {
 }
 
 void USBBackend::Device::DataOutTransferCompleted() {
-	size_t beg_off = (tfer_data_out->buffer - request_out.payload.data());
-	size_t read = beg_off + tfer_data_out->actual_length;
+	size_t beg_off = (tfer_data_out.tfer->buffer - request_out.payload.data());
+	size_t read = beg_off + tfer_data_out.tfer->actual_length;
 	size_t remaining = mhdr.payload_size - read;
 	LogMessage(Debug, "send request data 0x%x/0x%x. 0x%x remaining", read, request_out.payload.size(), remaining);
 
 	if(remaining > 0) {
 		// continue transferring
-		libusb_fill_bulk_transfer(tfer_data_out, handle, endp_data_out,
+		libusb_fill_bulk_transfer(tfer_data_out.tfer, handle, endp_data_out,
 															request_out.payload.data() + read,
 															LimitTransferSize(remaining),
-															&Device::DataOutTransferShim, SharedPtrForTransfer(), 15000);
-		int r = libusb_submit_transfer(tfer_data_out);
+															&Device::DataOutTransferShim, ClaimTransfer(tfer_data_out), 15000);
+		int r = libusb_submit_transfer(tfer_data_out.tfer);
 		if(r != 0) {
 			LogMessage(Debug, "transfer failed: %s", libusb_error_name(r));
+			tfer_data_out.self.reset();
 			deletion_flag = true;
 			return;
 		}
@@ -246,55 +280,84 @@ void USBBackend::Device::MetaInTransferCompleted() {
 	response_in.object_id = mhdr_in.object_id;
 	response_in.result_code = mhdr_in.result_code;
 	response_in.tag = mhdr_in.tag;
-	response_in.payload.resize(mhdr_in.payload_size);
+	response_in.payload = Payload((size_t) mhdr_in.payload_size);
 	object_ids_in.resize(mhdr_in.object_count);
 	
 	if(mhdr_in.payload_size > 0) {
-		libusb_fill_bulk_transfer(tfer_data_in, handle, endp_data_in, response_in.payload.data(), LimitTransferSize(response_in.payload.size()), &Device::DataInTransferShim, SharedPtrForTransfer(), 5000);
-		int r = libusb_submit_transfer(tfer_data_in);
-		if(r != 0) {
-			LogMessage(Debug, "transfer failed: %s", libusb_error_name(r));
-			deletion_flag = true;
-			return;
-		}
-	} else if(mhdr_in.object_count > 0) {
-		libusb_fill_bulk_transfer(tfer_data_in, handle, endp_data_in, (uint8_t*) object_ids_in.data(), object_ids_in.size() * sizeof(uint32_t), &Device::ObjectInTransferShim, SharedPtrForTransfer(), 5000);
-		int r = libusb_submit_transfer(tfer_data_in);
-		if(r != 0) {
-			LogMessage(Debug, "transfer failed: %s", libusb_error_name(r));
-			deletion_flag = true;
-			return;
-		}
+		data_in_posted = 0;
+		data_in_received = 0;
+		data_in_realigning = false;
+		data_in_start = std::chrono::steady_clock::now();
+		SubmitDataInTransfers();
 	} else {
-		DispatchResponse();
+		ObjectsIn();
 	}
 }
 
-void USBBackend::Device::DataInTransferCompleted() {
-	size_t beg_off = (tfer_data_in->buffer - response_in.payload.data());
-	size_t read = beg_off + tfer_data_in->actual_length;
-	size_t remaining = mhdr_in.payload_size - read;
-
-	if(remaining > 0) {
-		// continue transferring
-		libusb_fill_bulk_transfer(tfer_data_in, handle, endp_data_in,
-															response_in.payload.data() + read,
-															LimitTransferSize(remaining),
-															&Device::DataInTransferShim, SharedPtrForTransfer(), 15000);
-		int r = libusb_submit_transfer(tfer_data_in);
+void USBBackend::Device::SubmitDataInTransfers() {
+	size_t size = response_in.payload.size();
+	while(!data_in_realigning && data_in_in_flight < tfer_data_in.size() && data_in_posted < size) {
+		Transfer &transfer = tfer_data_in[data_in_submit_index];
+		transfer.length = std::min(size - data_in_posted, backend->config.transfer_size);
+		libusb_fill_bulk_transfer(transfer.tfer, handle, endp_data_in,
+															response_in.payload.data() + data_in_posted,
+															transfer.length,
+															&Device::DataInTransferShim, ClaimTransfer(transfer), 15000);
+		int r = libusb_submit_transfer(transfer.tfer);
 		if(r != 0) {
 			LogMessage(Debug, "transfer failed: %s", libusb_error_name(r));
+			transfer.self.reset();
 			deletion_flag = true;
 			return;
 		}
+		data_in_posted+= transfer.length;
+		data_in_in_flight++;
+		data_in_submit_index = (data_in_submit_index + 1) % tfer_data_in.size();
+	}
+}
+
+void USBBackend::Device::DataInTransferCompleted(Transfer &transfer) {
+	uint8_t *destination = response_in.payload.data() + data_in_received;
+	size_t actual_length = transfer.tfer->actual_length;
+	data_in_in_flight--;
+	
+	// An earlier transfer came back short, so this one's data landed further
+	// along than it should have. Everything in between has already been
+	// consumed, so it can just be moved down.
+	if(transfer.tfer->buffer != destination) {
+		memmove(destination, transfer.tfer->buffer, actual_length);
+	}
+	data_in_received+= actual_length;
+	
+	size_t size = response_in.payload.size();
+	if(data_in_received < size) {
+		if(actual_length < transfer.length && data_in_in_flight > 0) {
+			data_in_realigning = true;
+		}
+		if(data_in_in_flight == 0) {
+			data_in_realigning = false;
+			data_in_posted = data_in_received;
+		}
+		SubmitDataInTransfers();
 		return;
 	}
 
+	auto duration = std::chrono::steady_clock::now() - data_in_start;
+	if(size >= 0x100000) {
+		double seconds = std::chrono::duration<double>(duration).count();
+		LogMessage(Debug, "received 0x%zx byte response in %.1f ms (%.1f MB/s)", size, seconds * 1000.0, size / seconds / 1000000.0);
+	}
+
+	ObjectsIn();
+}
+
+void USBBackend::Device::ObjectsIn() {
 	if(mhdr_in.object_count > 0) {
-		libusb_fill_bulk_transfer(tfer_data_in, handle, endp_data_in, (uint8_t*) object_ids_in.data(), object_ids_in.size() * sizeof(uint32_t), &Device::ObjectInTransferShim, SharedPtrForTransfer(), 5000);
-		int r = libusb_submit_transfer(tfer_data_in);
+		libusb_fill_bulk_transfer(tfer_object_in.tfer, handle, endp_data_in, (uint8_t*) object_ids_in.data(), object_ids_in.size() * sizeof(uint32_t), &Device::ObjectInTransferShim, ClaimTransfer(tfer_object_in), 5000);
+		int r = libusb_submit_transfer(tfer_object_in.tfer);
 		if(r != 0) {
 			LogMessage(Debug, "transfer failed: %s", libusb_error_name(r));
+			tfer_object_in.self.reset();
 			deletion_flag = true;
 			return;
 		}
@@ -304,7 +367,7 @@ void USBBackend::Device::DataInTransferCompleted() {
 }
 
 void USBBackend::Device::ObjectInTransferCompleted() {
-	if(tfer_data_in->actual_length != mhdr_in.object_count * sizeof(uint32_t)) {
+	if(tfer_object_in.tfer->actual_length != mhdr_in.object_count * sizeof(uint32_t)) {
 		LogMessage(Debug, "invalid object ID transfer\n");
 		deletion_flag = true;
 		return;
@@ -359,10 +422,11 @@ void USBBackend::Device::Identified(Response &r) {
 
 void USBBackend::Device::ResubmitMetaInTransfer() {
 	LogMessage(Debug, "submitting meta in transfer");
-	libusb_fill_bulk_transfer(tfer_meta_in, handle, endp_meta_in, (uint8_t*) &mhdr_in, sizeof(mhdr_in), &Device::MetaInTransferShim, SharedPtrForTransfer(), 600000);
-	int r = libusb_submit_transfer(tfer_meta_in);
+	libusb_fill_bulk_transfer(tfer_meta_in.tfer, handle, endp_meta_in, (uint8_t*) &mhdr_in, sizeof(mhdr_in), &Device::MetaInTransferShim, ClaimTransfer(tfer_meta_in), 600000);
+	int r = libusb_submit_transfer(tfer_meta_in.tfer);
 	if(r != 0) {
 		LogMessage(Debug, "transfer failed: %s", libusb_error_name(r));
+		tfer_meta_in.self.reset();
 		deletion_flag = true;
 	}
 }
@@ -386,49 +450,48 @@ size_t USBBackend::Device::LimitTransferSize(size_t sz) {
 	}
 }
 
+// Each shim takes the device reference out of the transfer's context first,
+// so that the device can be destroyed once its last transfer comes back.
+
 void USBBackend::Device::MetaOutTransferShim(libusb_transfer *tfer) {
 	LogMessage(Debug, "meta out transfer shim, status = %d", tfer->status);
-	std::shared_ptr<Device> *d = (std::shared_ptr<Device> *) tfer->user_data;
-	if(!(*d)->CheckTransfer(tfer)) {
-		(*d)->MetaOutTransferCompleted();
+	std::shared_ptr<Device> d = std::move(((Transfer*) tfer->user_data)->self);
+	if(!d->CheckTransfer(tfer)) {
+		d->MetaOutTransferCompleted();
 	}
-	delete d;
 }
 
 void USBBackend::Device::DataOutTransferShim(libusb_transfer *tfer) {
-	std::shared_ptr<Device> *d = (std::shared_ptr<Device> *) tfer->user_data;
-	if(!(*d)->CheckTransfer(tfer)) {
-		(*d)->DataOutTransferCompleted();
+	std::shared_ptr<Device> d = std::move(((Transfer*) tfer->user_data)->self);
+	if(!d->CheckTransfer(tfer)) {
+		d->DataOutTransferCompleted();
 	}
-	delete d;
 }
 
 void USBBackend::Device::MetaInTransferShim(libusb_transfer *tfer) {
-	std::shared_ptr<Device> *d = (std::shared_ptr<Device> *) tfer->user_data;
+	std::shared_ptr<Device> d = std::move(((Transfer*) tfer->user_data)->self);
 	if(tfer->status == LIBUSB_TRANSFER_TIMED_OUT) {
-		(*d)->ResubmitMetaInTransfer();
+		d->ResubmitMetaInTransfer();
 	} else {
-		if(!(*d)->CheckTransfer(tfer)) {
-			(*d)->MetaInTransferCompleted();
+		if(!d->CheckTransfer(tfer)) {
+			d->MetaInTransferCompleted();
 		}
 	}
-	delete d;
 }
 
 void USBBackend::Device::DataInTransferShim(libusb_transfer *tfer) {
-	std::shared_ptr<Device> *d = (std::shared_ptr<Device> *) tfer->user_data;
-	if(!(*d)->CheckTransfer(tfer)) {
-		(*d)->DataInTransferCompleted();
+	Transfer *transfer = (Transfer*) tfer->user_data;
+	std::shared_ptr<Device> d = std::move(transfer->self);
+	if(!d->CheckTransfer(tfer)) {
+		d->DataInTransferCompleted(*transfer);
 	}
-	delete d;
 }
 
 void USBBackend::Device::ObjectInTransferShim(libusb_transfer *tfer) {
-	std::shared_ptr<Device> *d = (std::shared_ptr<Device> *) tfer->user_data;
-	if(!(*d)->CheckTransfer(tfer)) {
-		(*d)->ObjectInTransferCompleted();
+	std::shared_ptr<Device> d = std::move(((Transfer*) tfer->user_data)->self);
+	if(!d->CheckTransfer(tfer)) {
+		d->ObjectInTransferCompleted();
 	}
-	delete d;
 }
 
 void USBBackend::Probe() {
@@ -662,54 +725,101 @@ void USBBackend::ProbeStdioInterface(libusb_device *device, const libusb_interfa
 		return;
 	}
 
-	auto state = std::make_shared<StdoutTransferState>(handle, endp_stdio_in.bEndpointAddress);
+	auto state = std::make_shared<StdoutTransferState>(*this, handle, endp_stdio_in.bEndpointAddress);
 	stdout_transfers.push_back(state);
-	state->Submit();
+	state->SubmitAll();
+}
+
+void USBBackend::ForwardStdio(StdoutTransferState &state) {
+	if(state.pending_lines.empty()) {
+		return;
+	}
+	
+	libusb_device *usb_device = libusb_get_device(state.handle);
+	for(auto &d : devices) {
+		if(d->ready_flag && d->GetUsbDevice() == usb_device) {
+			daemon.AppendDeviceLog(d->device_id, std::move(state.pending_lines));
+			state.pending_lines.clear();
+			return;
+		}
+	}
+
+	// device hasn't identified itself yet; hang on to the most recent lines
+	// until it does
+	const size_t max_pending_lines = 1024;
+	if(state.pending_lines.size() > max_pending_lines) {
+		state.pending_lines.erase(
+			state.pending_lines.begin(),
+			state.pending_lines.end() - max_pending_lines);
+	}
 }
 
-USBBackend::StdoutTransferState::StdoutTransferState(libusb_device_handle *handle, uint8_t addr) :
-	handle(handle), address(addr) {
-	tfer = libusb_alloc_transfer(0);
+USBBackend::StdoutTransferState::StdoutTransferState(USBBackend &backend, libusb_device_handle *handle, uint8_t addr) :
+	backend(backend), handle(handle), address(addr) {
+	for(Transfer &transfer : transfers) {
+		transfer.state = this;
+		transfer.tfer = libusb_alloc_transfer(0);
+	}
 }
 
 USBBackend::StdoutTransferState::~StdoutTransferState() {
-	libusb_free_transfer(tfer);
+	for(Transfer &transfer : transfers) {
+		libusb_free_transfer(transfer.tfer);
+	}
 	libusb_close(handle);
 }
 
-void USBBackend::StdoutTransferState::Submit() {
-	libusb_fill_bulk_transfer(tfer, handle, address, io_buffer, sizeof(io_buffer), &StdoutTransferState::Callback, this, 60000);
-	int r = libusb_submit_transfer(tfer);
+void USBBackend::StdoutTransferState::SubmitAll() {
+	for(Transfer &transfer : transfers) {
+		Submit(transfer);
+	}
+}
+
+void USBBackend::StdoutTransferState::Submit(Transfer &transfer) {
+	if(failed) {
+		Kill();
+		return;
+	}
+	libusb_fill_bulk_transfer(transfer.tfer, handle, address, transfer.io_buffer, sizeof(transfer.io_buffer), &StdoutTransferState::Callback, &transfer, 60000);
+	int r = libusb_submit_transfer(transfer.tfer);
 	if(r != 0) {
 		LogMessage(Debug, "submit failed");
 		Kill();
+	} else {
+		transfers_in_flight++;
 	}
 }
 
 void USBBackend::StdoutTransferState::Kill() {
-	deletion_flag = true;
+	if(!failed) {
+		failed = true;
+		for(Transfer &transfer : transfers) {
+			libusb_cancel_transfer(transfer.tfer);
+		}
+	}
+	// wait for every transfer to come back before letting ourselves be deleted
+	if(transfers_in_flight == 0) {
+		deletion_flag = true;
+	}
 }
 
 void USBBackend::StdoutTransferState::Callback(libusb_transfer *tfer) {
-	StdoutTransferState *state = (StdoutTransferState*) tfer->user_data;
+	Transfer &transfer = *(Transfer*) tfer->user_data;
+	StdoutTransferState *state = transfer.state;
+	state->transfers_in_flight--;
 	if(tfer->status == LIBUSB_TRANSFER_COMPLETED) {
-		state->string_buffer.Write(state->io_buffer, tfer->actual_length);
-		for(bool found_line = true; found_line; found_line = false) {
-			char *current_line = (char*) state->string_buffer.Read();
-			for(size_t i = 0; i < state->string_buffer.ReadAvailable(); i++) {
-				if(current_line[i] == '\n') {
-					LogMessage(Message, "[TWILI] %.*s", i, current_line);
-					state->string_buffer.MarkRead(i+1);
-					found_line = true;
-					break;
-				}
-			}
-		}
-		state->Submit();
+		// bulk transfers on one endpoint complete in the order they were
+		// submitted, so the output stays in order
+		state->string_buffer.Write(transfer.io_buffer, tfer->actual_length);
+		DeviceLog::SplitLines(state->string_buffer, state->pending_lines);
+		state->backend.ForwardStdio(*state);
+		state->Submit(transfer);
 	} else if(tfer->status == LIBUSB_TRANSFER_TIMED_OUT) {
-		state->Submit();
+		state->Submit(transfer);
 	} else {
-		LogMessage(Debug, "stdout transfer failed");
+		if(!state->failed) {
+			LogMessage(Debug, "stdout transfer failed");
+		}
 		state->Kill();
 	}
 }
@@ -746,6 +856,8 @@ void USBBackend::event_thread_func() {
 		}
 
 		for(auto i = stdout_transfers.begin(); i != stdout_transfers.end(); ) {
+			// flush anything that arrived before its device was identified
+			ForwardStdio(**i);
 			if((*i)->deletion_flag) {
 				i = stdout_transfers.erase(i);
 			} else {
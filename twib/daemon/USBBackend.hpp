@@ -27,6 +27,7 @@
 #include<queue>
 #include<mutex>
 #include<condition_variable>
+#include<chrono>
 
 #include<libusb.h>
 
@@ -46,7 +47,12 @@ namespace backend {
 
 class USBBackend {
  public:
-	USBBackend(Daemon &daemon);
+	struct Config {
+		size_t read_ahead = 4; // data IN transfers to keep queued while receiving a response payload
+		size_t transfer_size = 0x10000; // bytes per data IN transfer
+	};
+	
+	USBBackend(Daemon &daemon, const Config &config);
 	~USBBackend();
 
 	class LibusbContext {
@@ -71,10 +77,12 @@ class USBBackend {
 		void MarkAdded();
 		
 		// thread-agnostic
-		virtual void SendRequest(const Request &&r) override;
+		virtual void SendRequest(Request &&r) override;
 
 		virtual int GetPriority() override;
 		virtual std::string GetBridgeType() override;
+
+		libusb_device *GetUsbDevice();
 		
 		bool ready_flag = false;
 		bool added_flag = false;
@@ -87,10 +95,32 @@ class USBBackend {
 		uint8_t endp_data_out;
 		uint8_t endp_meta_in;
 		uint8_t endp_data_in;
-		libusb_transfer *tfer_meta_out = NULL;
-		libusb_transfer *tfer_data_out = NULL;
-		libusb_transfer *tfer_meta_in = NULL;
-		libusb_transfer *tfer_data_in = NULL;
+
+		// Transfers and the contexts handed to their callbacks are allocated
+		// once per device instead of once per submission. `self` keeps the
+		// device alive while the transfer is in flight.
+		struct Transfer {
+			libusb_transfer *tfer = nullptr;
+			std::shared_ptr<Device> self;
+			size_t length; // for data IN transfers, how much was requested
+		};
+		
+		Transfer tfer_meta_out;
+		Transfer tfer_data_out;
+		Transfer tfer_meta_in;
+		Transfer tfer_object_in;
+		// Response payloads are read through several queued transfers at once.
+		// Bulk transfers on one endpoint complete in the order they were
+		// submitted, so these are used as a ring.
+		std::vector<Transfer> tfer_data_in;
+		size_t data_in_submit_index = 0;
+		size_t data_in_in_flight = 0;
+		size_t data_in_posted = 0; // offset in the payload that the next transfer reads to
+		size_t data_in_received = 0; // bytes of the payload that are in place
+		// set when a transfer comes back short while others are queued behind
+		// it; queueing stops until they drain so that they can be moved into place
+		bool data_in_realigning = false;
+		std::chrono::steady_clock::time_point data_in_start;
 		State state = State::AVAILABLE;
 		bool transferring_meta = false;
 		bool transferring_data = false;
@@ -105,11 +135,13 @@ class USBBackend {
 
 		std::unique_lock<InitialScanLock> isl_lock;
 		
-		std::shared_ptr<Device> *SharedPtrForTransfer();
+		void *ClaimTransfer(Transfer &transfer);
 		void MetaOutTransferCompleted();
 		void DataOutTransferCompleted();
 		void MetaInTransferCompleted();
-		void DataInTransferCompleted();
+		void SubmitDataInTransfers();
+		void DataInTransferCompleted(Transfer &transfer);
+		void ObjectsIn();
 		void ObjectInTransferCompleted();
 		void DispatchResponse();
 		void Identified(Response &r);
@@ -130,6 +162,7 @@ class USBBackend {
 
  private:
 	Daemon &daemon;
+	Config config;
 	LibusbContext ctx;
 	std::list<std::shared_ptr<Device>> devices;
 	std::queue<libusb_device*> devices_to_add;
@@ -138,24 +171,41 @@ class USBBackend {
 	
 	class StdoutTransferState {
 	 public:
-		StdoutTransferState(libusb_device_handle *handle, uint8_t address);
+		StdoutTransferState(USBBackend &backend, libusb_device_handle *handle, uint8_t address);
 		~StdoutTransferState();
 
-		void Submit();
+		// Keeps this many transfers queued on the endpoint, so that the
+		// device always has somewhere to put its output.
+		static const size_t TransferCount = 4;
+
+		struct Transfer {
+			StdoutTransferState *state;
+			libusb_transfer *tfer;
+			uint8_t io_buffer[0x4000];
+		};
+
+		void SubmitAll();
+		void Submit(Transfer &transfer);
 		void Kill(); // we have to delete this outside of the libusb event loop
 		static void Callback(libusb_transfer *tfer);
-		
-		libusb_transfer *tfer;
+
+		USBBackend &backend;
 		libusb_device_handle *handle;
 		uint8_t address;
-		uint8_t io_buffer[0x4000];
+		Transfer transfers[TransferCount];
+		size_t transfers_in_flight = 0;
+		bool failed = false;
 		util::Buffer string_buffer;
+		// lines that can't be attributed to a device until its Twili
+		// interface finishes identifying itself
+		std::vector<std::string> pending_lines;
 		bool deletion_flag = false;
 	};
 
 	std::list<std::shared_ptr<StdoutTransferState>> stdout_transfers;
 	
 	void ProbeStdioInterface(libusb_device *dev, const libusb_interface_descriptor *d);
+	void ForwardStdio(StdoutTransferState &state);
 	
 	bool event_thread_destroy = false;
 	void event_thread_func();
@@ -177,7 +177,7 @@ USBKBackend::Device::Device(USBKBackend &backend, KUSB_DRIVER_API Usb, UsbHandle
 }
 
 USBKBackend::Device::~Device() {
-	for(auto r : pending_requests) {
+	for(auto &r : pending_requests) {
 		if(r.client_id != 0xffffffff) {
 			backend.daemon.PostResponse(r.RespondError(TWILI_ERR_PROTOCOL_TRANSFER_ERROR));
 		}
@@ -205,7 +205,7 @@ void USBKBackend::Device::MarkAdded() {
 	added_flag = true;
 }
 
-void USBKBackend::Device::SendRequest(const Request &&request) {
+void USBKBackend::Device::SendRequest(Request &&request) {
 	std::unique_lock<std::mutex> lock(state_mutex);
 	while(state != State::AVAILABLE) {
 		state_cv.wait(lock);
@@ -220,7 +220,8 @@ void USBKBackend::Device::SendRequest(const Request &&request) {
 	mhdr.object_count = 0;
 
 	request_out = request.Weak();
-	pending_requests.push_back(request_out);
+	request_out.payload = std::move(request.payload);
+	pending_requests.push_back(request.Weak());
 
 	member_meta_out.Submit((uint8_t*)&mhdr, sizeof(mhdr));
 	transferring_data = false;
@@ -271,7 +272,7 @@ void USBKBackend::Device::MetaInTransferCompleted(size_t size) {
 	response_in.object_id = mhdr_in.object_id;
 	response_in.result_code = mhdr_in.result_code;
 	response_in.tag = mhdr_in.tag;
-	response_in.payload.resize(mhdr_in.payload_size);
+	response_in.payload = Payload((size_t) mhdr_in.payload_size);
 	object_ids_in.resize(mhdr_in.object_count);
 	
 	data_in_transferred = 0;
@@ -574,16 +575,10 @@ void USBKBackend::StdoutTransferState::Signal() {
 	UINT actual_length;
 	if(OvlK_Wait(overlap, 0, KOVL_WAIT_FLAG_NONE, &actual_length)) {
 		string_buffer.Write(io_buffer, actual_length);
-		for(bool found_line = true; found_line; found_line = false) {
-			char *current_line = (char*) string_buffer.Read();
-			for(size_t i = 0; i < string_buffer.ReadAvailable(); i++) {
-				if(current_line[i] == '\n') {
-					LogMessage(Message, "[TWILI] %.*s", i, current_line);
-					string_buffer.MarkRead(i+1);
-					found_line = true;
-					break;
-				}
-			}
+		std::vector<std::string> lines;
+		DeviceLog::SplitLines(string_buffer, lines);
+		for(std::string &line : lines) {
+			LogMessage(Message, "[TWILI] %s", line.c_str());
 		}
 		Submit();
 	} else {
@@ -103,7 +103,7 @@ class USBKBackend {
 		void MarkAdded();
 		
 		// thread-agnostic
-		virtual void SendRequest(const Request &&r) override;
+		virtual void SendRequest(Request &&r) override;
 
 		virtual int GetPriority() override;
 		virtual std::string GetBridgeType() override;
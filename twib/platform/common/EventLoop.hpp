@@ -26,6 +26,8 @@
 #include<vector>
 #include<thread>
 #include<mutex>
+#include<algorithm>
+#include<functional>
 
 #include<stdint.h>
 
@@ -68,23 +70,66 @@ class EventLoopBase {
 	
 	void Clear() {
 		members.clear();
+		members_changed = true;
 	}
 	
 	void AddMember(Member &member) {
 		members.push_back(member);
+		members_changed = true;
+	}
+
+	// Members added with Register stay in the loop until they are
+	// unregistered, instead of needing to be added again by every call to
+	// Logic::Prepare. These must only be called on the event thread or before
+	// the loop begins, and Unregister must not be called from a member's
+	// Signal methods.
+	void Register(Member &member) {
+		registered_members.push_back(member);
+		members_changed = true;
+	}
+
+	void Unregister(Member &member) {
+		registered_members.erase(
+			std::remove_if(
+				registered_members.begin(), registered_members.end(),
+				[&member](std::reference_wrapper<Member> &m) {
+					return &m.get() == &member;
+				}),
+			registered_members.end());
+		members_changed = true;
 	}
 
 	virtual const Notifier &GetNotifier() = 0;
  protected:
 	std::vector<std::reference_wrapper<Member>> members;
+	std::vector<std::reference_wrapper<Member>> registered_members;
 	Logic &logic;
 
+	// Gathers the members for this iteration of the event loop into
+	// active_members. The list is only rebuilt when members were added or
+	// removed since the last iteration, in which case `changed` is set so the
+	// loop can update whatever it keeps for them. Members that get registered
+	// while they're being signalled wait until the next iteration.
+	std::vector<std::reference_wrapper<Member>> &GatherMembers(bool &changed) {
+		changed = members_changed;
+		if(members_changed) {
+			active_members.clear();
+			active_members.insert(active_members.end(), members.begin(), members.end());
+			active_members.insert(active_members.end(), registered_members.begin(), registered_members.end());
+			members_changed = false;
+		}
+		return active_members;
+	}
+
 	bool event_thread_destroy = false;
 	bool event_thread_running = false;
 	std::thread event_thread;
 	virtual void event_thread_func() = 0;
 	
 	size_t service_timer = 0;
+ private:
+	std::vector<std::reference_wrapper<Member>> active_members;
+	bool members_changed = true;
 };
 
 } // namespace detail
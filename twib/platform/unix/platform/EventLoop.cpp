@@ -62,32 +62,52 @@ EventLoop::Notifier &EventLoop::GetNotifier() {
 void EventLoop::event_thread_func() {
 	while(!event_thread_destroy) {
 		logic.Prepare(*this);
-
-		fd_set readfds;
-		fd_set writefds;
-		fd_set errorfds;
-		int max_fd = 0;
-
-		FD_ZERO(&readfds);
-		FD_ZERO(&writefds);
-		FD_ZERO(&errorfds);
-		
-		for(auto i = members.begin(); i != members.end(); i++) {
+		bool members_changed;
+		std::vector<std::reference_wrapper<FileMember>> &active_members = GatherMembers(members_changed);
+
+		// Most members want the same thing from one iteration to the next, so
+		// the sets are kept around and only rebuilt when that changes.
+		bool interest_changed = members_changed;
+		if(members_changed) {
+			FD_ZERO(&member_errorfds);
+			max_fd = notification_pipe[0];
+			for(auto i = active_members.begin(); i != active_members.end(); i++) {
+				FileMember &member = i->get();
+				member.fd = member.GetFile().fd;
+				FD_SET(member.fd, &member_errorfds);
+				max_fd = std::max(max_fd, member.fd);
+			}
+		}
+		for(auto i = active_members.begin(); i != active_members.end(); i++) {
 			FileMember &member = i->get();
-			File &f = member.GetFile();
-			if(member.WantsRead()) {
-				FD_SET(f.fd, &readfds);
+			bool wants_read = member.WantsRead();
+			bool wants_write = member.WantsWrite();
+			if(wants_read != member.wants_read || wants_write != member.wants_write) {
+				member.wants_read = wants_read;
+				member.wants_write = wants_write;
+				interest_changed = true;
 			}
-			if(member.WantsWrite()) {
-				FD_SET(f.fd, &writefds);
+		}
+		if(interest_changed) {
+			FD_ZERO(&member_readfds);
+			FD_ZERO(&member_writefds);
+			for(auto i = active_members.begin(); i != active_members.end(); i++) {
+				FileMember &member = i->get();
+				if(member.wants_read) {
+					FD_SET(member.fd, &member_readfds);
+				}
+				if(member.wants_write) {
+					FD_SET(member.fd, &member_writefds);
+				}
 			}
-			FD_SET(f.fd, &errorfds);
-			max_fd = std::max(max_fd, f.fd);
+			// add event thread notification pipe
+			FD_SET(notification_pipe[0], &member_readfds);
 		}
-		
-		// add event thread notification pipe
-		max_fd = std::max(max_fd, notification_pipe[0]);
-		FD_SET(notification_pipe[0], &readfds);
+
+		// select overwrites these
+		fd_set readfds = member_readfds;
+		fd_set writefds = member_writefds;
+		fd_set errorfds = member_errorfds;
 		
 		if(select(max_fd + 1, &readfds, &writefds, &errorfds, NULL) < 0) {
 			LogMessage(Fatal, "failed to select file descriptors: %s", NetErrStr());
@@ -105,16 +125,15 @@ void EventLoop::event_thread_func() {
 			LogMessage(Debug, "event thread notified: '%.*s'", r, buf);
 		}
 
-		for(auto i = members.begin(); i != members.end(); i++) {
+		for(auto i = active_members.begin(); i != active_members.end(); i++) {
 			FileMember &member = i->get();
-			File &f = member.GetFile();
-			if(FD_ISSET(f.fd, &readfds)) {
+			if(FD_ISSET(member.fd, &readfds)) {
 				member.SignalRead();
 			}
-			if(FD_ISSET(f.fd, &writefds)) {
+			if(FD_ISSET(member.fd, &writefds)) {
 				member.SignalWrite();
 			}
-			if(FD_ISSET(f.fd, &errorfds)) {
+			if(FD_ISSET(member.fd, &errorfds)) {
 				member.SignalError();
 			}
 		}
@@ -48,6 +48,10 @@ class EventLoopFileMember {
 	virtual File &GetFile() = 0;
  private:
 	size_t last_service = 0;
+	// what the event loop last saw, so it can tell when to update its fd sets
+	int fd = -1;
+	bool wants_read = false;
+	bool wants_write = false;
 };
 
 // to provide a common interface
@@ -75,6 +79,10 @@ protected:
 
 	// TODO: use File to RAII this
 	int notification_pipe[2];
+	fd_set member_readfds;
+	fd_set member_writefds;
+	fd_set member_errorfds;
+	int max_fd = 0;
 	class EventThreadNotifier : public Notifier {
 	public:
 		EventThreadNotifier(EventLoop &loop);
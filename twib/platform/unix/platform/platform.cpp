@@ -21,7 +21,11 @@
 #include "platform.hpp"
 
 #include<fcntl.h>
+#include<limits.h>
 #include<sys/stat.h>
+#include<sys/uio.h>
+
+#include<algorithm>
 
 namespace twili {
 namespace platform {
@@ -151,6 +155,19 @@ ssize_t Socket::Send(const void *buf, size_t length, int flags) {
 	return send(fd, buf, length, flags);
 }
 
+ssize_t Socket::Send(const SendBuffer *buffers, size_t count, int flags) {
+	struct iovec iov[IOV_MAX];
+	count = std::min(count, (size_t) IOV_MAX);
+	for(size_t i = 0; i < count; i++) {
+		iov[i].iov_base = const_cast<void*>(buffers[i].data);
+		iov[i].iov_len = buffers[i].size;
+	}
+	struct msghdr msg = {};
+	msg.msg_iov = iov;
+	msg.msg_iovlen = count;
+	return sendmsg(fd, &msg, flags);
+}
+
 int Socket::SetSockOpt(int level, int option_name, const void *option_value, socklen_t option_len) {
 	return setsockopt(fd, level, option_name, option_value, option_len);
 }
@@ -43,6 +43,12 @@ static inline char *NetErrStr() {
 	return strerror(errno);
 }
 
+// one piece of the data for Socket::Send to gather
+struct SendBuffer {
+	const void *data;
+	size_t size;
+};
+
 namespace unix {
 
 class File {
@@ -91,6 +97,8 @@ class Socket : public File {
 	ssize_t Recv(void *buf, size_t length, int flags);
 	ssize_t RecvFrom(void *buf, size_t length, int flags, struct sockaddr *address, socklen_t *address_len);
 	ssize_t Send(const void *buf, size_t length, int flags);
+	// sends from several buffers at once, like sendmsg
+	ssize_t Send(const SendBuffer *buffers, size_t count, int flags);
 	int SetSockOpt(int level, int option_name, const void *option_value, socklen_t option_len); // no error check
 	
 	// checks errors for you
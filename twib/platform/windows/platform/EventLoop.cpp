@@ -55,11 +55,13 @@ EventLoop::Notifier &EventLoop::GetNotifier() {
 void EventLoop::event_thread_func() {
 	while(!event_thread_destroy) {
 		logic.Prepare(*this);
+		bool members_changed;
+		std::vector<std::reference_wrapper<NativeMember>> &active_members = GatherMembers(members_changed);
 
-		std::sort(members.begin(), members.end(), [](auto &a, auto &b) { return a.get().last_service > b.get().last_service; });
+		std::sort(active_members.begin(), active_members.end(), [](auto &a, auto &b) { return a.get().last_service > b.get().last_service; });
 		std::vector<HANDLE> event_handles;
 		std::vector<std::reference_wrapper<NativeMember>> event_members;
-		for(auto i = members.begin(); i != members.end(); i++) {
+		for(auto i = active_members.begin(); i != active_members.end(); i++) {
 			NativeMember &member = i->get();
 			if(member.WantsSignal()) {
 				event_handles.push_back(member.GetHandle());
@@ -24,6 +24,7 @@
 #include "platform/platform.hpp"
 
 #include<optional>
+#include<vector>
 
 #include "common/Logger.hpp"
 
@@ -181,6 +182,19 @@ ssize_t Socket::Send(const void *buffer, size_t length, int flags) {
 	return bytes;
 }
 
+ssize_t Socket::Send(const SendBuffer *buffers, size_t count, int flags) {
+	DWORD bytes;
+	std::vector<WSABUF> bufs(count);
+	for(size_t i = 0; i < count; i++) {
+		bufs[i].len = buffers[i].size;
+		bufs[i].buf = (CHAR*) buffers[i].data;
+	}
+	if(WSASend(fd, bufs.data(), bufs.size(), &bytes, flags, nullptr, nullptr) != 0) {
+		return -1;
+	}
+	return bytes;
+}
+
 int Socket::SetSockOpt(int level, int option_name, const void *option_value, socklen_t option_len) {
 	return setsockopt(fd, level, option_name, (const char*) option_value, option_len);
 }
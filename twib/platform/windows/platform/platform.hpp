@@ -58,6 +58,12 @@ static inline char *NetErrStr() {
 	return s;
 }
 
+// one piece of the data for Socket::Send to gather
+struct SendBuffer {
+	const void *data;
+	size_t size;
+};
+
 namespace windows {
 
 class KObject {
@@ -123,6 +129,8 @@ class Socket {
 	ssize_t Recv(void *buf, size_t length, int flags);
 	ssize_t RecvFrom(void *buf, size_t length, int flags, struct sockaddr *address, socklen_t *address_len);
 	ssize_t Send(const void *buf, size_t length, int flags);
+	// sends from several buffers at once, like WSASend with several WSABUFs
+	ssize_t Send(const SendBuffer *buffers, size_t count, int flags);
 	int SetSockOpt(int level, int option_name, const void *option_value, socklen_t option_len);
 
 	void Bind(const struct sockaddr *address, socklen_t address_len);
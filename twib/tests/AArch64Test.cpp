@@ -0,0 +1,101 @@
+//
+// Twili - Homebrew debug monitor for the Nintendo Switch
+// Copyright (C) 2019 misson20000 <xenotoad@xenotoad.net>
+//
+// This file is part of Twili.
+//
+// Twili is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Twili is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Twili.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include "Test.hpp"
+
+#include<string>
+#include<vector>
+
+#include "tool/AArch64.hpp"
+
+using namespace twili::twib::tool::gdb;
+
+namespace {
+
+const uint64_t PC = 0x7100000100;
+const uint64_t X1 = 0x7100001234;
+const uint64_t X8 = 0x7100008000;
+const uint64_t X16 = 0x7100016000;
+const uint64_t LR = 0x7100030000;
+
+struct SuccessorCase {
+	const char *disassembly;
+	uint32_t instruction;
+	std::vector<uint64_t> successors; // in ascending order
+};
+
+// encodings from llvm-mc -triple=aarch64 -show-encoding
+const SuccessorCase SUCCESSOR_CASES[] = {
+	{"nop", 0xd503201f, {PC + 4}},
+	{"add x0, x1, x2", 0x8b020020, {PC + 4}},
+	{"b #8", 0x14000002, {PC + 8}},
+	{"b #-4", 0x17ffffff, {PC - 4}},
+	{"b #4", 0x14000001, {PC + 4}},
+	{"b #-0x8000000", 0x16000000, {PC - 0x8000000}},
+	{"bl #0x100", 0x94000040, {PC + 0x100}},
+	{"bl #0x7fffffc", 0x95ffffff, {PC + 0x7fffffc}},
+	{"b.eq #0x10", 0x54000080, {PC + 4, PC + 0x10}},
+	{"b.ne #-8", 0x54ffffc1, {PC - 8, PC + 4}},
+	{"b.al #0x10", 0x5400008e, {PC + 0x10}},
+	{"cbz x0, #0x20", 0xb4000100, {PC + 4, PC + 0x20}},
+	{"cbnz w1, #-4", 0x35ffffe1, {PC - 4, PC + 4}},
+	{"cbz x2, #4", 0xb4000022, {PC + 4}},
+	{"tbz w0, #3, #0x40", 0x36180200, {PC + 4, PC + 0x40}},
+	{"tbnz x0, #63, #-4", 0xb7ffffe0, {PC - 4, PC + 4}},
+	{"br x16", 0xd61f0200, {X16}},
+	{"blr x8", 0xd63f0100, {X8}},
+	{"ret", 0xd65f03c0, {LR}},
+	{"ret x1", 0xd65f0020, {X1}},
+	{"eret", 0xd69f03e0, {PC + 4}},
+};
+
+// laid out like nx::ThreadContext: x0-x30, sp, pc
+std::vector<uint64_t> MakeRegisters() {
+	std::vector<uint64_t> registers(33, 0);
+	registers[1] = X1;
+	registers[8] = X8;
+	registers[16] = X16;
+	registers[30] = LR;
+	registers[31] = 0x7100100000; // sp
+	registers[32] = PC;
+	return registers;
+}
+
+} // anonymous namespace
+
+TWIB_TEST(AArch64, PredictsSuccessors) {
+	std::vector<uint64_t> registers = MakeRegisters();
+	for(const SuccessorCase &c : SUCCESSOR_CASES) {
+		std::vector<uint64_t> successors = aarch64::PredictSuccessors(c.instruction, PC, registers);
+		if(successors != c.successors) {
+			throw twili::twib::test::Failure(__FILE__, __LINE__, std::string("wrong successors for ") + c.disassembly);
+		}
+	}
+}
+
+TWIB_TEST(AArch64, ReadsZeroRegisterAsZero) {
+	// br xzr isn't encodable, but index 31 in Rn means xzr rather than sp
+	// for every register branch, so the decoder has to read it as 0
+	std::vector<uint64_t> registers = MakeRegisters();
+	std::vector<uint64_t> successors = aarch64::PredictSuccessors(0xd61f03e0, PC, registers);
+	CHECK_EQ(successors.size(), (size_t) 1);
+	CHECK_EQ(successors[0], (uint64_t) 0);
+}
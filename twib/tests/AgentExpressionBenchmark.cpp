@@ -0,0 +1,122 @@
+//
+// Twili - Homebrew debug monitor for the Nintendo Switch
+// Copyright (C) 2019 misson20000 <xenotoad@xenotoad.net>
+//
+// This file is part of Twili.
+//
+// Twili is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Twili is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Twili.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include "Benchmark.hpp"
+
+#include<chrono>
+#include<string>
+#include<vector>
+
+#include<string.h>
+
+#include "common/config.hpp"
+#include "tool/AgentExpression.hpp"
+#if TWIB_GDB_ENABLED == 1
+#include "tool/GdbStub.hpp"
+#include "StoppedThreadClient.hpp"
+#endif
+
+using namespace twili::twib;
+using tool::gdb::AgentExpression;
+
+namespace {
+
+const uint64_t SP = 0x7100100000;
+const uint64_t BREAKPOINT_PC = 0x7100000100;
+
+// $x0 == 5 && *(uint32_t*) ($sp + 8) < 4, which is false in the state below
+const std::vector<uint8_t> CONDITION = {
+	0x26, 0x00, 0x00, 0x22, 5, 0x13,
+	0x20, 0x00, 0x0c, 0x22, 0, 0x27,
+	0x26, 0x00, 0x1f, 0x22, 8, 0x02, 0x19,
+	0x22, 4, 0x14, 0x27};
+
+std::vector<uint8_t> MakeStack() {
+	std::vector<uint8_t> stack(0x1000, 0);
+	uint32_t counter = 1000;
+	memcpy(stack.data() + 8, &counter, sizeof(counter));
+	return stack;
+}
+
+class CachedContext : public AgentExpression::Context {
+ public:
+	CachedContext() : stack(MakeStack()) {
+	}
+	
+	virtual uint64_t ReadRegister(uint16_t index) override {
+		return index == 0 ? 5 : index == 31 ? SP : 0;
+	}
+	
+	virtual void ReadMemory(uint64_t address, void *dest, size_t size) override {
+		memcpy(dest, stack.data() + (address - SP), size);
+	}
+ private:
+	std::vector<uint8_t> stack;
+};
+
+#if TWIB_GDB_ENABLED == 1
+// Evaluates the condition the way the stub does when a thread traps on a
+// conditional breakpoint, against a device that answers after `latency`.
+// Returns hits per second.
+double MeasureStubHits(std::chrono::microseconds latency, size_t hits, double &requests_per_hit) {
+	test::StoppedThreadClient client(SP, MakeStack(), latency);
+	client.registers[0] = 5;
+	client.registers[31] = SP;
+	client.registers[32] = BREAKPOINT_PC;
+	tool::gdb::GdbStub::Process process(0x82, client.OpenDebugger());
+	tool::gdb::GdbStub::Thread &thread = process.threads.emplace(
+		std::piecewise_construct,
+		std::forward_as_tuple(0x100),
+		std::forward_as_tuple(process, 0x100, 0)).first->second;
+	process.breakpoints[BREAKPOINT_PC].conditions.push_back(AgentExpression(CONDITION));
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for(size_t i = 0; i < hits; i++) {
+		uint64_t pc;
+		test::Consume(process.EvaluateBreakpointConditions(thread, pc));
+	}
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	requests_per_hit = (double) client.requests / hits;
+	return hits / elapsed.count();
+}
+#endif
+
+} // anonymous namespace
+
+TWIB_BENCHMARK(AgentExpression) {
+	AgentExpression condition(CONDITION);
+	CachedContext context;
+	b.Run("evaluate $x0 == 5 && *(int*) ($sp + 8) < 4", 0, [&]() {
+			test::Consume(*condition.Evaluate(context));
+		});
+
+#if TWIB_GDB_ENABLED == 1
+	// what a hit costs when the condition is false and gdb is never woken;
+	// 1 ms is about what a USB round trip to the console takes
+	for(int latency_us : {0, 1000}) {
+		double requests_per_hit;
+		double hits = MeasureStubHits(std::chrono::microseconds(latency_us), latency_us ? 200 : 20000, requests_per_hit);
+		std::string label = "stub hits, " + std::to_string(latency_us) + " us device latency";
+		b.Report(label.c_str(), hits, "hits/s");
+		b.Report((label + ", device requests").c_str(), requests_per_hit, "per hit");
+	}
+#endif
+}
@@ -0,0 +1,246 @@
+//
+// Twili - Homebrew debug monitor for the Nintendo Switch
+// Copyright (C) 2019 misson20000 <xenotoad@xenotoad.net>
+//
+// This file is part of Twili.
+//
+// Twili is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Twili is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Twili.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include "Test.hpp"
+
+#include<optional>
+#include<string>
+#include<vector>
+
+#include<string.h>
+
+#include "common/config.hpp"
+#include "common/ResultError.hpp"
+#include "tool/AgentExpression.hpp"
+#if TWIB_GDB_ENABLED == 1
+#include "tool/GdbStub.hpp"
+#include "StoppedThreadClient.hpp"
+#endif
+
+using namespace twili;
+using namespace twili::twib;
+using tool::gdb::AgentExpression;
+
+namespace {
+
+const uint64_t SP = 0x7100100000;
+
+// x0-x30, sp, pc, cpsr, with the variables a breakpoint condition would look
+// at sitting just above sp
+class TestContext : public AgentExpression::Context {
+ public:
+	TestContext() : registers(34, 0), memory(0x100, 0) {
+		registers[0] = 5;
+		registers[31] = SP;
+		registers[32] = 0x7100000100;
+		uint32_t counter = 3;
+		uint64_t pointer = 0x7100200000;
+		memcpy(memory.data() + 8, &counter, sizeof(counter));
+		memcpy(memory.data() + 16, &pointer, sizeof(pointer));
+	}
+	
+	virtual uint64_t ReadRegister(uint16_t index) override {
+		return index < registers.size() ? registers[index] : 0;
+	}
+	
+	virtual void ReadMemory(uint64_t address, void *dest, size_t size) override {
+		reads++;
+		if(address < SP || address + size > SP + memory.size()) {
+			throw ResultError(0xd401);
+		}
+		memcpy(dest, memory.data() + (address - SP), size);
+	}
+
+	std::vector<uint64_t> registers;
+	std::vector<uint8_t> memory;
+	size_t reads = 0;
+};
+
+struct ExpressionCase {
+	const char *name;
+	std::vector<uint8_t> bytecode;
+	std::optional<uint64_t> result;
+};
+
+const ExpressionCase EXPRESSION_CASES[] = {
+	{"const8 add", {0x22, 5, 0x22, 3, 0x02, 0x27}, 8},
+	{"const16 is big-endian", {0x23, 0x12, 0x34, 0x27}, 0x1234},
+	{"const32 is big-endian", {0x24, 0x12, 0x34, 0x56, 0x78, 0x27}, 0x12345678},
+	{"const64 is big-endian", {0x25, 0x01, 0x23, 0x45, 0x67, 0x89, 0xab, 0xcd, 0xef, 0x27}, 0x0123456789abcdef},
+	{"sub wraps", {0x22, 3, 0x22, 5, 0x03, 0x27}, (uint64_t) -2},
+	{"mul", {0x22, 6, 0x22, 7, 0x04, 0x27}, 42},
+	{"div_signed", {0x22, 0xf6, 0x16, 8, 0x22, 3, 0x05, 0x27}, (uint64_t) -3},
+	{"div_unsigned", {0x22, 100, 0x22, 7, 0x06, 0x27}, 14},
+	{"rem_signed", {0x22, 0xf6, 0x16, 8, 0x22, 3, 0x07, 0x27}, (uint64_t) -1},
+	{"rem_unsigned", {0x22, 100, 0x22, 7, 0x08, 0x27}, 2},
+	{"div by zero", {0x22, 1, 0x22, 0, 0x06, 0x27}, std::nullopt},
+	{"div_signed overflow", {0x25, 0x80, 0, 0, 0, 0, 0, 0, 0, 0x22, 0xff, 0x16, 8, 0x05, 0x27}, std::nullopt},
+	{"rem_signed overflow", {0x25, 0x80, 0, 0, 0, 0, 0, 0, 0, 0x22, 0xff, 0x16, 8, 0x07, 0x27}, std::nullopt},
+	{"lsh", {0x22, 1, 0x22, 63, 0x09, 0x27}, 0x8000000000000000},
+	{"lsh by 64", {0x22, 1, 0x22, 64, 0x09, 0x27}, 0},
+	{"rsh_signed", {0x22, 0x80, 0x16, 8, 0x22, 4, 0x0a, 0x27}, (uint64_t) -8},
+	{"rsh_unsigned", {0x22, 0x80, 0x22, 4, 0x0b, 0x27}, 8},
+	{"ext", {0x22, 0x7f, 0x16, 8, 0x27}, 0x7f},
+	{"zero_ext", {0x24, 0xff, 0xff, 0xff, 0xff, 0x2a, 8, 0x27}, 0xff},
+	{"log_not", {0x22, 0, 0x0e, 0x27}, 1},
+	{"bit ops", {0x22, 0x0c, 0x22, 0x0a, 0x0f, 0x22, 0x01, 0x10, 0x22, 0xff, 0x11, 0x12, 0x27}, ~(uint64_t) 0xf6},
+	{"equal", {0x22, 5, 0x22, 5, 0x13, 0x27}, 1},
+	{"less_signed", {0x22, 0xff, 0x16, 8, 0x22, 1, 0x14, 0x27}, 1},
+	{"less_unsigned", {0x22, 0xff, 0x16, 8, 0x22, 1, 0x15, 0x27}, 0},
+	{"if_goto taken", {0x22, 1, 0x20, 0x00, 0x08, 0x22, 7, 0x27, 0x22, 9, 0x27}, 9},
+	{"if_goto not taken", {0x22, 0, 0x20, 0x00, 0x08, 0x22, 7, 0x27, 0x22, 9, 0x27}, 7},
+	{"goto", {0x21, 0x00, 0x05, 0x22, 7, 0x22, 9, 0x27}, 9},
+	{"dup", {0x22, 3, 0x28, 0x04, 0x27}, 9},
+	{"pop", {0x22, 3, 0x22, 4, 0x29, 0x27}, 3},
+	{"swap", {0x22, 1, 0x22, 2, 0x2b, 0x03, 0x27}, 1},
+	{"pick", {0x22, 5, 0x22, 6, 0x32, 1, 0x27}, 5},
+	{"rot", {0x22, 1, 0x22, 2, 0x22, 3, 0x33, 0x29, 0x29, 0x27}, 3},
+	{"trace opcodes keep stack effects", {0x22, 4, 0x0d, 8, 0x30, 0x00, 0x08, 0x2e, 0x00, 0x01, 0x27}, 4},
+	{"stack underflow", {0x02, 0x27}, std::nullopt},
+	{"pick underflow", {0x22, 1, 0x32, 1, 0x27}, std::nullopt},
+	{"stack overflow", {0x22, 1, 0x28, 0x21, 0x00, 0x02}, std::nullopt},
+	{"infinite loop", {0x21, 0x00, 0x00}, std::nullopt},
+	{"truncated immediate", {0x23, 0x12}, std::nullopt},
+	{"truncated jump", {0x22, 1, 0x20, 0x00}, std::nullopt},
+	{"runs off the end", {0x22, 1}, std::nullopt},
+	{"jumps off the end", {0x21, 0x01, 0x00}, std::nullopt},
+	{"unsupported opcode", {0x01, 0x27}, std::nullopt},
+};
+
+std::string Describe(std::optional<uint64_t> result) {
+	return result ? std::to_string(*result) : "nothing";
+}
+
+} // anonymous namespace
+
+TWIB_TEST(AgentExpression, Interprets) {
+	for(const ExpressionCase &c : EXPRESSION_CASES) {
+		TestContext context;
+		std::optional<uint64_t> result = AgentExpression(c.bytecode).Evaluate(context);
+		if(result != c.result) {
+			throw test::Failure(__FILE__, __LINE__, std::string(c.name) + ": got " + Describe(result) + ", expected " + Describe(c.result));
+		}
+	}
+}
+
+TWIB_TEST(AgentExpression, ReadsRegistersAndMemory) {
+	TestContext context;
+	// $x0 == 5 && *(uint32_t*) ($sp + 8) < 4
+	AgentExpression expression({
+			0x26, 0x00, 0x00, 0x22, 5, 0x13, // reg x0, const8 5, equal
+			0x20, 0x00, 0x0c, 0x22, 0, 0x27, // if_goto, const8 0, end
+			0x26, 0x00, 0x1f, 0x22, 8, 0x02, 0x19, // reg sp, const8 8, add, ref32
+			0x22, 4, 0x14, 0x27}); // const8 4, less_signed, end
+	CHECK_EQ(*expression.Evaluate(context), (uint64_t) 1);
+	CHECK_EQ(context.reads, (size_t) 1);
+
+	context.registers[0] = 6;
+	CHECK_EQ(*expression.Evaluate(context), (uint64_t) 0);
+	CHECK_EQ(context.reads, (size_t) 1); // short-circuited
+}
+
+TWIB_TEST(AgentExpression, ReadsLittleEndianMemory) {
+	TestContext context;
+	// *(uint64_t*) ($sp + 16)
+	CHECK_EQ(*AgentExpression({0x26, 0x00, 0x1f, 0x22, 16, 0x02, 0x1a, 0x27}).Evaluate(context), (uint64_t) 0x7100200000);
+	// *(uint32_t*) ($sp + 20)
+	CHECK_EQ(*AgentExpression({0x26, 0x00, 0x1f, 0x22, 20, 0x02, 0x19, 0x27}).Evaluate(context), (uint64_t) 0x71);
+}
+
+TWIB_TEST(AgentExpression, FailsOnUnreadableMemory) {
+	TestContext context;
+	// *(uint8_t*) 0
+	CHECK(!AgentExpression({0x22, 0, 0x17, 0x27}).Evaluate(context));
+}
+
+#if TWIB_GDB_ENABLED == 1
+namespace {
+
+const uint64_t BREAKPOINT_PC = 0x7100000100;
+const uint64_t THREAD_ID = 0x100;
+
+// Sets up a process stopped at a breakpoint on BREAKPOINT_PC, with the
+// stack in TestContext's layout.
+struct StoppedProcess {
+	StoppedProcess() :
+		client(SP, TestContext().memory),
+		process(0x81, client.OpenDebugger()) {
+		client.registers[0] = 5;
+		client.registers[31] = SP;
+		client.registers[32] = BREAKPOINT_PC;
+		process.threads.emplace(
+			std::piecewise_construct,
+			std::forward_as_tuple(THREAD_ID),
+			std::forward_as_tuple(process, THREAD_ID, 0));
+		process.breakpoints[BREAKPOINT_PC] = {};
+	}
+
+	bool ShouldStop() {
+		uint64_t pc = 0;
+		bool stop = process.EvaluateBreakpointConditions(process.threads.at(THREAD_ID), pc);
+		CHECK_EQ(pc, BREAKPOINT_PC);
+		return stop;
+	}
+	
+	test::StoppedThreadClient client;
+	tool::gdb::GdbStub::Process process;
+};
+
+// *(uint32_t*) ($sp + 8) == value
+AgentExpression CounterEquals(uint8_t value) {
+	return AgentExpression({0x26, 0x00, 0x1f, 0x22, 8, 0x02, 0x19, 0x22, value, 0x13, 0x27});
+}
+
+} // anonymous namespace
+
+TWIB_TEST(AgentExpression, StubStopsUnconditionally) {
+	StoppedProcess p;
+	CHECK(p.ShouldStop());
+}
+
+TWIB_TEST(AgentExpression, StubSkipsFalseConditions) {
+	StoppedProcess p;
+	p.process.breakpoints[BREAKPOINT_PC].conditions.push_back(CounterEquals(4));
+	CHECK(!p.ShouldStop());
+	p.process.breakpoints[BREAKPOINT_PC].conditions.push_back(CounterEquals(3));
+	CHECK(p.ShouldStop());
+}
+
+TWIB_TEST(AgentExpression, StubCachesMemoryPerHit) {
+	StoppedProcess p;
+	// several conditions over variables next to each other should cost one
+	// thread context fetch and one memory read
+	for(uint8_t v = 10; v < 20; v++) {
+		p.process.breakpoints[BREAKPOINT_PC].conditions.push_back(CounterEquals(v));
+	}
+	p.process.breakpoints[BREAKPOINT_PC].conditions.push_back(
+		AgentExpression({0x26, 0x00, 0x1f, 0x22, 16, 0x02, 0x1a, 0x22, 0, 0x13, 0x27}));
+	CHECK(!p.ShouldStop());
+	CHECK_EQ(p.client.requests, (size_t) 2);
+}
+
+TWIB_TEST(AgentExpression, StubStopsWhenConditionFails) {
+	StoppedProcess p;
+	// like gdb, stop if the condition can't be evaluated
+	p.process.breakpoints[BREAKPOINT_PC].conditions.push_back(AgentExpression({0x22, 0, 0x17, 0x27}));
+	CHECK(p.ShouldStop());
+}
+#endif
@@ -0,0 +1,120 @@
+//
+// Twili - Homebrew debug monitor for the Nintendo Switch
+// Copyright (C) 2019 misson20000 <xenotoad@xenotoad.net>
+//
+// This file is part of Twili.
+//
+// Twili is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Twili is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Twili.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "Benchmark.hpp"
+
+#include<stdio.h>
+#include<string.h>
+
+#include<chrono>
+#include<vector>
+
+namespace twili {
+namespace twib {
+namespace test {
+
+namespace {
+
+struct BenchmarkCase {
+	const char *name;
+	void (*function)(Benchmark &b);
+};
+
+std::vector<BenchmarkCase> &GetBenchmarkCases() {
+	static std::vector<BenchmarkCase> cases;
+	return cases;
+}
+
+volatile uint64_t sink;
+
+} // anonymous namespace
+
+void Benchmark::Run(const char *label, uint64_t bytes, std::function<void()> function) {
+	using clock = std::chrono::steady_clock;
+	
+	// find an iteration count that takes long enough to time well
+	uint64_t iterations = 1;
+	std::chrono::duration<double> elapsed;
+	while(true) {
+		clock::time_point start = clock::now();
+		for(uint64_t i = 0; i < iterations; i++) {
+			function();
+		}
+		elapsed = clock::now() - start;
+		if(elapsed.count() >= 0.5) {
+			break;
+		}
+		if(elapsed.count() < 0.05) {
+			iterations*= 10;
+		} else {
+			iterations = (uint64_t) (iterations * 0.6 / elapsed.count()) + 1;
+		}
+	}
+
+	double ns_per_call = elapsed.count() * 1e9 / iterations;
+	if(bytes) {
+		printf("  %-48s %12.1f ns/op %10.1f MiB/s\n", label, ns_per_call, bytes * iterations / elapsed.count() / (1024.0 * 1024.0));
+	} else {
+		printf("  %-48s %12.1f ns/op\n", label, ns_per_call);
+	}
+	fflush(stdout);
+}
+
+void Benchmark::Report(const char *label, double value, const char *unit) {
+	printf("  %-48s %12.1f %s\n", label, value, unit);
+	fflush(stdout);
+}
+
+BenchmarkRegistration::BenchmarkRegistration(const char *name, void (*function)(Benchmark &b)) {
+	GetBenchmarkCases().push_back({name, function});
+}
+
+void Consume(uint64_t value) {
+	sink^= value;
+}
+
+} // namespace test
+} // namespace twib
+} // namespace twili
+
+using namespace twili::twib;
+
+// usage: twib-bench [name...]
+int main(int argc, char *argv[]) {
+	int ran = 0;
+	for(test::BenchmarkCase &bc : test::GetBenchmarkCases()) {
+		bool selected = argc <= 1;
+		for(int i = 1; i < argc; i++) {
+			selected|= strcmp(argv[i], bc.name) == 0;
+		}
+		if(!selected) {
+			continue;
+		}
+		printf("%s\n", bc.name);
+		test::Benchmark b;
+		bc.function(b);
+		ran++;
+	}
+	if(ran == 0) {
+		fprintf(stderr, "no matching benchmarks\n");
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,56 @@
+//
+// Twili - Homebrew debug monitor for the Nintendo Switch
+// Copyright (C) 2019 misson20000 <xenotoad@xenotoad.net>
+//
+// This file is part of Twili.
+//
+// Twili is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Twili is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Twili.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#pragma once
+
+#include<functional>
+
+#include<stdint.h>
+
+namespace twili {
+namespace twib {
+namespace test {
+
+class Benchmark {
+ public:
+	// Calls function over and over for about half a second, then prints how
+	// long each call took. If bytes is nonzero, also prints the throughput
+	// for processing that many bytes per call.
+	void Run(const char *label, uint64_t bytes, std::function<void()> function);
+	// Prints a measurement that was taken some other way.
+	void Report(const char *label, double value, const char *unit);
+};
+
+class BenchmarkRegistration {
+ public:
+	BenchmarkRegistration(const char *name, void (*function)(Benchmark &b));
+};
+
+// Keeps the compiler from optimizing away work whose result is unused.
+void Consume(uint64_t value);
+
+} // namespace test
+} // namespace twib
+} // namespace twili
+
+#define TWIB_BENCHMARK(name) \
+	static void benchmark_##name(::twili::twib::test::Benchmark &b); \
+	static ::twili::twib::test::BenchmarkRegistration registration_##name(#name, &benchmark_##name); \
+	static void benchmark_##name(::twili::twib::test::Benchmark &b)
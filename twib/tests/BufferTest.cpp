@@ -0,0 +1,107 @@
+//
+// Twili - Homebrew debug monitor for the Nintendo Switch
+// Copyright (C) 2019 misson20000 <xenotoad@xenotoad.net>
+//
+// This file is part of Twili.
+//
+// Twili is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Twili is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Twili.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include "Test.hpp"
+
+#include<tuple>
+
+#include "Buffer.hpp"
+
+using namespace twili;
+
+namespace {
+
+void Fill(util::Buffer &buffer, size_t size, uint8_t first) {
+	for(size_t i = 0; i < size; i++) {
+		buffer.Write<uint8_t>(first + i);
+	}
+}
+
+} // anonymous namespace
+
+TWIB_TEST(Buffer, TakeDataHandsOverStorageFromTheStart) {
+	util::Buffer buffer;
+	uint8_t *storage = std::get<0>(buffer.Reserve(0x10000 + 10));
+	Fill(buffer, 0x10000 + 10, 0);
+
+	std::vector<uint8_t> taken = buffer.TakeData(0x10000);
+	CHECK(taken.data() == storage);
+	CHECK_EQ(taken.size(), (size_t) 0x10000);
+	CHECK_EQ(taken[0x1234], (uint8_t) 0x34);
+
+	// what followed is still there, in new storage
+	CHECK_EQ(buffer.ReadAvailable(), (size_t) 10);
+	CHECK(buffer.Read() != storage);
+	uint8_t next;
+	CHECK(buffer.Read(next));
+	CHECK_EQ(next, (uint8_t) 0x00);
+	Fill(buffer, 3, 0xa0);
+	CHECK_EQ(buffer.ReadAvailable(), (size_t) 12);
+}
+
+TWIB_TEST(Buffer, TakeDataCopiesFromTheMiddle) {
+	util::Buffer buffer;
+	Fill(buffer, 100, 0);
+	uint8_t skipped[10];
+	CHECK(buffer.Read(skipped, sizeof(skipped)));
+	uint8_t *storage = buffer.Read();
+
+	std::vector<uint8_t> taken = buffer.TakeData(50);
+	CHECK(taken.data() != storage);
+	CHECK_EQ(taken.size(), (size_t) 50);
+	CHECK_EQ(taken[0], (uint8_t) 10);
+	CHECK_EQ(buffer.ReadAvailable(), (size_t) 40);
+	CHECK_EQ(*buffer.Read(), (uint8_t) 60);
+}
+
+TWIB_TEST(Buffer, CompactKeepsUnreadData) {
+	util::Buffer buffer;
+	Fill(buffer, 100, 0);
+	uint8_t skipped[30];
+	CHECK(buffer.Read(skipped, sizeof(skipped)));
+	buffer.Compact();
+	CHECK_EQ(buffer.ReadAvailable(), (size_t) 70);
+	CHECK_EQ(*buffer.Read(), (uint8_t) 30);
+	std::vector<uint8_t> rest = buffer.TakeData();
+	CHECK_EQ(rest.size(), (size_t) 70);
+	CHECK_EQ(rest[69], (uint8_t) 99);
+}
+
+TWIB_TEST(Buffer, MoveTakesStorage) {
+	util::Buffer buffer;
+	Fill(buffer, 0x10000, 0);
+	uint8_t *storage = buffer.Read();
+
+	util::Buffer moved(std::move(buffer));
+	CHECK(moved.Read() == storage);
+	CHECK_EQ(moved.ReadAvailable(), (size_t) 0x10000);
+
+	// the moved-from buffer is empty, but still usable
+	CHECK_EQ(buffer.ReadAvailable(), (size_t) 0);
+	Fill(buffer, 4, 0x40);
+	CHECK_EQ(buffer.ReadAvailable(), (size_t) 4);
+	CHECK_EQ(*buffer.Read(), (uint8_t) 0x40);
+
+	util::Buffer assigned;
+	assigned = std::move(moved);
+	CHECK(assigned.Read() == storage);
+	CHECK_EQ(moved.ReadAvailable(), (size_t) 0);
+}
@@ -0,0 +1,164 @@
+//
+// Twili - Homebrew debug monitor for the Nintendo Switch
+// Copyright (C) 2019 misson20000 <xenotoad@xenotoad.net>
+//
+// This file is part of Twili.
+//
+// Twili is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Twili is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Twili.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include "Test.hpp"
+
+#include<algorithm>
+#include<memory>
+
+#include<string.h>
+
+#include "common/config.hpp"
+#include "tool/Client.hpp"
+#include "tool/interfaces/ITwibDebugger.hpp"
+#if TWIB_GDB_ENABLED == 1
+#include "tool/GdbStub.hpp"
+#endif
+
+#include "err.hpp"
+
+using namespace twili;
+using namespace twili::twib;
+
+namespace {
+
+const uint32_t KERNEL_ERR_NO_DEBUG_EVENTS = 0x8c01;
+// what Twili sends back per GET_DEBUG_EVENTS
+const size_t MAX_EVENTS_PER_RESPONSE = 256;
+
+// Plays a device whose debugger has a queue of AttachThread events, answering
+// requests as soon as they're sent and counting the ones that fetch events.
+class FakeDebuggerClient : public tool::client::Client {
+ public:
+	FakeDebuggerClient(size_t event_count, bool supports_bulk) :
+		event_count(event_count),
+		supports_bulk(supports_bulk) {
+	}
+
+	size_t round_trips = 0;
+ protected:
+	virtual void SendRequestImpl(const tool::Request &rq) override {
+		util::Buffer payload;
+		uint32_t result = 0;
+		switch((protocol::ITwibDebugger::Command) rq.command_id) {
+		case protocol::ITwibDebugger::Command::GET_DEBUG_EVENT:
+			round_trips++;
+			if(next_event < event_count) {
+				payload.Write(MakeEvent(next_event++));
+			} else {
+				result = KERNEL_ERR_NO_DEBUG_EVENTS;
+			}
+			break;
+		case protocol::ITwibDebugger::Command::GET_DEBUG_EVENTS: {
+			round_trips++;
+			if(!supports_bulk) {
+				result = TWILI_ERR_PROTOCOL_UNRECOGNIZED_FUNCTION;
+				break;
+			}
+			size_t count = std::min(event_count - next_event, MAX_EVENTS_PER_RESPONSE);
+			payload.Write<uint64_t>(count);
+			for(size_t i = 0; i < count; i++) {
+				payload.Write(MakeEvent(next_event++));
+			}
+			break; }
+		default:
+			result = TWILI_ERR_PROTOCOL_UNRECOGNIZED_FUNCTION;
+			break;
+		}
+
+		protocol::MessageHeader mh;
+		mh.device_id = rq.device_id;
+		mh.object_id = rq.object_id;
+		mh.result_code = result;
+		mh.tag = rq.tag;
+		mh.payload_size = payload.ReadAvailable();
+		mh.object_count = 0;
+		util::Buffer object_ids;
+		PostResponse(mh, payload, object_ids);
+	}
+ private:
+	static nx::DebugEvent MakeEvent(size_t index) {
+		nx::DebugEvent event;
+		memset(&event, 0, sizeof(event));
+		event.event_type = nx::DebugEvent::EventType::AttachThread;
+		event.thread_id = 0x100 + index;
+		event.attach_thread.thread_id = 0x100 + index;
+		return event;
+	}
+	
+	const size_t event_count;
+	const bool supports_bulk;
+	size_t next_event = 0;
+};
+
+tool::ITwibDebugger OpenDebugger(tool::client::Client &client) {
+	return tool::ITwibDebugger(std::make_shared<tool::RemoteObject>(client, 1, 1));
+}
+
+} // anonymous namespace
+
+TWIB_TEST(DebugEvents, DrainsHundredsInFewRoundTrips) {
+	FakeDebuggerClient client(600, true);
+	tool::ITwibDebugger debugger = OpenDebugger(client);
+
+	std::vector<nx::DebugEvent> events;
+	std::vector<nx::DebugEvent> batch;
+	while(!(batch = debugger.GetDebugEvents()).empty()) {
+		events.insert(events.end(), batch.begin(), batch.end());
+	}
+	CHECK_EQ(events.size(), (size_t) 600);
+	for(size_t i = 0; i < events.size(); i++) {
+		CHECK_EQ(events[i].thread_id, (uint64_t) 0x100 + i);
+	}
+	// three full responses, then an empty one
+	CHECK_EQ(client.round_trips, (size_t) 4);
+}
+
+TWIB_TEST(DebugEvents, FallsBackToOneAtATime) {
+	FakeDebuggerClient client(10, false);
+	tool::ITwibDebugger debugger = OpenDebugger(client);
+
+	std::vector<nx::DebugEvent> events = debugger.GetDebugEvents();
+	CHECK_EQ(events.size(), (size_t) 10);
+	CHECK_EQ(events.back().thread_id, (uint64_t) 0x109);
+	// the unrecognized GET_DEBUG_EVENTS, one per event, and the last empty one
+	CHECK_EQ(client.round_trips, (size_t) 12);
+
+	// having been told once, it doesn't ask for GET_DEBUG_EVENTS again
+	CHECK(debugger.GetDebugEvents().empty());
+	CHECK_EQ(client.round_trips, (size_t) 13);
+}
+
+#if TWIB_GDB_ENABLED == 1
+TWIB_TEST(DebugEvents, StubFetchesEventsInBulk) {
+	FakeDebuggerClient client(300, true);
+	tool::gdb::GdbStub::Process process(0x81, OpenDebugger(client));
+
+	size_t count = 0;
+	std::optional<nx::DebugEvent> event;
+	while((event = process.NextEvent())) {
+		CHECK_EQ(event->thread_id, (uint64_t) 0x100 + count);
+		count++;
+	}
+	CHECK_EQ(count, (size_t) 300);
+	CHECK_EQ(client.round_trips, (size_t) 3);
+}
+#endif
@@ -0,0 +1,193 @@
+//
+// Twili - Homebrew debug monitor for the Nintendo Switch
+// Copyright (C) 2019 misson20000 <xenotoad@xenotoad.net>
+//
+// This file is part of Twili.
+//
+// Twili is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Twili is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Twili.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include "Test.hpp"
+
+#include<fstream>
+#include<sstream>
+#include<string>
+#include<vector>
+
+#include<stdio.h>
+#include<stdlib.h>
+
+#ifndef _WIN32
+#include<unistd.h>
+#endif
+
+#include "daemon/DeviceLog.hpp"
+
+using namespace twili;
+using namespace twili::twib;
+
+namespace {
+
+std::vector<std::string> ReadAll(daemon::DeviceLog &log, uint64_t &sequence, uint64_t &dropped, size_t max_size = 0x10000) {
+	std::vector<std::string> out;
+	sequence = log.Read(sequence, max_size, out, dropped);
+	return out;
+}
+
+} // anonymous namespace
+
+TWIB_TEST(DeviceLog, SplitsLines) {
+	util::Buffer buffer;
+	std::vector<std::string> lines;
+	buffer.Write("first\nsecond\r\n\npart");
+	daemon::DeviceLog::SplitLines(buffer, lines);
+	CHECK_EQ(lines.size(), (size_t) 3);
+	CHECK_EQ(lines[0], std::string("first"));
+	CHECK_EQ(lines[1], std::string("second"));
+	CHECK_EQ(lines[2], std::string(""));
+
+	// a partial line waits for the rest of it
+	CHECK_EQ(buffer.ReadAvailable(), (size_t) 4);
+	buffer.Write("ial\n");
+	daemon::DeviceLog::SplitLines(buffer, lines);
+	CHECK_EQ(lines.size(), (size_t) 4);
+	CHECK_EQ(lines[3], std::string("partial"));
+	CHECK_EQ(buffer.ReadAvailable(), (size_t) 0);
+}
+
+TWIB_TEST(DeviceLog, SplitsOverlongLines) {
+	util::Buffer buffer;
+	std::vector<std::string> lines;
+	buffer.Write("0123456789abc");
+	daemon::DeviceLog::SplitLines(buffer, lines, 8);
+	CHECK_EQ(lines.size(), (size_t) 1);
+	CHECK_EQ(lines[0], std::string("0123456789abc"));
+	CHECK_EQ(buffer.ReadAvailable(), (size_t) 0);
+
+	buffer.Write("short");
+	daemon::DeviceLog::SplitLines(buffer, lines, 8);
+	CHECK_EQ(lines.size(), (size_t) 1);
+}
+
+TWIB_TEST(DeviceLog, ReadsFromSequence) {
+	daemon::DeviceLog::Config config;
+	daemon::DeviceLog log(1, config);
+	CHECK_EQ(log.GetEndSequence(), (uint64_t) 0);
+	log.Append("a");
+	log.Append("b");
+	log.Append("c");
+	CHECK_EQ(log.GetEndSequence(), (uint64_t) 3);
+
+	uint64_t sequence = 1, dropped;
+	std::vector<std::string> lines = ReadAll(log, sequence, dropped);
+	CHECK_EQ(lines.size(), (size_t) 2);
+	CHECK_EQ(lines[0], std::string("b"));
+	CHECK_EQ(lines[1], std::string("c"));
+	CHECK_EQ(sequence, (uint64_t) 3);
+	CHECK_EQ(dropped, (uint64_t) 0);
+
+	// caught up, and reading from past the end doesn't skip anything later
+	CHECK(ReadAll(log, sequence, dropped).empty());
+	uint64_t ahead = 10;
+	CHECK(ReadAll(log, ahead, dropped).empty());
+	CHECK_EQ(ahead, (uint64_t) 3);
+	log.Append("d");
+	lines = ReadAll(log, sequence, dropped);
+	CHECK_EQ(lines.size(), (size_t) 1);
+	CHECK_EQ(lines[0], std::string("d"));
+}
+
+TWIB_TEST(DeviceLog, DropsOldestLinesPastCapacity) {
+	daemon::DeviceLog::Config config;
+	config.capacity = 10;
+	daemon::DeviceLog log(1, config);
+	for(const char *line : {"0000", "1111", "2222", "3333"}) {
+		log.Append(line);
+	}
+
+	uint64_t sequence = 0, dropped;
+	std::vector<std::string> lines = ReadAll(log, sequence, dropped);
+	CHECK_EQ(dropped, (uint64_t) 2);
+	CHECK_EQ(lines.size(), (size_t) 2);
+	CHECK_EQ(lines[0], std::string("2222"));
+	CHECK_EQ(sequence, (uint64_t) 4);
+
+	// the newest line is kept even if it's bigger than the whole ring
+	log.Append(std::string(64, 'x'));
+	lines = ReadAll(log, sequence, dropped);
+	CHECK_EQ(lines.size(), (size_t) 1);
+	CHECK_EQ(lines[0].size(), (size_t) 64);
+}
+
+TWIB_TEST(DeviceLog, LimitsReadSize) {
+	daemon::DeviceLog::Config config;
+	daemon::DeviceLog log(1, config);
+	log.Append(std::string(100, 'a'));
+	log.Append(std::string(100, 'b'));
+	log.Append(std::string(100, 'c'));
+
+	uint64_t sequence = 0, dropped;
+	CHECK_EQ(ReadAll(log, sequence, dropped, 250).size(), (size_t) 2);
+	CHECK_EQ(sequence, (uint64_t) 2);
+	// a line over the limit still comes back on its own
+	CHECK_EQ(ReadAll(log, sequence, dropped, 10).size(), (size_t) 1);
+	CHECK_EQ(sequence, (uint64_t) 3);
+}
+
+#ifndef _WIN32
+TWIB_TEST(DeviceLog, RotatesFiles) {
+	char name[] = "/tmp/twib-test-XXXXXX";
+	CHECK(mkdtemp(name) != nullptr);
+	std::string directory = name;
+	auto slurp = [&](const char *file) {
+		std::ifstream stream(directory + "/" + file);
+		std::stringstream contents;
+		contents << stream.rdbuf();
+		return contents.str();
+	};
+
+	daemon::DeviceLog::Config config;
+	config.directory = directory;
+	config.file_size = 12;
+	config.file_count = 3;
+	{
+		daemon::DeviceLog log(0xabcd, config);
+		for(const char *line : {"line0", "line1", "line2", "line3", "line4", "line5", "line6"}) {
+			log.Append(line);
+		}
+	}
+
+	// two lines fit in each file, and the oldest file is gone
+	CHECK_EQ(slurp("0000abcd.log"), std::string("line6\n"));
+	CHECK_EQ(slurp("0000abcd.log.1"), std::string("line4\nline5\n"));
+	CHECK_EQ(slurp("0000abcd.log.2"), std::string("line2\nline3\n"));
+	CHECK(access((directory + "/0000abcd.log.3").c_str(), F_OK) != 0);
+
+	// a new log picks up where the current file left off, and a flush puts
+	// what's been appended on disk without closing it
+	{
+		daemon::DeviceLog log(0xabcd, config);
+		log.Append("line7");
+		log.Flush();
+		CHECK_EQ(slurp("0000abcd.log"), std::string("line6\nline7\n"));
+	}
+	CHECK_EQ(slurp("0000abcd.log"), std::string("line6\nline7\n"));
+
+	for(const char *file : {"0000abcd.log", "0000abcd.log.1", "0000abcd.log.2"}) {
+		remove((directory + "/" + file).c_str());
+	}
+	rmdir(name);
+}
+#endif
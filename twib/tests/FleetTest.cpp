@@ -0,0 +1,132 @@
+//
+// Twili - Homebrew debug monitor for the Nintendo Switch
+// Copyright (C) 2019 misson20000 <xenotoad@xenotoad.net>
+//
+// This file is part of Twili.
+//
+// Twili is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Twili is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Twili.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include "Test.hpp"
+#include "SimDaemon.hpp"
+
+#include<map>
+
+using namespace twili::twib;
+
+namespace {
+
+struct DeviceBlock {
+	bool ok;
+	std::string output, errors;
+};
+
+// Splits `twib --fleet` output into the block printed for each device, keyed
+// by nickname.
+std::map<std::string, DeviceBlock> SplitBlocks(const std::string &output) {
+	std::map<std::string, DeviceBlock> blocks;
+	DeviceBlock *current = nullptr;
+	size_t begin = 0;
+	while(begin < output.size()) {
+		size_t end = output.find('\n', begin);
+		end = end == std::string::npos ? output.size() : end + 1;
+		std::string line = output.substr(begin, end - begin);
+		begin = end;
+
+		// === 0123abcd (nickname): ok ===
+		size_t open = line.find(" (");
+		size_t close = line.find("): ");
+		if(line.compare(0, 4, "=== ") == 0 && open != std::string::npos && close != std::string::npos) {
+			std::string nickname = line.substr(open + 2, close - open - 2);
+			CHECK(blocks.find(nickname) == blocks.end());
+			current = &blocks[nickname];
+			current->ok = line.compare(close + 3, 2, "ok") == 0;
+		} else {
+			CHECK(current != nullptr);
+			current->output+= line;
+		}
+	}
+	return blocks;
+}
+
+} // anonymous namespace
+
+TWIB_TEST(Fleet, RunsOnEveryDeviceAndReportsFailures) {
+	test::SimDaemon daemon({"--sim-devices", "4", "--sim-failing-devices", "1"});
+	CHECK(daemon.WaitForDevices(4));
+
+	std::string output, errors;
+	CHECK_EQ(daemon.RunTwib({"-F", "ps"}, output, errors), 1);
+
+	std::map<std::string, DeviceBlock> blocks = SplitBlocks(output);
+	CHECK_EQ(blocks.size(), (size_t) 4);
+	for(const char *nickname : {"sim-0", "sim-1", "sim-2"}) {
+		CHECK(blocks[nickname].ok);
+		CHECK(blocks[nickname].output.find("simapplet") != std::string::npos);
+		CHECK(blocks[nickname].output.find("simapp ") != std::string::npos);
+	}
+	CHECK(!blocks["sim-3"].ok);
+	CHECK(blocks["sim-3"].output.find("simapp") == std::string::npos);
+	CHECK(errors.find("failed on 1 of 4 devices") != std::string::npos);
+}
+
+TWIB_TEST(Fleet, KeepsEachDevicesOutputTogether) {
+	// with more jobs than devices, every device runs at once, so their
+	// output would interleave if it weren't buffered
+	test::SimDaemon daemon({"--sim-devices", "6", "--sim-latency", "2000"});
+	CHECK(daemon.WaitForDevices(6));
+
+	std::string output, errors;
+	CHECK_EQ(daemon.RunTwib({"-F", "-j", "8", "ps"}, output, errors), 0);
+	
+	std::map<std::string, DeviceBlock> blocks = SplitBlocks(output);
+	CHECK_EQ(blocks.size(), (size_t) 6);
+	for(auto &i : blocks) {
+		CHECK(i.second.ok);
+		// the header row and both processes, all in this device's block
+		CHECK_EQ(i.second.output.find("Process ID"), (size_t) 0);
+		CHECK(i.second.output.find("simapplet") != std::string::npos);
+		CHECK(i.second.output.find("simapp ") != std::string::npos);
+	}
+}
+
+TWIB_TEST(Fleet, OneJobAtATime) {
+	test::SimDaemon daemon({"--sim-devices", "3", "--sim-failing-devices", "2"});
+	CHECK(daemon.WaitForDevices(3));
+
+	std::string output, errors;
+	CHECK_EQ(daemon.RunTwib({"-F", "-j", "1", "ps"}, output, errors), 1);
+
+	std::map<std::string, DeviceBlock> blocks = SplitBlocks(output);
+	CHECK_EQ(blocks.size(), (size_t) 3);
+	CHECK(blocks["sim-0"].ok);
+	CHECK(!blocks["sim-1"].ok);
+	CHECK(!blocks["sim-2"].ok);
+	CHECK(errors.find("failed on 2 of 3 devices") != std::string::npos);
+}
+
+TWIB_TEST(Fleet, MatchSelectsDevices) {
+	test::SimDaemon daemon({"--sim-devices", "4", "--sim-failing-devices", "1"});
+	CHECK(daemon.WaitForDevices(4));
+
+	std::string output, errors;
+	CHECK_EQ(daemon.RunTwib({"-F", "--fleet-match", "sim-1", "ps"}, output, errors), 0);
+
+	std::map<std::string, DeviceBlock> blocks = SplitBlocks(output);
+	CHECK_EQ(blocks.size(), (size_t) 1);
+	CHECK(blocks["sim-1"].ok);
+
+	CHECK_EQ(daemon.RunTwib({"-F", "--fleet-match", "no-such-device", "ps"}, output, errors), 1);
+}
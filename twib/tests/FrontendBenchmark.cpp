@@ -0,0 +1,121 @@
+//
+// Twili - Homebrew debug monitor for the Nintendo Switch
+// Copyright (C) 2019 misson20000 <xenotoad@xenotoad.net>
+//
+// This file is part of Twili.
+//
+// Twili is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Twili is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Twili.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include "Benchmark.hpp"
+#include "SimDaemon.hpp"
+
+#include<atomic>
+#include<chrono>
+#include<memory>
+#include<stdexcept>
+#include<string>
+#include<thread>
+#include<vector>
+
+#include "tool/interfaces/ITwibDeviceInterface.hpp"
+#include "tool/interfaces/ITwibMetaInterface.hpp"
+
+using namespace twili::twib;
+
+namespace {
+
+const size_t DEVICE_COUNT = 8;
+const uint64_t SIM_APP_PID = 0x82;
+const uint64_t SIM_MEMORY_BASE = 0x7100000000;
+
+// Each client gets its own connection and keeps one READ_MEMORY of `size`
+// bytes in flight to one of the devices. Returns requests per second across
+// every client.
+double MeasureClients(test::SimDaemon &daemon, size_t client_count, uint64_t size) {
+	std::atomic<bool> running(true);
+	std::atomic<uint64_t> requests(0);
+	std::vector<std::thread> threads;
+	for(size_t i = 0; i < client_count; i++) {
+		threads.emplace_back([&, i]() {
+				std::unique_ptr<tool::client::Client> client = daemon.Connect();
+				std::vector<uint32_t> devices = test::ListDeviceIds(*client);
+				tool::ITwibDeviceInterface itdi(std::make_shared<tool::RemoteObject>(*client, devices[i % devices.size()], 0));
+				tool::ITwibDebugger debugger = itdi.OpenActiveDebugger(SIM_APP_PID);
+				while(running) {
+					test::Consume(debugger.ReadMemory(SIM_MEMORY_BASE, size).size());
+					requests++;
+				}
+			});
+	}
+
+	// let every client connect before measuring
+	std::this_thread::sleep_for(std::chrono::milliseconds(200));
+	uint64_t before = requests;
+	auto start = std::chrono::steady_clock::now();
+	std::this_thread::sleep_for(std::chrono::seconds(1));
+	uint64_t after = requests;
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	running = false;
+	for(std::thread &thread : threads) {
+		thread.join();
+	}
+	return (after - before) / elapsed.count();
+}
+
+} // anonymous namespace
+
+TWIB_BENCHMARK(Frontend) {
+	for(size_t thread_count : {1, 2, 4}) {
+		test::SimDaemon daemon({"--sim-devices", std::to_string(DEVICE_COUNT), "--frontend-threads", std::to_string(thread_count)});
+		if(!daemon.WaitForDevices(DEVICE_COUNT)) {
+			throw std::runtime_error("simulated devices didn't show up");
+		}
+		for(size_t client_count : {1, 16, 64}) {
+			for(uint64_t size : {0x100, 0x10000}) {
+				std::string label =
+					std::to_string(thread_count) + " threads, " +
+					std::to_string(client_count) + " clients, " +
+					std::to_string(size) + " byte reads";
+				b.Report(label.c_str(), MeasureClients(daemon, client_count, size), "requests/s");
+			}
+		}
+	}
+}
+
+// One client makes requests while the rest sit connected and idle, which
+// shows what each wakeup of the frontend's event loop costs per client.
+TWIB_BENCHMARK(FrontendIdleClients) {
+	test::SimDaemon daemon({"--sim-devices", "1", "--frontend-threads", "1"});
+	if(!daemon.WaitForDevices(1)) {
+		throw std::runtime_error("simulated devices didn't show up");
+	}
+	std::unique_ptr<tool::client::Client> active = daemon.Connect();
+	tool::ITwibMetaInterface itmi(tool::RemoteObject(*active, 0, 0));
+	std::vector<std::unique_ptr<tool::client::Client>> idle;
+	// each client here holds a few descriptors, and select can't watch any
+	// past FD_SETSIZE
+	for(size_t idle_count : {0, 16, 64, 256}) {
+		while(idle.size() < idle_count) {
+			idle.push_back(daemon.Connect());
+		}
+		// let the frontend pick up the new connections
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+		std::string label = std::to_string(idle_count) + " idle clients";
+		b.Run(label.c_str(), 0, [&]() {
+				test::Consume(itmi.ListDevices().size());
+			});
+	}
+}
@@ -0,0 +1,113 @@
+//
+// Twili - Homebrew debug monitor for the Nintendo Switch
+// Copyright (C) 2019 misson20000 <xenotoad@xenotoad.net>
+//
+// This file is part of Twili.
+//
+// Twili is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Twili is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Twili.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include "Test.hpp"
+
+#include<initializer_list>
+#include<string>
+
+#include "util.hpp"
+
+using namespace twili;
+
+namespace {
+
+struct GlobCase {
+	const char *pattern;
+	const char *name;
+	bool matches;
+};
+
+// says which case failed, instead of just that some row didn't match
+std::string Describe(const char *pattern, const char *name, bool matches) {
+	return std::string("\"") + pattern + "\" against \"" + name + "\": " + (matches ? "match" : "no match");
+}
+
+void CheckCases(std::initializer_list<GlobCase> cases) {
+	for(const GlobCase &c : cases) {
+		CHECK_EQ(
+			Describe(c.pattern, c.name, util::GlobMatch(c.pattern, c.name)),
+			Describe(c.pattern, c.name, c.matches));
+	}
+}
+
+} // anonymous namespace
+
+TWIB_TEST(GlobMatch, EmptyPatternMatchesEverything) {
+	CheckCases({
+			{"", "", true},
+			{"", "anything", true},
+			{"", ".hidden", true},
+		});
+}
+
+TWIB_TEST(GlobMatch, Literals) {
+	CheckCases({
+			{"abc", "abc", true},
+			{"abc", "abcd", false},
+			{"abcd", "abc", false},
+			{"abc", "abd", false},
+			{"abc", "ABC", false},
+			{"abc", "", false},
+		});
+}
+
+TWIB_TEST(GlobMatch, QuestionMarkMatchesOneCharacter) {
+	CheckCases({
+			{"?", "a", true},
+			{"?", "", false},
+			{"?", "ab", false},
+			{"a?c", "abc", true},
+			{"a?c", "ac", false},
+			{"??", "ab", true},
+			{"*.??", "main.rs", true},
+			{"*.??", "main.cpp", false},
+		});
+}
+
+TWIB_TEST(GlobMatch, TrailingStar) {
+	CheckCases({
+			{"*", "", true},
+			{"*", "anything", true},
+			{"abc*", "abc", true},
+			{"abc*", "abcdef", true},
+			{"abc*", "ab", false},
+			{"abc**", "abc", true},
+			{"a*c*", "abxcyz", true},
+		});
+}
+
+TWIB_TEST(GlobMatch, StarBacktracks) {
+	CheckCases({
+			// the first 'a' is a false start; the star has to take "ab"
+			{"*a", "aba", true},
+			{"*a", "ab", false},
+			{"*ab", "aab", true},
+			{"a*b", "abab", true},
+			{"a*b", "abac", false},
+			{"*.log", "main.log.1", false},
+			{"*.log.*", "main.log.1", true},
+			{"*x*y*z", "xxyyzz", true},
+			{"*x*y*z", "xxzzyy", false},
+			{"a*a*a", "aaa", true},
+			{"a*a*a", "aa", false},
+		});
+}
@@ -0,0 +1,73 @@
+//
+// Twili - Homebrew debug monitor for the Nintendo Switch
+// Copyright (C) 2019 misson20000 <xenotoad@xenotoad.net>
+//
+// This file is part of Twili.
+//
+// Twili is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Twili is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Twili.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include "Benchmark.hpp"
+
+#include<random>
+#include<string>
+#include<vector>
+
+#include "Hash.hpp"
+
+using namespace twili;
+using namespace twili::twib;
+
+TWIB_BENCHMARK(Hash) {
+	std::vector<uint8_t> data(64 * 1024 * 1024);
+	std::mt19937_64 rng(3);
+	for(size_t i = 0; i < data.size(); i+= 8) {
+		uint64_t r = rng();
+		std::copy((uint8_t*) &r, (uint8_t*) (&r + 1), data.begin() + i);
+	}
+
+	b.Run("XXH3 64 MiB", data.size(), [&]() {
+			util::FastHash hash;
+			hash.Update(data.data(), data.size());
+			test::Consume(hash.Finish());
+		});
+	// the way HASH reads files on the console
+	b.Run("XXH3 64 MiB in 64 KiB pieces", data.size(), [&]() {
+			util::FastHash hash;
+			for(size_t i = 0; i < data.size(); i+= 0x10000) {
+				hash.Update(data.data() + i, 0x10000);
+			}
+			test::Consume(hash.Finish());
+		});
+	b.Run("XXH3 64 MiB in 4 KiB blocks", data.size(), [&]() {
+			util::BlockHasher hasher(util::HashAlgorithm::Fast, 0x1000);
+			hasher.Update(data.data(), data.size());
+			test::Consume(hasher.Finish().size());
+		});
+	b.Run("XXH3 1M 16-byte inputs", 16 * 1024 * 1024, [&]() {
+			for(size_t i = 0; i < 16 * 1024 * 1024; i+= 16) {
+				util::FastHash hash;
+				hash.Update(data.data() + i, 16);
+				test::Consume(hash.Finish());
+			}
+		});
+	b.Run("SHA-256 64 MiB", data.size(), [&]() {
+			util::Sha256 hash;
+			hash.Update(data.data(), data.size());
+			uint8_t digest[32];
+			hash.Finish(digest);
+			test::Consume(digest[0]);
+		});
+}
@@ -0,0 +1,169 @@
+//
+// Twili - Homebrew debug monitor for the Nintendo Switch
+// Copyright (C) 2019 misson20000 <xenotoad@xenotoad.net>
+//
+// This file is part of Twili.
+//
+// Twili is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Twili is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Twili.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include "Test.hpp"
+
+#include<algorithm>
+#include<random>
+#include<string>
+#include<vector>
+
+#include<string.h>
+
+#include "Hash.hpp"
+#include "PageHash.hpp"
+
+using namespace twili;
+
+namespace {
+
+// byte i is i * 0x9d, so every length exercises different bytes
+std::vector<uint8_t> Pattern(size_t size) {
+	std::vector<uint8_t> data(size);
+	for(size_t i = 0; i < size; i++) {
+		data[i] = (uint8_t) (i * 0x9d);
+	}
+	return data;
+}
+
+uint64_t Xxh3(const uint8_t *data, size_t size) {
+	util::FastHash hash;
+	hash.Update(data, size);
+	return hash.Finish();
+}
+
+uint64_t Xxh3(const std::string &str) {
+	return Xxh3((const uint8_t*) str.data(), str.size());
+}
+
+std::string Sha256(const std::vector<uint8_t> &data) {
+	util::Sha256 hash;
+	hash.Update(data.data(), data.size());
+	uint8_t digest[32];
+	hash.Finish(digest);
+	std::string hex;
+	for(uint8_t byte : digest) {
+		const char *digits = "0123456789abcdef";
+		hex.push_back(digits[byte >> 4]);
+		hex.push_back(digits[byte & 15]);
+	}
+	return hex;
+}
+
+// from xxHash's XXH3_64bits(), covering each of its input size classes
+const struct {
+	size_t size;
+	uint64_t hash;
+} XXH3_PATTERN_VECTORS[] = {
+	{5, 0xc71d21cabe53fcbd},
+	{8, 0x349cd1b032562362},
+	{16, 0x1e874a7f0cbec2e6},
+	{17, 0x19fd3fa2ea188b5d},
+	{100, 0x4fc682877c466f16},
+	{128, 0x7517ab114e2df367},
+	{129, 0x46040656f760dc2b},
+	{200, 0x7cfe06dbd0a6ff00},
+	{240, 0xb37dfad48c091c67},
+	{241, 0x03af61ff52e1e57c},
+	{300, 0xaeb0780556243b1a},
+	{1024, 0x703557f601af6601},
+	{1025, 0x540f616339f70f30},
+	{2048, 0xcd50eda85e473a9f},
+	{3089, 0x8f8bd978fb36a30d},
+	{16385, 0x294e2d2e4afe65bf},
+};
+
+} // anonymous namespace
+
+TWIB_TEST(Hash, MatchesXxh3Strings) {
+	CHECK_EQ(Xxh3(""), (uint64_t) 0x2d06800538d394c2);
+	CHECK_EQ(Xxh3("a"), (uint64_t) 0xe6c632b61e964e1f);
+	CHECK_EQ(Xxh3("abc"), (uint64_t) 0x78af5f94892f3950);
+	CHECK_EQ(Xxh3("hello world"), (uint64_t) 0xd447b1ea40e6988b);
+	CHECK_EQ(Xxh3("The quick brown fox jumps over the lazy dog"), (uint64_t) 0xce7d19a5418fb365);
+}
+
+TWIB_TEST(Hash, MatchesXxh3Vectors) {
+	std::vector<uint8_t> data = Pattern(16385);
+	for(auto &v : XXH3_PATTERN_VECTORS) {
+		CHECK_EQ(Xxh3(data.data(), v.size), v.hash);
+	}
+}
+
+TWIB_TEST(Hash, StreamingMatchesOneShot) {
+	std::vector<uint8_t> data = Pattern(3089);
+	std::mt19937_64 rng(11);
+	for(auto &v : XXH3_PATTERN_VECTORS) {
+		if(v.size > data.size()) {
+			continue;
+		}
+		// byte at a time, then in random pieces that straddle the
+		// buffer and block boundaries
+		util::FastHash hash;
+		for(size_t i = 0; i < v.size; i++) {
+			hash.Update(data.data() + i, 1);
+		}
+		CHECK_EQ(hash.Finish(), v.hash);
+		
+		for(int trial = 0; trial < 20; trial++) {
+			size_t offset = 0;
+			while(offset < v.size) {
+				size_t piece = std::min<size_t>(v.size - offset, rng() % 600);
+				hash.Update(data.data() + offset, piece);
+				offset+= piece;
+			}
+			CHECK_EQ(hash.Finish(), v.hash);
+		}
+	}
+}
+
+TWIB_TEST(Hash, Sha256) {
+	CHECK_EQ(Sha256({}), std::string("e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855"));
+	CHECK_EQ(Sha256({'a', 'b', 'c'}), std::string("ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad"));
+	CHECK_EQ(Sha256(Pattern(3089)), std::string("7f9db4a453d94db8de544681cb47dd830fb0d9e23239a7eb19b114c4e0e90689"));
+}
+
+TWIB_TEST(Hash, BlockHasherSplitsBlocks) {
+	std::vector<uint8_t> data = Pattern(10000);
+	util::BlockHasher hasher(util::HashAlgorithm::Fast, 4096);
+	hasher.Update(data.data(), 5000);
+	hasher.Update(data.data() + 5000, 5000);
+	std::vector<uint8_t> digests = hasher.Finish();
+	CHECK_EQ(digests.size(), (size_t) 24);
+	
+	uint64_t expected[3] = {
+		Xxh3(data.data(), 4096),
+		Xxh3(data.data() + 4096, 4096),
+		Xxh3(data.data() + 8192, 10000 - 8192)};
+	CHECK(memcmp(digests.data(), expected, sizeof(expected)) == 0);
+}
+
+TWIB_TEST(Hash, BlockHasherEmptyStream) {
+	util::BlockHasher whole(util::HashAlgorithm::Sha256, 0);
+	CHECK_EQ(whole.Finish().size(), (size_t) 32);
+	util::BlockHasher blocks(util::HashAlgorithm::Fast, 4096);
+	CHECK_EQ(blocks.Finish().size(), (size_t) 0);
+}
+
+TWIB_TEST(Hash, PageHashIsXxh3) {
+	std::vector<uint8_t> page = Pattern(util::PAGE_HASH_PAGE_SIZE);
+	CHECK_EQ(util::HashPage(page.data(), page.size()), Xxh3(page.data(), page.size()));
+}
@@ -0,0 +1,102 @@
+//
+// Twili - Homebrew debug monitor for the Nintendo Switch
+// Copyright (C) 2019 misson20000 <xenotoad@xenotoad.net>
+//
+// This file is part of Twili.
+//
+// Twili is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Twili is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Twili.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include "Test.hpp"
+
+#include<memory>
+#include<string>
+#include<vector>
+
+#include "JobScheduler.hpp"
+
+using namespace twili;
+
+namespace {
+
+std::string Drain(util::JobScheduler<std::string> &scheduler) {
+	std::string order;
+	while(std::optional<std::string> job = scheduler.Next()) {
+		order+= *job;
+	}
+	return order;
+}
+
+} // anonymous namespace
+
+TWIB_TEST(JobScheduler, TakesTurnsBetweenOwners) {
+	util::JobScheduler<std::string> scheduler(64);
+	for(const char *job : {"a", "b", "c", "d", "e"}) {
+		CHECK(scheduler.Submit(1, job));
+	}
+	CHECK(scheduler.Submit(2, "F"));
+	CHECK(scheduler.Submit(2, "G"));
+	CHECK(scheduler.Submit(3, "0"));
+	CHECK_EQ(scheduler.GetQueuedCount(), (size_t) 8);
+
+	// each owner's jobs stay in order, and a busy owner only gets every
+	// other turn once the rest have run out
+	CHECK_EQ(Drain(scheduler), std::string("aF0bGcde"));
+	CHECK_EQ(scheduler.GetQueuedCount(), (size_t) 0);
+}
+
+TWIB_TEST(JobScheduler, NewOwnersJoinTheRotation) {
+	util::JobScheduler<std::string> scheduler(64);
+	CHECK(scheduler.Submit(5, "a"));
+	CHECK(scheduler.Submit(5, "b"));
+	CHECK(scheduler.Submit(5, "c"));
+	CHECK_EQ(*scheduler.Next(), std::string("a"));
+
+	// owners after the last one served go next, then it wraps around to the
+	// lower ones
+	CHECK(scheduler.Submit(9, "X"));
+	CHECK(scheduler.Submit(2, "0"));
+	CHECK_EQ(Drain(scheduler), std::string("X0bc"));
+}
+
+TWIB_TEST(JobScheduler, OwnersThatRunOutCanComeBack) {
+	util::JobScheduler<std::string> scheduler(64);
+	CHECK(scheduler.Submit(1, "a"));
+	CHECK_EQ(*scheduler.Next(), std::string("a"));
+	CHECK(!scheduler.Next());
+
+	CHECK(scheduler.Submit(1, "b"));
+	CHECK(scheduler.Submit(0, "0"));
+	CHECK_EQ(Drain(scheduler), std::string("0b"));
+}
+
+TWIB_TEST(JobScheduler, RefusesJobsWhenFull) {
+	util::JobScheduler<std::unique_ptr<int>> scheduler(2);
+	CHECK(scheduler.Submit(1, std::make_unique<int>(1)));
+	CHECK(scheduler.Submit(2, std::make_unique<int>(2)));
+
+	// a refused job is left with the caller, who runs it some other way
+	std::unique_ptr<int> refused = std::make_unique<int>(3);
+	CHECK(!scheduler.Submit(3, std::move(refused)));
+	CHECK(refused != nullptr);
+	CHECK_EQ(*refused, 3);
+	CHECK_EQ(scheduler.GetQueuedCount(), (size_t) 2);
+
+	CHECK_EQ(**scheduler.Next(), 1);
+	CHECK(scheduler.Submit(3, std::move(refused)));
+	CHECK_EQ(**scheduler.Next(), 2);
+	CHECK_EQ(**scheduler.Next(), 3);
+	CHECK(!scheduler.Next());
+}
@@ -0,0 +1,112 @@
+//
+// Twili - Homebrew debug monitor for the Nintendo Switch
+// Copyright (C) 2019 misson20000 <xenotoad@xenotoad.net>
+//
+// This file is part of Twili.
+//
+// Twili is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Twili is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Twili.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "Test.hpp"
+
+#include<optional>
+#include<string>
+#include<vector>
+
+#include<stdio.h>
+#include<stdlib.h>
+
+#ifndef _WIN32
+#include<unistd.h>
+#endif
+
+#include "tool/MemorySnapshot.hpp"
+
+using namespace twili;
+using namespace twili::twib;
+
+#ifndef _WIN32
+namespace {
+
+// a directory that's removed, along with the snapshot in it, afterwards
+class SnapshotDirectory {
+ public:
+	SnapshotDirectory() {
+		CHECK(mkdtemp(name) != nullptr);
+		path = std::string(name) + "/snapshot";
+	}
+	~SnapshotDirectory() {
+		remove(path.c_str());
+		rmdir(name);
+	}
+
+	void Write(const std::vector<uint8_t> &bytes) {
+		FILE *file = fopen(path.c_str(), "wb");
+		CHECK(file != nullptr);
+		CHECK_EQ(fwrite(bytes.data(), 1, bytes.size(), file), bytes.size());
+		fclose(file);
+	}
+	
+	std::string path;
+ private:
+	char name[22] = "/tmp/twib-test-XXXXXX";
+};
+
+std::vector<uint8_t> Header(uint64_t page_count) {
+	std::vector<uint8_t> header = {'T', 'W', 'I', 'B', 'S', 'N', 'A', 'P'};
+	uint64_t address = 0x7100000000;
+	header.insert(header.end(), (uint8_t*) &address, (uint8_t*) (&address + 1));
+	header.insert(header.end(), (uint8_t*) &page_count, (uint8_t*) (&page_count + 1));
+	return header;
+}
+
+} // anonymous namespace
+
+TWIB_TEST(MemorySnapshot, RoundTrips) {
+	SnapshotDirectory directory;
+	std::vector<uint8_t> data(2 * util::PAGE_HASH_PAGE_SIZE);
+	for(size_t i = 0; i < data.size(); i++) {
+		data[i] = i * 7;
+	}
+	tool::MemorySnapshot snapshot(0x7100000000, {0x1234, util::PAGE_HASH_UNREADABLE}, data);
+	CHECK(snapshot.Save(directory.path.c_str()));
+
+	std::optional<tool::MemorySnapshot> loaded = tool::MemorySnapshot::Load(directory.path.c_str());
+	CHECK(loaded);
+	CHECK_EQ(loaded->address, (uint64_t) 0x7100000000);
+	CHECK(loaded->hashes == snapshot.hashes);
+	CHECK(loaded->data == snapshot.data);
+}
+
+TWIB_TEST(MemorySnapshot, RejectsWrongSize) {
+	SnapshotDirectory directory;
+	std::vector<uint8_t> file = Header(1);
+	file.resize(file.size() + sizeof(uint64_t) + util::PAGE_HASH_PAGE_SIZE - 1);
+	directory.Write(file);
+	CHECK(!tool::MemorySnapshot::Load(directory.path.c_str()));
+
+	file = Header(1);
+	file.resize(file.size() + 2 * (sizeof(uint64_t) + util::PAGE_HASH_PAGE_SIZE));
+	directory.Write(file);
+	CHECK(!tool::MemorySnapshot::Load(directory.path.c_str()));
+}
+
+TWIB_TEST(MemorySnapshot, RejectsOverflowingPageCount) {
+	// (1 << 61) pages of hashes and data are exactly 2^64 bytes each, which
+	// would wrap around to match a file with nothing after the header
+	SnapshotDirectory directory;
+	directory.Write(Header((uint64_t) 1 << 61));
+	CHECK(!tool::MemorySnapshot::Load(directory.path.c_str()));
+}
+#endif
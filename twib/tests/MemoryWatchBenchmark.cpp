@@ -0,0 +1,169 @@
+//
+// Twili - Homebrew debug monitor for the Nintendo Switch
+// Copyright (C) 2019 misson20000 <xenotoad@xenotoad.net>
+//
+// This file is part of Twili.
+//
+// Twili is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Twili is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Twili.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include "Benchmark.hpp"
+#include "SimDaemon.hpp"
+
+#include<atomic>
+#include<chrono>
+#include<functional>
+#include<map>
+#include<memory>
+#include<mutex>
+#include<optional>
+#include<stdexcept>
+#include<string>
+#include<thread>
+#include<vector>
+
+#include<string.h>
+
+#include "tool/interfaces/ITwibDeviceInterface.hpp"
+
+using namespace twili::twib;
+
+namespace {
+
+const uint64_t SIM_APP_PID = 0x82;
+const uint64_t SIM_MEMORY_BASE = 0x7100000000;
+// sixteen 8-byte variables scattered over a few pages, like the fields of a
+// game's state that a tool would poll
+const size_t RANGE_COUNT = 16;
+const uint64_t RANGE_SIZE = 8;
+const uint64_t RANGE_STRIDE = 0x100;
+const uint64_t RANGES_BASE = SIM_MEMORY_BASE + 0x1000;
+// a USB round trip to the console takes about this long
+const char *SIM_LATENCY_US = "500";
+const std::chrono::milliseconds WRITE_INTERVAL(10);
+const std::chrono::seconds DURATION(2);
+
+struct Result {
+	double samples_per_second;
+	double mean_latency_ms; // from writing a variable to the host seeing it
+};
+
+// Runs `sample` for DURATION while another connection changes the first
+// variable every WRITE_INTERVAL. `sample` returns the value it saw in the
+// first variable, if it saw one.
+Result Measure(test::SimDaemon &daemon, std::function<std::optional<uint64_t>()> sample) {
+	std::mutex mutex;
+	std::map<uint64_t, std::chrono::steady_clock::time_point> write_times;
+	std::atomic<bool> running(true);
+	
+	std::thread writer([&]() {
+			std::unique_ptr<tool::client::Client> client = daemon.Connect();
+			tool::ITwibDeviceInterface itdi(std::make_shared<tool::RemoteObject>(*client, test::ListDeviceIds(*client)[0], 0));
+			tool::ITwibDebugger debugger = itdi.OpenActiveDebugger(SIM_APP_PID);
+			for(uint64_t value = 1; running; value++) {
+				std::vector<uint8_t> bytes(sizeof(value));
+				memcpy(bytes.data(), &value, sizeof(value));
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					write_times[value] = std::chrono::steady_clock::now();
+				}
+				debugger.WriteMemory(RANGES_BASE, bytes);
+				std::this_thread::sleep_for(WRITE_INTERVAL);
+			}
+		});
+
+	uint64_t samples = 0;
+	uint64_t last_seen = 0;
+	std::chrono::duration<double> total_latency(0);
+	uint64_t latency_count = 0;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	while(std::chrono::steady_clock::now() - start < DURATION) {
+		std::optional<uint64_t> value = sample();
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		samples++;
+		if(!value || *value <= last_seen) {
+			continue;
+		}
+		std::lock_guard<std::mutex> lock(mutex);
+		auto i = write_times.find(*value);
+		if(i != write_times.end()) { // and not the noise that was there first
+			total_latency+= now - i->second;
+			latency_count++;
+			last_seen = *value;
+		}
+	}
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	running = false;
+	writer.join();
+
+	return {samples / elapsed.count(), latency_count ? total_latency.count() * 1000.0 / latency_count : 0.0};
+}
+
+uint64_t ReadValue(const uint8_t *bytes) {
+	uint64_t value;
+	memcpy(&value, bytes, sizeof(value));
+	return value;
+}
+
+} // anonymous namespace
+
+TWIB_BENCHMARK(MemoryWatch) {
+	test::SimDaemon daemon({"--sim-devices", "1", "--sim-latency", SIM_LATENCY_US});
+	if(!daemon.WaitForDevices(1)) {
+		throw std::runtime_error("simulated device didn't show up");
+	}
+	std::unique_ptr<tool::client::Client> client = daemon.Connect();
+	tool::ITwibDeviceInterface itdi(std::make_shared<tool::RemoteObject>(*client, test::ListDeviceIds(*client)[0], 0));
+	tool::ITwibDebugger debugger = itdi.OpenActiveDebugger(SIM_APP_PID);
+	
+	auto report = [&](const std::string &label, Result result) {
+			b.Report(label.c_str(), result.samples_per_second, "samples/s");
+			b.Report((label + ", change latency").c_str(), result.mean_latency_ms, "ms");
+		};
+
+	report("ReadMemory per variable", Measure(daemon, [&]() -> std::optional<uint64_t> {
+			std::optional<uint64_t> first;
+			for(size_t i = 0; i < RANGE_COUNT; i++) {
+				std::vector<uint8_t> bytes = debugger.ReadMemory(RANGES_BASE + i * RANGE_STRIDE, RANGE_SIZE);
+				if(i == 0) {
+					first = ReadValue(bytes.data());
+				}
+			}
+			return first;
+		}));
+
+	report("one ReadMemory over every variable", Measure(daemon, [&]() -> std::optional<uint64_t> {
+			std::vector<uint8_t> bytes = debugger.ReadMemory(RANGES_BASE, RANGE_COUNT * RANGE_STRIDE);
+			return ReadValue(bytes.data());
+		}));
+
+	for(uint64_t interval_ms : {1, 16}) {
+		std::vector<twili::protocol::ITwibMemoryWatch::Range> ranges;
+		for(size_t i = 0; i < RANGE_COUNT; i++) {
+			ranges.push_back({RANGES_BASE + i * RANGE_STRIDE, RANGE_SIZE});
+		}
+		tool::ITwibMemoryWatch watch = debugger.CreateMemoryWatch(interval_ms * 1000000, ranges);
+		report("memory watch, " + std::to_string(interval_ms) + " ms interval", Measure(daemon, [&]() -> std::optional<uint64_t> {
+				uint64_t dropped;
+				std::optional<uint64_t> first;
+				for(tool::ITwibMemoryWatch::Change &change : watch.Read(dropped)) {
+					if(change.address == RANGES_BASE) {
+						first = ReadValue(change.data.data());
+					}
+				}
+				return first;
+			}));
+	}
+}
@@ -0,0 +1,77 @@
+//
+// Twili - Homebrew debug monitor for the Nintendo Switch
+// Copyright (C) 2019 misson20000 <xenotoad@xenotoad.net>
+//
+// This file is part of Twili.
+//
+// Twili is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Twili is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Twili.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include "Test.hpp"
+#include "SimDaemon.hpp"
+
+#include<memory>
+#include<string>
+#include<vector>
+
+#include "tool/interfaces/ITwibDeviceInterface.hpp"
+
+using namespace twili::twib;
+
+namespace {
+
+const uint64_t SIM_APP_PID = 0x82;
+const uint64_t WATCHED = 0x7100001000;
+
+} // anonymous namespace
+
+TWIB_TEST(MemoryWatch, ReportsOnlyChangedRanges) {
+	test::SimDaemon daemon({"--sim-devices", "1"});
+	CHECK(daemon.WaitForDevices(1));
+	std::unique_ptr<tool::client::Client> client = daemon.Connect();
+	tool::ITwibDeviceInterface itdi(std::make_shared<tool::RemoteObject>(*client, test::ListDeviceIds(*client)[0], 0));
+	tool::ITwibDebugger debugger = itdi.OpenActiveDebugger(SIM_APP_PID);
+
+	tool::ITwibMemoryWatch watch = debugger.CreateMemoryWatch(1000000, {{WATCHED, 4}, {WATCHED + 0x100, 8}});
+	
+	// the first sample has everything
+	uint64_t dropped;
+	std::vector<tool::ITwibMemoryWatch::Change> changes = watch.Read(dropped);
+	CHECK_EQ(changes.size(), (size_t) 2);
+	CHECK_EQ(changes[0].address, WATCHED);
+	CHECK(changes[0].data == debugger.ReadMemory(WATCHED, 4));
+	CHECK_EQ(changes[1].data.size(), (size_t) 8);
+	CHECK_EQ(dropped, (uint64_t) 0);
+
+	std::vector<uint8_t> bytes = {1, 2, 3, 4, 5, 6, 7, 8};
+	debugger.WriteMemory(WATCHED + 0x100, bytes);
+	do {
+		changes = watch.Read(dropped);
+	} while(changes.empty()); // the simulated device answers each sample
+	CHECK_EQ(changes.size(), (size_t) 1);
+	CHECK_EQ(changes[0].address, WATCHED + 0x100);
+	CHECK(changes[0].data == bytes);
+	CHECK(changes[0].timestamp > 0);
+}
+
+TWIB_TEST(MemoryWatch, TwibPrintsChanges) {
+	test::SimDaemon daemon({"--sim-devices", "1"});
+	CHECK(daemon.WaitForDevices(1));
+
+	std::string output, errors;
+	CHECK_EQ(daemon.RunTwib({"watch", "0x82", "0x7100001000:4", "0x7100001100:2", "-c", "2"}, output, errors), 0);
+	CHECK(output.find("0x0000007100001000:") != std::string::npos);
+	CHECK(output.find("0x0000007100001100:") != std::string::npos);
+}
@@ -0,0 +1,223 @@
+//
+// Twili - Homebrew debug monitor for the Nintendo Switch
+// Copyright (C) 2019 misson20000 <xenotoad@xenotoad.net>
+//
+// This file is part of Twili.
+//
+// Twili is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Twili is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Twili.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include "Test.hpp"
+
+#include<atomic>
+#include<deque>
+#include<new>
+
+#include<stdlib.h>
+#include<string.h>
+
+#include "common/MessageConnection.hpp"
+
+// Counts large allocations, so the tests can tell when a payload was copied
+// into a new buffer instead of being handed along.
+static std::atomic<bool> counting_allocations(false);
+static std::atomic<size_t> large_allocations(0);
+static const size_t LARGE_ALLOCATION_SIZE = 0x10000;
+
+namespace {
+
+void *Allocate(size_t size) {
+	if(counting_allocations && size >= LARGE_ALLOCATION_SIZE) {
+		large_allocations++;
+	}
+	void *p = malloc(size ? size : 1);
+	if(p == nullptr) {
+		throw std::bad_alloc();
+	}
+	return p;
+}
+
+} // anonymous namespace
+
+// every replaceable form goes through malloc and free, so each delete
+// matches its new
+void *operator new(size_t size) {
+	return Allocate(size);
+}
+
+void *operator new[](size_t size) {
+	return Allocate(size);
+}
+
+void operator delete(void *p) noexcept {
+	free(p);
+}
+
+void operator delete[](void *p) noexcept {
+	free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+	free(p);
+}
+
+void operator delete[](void *p, size_t) noexcept {
+	free(p);
+}
+
+using namespace twili;
+using namespace twili::twib;
+
+namespace {
+
+class AllocationCounter {
+ public:
+	AllocationCounter() {
+		large_allocations = 0;
+		counting_allocations = true;
+	}
+	~AllocationCounter() {
+		counting_allocations = false;
+	}
+	size_t Large() {
+		return large_allocations;
+	}
+};
+
+// Feeds canned input in fixed-size reads, the way SocketMessageConnection
+// receives, and keeps whatever is sent.
+class FakeConnection : public common::MessageConnection {
+ public:
+	std::deque<std::vector<uint8_t>> reads;
+	uint8_t *last_read_target = nullptr;
+
+	void Feed(const std::vector<uint8_t> &bytes, size_t read_size) {
+		for(size_t i = 0; i < bytes.size(); i+= read_size) {
+			size_t size = std::min(read_size, bytes.size() - i);
+			reads.emplace_back(bytes.begin() + i, bytes.begin() + i + size);
+		}
+	}
+
+	common::OutputQueue &Output() {
+		return out_buffer;
+	}
+	
+ protected:
+	virtual bool RequestInput() override {
+		if(reads.empty()) {
+			return false;
+		}
+		std::vector<uint8_t> &read = reads.front();
+		std::tuple<uint8_t*, size_t> target = in_buffer.Reserve(READ_SIZE);
+		CHECK(std::get<1>(target) >= read.size());
+		memcpy(std::get<0>(target), read.data(), read.size());
+		last_read_target = std::get<0>(target);
+		in_buffer.MarkWritten(read.size());
+		reads.pop_front();
+		return true;
+	}
+
+	virtual bool RequestOutput() override {
+		return false;
+	}
+};
+
+std::vector<uint8_t> MakeMessage(uint32_t tag, size_t payload_size, std::vector<uint32_t> object_ids) {
+	protocol::MessageHeader mh = {};
+	mh.tag = tag;
+	mh.payload_size = payload_size;
+	mh.object_count = object_ids.size();
+	std::vector<uint8_t> message((uint8_t*) &mh, (uint8_t*) (&mh + 1));
+	for(size_t i = 0; i < payload_size; i++) {
+		message.push_back(i * 13 + tag);
+	}
+	message.insert(message.end(), (uint8_t*) object_ids.data(), (uint8_t*) (object_ids.data() + object_ids.size()));
+	return message;
+}
+
+} // anonymous namespace
+
+TWIB_TEST(MessageConnection, ReceivesLargePayloadInPlace) {
+	const size_t size = 0x100000;
+	std::vector<uint8_t> input = MakeMessage(1, size, {7, 8});
+	std::vector<uint8_t> second = MakeMessage(2, 16, {});
+	input.insert(input.end(), second.begin(), second.end());
+	
+	FakeConnection connection;
+	connection.Feed(input, 8192);
+
+	AllocationCounter counter;
+	common::MessageConnection::Request *rq;
+	uint8_t *first_read_target = nullptr;
+	do {
+		rq = connection.Process();
+		if(first_read_target == nullptr) {
+			first_read_target = connection.last_read_target;
+		}
+	} while(rq == nullptr && !connection.reads.empty());
+	CHECK(rq != nullptr);
+	CHECK_EQ(rq->mh.tag, (uint32_t) 1);
+	CHECK_EQ(rq->mh.object_count, (uint32_t) 2);
+
+	std::vector<uint8_t> payload = rq->payload.TakeData();
+	CHECK_EQ(payload.size(), size);
+	CHECK(std::equal(payload.begin(), payload.end(), input.begin() + sizeof(protocol::MessageHeader)));
+	// the receive buffer grew once to hold the payload, which was then
+	// handed over without being copied
+	CHECK_EQ(counter.Large(), (size_t) 1);
+
+	uint32_t object_ids[2];
+	CHECK(rq->object_ids.Read((uint8_t*) object_ids, sizeof(object_ids)));
+	CHECK_EQ(object_ids[1], (uint32_t) 8);
+
+	while((rq = connection.Process()) == nullptr && !connection.reads.empty()) {
+	}
+	CHECK(rq != nullptr);
+	CHECK_EQ(rq->mh.tag, (uint32_t) 2);
+	CHECK_EQ(rq->payload.ReadAvailable(), (size_t) 16);
+}
+
+TWIB_TEST(MessageConnection, SendsLargePayloadByReference) {
+	FakeConnection connection;
+	auto payload = std::make_shared<const std::vector<uint8_t>>(0x100000, 0xcc);
+	protocol::MessageHeader mh = {};
+	mh.payload_size = payload->size();
+	mh.object_count = 1;
+
+	{
+		AllocationCounter counter;
+		connection.SendMessage(mh, payload, std::vector<uint32_t>{5});
+		CHECK_EQ(counter.Large(), (size_t) 0);
+	}
+
+	common::OutputQueue &out = connection.Output();
+	CHECK_EQ(out.ReadAvailable(), sizeof(mh) + payload->size() + sizeof(uint32_t));
+	platform::SendBuffer buffers[4];
+	CHECK_EQ(out.Gather(buffers, 4), (size_t) 3);
+	CHECK(buffers[1].data == payload->data());
+}
+
+TWIB_TEST(MessageConnection, CopiesSmallPayloads) {
+	FakeConnection connection;
+	auto payload = std::make_shared<const std::vector<uint8_t>>(100, 0xcc);
+	protocol::MessageHeader mh = {};
+	mh.payload_size = payload->size();
+	connection.SendMessage(mh, payload, std::vector<uint32_t>());
+	
+	// the message is sent as it was when SendMessage returned
+	CHECK_EQ(payload.use_count(), 1);
+	common::OutputQueue &out = connection.Output();
+	CHECK_EQ(out.ReadAvailable(), sizeof(mh) + payload->size());
+}
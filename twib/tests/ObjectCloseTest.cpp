@@ -0,0 +1,95 @@
+//
+// Twili - Homebrew debug monitor for the Nintendo Switch
+// Copyright (C) 2019 misson20000 <xenotoad@xenotoad.net>
+//
+// This file is part of Twili.
+//
+// Twili is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Twili is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Twili.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include "Test.hpp"
+#include "SimDaemon.hpp"
+
+#include<chrono>
+#include<memory>
+#include<optional>
+
+#include<stdio.h>
+
+#include "tool/interfaces/ITwibDeviceInterface.hpp"
+
+using namespace twili::twib;
+
+namespace {
+
+// Every request and every response is delayed this much, so a round trip to
+// the device costs twice this.
+const std::chrono::microseconds LATENCY(2000);
+const size_t OBJECT_COUNT = 100;
+
+// Holds many file accessors open on a simulated device, plus one more to
+// probe the device with once the others are gone.
+class OpenFiles {
+ public:
+	OpenFiles() :
+		daemon({"--sim-devices", "1", "--sim-latency", std::to_string(LATENCY.count())}) {
+		CHECK(daemon.WaitForDevices(1));
+		FILE *f = fopen((daemon.fs_root + "/sd/file").c_str(), "wb");
+		CHECK(f != nullptr);
+		fputs("contents", f);
+		fclose(f);
+
+		client = daemon.Connect();
+		std::vector<uint32_t> devices = test::ListDeviceIds(*client);
+		CHECK_EQ(devices.size(), (size_t) 1);
+		tool::ITwibDeviceInterface itdi(std::make_shared<tool::RemoteObject>(*client, devices[0], 0));
+		tool::ITwibFilesystemAccessor itfsa = itdi.OpenFilesystemAccessor("sd");
+		for(size_t i = 0; i < OBJECT_COUNT; i++) {
+			files.push_back(itfsa.OpenFile(1, "/file"));
+		}
+		probe.emplace(itfsa.OpenFile(1, "/file"));
+	}
+
+	test::SimDaemon daemon;
+	std::unique_ptr<tool::client::Client> client;
+	std::vector<tool::ITwibFileAccessor> files;
+	std::optional<tool::ITwibFileAccessor> probe;
+};
+
+template<typename Function>
+std::chrono::microseconds Time(Function &&function) {
+	auto start = std::chrono::steady_clock::now();
+	function();
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+}
+
+} // anonymous namespace
+
+TWIB_TEST(ObjectClose, TeardownDoesNotWaitForDevice) {
+	OpenFiles session;
+	// waiting on even half of the close round trips would take this long
+	std::chrono::microseconds serial_time = LATENCY * OBJECT_COUNT;
+	CHECK(Time([&]() { session.files.clear(); }) < serial_time);
+	CHECK_EQ(session.probe->GetSize(), (size_t) 8);
+}
+
+TWIB_TEST(ObjectClose, ClosesReachDeviceInBatches) {
+	OpenFiles session;
+	session.files.clear();
+	// The probe queues up behind the closes on the device, which would keep
+	// it waiting for a full round trip per object if they went one by one.
+	std::chrono::microseconds serial_time = LATENCY * OBJECT_COUNT;
+	CHECK(Time([&]() { CHECK_EQ(session.probe->GetSize(), (size_t) 8); }) < serial_time);
+}
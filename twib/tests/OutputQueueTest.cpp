@@ -0,0 +1,110 @@
+//
+// Twili - Homebrew debug monitor for the Nintendo Switch
+// Copyright (C) 2019 misson20000 <xenotoad@xenotoad.net>
+//
+// This file is part of Twili.
+//
+// Twili is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Twili is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Twili.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include "Test.hpp"
+
+#include<string.h>
+
+#include "common/OutputQueue.hpp"
+
+using namespace twili;
+using namespace twili::twib;
+
+namespace {
+
+std::vector<uint8_t> Drain(common::OutputQueue &queue, size_t step) {
+	std::vector<uint8_t> sent;
+	while(queue.ReadAvailable() > 0) {
+		platform::SendBuffer buffers[4];
+		size_t count = queue.Gather(buffers, 4);
+		CHECK(count > 0);
+		// send at most `step` bytes, like a socket that only takes some
+		size_t size = 0;
+		for(size_t i = 0; i < count && size < step; i++) {
+			size_t n = std::min(buffers[i].size, step - size);
+			const uint8_t *data = (const uint8_t*) buffers[i].data;
+			sent.insert(sent.end(), data, data + n);
+			size+= n;
+		}
+		queue.MarkRead(size);
+	}
+	return sent;
+}
+
+} // anonymous namespace
+
+TWIB_TEST(OutputQueue, SendsSharedDataInPlace) {
+	common::OutputQueue queue;
+	auto payload = std::make_shared<std::vector<uint8_t>>(0x10000, 0x5a);
+	queue.Write<uint32_t>(0x11111111);
+	queue.Write(std::shared_ptr<const std::vector<uint8_t>>(payload));
+	queue.Write(std::vector<uint32_t>{2, 3});
+	CHECK_EQ(queue.ReadAvailable(), (size_t) 4 + 0x10000 + 8);
+
+	platform::SendBuffer buffers[4];
+	CHECK_EQ(queue.Gather(buffers, 4), (size_t) 3);
+	CHECK_EQ(buffers[0].size, (size_t) 4);
+	CHECK(buffers[1].data == payload->data());
+	CHECK_EQ(buffers[1].size, (size_t) 0x10000);
+	CHECK_EQ(buffers[2].size, (size_t) 8);
+
+	// the queue holds a reference until the data is sent
+	CHECK_EQ(payload.use_count(), 2);
+	queue.MarkRead(4 + 0x8000);
+	CHECK_EQ(queue.Gather(buffers, 1), (size_t) 1);
+	CHECK(buffers[0].data == payload->data() + 0x8000);
+	queue.MarkRead(0x8000);
+	CHECK_EQ(payload.use_count(), 1);
+	CHECK_EQ(queue.ReadAvailable(), (size_t) 8);
+}
+
+TWIB_TEST(OutputQueue, CoalescesCopiedWrites) {
+	common::OutputQueue queue;
+	for(uint32_t i = 0; i < 100; i++) {
+		queue.Write(i);
+	}
+	platform::SendBuffer buffers[4];
+	// the first write stands alone, and the rest are appended behind it
+	CHECK_EQ(queue.Gather(buffers, 4), (size_t) 2);
+	CHECK_EQ(buffers[0].size + buffers[1].size, (size_t) 400);
+}
+
+TWIB_TEST(OutputQueue, KeepsOrderAcrossPartialSends) {
+	common::OutputQueue queue;
+	std::vector<uint8_t> expected;
+	for(int i = 0; i < 20; i++) {
+		std::vector<uint8_t> piece(i * 37 + 1);
+		for(size_t j = 0; j < piece.size(); j++) {
+			piece[j] = i * 7 + j;
+		}
+		if(i % 3 == 0) {
+			queue.Write(std::make_shared<const std::vector<uint8_t>>(piece));
+		} else {
+			queue.Write(piece);
+		}
+		expected.insert(expected.end(), piece.begin(), piece.end());
+	}
+	CHECK(Drain(queue, 97) == expected);
+	CHECK_EQ(queue.ReadAvailable(), (size_t) 0);
+
+	platform::SendBuffer buffers[1];
+	CHECK_EQ(queue.Gather(buffers, 1), (size_t) 0);
+}
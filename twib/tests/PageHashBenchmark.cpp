@@ -0,0 +1,65 @@
+//
+// Twili - Homebrew debug monitor for the Nintendo Switch
+// Copyright (C) 2019 misson20000 <xenotoad@xenotoad.net>
+//
+// This file is part of Twili.
+//
+// Twili is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Twili is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Twili.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "Benchmark.hpp"
+
+#include<random>
+#include<vector>
+
+#include "PageHash.hpp"
+
+using namespace twili;
+using namespace twili::twib;
+
+TWIB_BENCHMARK(PageHash) {
+	const size_t page_size = util::PAGE_HASH_PAGE_SIZE;
+	
+	std::vector<uint8_t> data(64 * 1024 * 1024);
+	std::mt19937_64 rng(7);
+	for(size_t i = 0; i < data.size(); i+= 8) {
+		uint64_t r = rng();
+		std::copy((uint8_t*) &r, (uint8_t*) (&r + 1), data.begin() + i);
+	}
+
+	std::vector<uint64_t> hashes(data.size() / page_size);
+	b.Run("hash 64 MiB of pages", data.size(), [&]() {
+			for(size_t i = 0; i < hashes.size(); i++) {
+				hashes[i] = util::HashPage(data.data() + i * page_size, page_size);
+			}
+			test::Consume(hashes[0]);
+		});
+
+	// 4 GiB worth of pages, with a few scattered changes, like a game's heap
+	// between two frames
+	std::vector<uint64_t> previous(0x100000);
+	for(uint64_t &h : previous) {
+		h = rng() | 1;
+	}
+	std::vector<uint64_t> current = previous;
+	for(size_t i = 0; i < current.size() / 100; i++) {
+		current[rng() % current.size()]^= 2;
+	}
+	b.Run("diff 1M page hashes, 1% changed", 0, [&]() {
+			test::Consume(util::DiffPageHashes(previous, current).size());
+		});
+	b.Run("diff 1M page hashes, nothing changed", 0, [&]() {
+			test::Consume(util::DiffPageHashes(previous, previous).size());
+		});
+}
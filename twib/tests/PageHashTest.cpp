@@ -0,0 +1,87 @@
+//
+// Twili - Homebrew debug monitor for the Nintendo Switch
+// Copyright (C) 2019 misson20000 <xenotoad@xenotoad.net>
+//
+// This file is part of Twili.
+//
+// Twili is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Twili is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Twili.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "Test.hpp"
+
+#include<random>
+#include<set>
+
+#include "PageHash.hpp"
+
+namespace twili {
+namespace util {
+
+// found by argument-dependent lookup when comparing vectors of ranges
+static bool operator==(const PageRange &a, const PageRange &b) {
+	return a.first_page == b.first_page && a.page_count == b.page_count;
+}
+
+} // namespace util
+} // namespace twili
+
+using namespace twili;
+
+TWIB_TEST(PageHash, NoticesEveryByte) {
+	std::vector<uint8_t> page(util::PAGE_HASH_PAGE_SIZE);
+	std::mt19937 rng(99);
+	for(uint8_t &b : page) {
+		b = rng();
+	}
+	uint64_t original = util::HashPage(page.data(), page.size());
+	CHECK_EQ(util::HashPage(page.data(), page.size()), original);
+
+	std::set<uint64_t> seen = {original};
+	for(size_t i = 0; i < page.size(); i++) {
+		page[i]^= 0x01;
+		uint64_t h = util::HashPage(page.data(), page.size());
+		CHECK(h != util::PAGE_HASH_UNREADABLE);
+		seen.insert(h);
+		page[i]^= 0x01;
+	}
+	// a single flipped bit anywhere gives a new hash
+	CHECK_EQ(seen.size(), page.size() + 1);
+}
+
+TWIB_TEST(PageHash, ZeroPageIsNotUnreadable) {
+	std::vector<uint8_t> page(util::PAGE_HASH_PAGE_SIZE, 0);
+	CHECK(util::HashPage(page.data(), page.size()) != util::PAGE_HASH_UNREADABLE);
+}
+
+TWIB_TEST(PageHash, DiffOfIdenticalHashesIsEmpty) {
+	std::vector<uint64_t> hashes = {1, 2, 3, 4};
+	CHECK(util::DiffPageHashes(hashes, hashes).empty());
+	CHECK(util::DiffPageHashes({}, {}).empty());
+}
+
+TWIB_TEST(PageHash, DiffCoalescesChangedPages) {
+	std::vector<uint64_t> previous = {1, 2, 3, 4, 5, 6, 7, 8};
+	std::vector<uint64_t> current =  {1, 9, 9, 4, 5, 9, 7, 9};
+	std::vector<util::PageRange> ranges = util::DiffPageHashes(previous, current);
+	CHECK(ranges == (std::vector<util::PageRange> {{1, 2}, {5, 1}, {7, 1}}));
+}
+
+TWIB_TEST(PageHash, DiffCountsMissingPagesAsChanged) {
+	std::vector<uint64_t> shorter = {1, 2};
+	std::vector<uint64_t> longer = {1, 2, 3, 4};
+	CHECK(util::DiffPageHashes(shorter, longer) == (std::vector<util::PageRange> {{2, 2}}));
+	CHECK(util::DiffPageHashes(longer, shorter) == (std::vector<util::PageRange> {{2, 2}}));
+	// with nothing to compare against, everything changed
+	CHECK(util::DiffPageHashes({}, longer) == (std::vector<util::PageRange> {{0, 4}}));
+}
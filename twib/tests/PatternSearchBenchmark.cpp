@@ -0,0 +1,75 @@
+//
+// Twili - Homebrew debug monitor for the Nintendo Switch
+// Copyright (C) 2019 misson20000 <xenotoad@xenotoad.net>
+//
+// This file is part of Twili.
+//
+// Twili is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Twili is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Twili.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "Benchmark.hpp"
+
+#include<random>
+#include<vector>
+
+#include "PatternSearch.hpp"
+
+using namespace twili;
+using namespace twili::twib;
+
+TWIB_BENCHMARK(PatternSearch) {
+	// random bytes, like a heap full of data that mostly doesn't match
+	std::vector<uint8_t> data(64 * 1024 * 1024);
+	std::mt19937_64 rng(42);
+	for(size_t i = 0; i < data.size(); i+= 8) {
+		uint64_t r = rng();
+		std::copy((uint8_t*) &r, (uint8_t*) (&r + 1), data.begin() + i);
+	}
+
+	struct Case {
+		const char *label;
+		std::vector<uint8_t> pattern;
+		std::vector<uint8_t> mask;
+		uint64_t alignment;
+	};
+	std::vector<Case> cases = {
+		{"4 byte value", {0xde, 0xad, 0xbe, 0xef}, {}, 1},
+		{"4 byte value, 4 byte aligned", {0xde, 0xad, 0xbe, 0xef}, {}, 4},
+		{"8 byte value, 8 byte aligned", {1, 2, 3, 4, 5, 6, 7, 8}, {}, 8},
+		{"16 byte signature with wildcards", {0xfd, 0x7b, 0, 0, 0xfd, 0x03, 0, 0x91, 0, 0, 0, 0, 0xf3, 0x53, 0, 0xa9}, {0xff, 0xff, 0, 0, 0xff, 0xff, 0, 0xff, 0, 0, 0, 0, 0xff, 0xff, 0, 0xff}, 4},
+		{"no fully unmasked byte", {0x10, 0x20, 0x30, 0x40}, {0xf0, 0xf0, 0xf0, 0xf0}, 1},
+	};
+
+	for(Case &c : cases) {
+		util::PatternMatcher matcher(c.pattern, c.mask, c.alignment);
+		std::vector<uint64_t> results;
+		b.Run(c.label, data.size(), [&]() {
+				results.clear();
+				matcher.Search(data.data(), data.size(), data.size(), 0x7100000000, results, SIZE_MAX);
+				test::Consume(results.size());
+			});
+	}
+
+	// the way twili feeds it, in 64 KiB reads
+	util::PatternMatcher matcher({0xde, 0xad, 0xbe, 0xef}, {}, 1);
+	b.Run("4 byte value, scanned in 64 KiB pieces", data.size(), [&]() {
+			std::vector<uint64_t> results;
+			util::PatternScanner scanner(matcher, results, SIZE_MAX);
+			for(size_t offset = 0; offset < data.size(); offset+= 0x10000) {
+				std::copy_n(data.begin() + offset, 0x10000, scanner.Prepare(0x7100000000 + offset, 0x10000));
+				scanner.Commit();
+			}
+			test::Consume(results.size());
+		});
+}
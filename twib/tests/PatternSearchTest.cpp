@@ -0,0 +1,214 @@
+//
+// Twili - Homebrew debug monitor for the Nintendo Switch
+// Copyright (C) 2019 misson20000 <xenotoad@xenotoad.net>
+//
+// This file is part of Twili.
+//
+// Twili is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Twili is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Twili.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "Test.hpp"
+
+#include<algorithm>
+#include<random>
+
+#include "PatternSearch.hpp"
+
+using namespace twili;
+
+namespace {
+
+// the obvious way to do it, to check the real thing against
+std::vector<uint64_t> NaiveSearch(const std::vector<uint8_t> &data, uint64_t address, const std::vector<uint8_t> &pattern, const std::vector<uint8_t> &mask, uint64_t alignment) {
+	std::vector<uint64_t> results;
+	for(size_t offset = 0; offset + pattern.size() <= data.size(); offset++) {
+		if((address + offset) % alignment != 0) {
+			continue;
+		}
+		bool match = true;
+		for(size_t i = 0; i < pattern.size(); i++) {
+			uint8_t m = mask.empty() ? 0xff : mask[i];
+			match = match && (data[offset + i] & m) == (pattern[i] & m);
+		}
+		if(match) {
+			results.push_back(address + offset);
+		}
+	}
+	return results;
+}
+
+std::vector<uint64_t> Search(const std::vector<uint8_t> &data, uint64_t address, const std::vector<uint8_t> &pattern, const std::vector<uint8_t> &mask, uint64_t alignment, size_t max_results = SIZE_MAX) {
+	util::PatternMatcher matcher(pattern, mask, alignment);
+	std::vector<uint64_t> results;
+	matcher.Search(data.data(), data.size(), data.size(), address, results, max_results);
+	return results;
+}
+
+} // anonymous namespace
+
+TWIB_TEST(PatternSearch, FindsExactMatches) {
+	std::vector<uint8_t> data = {1, 2, 3, 1, 2, 3, 4, 1, 2};
+	std::vector<uint64_t> results = Search(data, 0x1000, {1, 2}, {}, 1);
+	CHECK(results == (std::vector<uint64_t> {0x1000, 0x1003, 0x1007}));
+}
+
+TWIB_TEST(PatternSearch, AppliesMask) {
+	std::vector<uint8_t> data = {0x10, 0xaa, 0x30, 0x11, 0xbb, 0x30, 0x10, 0xcc, 0x31};
+	// second byte is a wildcard, and only the high nibble of the third counts
+	std::vector<uint64_t> results = Search(data, 0, {0x10, 0x00, 0x30}, {0xff, 0x00, 0xf0}, 1);
+	CHECK(results == (std::vector<uint64_t> {0, 6}));
+}
+
+TWIB_TEST(PatternSearch, MatchesWithoutAnchorByte) {
+	// no byte of the pattern is fully unmasked, so every offset gets tested
+	std::vector<uint8_t> data = {0x12, 0x34, 0x1f, 0x3f, 0x20, 0x30};
+	std::vector<uint64_t> results = Search(data, 0, {0x10, 0x30}, {0xf0, 0xf0}, 1);
+	CHECK(results == (std::vector<uint64_t> {0, 2}));
+}
+
+TWIB_TEST(PatternSearch, RespectsAlignment) {
+	std::vector<uint8_t> data(32, 0);
+	data[3] = 0x55;
+	data[8] = 0x55;
+	data[12] = 0x55;
+	data[16] = 0x55;
+	// address 0x1004 puts data[4] on an 8-byte boundary
+	std::vector<uint64_t> results = Search(data, 0x1004, {0x55}, {}, 8);
+	CHECK(results == (std::vector<uint64_t> {0x1010}));
+	results = Search(data, 0x1000, {0x55}, {}, 8);
+	CHECK(results == (std::vector<uint64_t> {0x1008, 0x1010}));
+}
+
+TWIB_TEST(PatternSearch, LimitOnlyBoundsMatchStarts) {
+	std::vector<uint8_t> data = {0, 0, 0, 7, 8, 9, 7, 8, 9};
+	util::PatternMatcher matcher({7, 8, 9}, {}, 1);
+	std::vector<uint64_t> results;
+	// a match may start inside the limit and run past it
+	matcher.Search(data.data(), data.size(), 4, 0, results, SIZE_MAX);
+	CHECK(results == (std::vector<uint64_t> {3}));
+}
+
+TWIB_TEST(PatternSearch, StopsAtMaxResults) {
+	std::vector<uint8_t> data(64, 0xee);
+	util::PatternMatcher matcher({0xee}, {}, 1);
+	std::vector<uint64_t> results;
+	CHECK(matcher.Search(data.data(), data.size(), data.size(), 0, results, 5));
+	CHECK_EQ(results.size(), (size_t) 5);
+	CHECK_EQ(results.back(), (uint64_t) 4);
+
+	results.clear();
+	CHECK(!matcher.Search(data.data(), data.size(), data.size(), 0, results, 100));
+	CHECK_EQ(results.size(), (size_t) 64);
+}
+
+TWIB_TEST(PatternSearch, RejectsBadPatterns) {
+	CHECK(!util::PatternMatcher({}, {}, 1).IsValid());
+	CHECK(!util::PatternMatcher({1, 2}, {0xff}, 1).IsValid());
+	CHECK(!util::PatternMatcher({1, 2}, {}, 0).IsValid());
+	CHECK(util::PatternMatcher({1, 2}, {0xff, 0}, 4).IsValid());
+	
+	std::vector<uint8_t> data = {1, 2, 3};
+	CHECK(Search(data, 0, {}, {}, 1).empty());
+}
+
+TWIB_TEST(PatternSearch, IgnoresDataShorterThanPattern) {
+	std::vector<uint8_t> data = {1, 2};
+	CHECK(Search(data, 0, {1, 2, 3}, {}, 1).empty());
+}
+
+TWIB_TEST(PatternSearch, AgreesWithNaiveSearch) {
+	std::mt19937 rng(1234);
+	for(int round = 0; round < 500; round++) {
+		// a small alphabet, so that there are plenty of matches
+		std::vector<uint8_t> data(rng() % 512);
+		for(uint8_t &b : data) {
+			b = rng() % 4;
+		}
+		std::vector<uint8_t> pattern(1 + rng() % 6);
+		std::vector<uint8_t> mask;
+		for(uint8_t &b : pattern) {
+			b = rng() % 4;
+		}
+		if(rng() % 2) {
+			for(size_t i = 0; i < pattern.size(); i++) {
+				mask.push_back((uint8_t[]) {0xff, 0x00, 0x01, 0xfe}[rng() % 4]);
+			}
+		}
+		uint64_t alignment = (uint64_t[]) {1, 2, 4, 8, 16}[rng() % 5];
+		uint64_t address = 0x7100000000 + rng() % 32;
+
+		CHECK(Search(data, address, pattern, mask, alignment) == NaiveSearch(data, address, pattern, mask, alignment));
+	}
+}
+
+TWIB_TEST(PatternSearch, ScannerFindsMatchesAcrossPieces) {
+	std::mt19937 rng(5678);
+	for(int round = 0; round < 200; round++) {
+		std::vector<uint8_t> data(1 + rng() % 1024);
+		for(uint8_t &b : data) {
+			b = rng() % 3;
+		}
+		std::vector<uint8_t> pattern(1 + rng() % 12);
+		for(uint8_t &b : pattern) {
+			b = rng() % 3;
+		}
+		uint64_t address = 0x1000;
+		util::PatternMatcher matcher(pattern, {}, 1);
+
+		// feed it in random-sized contiguous pieces
+		std::vector<uint64_t> results;
+		util::PatternScanner scanner(matcher, results, SIZE_MAX);
+		for(size_t offset = 0; offset < data.size(); ) {
+			size_t size = std::min<size_t>(1 + rng() % 64, data.size() - offset);
+			std::copy_n(data.begin() + offset, size, scanner.Prepare(address + offset, size));
+			scanner.Commit();
+			offset+= size;
+		}
+		
+		CHECK(results == NaiveSearch(data, address, pattern, {}, 1));
+	}
+}
+
+TWIB_TEST(PatternSearch, ScannerDoesNotMatchAcrossGaps) {
+	util::PatternMatcher matcher({1, 2, 3, 4}, {}, 1);
+	std::vector<uint64_t> results;
+	util::PatternScanner scanner(matcher, results, SIZE_MAX);
+
+	std::vector<uint8_t> first = {0, 0, 1, 2};
+	std::vector<uint8_t> second = {3, 4, 0, 0};
+	std::copy(first.begin(), first.end(), scanner.Prepare(0x1000, first.size()));
+	scanner.Commit();
+	// a hole between 0x1004 and 0x1010
+	std::copy(second.begin(), second.end(), scanner.Prepare(0x1010, second.size()));
+	scanner.Commit();
+	CHECK(results.empty());
+
+	// but right up against each other, they match
+	std::copy(first.begin(), first.end(), scanner.Prepare(0x2000, first.size()));
+	scanner.Commit();
+	std::copy(second.begin(), second.end(), scanner.Prepare(0x2004, second.size()));
+	scanner.Commit();
+	CHECK(results == (std::vector<uint64_t> {0x2002}));
+}
+
+TWIB_TEST(PatternSearch, ScannerStopsAtMaxResults) {
+	util::PatternMatcher matcher({9}, {}, 1);
+	std::vector<uint64_t> results;
+	util::PatternScanner scanner(matcher, results, 3);
+	std::fill_n(scanner.Prepare(0, 2), 2, 9);
+	CHECK(!scanner.Commit());
+	std::fill_n(scanner.Prepare(2, 2), 2, 9);
+	CHECK(scanner.Commit());
+	CHECK_EQ(results.size(), (size_t) 3);
+}
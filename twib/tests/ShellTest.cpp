@@ -0,0 +1,73 @@
+//
+// Twili - Homebrew debug monitor for the Nintendo Switch
+// Copyright (C) 2019 misson20000 <xenotoad@xenotoad.net>
+//
+// This file is part of Twili.
+//
+// Twili is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Twili is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Twili.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "Test.hpp"
+#include "SimDaemon.hpp"
+
+#include<string>
+
+#include<stdio.h>
+
+#include "common/config.hpp"
+
+using namespace twili::twib;
+
+namespace {
+
+void WriteFile(const std::string &path, const std::string &contents) {
+	FILE *file = fopen(path.c_str(), "w");
+	CHECK(file != nullptr);
+	fwrite(contents.data(), 1, contents.size(), file);
+	fclose(file);
+}
+
+} // anonymous namespace
+
+TWIB_TEST(Shell, BackgroundOutputStaysTogether) {
+	test::SimDaemon daemon({"--sim-devices", "1", "--sim-latency", "2000"});
+	CHECK(daemon.WaitForDevices(1));
+
+	std::string a(0x30000, 'a'), b(0x30000, 'b');
+	WriteFile(daemon.fs_root + "/sd/a", a);
+	WriteFile(daemon.fs_root + "/sd/b", b);
+	std::string script = daemon.fs_root + "/script";
+	WriteFile(script, "sd pull a - &\nsd pull b - &\nwait\nsd ls /\n");
+
+	std::string output, errors;
+	CHECK_EQ(daemon.RunTwib({"shell", "-j", "2", script}, output, errors), 0);
+	// pulls print through the shell like everything else, so each file's
+	// contents come out in one piece, and before the listing that follows
+	CHECK(output == a + b + "a\nb\n" || output == b + a + "a\nb\n");
+	CHECK(errors.find("[3] sd ls /: ok") != std::string::npos);
+}
+
+#if TWIB_GDB_ENABLED == 1
+TWIB_TEST(Shell, RefusesGdb) {
+	test::SimDaemon daemon({"--sim-devices", "1"});
+	CHECK(daemon.WaitForDevices(1));
+
+	std::string script = daemon.fs_root + "/script";
+	WriteFile(script, "gdb\n");
+
+	std::string output, errors;
+	CHECK_EQ(daemon.RunTwib({"shell", script}, output, errors), 1);
+	CHECK(errors.find("gdb can't be run from a shell") != std::string::npos);
+}
+#endif
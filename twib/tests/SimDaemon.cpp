@@ -0,0 +1,228 @@
+//
+// Twili - Homebrew debug monitor for the Nintendo Switch
+// Copyright (C) 2019 misson20000 <xenotoad@xenotoad.net>
+//
+// This file is part of Twili.
+//
+// Twili is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Twili is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Twili.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include "SimDaemon.hpp"
+
+#include "common/config.hpp"
+
+#include<stdexcept>
+#include<system_error>
+#include<thread>
+
+#include<errno.h>
+#include<fcntl.h>
+#include<poll.h>
+#include<signal.h>
+#include<stdlib.h>
+#include<string.h>
+#include<sys/stat.h>
+#include<sys/wait.h>
+#include<unistd.h>
+
+#include "tool/Connect.hpp"
+#include "tool/interfaces/ITwibMetaInterface.hpp"
+
+namespace twili {
+namespace twib {
+namespace test {
+
+namespace {
+
+std::vector<char*> MakeArgv(const std::string &path, const std::vector<std::string> &args) {
+	std::vector<char*> argv;
+	argv.push_back(const_cast<char*>(path.c_str()));
+	for(const std::string &arg : args) {
+		argv.push_back(const_cast<char*>(arg.c_str()));
+	}
+	argv.push_back(nullptr);
+	return argv;
+}
+
+} // anonymous namespace
+
+std::string GetTwibdPath() {
+	return TEST_TWIBD_PATH;
+}
+
+std::string GetTwibPath() {
+	return TEST_TWIB_PATH;
+}
+
+int RunProgram(const std::string &path, const std::vector<std::string> &args, std::string &output, std::string &errors) {
+	int out_fds[2], err_fds[2];
+	if(pipe(out_fds) != 0) {
+		throw std::system_error(errno, std::generic_category());
+	}
+	if(pipe(err_fds) != 0) {
+		close(out_fds[0]);
+		close(out_fds[1]);
+		throw std::system_error(errno, std::generic_category());
+	}
+	std::vector<char*> argv = MakeArgv(path, args);
+	pid_t child = fork();
+	if(child < 0) {
+		throw std::system_error(errno, std::generic_category());
+	}
+	if(child == 0) {
+		dup2(out_fds[1], STDOUT_FILENO);
+		dup2(err_fds[1], STDERR_FILENO);
+		close(out_fds[0]);
+		close(out_fds[1]);
+		close(err_fds[0]);
+		close(err_fds[1]);
+		execv(path.c_str(), argv.data());
+		_exit(127);
+	}
+	close(out_fds[1]);
+	close(err_fds[1]);
+
+	output.clear();
+	errors.clear();
+	struct pollfd fds[2] = {{out_fds[0], POLLIN, 0}, {err_fds[0], POLLIN, 0}};
+	std::string *destinations[2] = {&output, &errors};
+	int open_count = 2;
+	while(open_count > 0) {
+		if(poll(fds, 2, -1) < 0) {
+			if(errno == EINTR) {
+				continue;
+			}
+			break;
+		}
+		for(int i = 0; i < 2; i++) {
+			if(fds[i].fd < 0 || fds[i].revents == 0) {
+				continue;
+			}
+			char buffer[4096];
+			ssize_t r = read(fds[i].fd, buffer, sizeof(buffer));
+			if(r > 0) {
+				destinations[i]->append(buffer, r);
+			} else if(r == 0 || errno != EINTR) {
+				close(fds[i].fd);
+				fds[i].fd = -1;
+				open_count--;
+			}
+		}
+	}
+	for(struct pollfd &pfd : fds) {
+		if(pfd.fd >= 0) {
+			close(pfd.fd);
+		}
+	}
+
+	int status;
+	while(waitpid(child, &status, 0) < 0) {
+		if(errno != EINTR) {
+			throw std::system_error(errno, std::generic_category());
+		}
+	}
+	return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+SimDaemon::SimDaemon(std::vector<std::string> args) {
+	char name[] = "/tmp/twib-test-XXXXXX";
+	if(mkdtemp(name) == nullptr) {
+		throw std::system_error(errno, std::generic_category());
+	}
+	directory = name;
+	fs_root = directory + "/fs";
+	socket_path = directory + "/twibd.sock";
+	mkdir(fs_root.c_str(), 0755);
+	mkdir((fs_root + "/sd").c_str(), 0755);
+
+	std::vector<std::string> daemon_args = {"-P", socket_path, "--sim-fs-root", fs_root};
+#if TWIB_TCP_FRONTEND_ENABLED == 1
+	daemon_args.push_back("--no-tcp");
+#endif
+	daemon_args.insert(daemon_args.end(), args.begin(), args.end());
+	std::string path = GetTwibdPath();
+	std::vector<char*> argv = MakeArgv(path, daemon_args);
+	std::string log_path = directory + "/twibd.log";
+	
+	pid = fork();
+	if(pid < 0) {
+		throw std::system_error(errno, std::generic_category());
+	}
+	if(pid == 0) {
+		int log = open(log_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		if(log >= 0) {
+			dup2(log, STDOUT_FILENO);
+			dup2(log, STDERR_FILENO);
+			close(log);
+		}
+		execv(path.c_str(), argv.data());
+		_exit(127);
+	}
+}
+
+SimDaemon::~SimDaemon() {
+	if(pid > 0) {
+		kill(pid, SIGTERM);
+		int status;
+		waitpid(pid, &status, 0);
+	}
+	std::string output, errors;
+	RunProgram("/bin/rm", {"-rf", directory}, output, errors);
+}
+
+bool SimDaemon::WaitForDevices(size_t count, std::chrono::seconds timeout) {
+	auto deadline = std::chrono::steady_clock::now() + timeout;
+	std::string output, errors;
+	do {
+		if(RunTwib({"list-devices"}, output, errors) == 0) {
+			// one table row per device, with the nickname in the second column
+			size_t listed = 0;
+			for(size_t i = output.find("| sim-"); i != std::string::npos; i = output.find("| sim-", i + 1)) {
+				listed++;
+			}
+			if(listed >= count) {
+				return true;
+			}
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	} while(std::chrono::steady_clock::now() < deadline);
+	return false;
+}
+
+int SimDaemon::RunTwib(std::vector<std::string> args, std::string &output, std::string &errors) {
+	args.insert(args.begin(), {"-P", socket_path});
+	return RunProgram(GetTwibPath(), args, output, errors);
+}
+
+std::unique_ptr<tool::client::Client> SimDaemon::Connect() {
+	std::unique_ptr<tool::client::Client> client = tool::connect_unix(socket_path);
+	if(!client) {
+		throw std::runtime_error("could not connect to twibd");
+	}
+	return client;
+}
+
+std::vector<uint32_t> ListDeviceIds(tool::client::Client &client) {
+	tool::ITwibMetaInterface itmi(tool::RemoteObject(client, 0, 0));
+	std::vector<uint32_t> ids;
+	for(const msgpack11::MsgPack &device : itmi.ListDevices()) {
+		ids.push_back(device["device_id"].uint32_value());
+	}
+	return ids;
+}
+
+} // namespace test
+} // namespace twib
+} // namespace twili
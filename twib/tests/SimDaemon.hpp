@@ -0,0 +1,77 @@
+//
+// Twili - Homebrew debug monitor for the Nintendo Switch
+// Copyright (C) 2019 misson20000 <xenotoad@xenotoad.net>
+//
+// This file is part of Twili.
+//
+// Twili is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Twili is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Twili.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#pragma once
+
+#include<chrono>
+#include<memory>
+#include<string>
+#include<vector>
+
+#include<sys/types.h>
+
+#include "tool/Client.hpp"
+
+namespace twili {
+namespace twib {
+namespace test {
+
+// Runs a twibd with simulated devices on a private socket, for tests that
+// exercise twibd and twib end to end. The daemon is killed and its temporary
+// directory removed when this is destroyed.
+class SimDaemon {
+ public:
+	// `args` are passed to twibd after the socket and filesystem options,
+	// and should include --sim-devices.
+	SimDaemon(std::vector<std::string> args);
+	~SimDaemon();
+
+	// Waits until twibd lists `count` devices. Returns false on timeout.
+	bool WaitForDevices(size_t count, std::chrono::seconds timeout = std::chrono::seconds(10));
+	// Runs twib against this daemon, collecting stdout into `output` and
+	// stderr into `errors`. Returns twib's exit status, or -1 if it didn't
+	// exit normally.
+	int RunTwib(std::vector<std::string> args, std::string &output, std::string &errors);
+	// Connects a client to this daemon, for tests that talk to it directly.
+	std::unique_ptr<tool::client::Client> Connect();
+
+	// a directory whose subdirectories back the simulated filesystems; "sd"
+	// already exists
+	std::string fs_root;
+	std::string socket_path;
+ private:
+	std::string directory;
+	pid_t pid = -1;
+};
+
+// IDs of the devices a client's daemon knows about
+std::vector<uint32_t> ListDeviceIds(tool::client::Client &client);
+
+// path to a program built alongside the tests
+std::string GetTwibdPath();
+std::string GetTwibPath();
+
+// Runs a program, collecting stdout into `output` and stderr into `errors`.
+int RunProgram(const std::string &path, const std::vector<std::string> &args, std::string &output, std::string &errors);
+
+} // namespace test
+} // namespace twib
+} // namespace twili
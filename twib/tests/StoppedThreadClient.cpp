@@ -0,0 +1,95 @@
+//
+// Twili - Homebrew debug monitor for the Nintendo Switch
+// Copyright (C) 2019 misson20000 <xenotoad@xenotoad.net>
+//
+// This file is part of Twili.
+//
+// Twili is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Twili is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Twili.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include "StoppedThreadClient.hpp"
+
+#include<thread>
+
+#include<string.h>
+
+#include "err.hpp"
+
+namespace twili {
+namespace twib {
+namespace test {
+
+namespace {
+
+const uint32_t KERNEL_ERR_INVALID_CURRENT_MEMORY = 0xd401;
+const size_t THREAD_CONTEXT_SIZE = 100; // in registers, as ITwibDebugger expects
+
+} // anonymous namespace
+
+StoppedThreadClient::StoppedThreadClient(uint64_t memory_base, std::vector<uint8_t> memory, std::chrono::microseconds latency) :
+	registers(THREAD_CONTEXT_SIZE, 0),
+	memory_base(memory_base),
+	memory(memory),
+	latency(latency) {
+}
+
+tool::ITwibDebugger StoppedThreadClient::OpenDebugger() {
+	return tool::ITwibDebugger(std::make_shared<tool::RemoteObject>(*this, 1, 1));
+}
+
+void StoppedThreadClient::SendRequestImpl(const tool::Request &rq) {
+	requests++;
+	if(latency.count() > 0) {
+		std::this_thread::sleep_for(latency);
+	}
+	
+	util::Buffer request(rq.payload);
+	util::Buffer payload;
+	uint32_t result = 0;
+	switch((protocol::ITwibDebugger::Command) rq.command_id) {
+	case protocol::ITwibDebugger::Command::GET_THREAD_CONTEXT:
+		registers.resize(THREAD_CONTEXT_SIZE);
+		payload.Write(registers);
+		break;
+	case protocol::ITwibDebugger::Command::READ_MEMORY: {
+		uint64_t addr = 0, size = 0;
+		request.Read(addr);
+		request.Read(size);
+		if(addr < memory_base || size > memory.size() || addr - memory_base > memory.size() - size) {
+			result = KERNEL_ERR_INVALID_CURRENT_MEMORY;
+			break;
+		}
+		payload.Write<uint64_t>(size);
+		payload.Write(memory.data() + (addr - memory_base), size);
+		break; }
+	default:
+		result = TWILI_ERR_PROTOCOL_UNRECOGNIZED_FUNCTION;
+		break;
+	}
+
+	protocol::MessageHeader mh;
+	mh.device_id = rq.device_id;
+	mh.object_id = rq.object_id;
+	mh.result_code = result;
+	mh.tag = rq.tag;
+	mh.payload_size = payload.ReadAvailable();
+	mh.object_count = 0;
+	util::Buffer object_ids;
+	PostResponse(mh, payload, object_ids);
+}
+
+} // namespace test
+} // namespace twib
+} // namespace twili
@@ -0,0 +1,56 @@
+//
+// Twili - Homebrew debug monitor for the Nintendo Switch
+// Copyright (C) 2019 misson20000 <xenotoad@xenotoad.net>
+//
+// This file is part of Twili.
+//
+// Twili is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Twili is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Twili.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#pragma once
+
+#include<chrono>
+#include<vector>
+
+#include "tool/Client.hpp"
+#include "tool/interfaces/ITwibDebugger.hpp"
+
+namespace twili {
+namespace twib {
+namespace test {
+
+// Plays a device with one stopped thread and one mapped region of memory,
+// answering GET_THREAD_CONTEXT and READ_MEMORY after `latency` and counting
+// the requests it gets.
+class StoppedThreadClient : public tool::client::Client {
+ public:
+	StoppedThreadClient(uint64_t memory_base, std::vector<uint8_t> memory, std::chrono::microseconds latency = std::chrono::microseconds(0));
+
+	tool::ITwibDebugger OpenDebugger();
+
+	// laid out like nx::ThreadContext
+	std::vector<uint64_t> registers;
+	const uint64_t memory_base;
+	std::vector<uint8_t> memory;
+	size_t requests = 0;
+ protected:
+	virtual void SendRequestImpl(const tool::Request &rq) override;
+ private:
+	const std::chrono::microseconds latency;
+};
+
+} // namespace test
+} // namespace twib
+} // namespace twili
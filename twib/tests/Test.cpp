@@ -0,0 +1,101 @@
+//
+// Twili - Homebrew debug monitor for the Nintendo Switch
+// Copyright (C) 2019 misson20000 <xenotoad@xenotoad.net>
+//
+// This file is part of Twili.
+//
+// Twili is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Twili is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Twili.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "Test.hpp"
+
+#include<stdio.h>
+#include<string.h>
+
+#include<exception>
+
+namespace twili {
+namespace twib {
+namespace test {
+
+namespace {
+
+struct TestCase {
+	const char *suite;
+	const char *name;
+	void (*function)();
+};
+
+std::vector<TestCase> &GetTestCases() {
+	static std::vector<TestCase> cases;
+	return cases;
+}
+
+std::vector<std::string> arguments;
+
+} // anonymous namespace
+
+Failure::Failure(const char *file, int line, std::string message) :
+	file(file),
+	line(line),
+	message(message) {
+}
+
+Registration::Registration(const char *suite, const char *name, void (*function)()) {
+	GetTestCases().push_back({suite, name, function});
+}
+
+const std::vector<std::string> &GetArguments() {
+	return arguments;
+}
+
+} // namespace test
+} // namespace twib
+} // namespace twili
+
+using namespace twili::twib;
+
+// usage: twib-tests [suite [arguments...]]
+int main(int argc, char *argv[]) {
+	const char *suite = argc > 1 ? argv[1] : nullptr;
+	for(int i = 2; i < argc; i++) {
+		test::arguments.push_back(argv[i]);
+	}
+
+	int ran = 0;
+	int failed = 0;
+	for(test::TestCase &tc : test::GetTestCases()) {
+		if(suite != nullptr && strcmp(suite, tc.suite) != 0) {
+			continue;
+		}
+		ran++;
+		try {
+			tc.function();
+			printf("[  ok  ] %s.%s\n", tc.suite, tc.name);
+		} catch(test::Failure &f) {
+			printf("[ FAIL ] %s.%s\n  %s:%d: %s\n", tc.suite, tc.name, f.file, f.line, f.message.c_str());
+			failed++;
+		} catch(std::exception &e) {
+			printf("[ FAIL ] %s.%s\n  threw %s\n", tc.suite, tc.name, e.what());
+			failed++;
+		}
+	}
+
+	if(ran == 0) {
+		fprintf(stderr, "no tests in suite '%s'\n", suite);
+		return 1;
+	}
+	printf("%d of %d tests passed\n", ran - failed, ran);
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,76 @@
+//
+// Twili - Homebrew debug monitor for the Nintendo Switch
+// Copyright (C) 2019 misson20000 <xenotoad@xenotoad.net>
+//
+// This file is part of Twili.
+//
+// Twili is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Twili is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Twili.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#pragma once
+
+#include<sstream>
+#include<string>
+#include<vector>
+
+namespace twili {
+namespace twib {
+namespace test {
+
+// Thrown by the CHECK macros to fail the running test.
+class Failure {
+ public:
+	Failure(const char *file, int line, std::string message);
+	
+	const char *file;
+	int line;
+	std::string message;
+};
+
+class Registration {
+ public:
+	Registration(const char *suite, const char *name, void (*function)());
+};
+
+// whatever followed the suite name on the command line, for tests that need
+// to find something from the build
+const std::vector<std::string> &GetArguments();
+
+template<typename T, typename U>
+void CheckEqual(const T &actual, const U &expected, const char *actual_expr, const char *expected_expr, const char *file, int line) {
+	if(!(actual == expected)) {
+		std::ostringstream ss;
+		ss << actual_expr << " == " << expected_expr << " (got " << actual << ", expected " << expected << ")";
+		throw Failure(file, line, ss.str());
+	}
+}
+
+} // namespace test
+} // namespace twib
+} // namespace twili
+
+#define TWIB_TEST(suite, name) \
+	static void test_##suite##_##name(); \
+	static ::twili::twib::test::Registration registration_##suite##_##name(#suite, #name, &test_##suite##_##name); \
+	static void test_##suite##_##name()
+
+#define CHECK(expr) \
+	do { \
+		if(!(expr)) { \
+			throw ::twili::twib::test::Failure(__FILE__, __LINE__, #expr); \
+		} \
+	} while(0)
+
+#define CHECK_EQ(actual, expected) \
+	::twili::twib::test::CheckEqual((actual), (expected), #actual, #expected, __FILE__, __LINE__)
@@ -0,0 +1,252 @@
+//
+// Twili - Homebrew debug monitor for the Nintendo Switch
+// Copyright (C) 2019 misson20000 <xenotoad@xenotoad.net>
+//
+// This file is part of Twili.
+//
+// Twili is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Twili is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Twili.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include "Test.hpp"
+
+#include<deque>
+#include<map>
+#include<set>
+#include<stdexcept>
+
+#include "TransferRing.hpp"
+
+using namespace twili;
+
+namespace {
+
+// Stands in for a usb:ds endpoint. Every transfer completes in full unless
+// told otherwise, and the bytes of completed transfers are collected in the
+// order the host would receive them.
+struct FakeEndpoint {
+	struct Transfer {
+		uint32_t urb_id;
+		uint8_t *data;
+		std::vector<uint8_t> contents;
+		bool done = false;
+	};
+
+	uint32_t next_urb_id = 100;
+	std::deque<Transfer> transfers;
+	std::vector<uint8_t> received;
+	std::vector<uint32_t> waited;
+	std::set<uint8_t*> buffers;
+	size_t max_outstanding = 0;
+
+	// how the transfer with this URB ID ends: a short size, a failure, or the
+	// wait itself throwing
+	std::map<uint32_t, size_t> short_transfers;
+	std::set<uint32_t> failed_transfers;
+	std::set<uint32_t> throwing_transfers;
+
+	size_t Outstanding() const {
+		size_t count = 0;
+		for(const Transfer &t : transfers) {
+			count+= t.done ? 0 : 1;
+		}
+		return count;
+	}
+};
+
+struct FakeBuffer {
+	FakeBuffer(size_t size) : storage(size), data(storage.data()), size(size) {
+	}
+	std::vector<uint8_t> storage;
+	uint8_t *data;
+	size_t size;
+};
+
+struct FakeError {
+	FakeError(uint32_t code) : code(code) {
+	}
+	uint32_t code;
+};
+
+struct FakeTraits {
+	using Endpoint = FakeEndpoint;
+	using Buffer = FakeBuffer;
+	using Error = FakeError;
+
+	static uint32_t PostBufferAsync(FakeEndpoint &ep, uint8_t *data, size_t size) {
+		FakeEndpoint::Transfer t;
+		t.urb_id = ep.next_urb_id++;
+		t.data = data;
+		t.contents.assign(data, data + size);
+		ep.transfers.push_back(t);
+		ep.buffers.insert(data);
+		ep.max_outstanding = std::max(ep.max_outstanding, ep.Outstanding());
+		return t.urb_id;
+	}
+
+	static bool WaitForTransfer(FakeEndpoint &ep, uint32_t urb_id, size_t &transferred_size) {
+		ep.waited.push_back(urb_id);
+		// transfers finish in the order they were posted, so anything else is
+		// the ring losing track
+		FakeEndpoint::Transfer *oldest = nullptr;
+		for(FakeEndpoint::Transfer &t : ep.transfers) {
+			if(!t.done) {
+				oldest = &t;
+				break;
+			}
+		}
+		if(oldest == nullptr || oldest->urb_id != urb_id) {
+			throw std::logic_error("waited on a transfer out of order");
+		}
+		if(ep.throwing_transfers.count(urb_id)) {
+			throw std::runtime_error("lost the endpoint");
+		}
+		oldest->done = true;
+		if(ep.failed_transfers.count(urb_id)) {
+			return false;
+		}
+		transferred_size = oldest->contents.size();
+		auto s = ep.short_transfers.find(urb_id);
+		if(s != ep.short_transfers.end()) {
+			transferred_size = s->second;
+		}
+		ep.received.insert(ep.received.end(), oldest->contents.begin(), oldest->contents.begin() + transferred_size);
+		return true;
+	}
+
+	static void PostBufferSync(FakeEndpoint &ep, uint8_t *data, size_t size) {
+		ep.received.insert(ep.received.end(), data, data + size);
+	}
+};
+
+using Ring = util::TransferRing<FakeTraits>;
+
+std::vector<uint8_t> Chunk(uint8_t first, size_t size) {
+	std::vector<uint8_t> chunk(size);
+	for(size_t i = 0; i < size; i++) {
+		chunk[i] = first + i;
+	}
+	return chunk;
+}
+
+} // anonymous namespace
+
+TWIB_TEST(TransferRing, KeepsOrderAndReusesBuffers) {
+	FakeEndpoint ep;
+	Ring ring(4, 16);
+	std::vector<uint8_t> expected;
+	for(uint8_t i = 0; i < 10; i++) {
+		std::vector<uint8_t> chunk = Chunk(i * 16, 16 - (i % 3));
+		ring.Post(ep, chunk.data(), chunk.size());
+		// the ring copied it, so the caller can reuse its buffer right away
+		std::fill(chunk.begin(), chunk.end(), 0xff);
+		expected.insert(expected.end(), ep.transfers.back().contents.begin(), ep.transfers.back().contents.end());
+	}
+	CHECK_EQ(ring.GetInFlightCount(), (size_t) 4);
+	ring.Flush(ep);
+
+	CHECK_EQ(ring.GetInFlightCount(), (size_t) 0);
+	CHECK(ep.received == expected);
+	CHECK_EQ(expected[16], 16);
+	CHECK_EQ(ep.max_outstanding, (size_t) 4);
+	CHECK_EQ(ep.buffers.size(), (size_t) 4);
+	CHECK_EQ(ep.waited.size(), (size_t) 10);
+	for(size_t i = 0; i < ep.waited.size(); i++) {
+		CHECK_EQ(ep.waited[i], ep.transfers[i].urb_id);
+	}
+}
+
+TWIB_TEST(TransferRing, FinishesLoneShortTransfer) {
+	FakeEndpoint ep;
+	Ring ring(4, 16);
+	std::vector<uint8_t> chunk = Chunk(0, 16);
+	ep.short_transfers[ep.next_urb_id] = 10;
+	ring.Post(ep, chunk.data(), chunk.size());
+	ring.Flush(ep);
+	CHECK(ep.received == chunk);
+	CHECK_EQ(ring.GetInFlightCount(), (size_t) 0);
+}
+
+TWIB_TEST(TransferRing, ShortTransferWithOthersQueuedEmptiesRing) {
+	FakeEndpoint ep;
+	Ring ring(4, 16);
+	ep.short_transfers[ep.next_urb_id] = 10;
+	for(uint8_t i = 0; i < 3; i++) {
+		std::vector<uint8_t> chunk = Chunk(i * 16, 16);
+		ring.Post(ep, chunk.data(), chunk.size());
+	}
+	uint8_t *first_buffer = ep.transfers[0].data;
+
+	bool threw = false;
+	try {
+		ring.Flush(ep);
+	} catch(FakeError &e) {
+		CHECK_EQ(e.code, (uint32_t) TWILI_ERR_FATAL_USB_TRANSFER);
+		threw = true;
+	}
+	CHECK(threw);
+	// every queued transfer was waited out before giving up
+	CHECK_EQ(ep.Outstanding(), (size_t) 0);
+	CHECK_EQ(ring.GetInFlightCount(), (size_t) 0);
+
+	// and the ring starts over from its first buffer
+	std::vector<uint8_t> chunk = Chunk(0x80, 8);
+	ring.Post(ep, chunk.data(), chunk.size());
+	CHECK(ep.transfers.back().data == first_buffer);
+	ring.Flush(ep);
+	CHECK_EQ(ring.GetInFlightCount(), (size_t) 0);
+}
+
+TWIB_TEST(TransferRing, FailedTransferEmptiesRing) {
+	FakeEndpoint ep;
+	Ring ring(2, 16);
+	std::vector<uint8_t> chunk = Chunk(0, 16);
+	ep.failed_transfers.insert(ep.next_urb_id + 1);
+	ring.Post(ep, chunk.data(), chunk.size());
+	ring.Post(ep, chunk.data(), chunk.size());
+	// waits for the first transfer, which went fine
+	ring.Post(ep, chunk.data(), chunk.size());
+	CHECK_EQ(ring.GetInFlightCount(), (size_t) 2);
+
+	bool threw = false;
+	try {
+		// waits for the second, which failed
+		ring.Post(ep, chunk.data(), chunk.size());
+	} catch(FakeError &e) {
+		CHECK_EQ(e.code, (uint32_t) TWILI_ERR_USB_TRANSFER);
+		threw = true;
+	}
+	CHECK(threw);
+	CHECK_EQ(ep.Outstanding(), (size_t) 0);
+	CHECK_EQ(ring.GetInFlightCount(), (size_t) 0);
+	CHECK_EQ(ep.transfers.size(), (size_t) 3);
+}
+
+TWIB_TEST(TransferRing, ThrowingWaitForgetsTransfers) {
+	FakeEndpoint ep;
+	Ring ring(4, 16);
+	std::vector<uint8_t> chunk = Chunk(0, 16);
+	ep.throwing_transfers.insert(ep.next_urb_id);
+	ring.Post(ep, chunk.data(), chunk.size());
+	ring.Post(ep, chunk.data(), chunk.size());
+
+	bool threw = false;
+	try {
+		ring.Flush(ep);
+	} catch(std::runtime_error &e) {
+		threw = true;
+	}
+	CHECK(threw);
+	CHECK_EQ(ring.GetInFlightCount(), (size_t) 0);
+}
@@ -0,0 +1,127 @@
+//
+// Twili - Homebrew debug monitor for the Nintendo Switch
+// Copyright (C) 2019 misson20000 <xenotoad@xenotoad.net>
+//
+// This file is part of Twili.
+//
+// Twili is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Twili is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Twili.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "Test.hpp"
+#include "SimDaemon.hpp"
+
+#include<memory>
+#include<string>
+#include<vector>
+
+#include<stdio.h>
+#include<sys/stat.h>
+
+#include "tool/interfaces/ITwibDeviceInterface.hpp"
+
+using namespace twili::twib;
+
+namespace {
+
+void MakeFile(const std::string &path) {
+	FILE *file = fopen(path.c_str(), "w");
+	CHECK(file != nullptr);
+	fputs("twili", file);
+	fclose(file);
+}
+
+// sd/tree/{a.txt, b.log, sub/c.txt, sub/deeper/{d.txt, e.log}}
+void MakeTree(test::SimDaemon &daemon) {
+	std::string tree = daemon.fs_root + "/sd/tree";
+	CHECK(mkdir(tree.c_str(), 0755) == 0);
+	CHECK(mkdir((tree + "/sub").c_str(), 0755) == 0);
+	CHECK(mkdir((tree + "/sub/deeper").c_str(), 0755) == 0);
+	MakeFile(tree + "/a.txt");
+	MakeFile(tree + "/b.log");
+	MakeFile(tree + "/sub/c.txt");
+	MakeFile(tree + "/sub/deeper/d.txt");
+	MakeFile(tree + "/sub/deeper/e.log");
+}
+
+// the same listings whether the device walks the tree or twib opens every
+// directory itself
+void CheckListings(test::SimDaemon &daemon) {
+	std::string output, errors;
+	CHECK_EQ(daemon.RunTwib({"sd", "ls", "-R", "--max-depth", "2", "/tree"}, output, errors), 0);
+	CHECK_EQ(output, std::string("a.txt\nb.log\nsub\nsub/c.txt\nsub/deeper\n"));
+
+	output.clear();
+	CHECK_EQ(daemon.RunTwib({"sd", "ls", "-R", "/tree"}, output, errors), 0);
+	CHECK_EQ(output, std::string("a.txt\nb.log\nsub\nsub/c.txt\nsub/deeper\nsub/deeper/d.txt\nsub/deeper/e.log\n"));
+
+	output.clear();
+	CHECK_EQ(daemon.RunTwib({"sd", "ls", "-R", "--name", "*.log", "/tree"}, output, errors), 0);
+	CHECK_EQ(output, std::string("b.log\nsub/deeper/e.log\n"));
+
+	// without -R, only the top level is searched
+	output.clear();
+	CHECK_EQ(daemon.RunTwib({"sd", "ls", "--name", "*.txt", "/tree"}, output, errors), 0);
+	CHECK_EQ(output, std::string("a.txt\n"));
+}
+
+} // anonymous namespace
+
+TWIB_TEST(WalkDirectory, DepthAndNameFilters) {
+	test::SimDaemon daemon({"--sim-devices", "1"});
+	CHECK(daemon.WaitForDevices(1));
+	MakeTree(daemon);
+	CheckListings(daemon);
+}
+
+TWIB_TEST(WalkDirectory, FallsBackToOpenDirectory) {
+	test::SimDaemon daemon({"--sim-devices", "1", "--sim-no-walk-directory"});
+	CHECK(daemon.WaitForDevices(1));
+	MakeTree(daemon);
+	CheckListings(daemon);
+}
+
+TWIB_TEST(WalkDirectory, ReportsTruncation) {
+	test::SimDaemon daemon({"--sim-devices", "1"});
+	CHECK(daemon.WaitForDevices(1));
+
+	// each entry packs to over 400 bytes, so these don't fit in the
+	// device's 4 MiB response
+	std::string long_name(200, 'x');
+	std::string big = daemon.fs_root + "/sd/big";
+	CHECK(mkdir(big.c_str(), 0755) == 0);
+	CHECK(mkdir((big + "/" + long_name).c_str(), 0755) == 0);
+	const size_t file_count = 12000;
+	for(size_t i = 0; i < file_count; i++) {
+		MakeFile(big + "/" + long_name + "/" + std::to_string(i) + long_name);
+	}
+
+	std::unique_ptr<tool::client::Client> client = daemon.Connect();
+	tool::ITwibDeviceInterface itdi(std::make_shared<tool::RemoteObject>(*client, test::ListDeviceIds(*client)[0], 0));
+	tool::ITwibFilesystemAccessor itfsa = itdi.OpenFilesystemAccessor("sd");
+	bool truncated = false;
+	std::vector<tool::ITwibFilesystemAccessor::WalkEntry> entries = itfsa.WalkDirectory("/big", 0, "", truncated);
+	CHECK(truncated);
+	CHECK(entries.size() > 1);
+	CHECK(entries.size() < file_count + 1);
+
+	// a partial listing still fails the command
+	std::string output, errors;
+	CHECK_EQ(daemon.RunTwib({"sd", "ls", "-R", "/big"}, output, errors), 1);
+	CHECK(errors.find("listing is incomplete") != std::string::npos);
+
+	truncated = true;
+	entries = itfsa.WalkDirectory("/big", 1, "", truncated);
+	CHECK(!truncated);
+	CHECK_EQ(entries.size(), (size_t) 1);
+}
@@ -0,0 +1,77 @@
+//
+// Twili - Homebrew debug monitor for the Nintendo Switch
+// Copyright (C) 2019 misson20000 <xenotoad@xenotoad.net>
+//
+// This file is part of Twili.
+//
+// Twili is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Twili is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Twili.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "AArch64.hpp"
+
+#include<algorithm>
+
+namespace twili {
+namespace twib {
+namespace tool {
+namespace gdb {
+namespace aarch64 {
+
+static int64_t SignExtend(uint64_t value, int bits) {
+	uint64_t sign = (uint64_t) 1 << (bits - 1);
+	value &= (sign << 1) - 1;
+	return (int64_t) (value ^ sign) - (int64_t) sign;
+}
+
+static uint64_t ReadRegister(const std::vector<uint64_t> &registers, uint32_t index) {
+	if(index == 31 || index >= registers.size()) {
+		return 0; // xzr
+	}
+	return registers[index];
+}
+
+std::vector<uint64_t> PredictSuccessors(uint32_t instruction, uint64_t pc, const std::vector<uint64_t> &registers) {
+	std::vector<uint64_t> successors;
+	
+	if((instruction & 0x7c000000) == 0x14000000) { // B, BL
+		successors.push_back(pc + (SignExtend(instruction, 26) << 2));
+	} else if((instruction & 0xff000010) == 0x54000000) { // B.cond
+		uint32_t cond = instruction & 0xf;
+		if(cond < 0xe) {
+			successors.push_back(pc + 4);
+		}
+		successors.push_back(pc + (SignExtend(instruction >> 5, 19) << 2));
+	} else if((instruction & 0x7e000000) == 0x34000000) { // CBZ, CBNZ
+		successors.push_back(pc + 4);
+		successors.push_back(pc + (SignExtend(instruction >> 5, 19) << 2));
+	} else if((instruction & 0x7e000000) == 0x36000000) { // TBZ, TBNZ
+		successors.push_back(pc + 4);
+		successors.push_back(pc + (SignExtend(instruction >> 5, 14) << 2));
+	} else if((instruction & 0xff9ffc1f) == 0xd61f0000 && (instruction & 0x00600000) != 0x00600000) { // BR, BLR, RET
+		successors.push_back(ReadRegister(registers, (instruction >> 5) & 0x1f));
+	} else {
+		successors.push_back(pc + 4);
+	}
+
+	// a branch to the next instruction shouldn't get two breakpoints
+	std::sort(successors.begin(), successors.end());
+	successors.erase(std::unique(successors.begin(), successors.end()), successors.end());
+	return successors;
+}
+
+} // namespace aarch64
+} // namespace gdb
+} // namespace tool
+} // namespace twib
+} // namespace twili
@@ -0,0 +1,46 @@
+//
+// Twili - Homebrew debug monitor for the Nintendo Switch
+// Copyright (C) 2019 misson20000 <xenotoad@xenotoad.net>
+//
+// This file is part of Twili.
+//
+// Twili is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Twili is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Twili.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#pragma once
+
+#include<vector>
+
+#include<stdint.h>
+
+namespace twili {
+namespace twib {
+namespace tool {
+namespace gdb {
+namespace aarch64 {
+
+// brk #0, same as gdb uses for software breakpoints
+static const uint32_t BreakpointInstruction = 0xd4200000;
+
+// Predicts which addresses the instruction at pc may transfer control to.
+// registers is laid out like nx::ThreadContext (x0-x30, sp, pc, ...).
+// Conditional branches yield both the fall-through and the branch target,
+// so the caller doesn't need to evaluate condition flags.
+std::vector<uint64_t> PredictSuccessors(uint32_t instruction, uint64_t pc, const std::vector<uint64_t> &registers);
+
+} // namespace aarch64
+} // namespace gdb
+} // namespace tool
+} // namespace twib
+} // namespace twili
@@ -0,0 +1,293 @@
+//
+// Twili - Homebrew debug monitor for the Nintendo Switch
+// Copyright (C) 2019 misson20000 <xenotoad@xenotoad.net>
+//
+// This file is part of Twili.
+//
+// Twili is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Twili is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Twili.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "AgentExpression.hpp"
+
+#include "common/Logger.hpp"
+#include "common/ResultError.hpp"
+
+namespace twili {
+namespace twib {
+namespace tool {
+namespace gdb {
+
+namespace {
+
+enum class Op : uint8_t {
+	Float = 0x01,
+	Add = 0x02,
+	Sub = 0x03,
+	Mul = 0x04,
+	DivSigned = 0x05,
+	DivUnsigned = 0x06,
+	RemSigned = 0x07,
+	RemUnsigned = 0x08,
+	Lsh = 0x09,
+	RshSigned = 0x0a,
+	RshUnsigned = 0x0b,
+	Trace = 0x0c,
+	TraceQuick = 0x0d,
+	LogNot = 0x0e,
+	BitAnd = 0x0f,
+	BitOr = 0x10,
+	BitXor = 0x11,
+	BitNot = 0x12,
+	Equal = 0x13,
+	LessSigned = 0x14,
+	LessUnsigned = 0x15,
+	Ext = 0x16,
+	Ref8 = 0x17,
+	Ref16 = 0x18,
+	Ref32 = 0x19,
+	Ref64 = 0x1a,
+	IfGoto = 0x20,
+	Goto = 0x21,
+	Const8 = 0x22,
+	Const16 = 0x23,
+	Const32 = 0x24,
+	Const64 = 0x25,
+	Reg = 0x26,
+	End = 0x27,
+	Dup = 0x28,
+	Pop = 0x29,
+	ZeroExt = 0x2a,
+	Swap = 0x2b,
+	TraceV = 0x2e,
+	TraceNz = 0x2f,
+	Trace16 = 0x30,
+	Pick = 0x32,
+	Rot = 0x33,
+};
+
+// same limits as gdbserver's interpreter
+static const size_t StackLimit = 256;
+static const size_t StepLimit = 0x10000;
+
+} // anonymous namespace
+
+AgentExpression::AgentExpression(std::vector<uint8_t> bytecode) : bytecode(bytecode) {
+}
+
+std::optional<uint64_t> AgentExpression::Evaluate(Context &context) const {
+	std::vector<uint64_t> stack;
+	size_t pc = 0;
+	
+	// immediates are big-endian
+	auto fetch = [&](size_t size, uint64_t &out) -> bool {
+		if(pc + size > bytecode.size()) {
+			return false;
+		}
+		out = 0;
+		for(size_t i = 0; i < size; i++) {
+			out<<= 8;
+			out|= bytecode[pc++];
+		}
+		return true;
+	};
+	
+	try {
+		for(size_t steps = 0; steps < StepLimit; steps++) {
+			if(pc >= bytecode.size()) {
+				LogMessage(Warning, "agent expression ran off the end");
+				return std::nullopt;
+			}
+
+			Op op = (Op) bytecode[pc++];
+			uint64_t imm = 0;
+			
+			// check stack depth up front so the cases below can pop freely
+			size_t pops = 0;
+			switch(op) {
+			case Op::Add: case Op::Sub: case Op::Mul:
+			case Op::DivSigned: case Op::DivUnsigned:
+			case Op::RemSigned: case Op::RemUnsigned:
+			case Op::Lsh: case Op::RshSigned: case Op::RshUnsigned:
+			case Op::BitAnd: case Op::BitOr: case Op::BitXor:
+			case Op::Equal: case Op::LessSigned: case Op::LessUnsigned:
+			case Op::Swap: case Op::Trace: case Op::TraceNz:
+				pops = 2;
+				break;
+			case Op::LogNot: case Op::BitNot: case Op::Ext: case Op::ZeroExt:
+			case Op::Ref8: case Op::Ref16: case Op::Ref32: case Op::Ref64:
+			case Op::IfGoto: case Op::End: case Op::Dup: case Op::Pop:
+			case Op::TraceQuick: case Op::Trace16:
+				pops = 1;
+				break;
+			case Op::Rot:
+				pops = 3;
+				break;
+			default:
+				break;
+			}
+			if(stack.size() < pops) {
+				LogMessage(Warning, "agent expression stack underflow at 0x%lx", pc - 1);
+				return std::nullopt;
+			}
+			
+			uint64_t a = 0, b = 0;
+			if(pops == 2) {
+				b = stack.back(); stack.pop_back();
+				a = stack.back(); stack.pop_back();
+			}
+			
+			switch(op) {
+			case Op::Add: stack.push_back(a + b); break;
+			case Op::Sub: stack.push_back(a - b); break;
+			case Op::Mul: stack.push_back(a * b); break;
+			case Op::DivSigned:
+			case Op::DivUnsigned:
+			case Op::RemSigned:
+			case Op::RemUnsigned:
+				if(b == 0) {
+					LogMessage(Warning, "agent expression divided by zero");
+					return std::nullopt;
+				}
+				if((op == Op::DivSigned || op == Op::RemSigned) && a == 0x8000000000000000 && b == (uint64_t) -1) {
+					// the quotient doesn't fit, and the host would trap on it
+					LogMessage(Warning, "agent expression divided INT64_MIN by -1");
+					return std::nullopt;
+				}
+				switch(op) {
+				case Op::DivSigned: stack.push_back((int64_t) a / (int64_t) b); break;
+				case Op::DivUnsigned: stack.push_back(a / b); break;
+				case Op::RemSigned: stack.push_back((int64_t) a % (int64_t) b); break;
+				default: stack.push_back(a % b); break;
+				}
+				break;
+			case Op::Lsh: stack.push_back(b >= 64 ? 0 : a << b); break;
+			case Op::RshSigned: stack.push_back((int64_t) a >> (b >= 64 ? 63 : b)); break;
+			case Op::RshUnsigned: stack.push_back(b >= 64 ? 0 : a >> b); break;
+			case Op::BitAnd: stack.push_back(a & b); break;
+			case Op::BitOr: stack.push_back(a | b); break;
+			case Op::BitXor: stack.push_back(a ^ b); break;
+			case Op::Equal: stack.push_back(a == b); break;
+			case Op::LessSigned: stack.push_back((int64_t) a < (int64_t) b); break;
+			case Op::LessUnsigned: stack.push_back(a < b); break;
+			case Op::LogNot: stack.back() = !stack.back(); break;
+			case Op::BitNot: stack.back() = ~stack.back(); break;
+			case Op::Ext:
+			case Op::ZeroExt: {
+				if(!fetch(1, imm)) { goto truncated; }
+				if(imm == 0 || imm >= 64) {
+					break;
+				}
+				uint64_t mask = ((uint64_t) 1 << imm) - 1;
+				uint64_t &v = stack.back();
+				v&= mask;
+				if(op == Op::Ext && (v >> (imm - 1)) & 1) {
+					v|= ~mask;
+				}
+				break; }
+			case Op::Ref8:
+			case Op::Ref16:
+			case Op::Ref32:
+			case Op::Ref64: {
+				size_t size = (size_t) 1 << ((uint8_t) op - (uint8_t) Op::Ref8);
+				uint64_t value = 0;
+				context.ReadMemory(stack.back(), &value, size); // little-endian target
+				stack.back() = value;
+				break; }
+			case Op::IfGoto:
+				if(!fetch(2, imm)) { goto truncated; }
+				if(stack.back()) {
+					pc = imm;
+				}
+				stack.pop_back();
+				break;
+			case Op::Goto:
+				if(!fetch(2, imm)) { goto truncated; }
+				pc = imm;
+				break;
+			case Op::Const8:
+			case Op::Const16:
+			case Op::Const32:
+			case Op::Const64:
+				if(!fetch((size_t) 1 << ((uint8_t) op - (uint8_t) Op::Const8), imm)) { goto truncated; }
+				stack.push_back(imm);
+				break;
+			case Op::Reg:
+				if(!fetch(2, imm)) { goto truncated; }
+				stack.push_back(context.ReadRegister(imm));
+				break;
+			case Op::End:
+				return stack.back();
+			case Op::Dup:
+				stack.push_back(stack.back());
+				break;
+			case Op::Pop:
+				stack.pop_back();
+				break;
+			case Op::Swap:
+				stack.push_back(b);
+				stack.push_back(a);
+				break;
+			case Op::Pick:
+				if(!fetch(1, imm)) { goto truncated; }
+				if(imm >= stack.size()) {
+					LogMessage(Warning, "agent expression stack underflow at 0x%lx", pc - 2);
+					return std::nullopt;
+				}
+				stack.push_back(stack[stack.size() - 1 - imm]);
+				break;
+			case Op::Rot: { // a b c => c a b
+				uint64_t c = stack[stack.size() - 1];
+				stack[stack.size() - 1] = stack[stack.size() - 2];
+				stack[stack.size() - 2] = stack[stack.size() - 3];
+				stack[stack.size() - 3] = c;
+				break; }
+			// there's nothing to collect when evaluating a condition, so the
+			// trace opcodes only keep their stack effects
+			case Op::Trace:
+			case Op::TraceNz:
+				break;
+			case Op::TraceQuick:
+				if(!fetch(1, imm)) { goto truncated; }
+				break;
+			case Op::Trace16:
+			case Op::TraceV:
+				if(!fetch(2, imm)) { goto truncated; }
+				break;
+			default:
+				LogMessage(Warning, "unsupported agent expression opcode 0x%x", (uint8_t) op);
+				return std::nullopt;
+			}
+
+			if(stack.size() > StackLimit) {
+				LogMessage(Warning, "agent expression stack overflow");
+				return std::nullopt;
+			}
+		}
+	} catch(ResultError &e) {
+		LogMessage(Warning, "agent expression failed to read memory: 0x%x", e.code);
+		return std::nullopt;
+	}
+
+	LogMessage(Warning, "agent expression didn't terminate");
+	return std::nullopt;
+
+truncated:
+	LogMessage(Warning, "agent expression truncated");
+	return std::nullopt;
+}
+
+} // namespace gdb
+} // namespace tool
+} // namespace twib
+} // namespace twili
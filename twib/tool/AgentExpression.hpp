@@ -0,0 +1,56 @@
+//
+// Twili - Homebrew debug monitor for the Nintendo Switch
+// Copyright (C) 2019 misson20000 <xenotoad@xenotoad.net>
+//
+// This file is part of Twili.
+//
+// Twili is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Twili is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Twili.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#pragma once
+
+#include<optional>
+#include<vector>
+
+#include<stdint.h>
+
+namespace twili {
+namespace twib {
+namespace tool {
+namespace gdb {
+
+// Interpreter for gdb's agent expression bytecode, as sent with
+// conditional breakpoints (Z0,addr,kind;Xlen,bytes).
+class AgentExpression {
+ public:
+	class Context {
+	 public:
+		virtual uint64_t ReadRegister(uint16_t index) = 0;
+		// throws ResultError on failure
+		virtual void ReadMemory(uint64_t address, void *dest, size_t size) = 0;
+	};
+	
+	AgentExpression(std::vector<uint8_t> bytecode);
+
+	// returns std::nullopt if the expression is malformed, uses an
+	// unsupported opcode, or touches memory that can't be read.
+	std::optional<uint64_t> Evaluate(Context &context) const;
+	
+	std::vector<uint8_t> bytecode;
+};
+
+} // namespace gdb
+} // namespace tool
+} // namespace twib
+} // namespace twili
@@ -0,0 +1,116 @@
+//
+// Twili - Homebrew debug monitor for the Nintendo Switch
+// Copyright (C) 2019 misson20000 <xenotoad@xenotoad.net>
+//
+// This file is part of Twili.
+//
+// Twili is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Twili is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Twili.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include "Connect.hpp"
+
+#include "platform/platform.hpp"
+
+#include<string.h>
+
+#include "common/Logger.hpp"
+#include "common/config.hpp"
+
+#if TWIB_TCP_FRONTEND_ENABLED == 1 || TWIB_UNIX_FRONTEND_ENABLED == 1
+#include "SocketClient.hpp"
+#endif
+#if TWIB_NAMED_PIPE_FRONTEND_ENABLED == 1
+#include "NamedPipeClient.hpp"
+#endif
+
+namespace twili {
+namespace twib {
+namespace tool {
+
+std::unique_ptr<client::Client> connect_tcp(uint16_t port) {
+#if TWIB_TCP_FRONTEND_ENABLED == 0
+	LogMessage(Fatal, "TCP socket not supported");
+	return std::unique_ptr<client::Client>();
+#else
+	platform::Socket socket(AF_INET6, SOCK_STREAM, 0);
+
+	struct sockaddr_in6 addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sin6_family = AF_INET6;
+	addr.sin6_addr = in6addr_loopback;
+	addr.sin6_port = htons(port);
+
+	socket.Connect((struct sockaddr *) &addr, sizeof(addr));
+	LogMessage(Info, "connected to twibd: %d", socket.fd);
+	
+	return std::make_unique<client::SocketClient>(std::move(socket));
+#endif
+}
+
+std::unique_ptr<client::Client> connect_unix(std::string path) {
+#if TWIB_UNIX_FRONTEND_ENABLED == 0
+	LogMessage(Fatal, "UNIX domain socket not supported");
+	return std::unique_ptr<client::Client>();
+#else
+	platform::Socket socket(AF_UNIX, SOCK_STREAM, 0);
+
+	struct sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+	socket.Connect((struct sockaddr *) &addr, sizeof(addr));
+	LogMessage(Info, "connected to twibd: %d", socket.fd);
+	
+	return std::make_unique<client::SocketClient>(std::move(socket));
+#endif
+}
+
+std::unique_ptr<client::Client> connect_named_pipe(std::string path) {
+#if TWIB_NAMED_PIPE_FRONTEND_ENABLED == 0
+	LogMessage(Fatal, "Named pipe not supported");
+	return std::unique_ptr<client::Client>();
+#else
+	twili::platform::windows::Pipe pipe; 
+	LogMessage(Debug, "connecting to %s...", path.c_str());
+	while(1) {
+		pipe = platform::windows::Pipe::OpenNamed(path.c_str());
+		if(pipe.handle != INVALID_HANDLE_VALUE) {
+			break;
+		}
+
+		if(GetLastError() != ERROR_PIPE_BUSY) {
+			LogMessage(Fatal, "Could not open pipe. GLE=%d", GetLastError());
+			return std::unique_ptr<client::Client>();
+		}
+
+		LogMessage(Info, "got ERROR_PIPE_BUSY, waiting...");
+		if(!WaitNamedPipe(path.c_str(), 20000)) {
+			LogMessage(Fatal, "Could not open pipe: 20 second wait timed out");
+			return std::unique_ptr<client::Client>();
+		}
+	}
+	/*DWORD mode = PIPE_READMODE_BYTE | PIPE_NOWAIT;
+	if(!SetNamedPipeHandleState(pipe.handle, &mode, nullptr, nullptr)) {
+		LogMessage(Fatal, "Failed to set named pipe handle state. GLE=%d", GetLastError());
+		return std::unique_ptr<client::Client>();
+	}*/
+	return std::make_unique<client::NamedPipeClient>(std::move(pipe));
+#endif
+}
+
+} // namespace tool
+} // namespace twib
+} // namespace twili
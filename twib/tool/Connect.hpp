@@ -0,0 +1,41 @@
+//
+// Twili - Homebrew debug monitor for the Nintendo Switch
+// Copyright (C) 2019 misson20000 <xenotoad@xenotoad.net>
+//
+// This file is part of Twili.
+//
+// Twili is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Twili is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Twili.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#pragma once
+
+#include<memory>
+#include<string>
+
+#include "Client.hpp"
+
+namespace twili {
+namespace twib {
+namespace tool {
+
+// Connect to twibd's frontends. These log and return a null pointer if the
+// frontend isn't supported on this platform or the connection fails.
+std::unique_ptr<client::Client> connect_tcp(uint16_t port);
+std::unique_ptr<client::Client> connect_unix(std::string path);
+std::unique_ptr<client::Client> connect_named_pipe(std::string path);
+
+} // namespace tool
+} // namespace twib
+} // namespace twili
@@ -19,9 +19,13 @@
 //
 
 #include "GdbStub.hpp"
+#include "AArch64.hpp"
 
+#include<algorithm>
 #include<functional>
 
+#include<string.h>
+
 #include "common/Logger.hpp"
 #include "common/ResultError.hpp"
 
@@ -30,6 +34,58 @@ namespace twib {
 namespace tool {
 namespace gdb {
 
+namespace {
+
+std::vector<uint8_t> BreakpointBytes() {
+	std::vector<uint8_t> bytes(sizeof(uint32_t));
+	memcpy(bytes.data(), &aarch64::BreakpointInstruction, sizeof(uint32_t));
+	return bytes;
+}
+
+// Breakpoint conditions tend to poke at the same few registers and
+// variables, so fetch each of them from the device at most once per hit.
+class BreakpointConditionContext : public AgentExpression::Context {
+ public:
+	BreakpointConditionContext(ITwibDebugger &debugger, std::vector<uint64_t> &registers) : debugger(debugger), registers(registers) {
+	}
+	
+	virtual uint64_t ReadRegister(uint16_t index) override {
+		if(index < 33) { // x0-x30, sp, pc
+			return registers[index];
+		} else if(index == 33) { // cpsr
+			return registers[33] & 0xffffffff;
+		}
+		LogMessage(Warning, "agent expression read unsupported register %d", index);
+		return 0;
+	}
+	
+	virtual void ReadMemory(uint64_t address, void *dest, size_t size) override {
+		uint8_t *out = (uint8_t*) dest;
+		while(size > 0) {
+			uint64_t block_addr = address & ~(BlockSize - 1);
+			auto i = blocks.find(block_addr);
+			if(i == blocks.end()) {
+				// blocks never cross a page boundary, so this can only fail if
+				// the requested address is unmapped too
+				i = blocks.emplace(block_addr, debugger.ReadMemory(block_addr, BlockSize)).first;
+			}
+			size_t offset = address - block_addr;
+			size_t chunk = std::min(size, (size_t) BlockSize - offset);
+			memcpy(out, i->second.data() + offset, chunk);
+			out+= chunk;
+			address+= chunk;
+			size-= chunk;
+		}
+	}
+ private:
+	static const uint64_t BlockSize = 0x100;
+	ITwibDebugger &debugger;
+	std::vector<uint64_t> &registers;
+	std::map<uint64_t, std::vector<uint8_t>> blocks;
+};
+
+} // anonymous namespace
+
 GdbStub::GdbStub(ITwibDeviceInterface &itdi) :
 	itdi(itdi),
 	connection(
@@ -52,6 +108,7 @@ GdbStub::GdbStub(ITwibDeviceInterface &itdi) :
 	AddMultiletterHandler("Cont?", &GdbStub::HandleVContQuery);
 	AddMultiletterHandler("Cont", &GdbStub::HandleVCont);
 	AddXferObject("libraries", xfer_libraries);
+	AddFeature("ConditionalBreakpoints+");
 }
 
 GdbStub::~GdbStub() {
@@ -348,7 +405,16 @@ void GdbStub::HandleReadMemory(util::Buffer &packet) {
 
 	try {
 		util::Buffer response;
-		std::vector<uint8_t> mem = current_thread->process.debugger.ReadMemory(address, size);
+		Process &process = current_thread->process;
+		std::vector<uint8_t> mem = process.debugger.ReadMemory(address, size);
+		// hide our breakpoint instructions from gdb
+		for(auto i = process.breakpoints.lower_bound(address >= 3 ? address - 3 : 0); i != process.breakpoints.end() && i->first < address + mem.size(); i++) {
+			for(size_t j = 0; j < i->second.original.size(); j++) {
+				if(i->first + j >= address && i->first + j < address + mem.size()) {
+					mem[i->first + j - address] = i->second.original[j];
+				}
+			}
+		}
 		GdbConnection::Encode(mem.data(), mem.size(), response);
 		connection.Respond(response);
 	} catch(ResultError &e) {
@@ -388,6 +454,115 @@ void GdbStub::HandleWriteMemory(util::Buffer &packet) {
 	}
 }
 
+void GdbStub::HandleInsertBreakpoint(util::Buffer &packet) {
+	uint64_t type, address, kind;
+	GdbConnection::DecodeWithSeparator(type, ',', packet);
+	GdbConnection::DecodeWithSeparator(address, ',', packet);
+	GdbConnection::DecodeWithSeparator(kind, ';', packet);
+
+	if(type != 0) { // only software breakpoints are supported
+		connection.RespondEmpty();
+		return;
+	}
+	
+	if(!current_thread) {
+		LogMessage(Warning, "attempted to insert breakpoint without selected thread");
+		connection.RespondError(1);
+		return;
+	}
+
+	if(kind != sizeof(uint32_t)) {
+		LogMessage(Warning, "unsupported breakpoint kind: %ld", kind);
+		connection.RespondError(1);
+		return;
+	}
+
+	std::vector<AgentExpression> conditions;
+	char ch;
+	while(packet.Read(ch)) {
+		if(ch != 'X') {
+			LogMessage(Warning, "unsupported breakpoint parameter: '%c'", ch);
+			connection.RespondError(1);
+			return;
+		}
+		uint64_t length;
+		GdbConnection::DecodeWithSeparator(length, ',', packet);
+		if(packet.ReadAvailable() < length * 2) {
+			LogMessage(Warning, "breakpoint condition truncated");
+			connection.RespondError(1);
+			return;
+		}
+		std::vector<uint8_t> bytecode;
+		for(uint64_t i = 0; i < length; i++) {
+			bytecode.push_back(GdbConnection::DecodeHexByte((char*) packet.Read()));
+			packet.MarkRead(2);
+		}
+		conditions.emplace_back(bytecode);
+		if(packet.ReadAvailable() && packet.Read()[0] == ';') {
+			packet.MarkRead(1); // consume
+		}
+	}
+
+	LogMessage(Debug, "inserting breakpoint at 0x%lx with %ld conditions", address, conditions.size());
+	
+	Process &process = current_thread->process;
+	auto i = process.breakpoints.find(address);
+	if(i != process.breakpoints.end()) {
+		// gdb sends Z0 again when conditions change
+		i->second.conditions = std::move(conditions);
+		connection.RespondOk();
+		return;
+	}
+	
+	try {
+		Process::Breakpoint bp;
+		bp.original = process.debugger.ReadMemory(address, sizeof(uint32_t));
+		std::vector<uint8_t> brk = BreakpointBytes();
+		process.debugger.WriteMemory(address, brk);
+		bp.conditions = std::move(conditions);
+		process.breakpoints.emplace(address, std::move(bp));
+		connection.RespondOk();
+	} catch(ResultError &e) {
+		connection.RespondError(e.code);
+	}
+}
+
+void GdbStub::HandleRemoveBreakpoint(util::Buffer &packet) {
+	uint64_t type, address, kind;
+	GdbConnection::DecodeWithSeparator(type, ',', packet);
+	GdbConnection::DecodeWithSeparator(address, ',', packet);
+	GdbConnection::Decode(kind, packet);
+
+	if(type != 0) {
+		connection.RespondEmpty();
+		return;
+	}
+	
+	if(!current_thread) {
+		LogMessage(Warning, "attempted to remove breakpoint without selected thread");
+		connection.RespondError(1);
+		return;
+	}
+
+	LogMessage(Debug, "removing breakpoint at 0x%lx", address);
+
+	Process &process = current_thread->process;
+	auto i = process.breakpoints.find(address);
+	if(i == process.breakpoints.end()) {
+		LogMessage(Warning, "no breakpoint at 0x%lx", address);
+		connection.RespondError(1);
+		return;
+	}
+
+	try {
+		process.debugger.WriteMemory(address, i->second.original);
+		process.breakpoints.erase(i);
+		connection.RespondOk();
+	} catch(ResultError &e) {
+		connection.RespondError(e.code);
+	}
+}
+
 void GdbStub::HandleVAttach(util::Buffer &packet) {
 	uint64_t pid = 0;
 	char ch;
@@ -428,7 +603,7 @@ void GdbStub::HandleVAttach(util::Buffer &packet) {
 
 void GdbStub::HandleVContQuery(util::Buffer &packet) {
 	util::Buffer response;
-	response.Write(std::string("vCont;c;C"));
+	response.Write(std::string("vCont;c;C;s;S"));
 	connection.Respond(response);
 }
 
@@ -442,7 +617,8 @@ void GdbStub::HandleVCont(util::Buffer &packet) {
 	struct Action {
 		enum class Type {
 			Invalid,
-			Continue
+			Continue,
+			Step
 		} type = Type::Invalid;
 	};
 
@@ -465,6 +641,12 @@ void GdbStub::HandleVCont(util::Buffer &packet) {
 			case 'c':
 				action.type = Action::Type::Continue;
 				break;
+			case 'S':
+				LogMessage(Warning, "vCont 'S' action not well supported");
+				// fall-through
+			case 's':
+				action.type = Action::Type::Step;
+				break;
 			default:
 				LogMessage(Warning, "unsupported vCont action: %c", ch);
 			}
@@ -532,6 +714,7 @@ void GdbStub::HandleVCont(util::Buffer &packet) {
 		}
 
 		proc.running_thread_ids.clear();
+		proc.stepping_thread_ids.clear();
 		for(auto &t : p.second) {
 			auto t_i = proc.threads.find(t.first);
 			if(t_i == proc.threads.end()) {
@@ -539,12 +722,25 @@ void GdbStub::HandleVCont(util::Buffer &packet) {
 				continue;
 			}
 			proc.running_thread_ids.push_back(t.first);
+			if(t.second.type == Action::Type::Step) {
+				proc.stepping_thread_ids.push_back(t.first);
+				try {
+					proc.PlantStepBreakpoints(t_i->second);
+				} catch(ResultError &e) {
+					LogMessage(Warning, "failed to plant step breakpoints: 0x%x", e.code);
+					proc.RemoveStepBreakpoints();
+					connection.RespondError(e.code);
+					return;
+				}
+			}
 		}
 		LogMessage(Debug, "continuing process");
 		for(auto &t : proc.running_thread_ids) {
 			LogMessage(Debug, "  tid 0x%lx", t);
 		}
-		proc.debugger.ContinueDebugEvent(7, proc.running_thread_ids);
+		if(!proc.step_over.active) { // otherwise, we'll continue once it's done
+			proc.Resume();
+		}
 		proc.running = true;
 	}
 	waiting_for_stop = true;
@@ -844,8 +1040,10 @@ bool GdbStub::Process::IngestEvents(GdbStub &stub) {
 	uint64_t thread_id = 0;
 	util::Buffer stop_info;
 	bool stopped = false;
+	std::optional<uint64_t> step_over_thread_id;
+	uint64_t step_over_address = 0;
 	
-	while(!stopped && (event = debugger.GetDebugEvent())) {
+	while(!stopped && (event = NextEvent())) {
 		LogMessage(Debug, "got event: %d", event->event_type);
 
 		running = false;
@@ -871,6 +1069,10 @@ bool GdbStub::Process::IngestEvents(GdbStub &stub) {
 			break; }
 		case nx::DebugEvent::EventType::ExitProcess: {
 			LogMessage(Warning, "process exited");
+			// nothing left to restore
+			step_breakpoints.clear();
+			breakpoints.clear();
+			step_over.active = false;
 			style = 'W';
 			signal = 0;
 			stopped = true;
@@ -889,6 +1091,11 @@ bool GdbStub::Process::IngestEvents(GdbStub &stub) {
 						running_thread_ids.begin(),
 						running_thread_ids.end(),
 						thread_id), running_thread_ids.end());
+				stepping_thread_ids.erase(
+					std::remove(
+						stepping_thread_ids.begin(),
+						stepping_thread_ids.end(),
+						thread_id), stepping_thread_ids.end());
 				stub.get_thread_info.valid = false;
 			} else {
 				LogMessage(Warning, "  no such thread 0x%x", thread_id);
@@ -901,6 +1108,34 @@ bool GdbStub::Process::IngestEvents(GdbStub &stub) {
 			}
 			break; }
 		case nx::DebugEvent::EventType::Exception: {
+			bool is_trap =
+				event->exception.exception_type == nx::DebugEvent::ExceptionType::Trap ||
+				event->exception.exception_type == nx::DebugEvent::ExceptionType::BreakPoint;
+			if(is_trap && step_over.active && thread_id == step_over.thread_id) {
+				LogMessage(Debug, "  stepped past conditional breakpoint");
+				EndStepOver();
+				break; // autocontinue
+			}
+			if(is_trap && !step_breakpoints.empty()) {
+				auto t = threads.find(thread_id);
+				if(t != threads.end() && IsParkedAtStepBreakpoint(t->second)) {
+					// it stays where it is and runs the original instruction
+					// once the step breakpoints have been taken out again
+					LogMessage(Debug, "  thread 0x%lx hit another thread's step breakpoint", thread_id);
+					break;
+				}
+			}
+			if(is_trap && !breakpoints.empty()) {
+				auto t = threads.find(thread_id);
+				uint64_t pc;
+				if(t != threads.end() && !EvaluateBreakpointConditions(t->second, pc)) {
+					LogMessage(Debug, "  breakpoint condition false, not stopping");
+					step_over_thread_id = thread_id;
+					step_over_address = pc;
+					break;
+				}
+			}
+			
 			LogMessage(Warning, "hit exception");
 			stopped = true;
 			switch(event->exception.exception_type) {
@@ -949,7 +1184,26 @@ bool GdbStub::Process::IngestEvents(GdbStub &stub) {
 		}
 	}
 
+	if(!stopped && step_over_thread_id) {
+		try {
+			BeginStepOver(threads.at(*step_over_thread_id), step_over_address);
+		} catch(ResultError &e) {
+			LogMessage(Warning, "failed to step past conditional breakpoint: 0x%x", e.code);
+			EndStepOver();
+			style = 'T';
+			signal = 5; // SIGTRAP
+			thread_id = *step_over_thread_id;
+			stopped = true;
+		}
+	}
+	
 	if(stopped) {
+		if(step_over.active) {
+			EndStepOver();
+		}
+		RemoveStepBreakpoints();
+		stepping_thread_ids.clear();
+		
 		util::Buffer stop_reason;
 		if(style == 'T') { // signal
 			stop_reason.Write('T');
@@ -998,13 +1252,151 @@ bool GdbStub::Process::IngestEvents(GdbStub &stub) {
 
 	if(was_running && !running && !stopped) { // if we're not running but we should be...
 		LogMessage(Debug, "got debug events but didn't stop, so continuing...");
-		debugger.ContinueDebugEvent(7, running_thread_ids);
+		Resume();
 		running = true;
 	}
 	
 	return stopped;
 }
 
+std::optional<nx::DebugEvent> GdbStub::Process::NextEvent() {
+	if(pending_events.empty()) {
+		// Fetch everything that's pending in one round trip. Attaching to a
+		// process produces an event for every thread it has.
+		std::vector<nx::DebugEvent> events = debugger.GetDebugEvents();
+		pending_events.insert(pending_events.end(), events.begin(), events.end());
+	}
+	if(pending_events.empty()) {
+		return std::nullopt;
+	}
+	nx::DebugEvent event = pending_events.front();
+	pending_events.pop_front();
+	return event;
+}
+
+void GdbStub::Process::PlantStepBreakpoints(Thread &thread) {
+	std::vector<uint64_t> registers = thread.GetRegisters();
+	uint64_t pc = registers[32]; // see nx::ThreadContext
+	
+	std::vector<uint8_t> insn_bytes = debugger.ReadMemory(pc, sizeof(uint32_t));
+	uint32_t instruction;
+	memcpy(&instruction, insn_bytes.data(), sizeof(instruction));
+
+	std::vector<uint8_t> brk = BreakpointBytes();
+	
+	for(uint64_t addr : aarch64::PredictSuccessors(instruction, pc, registers)) {
+		if(step_breakpoints.find(addr) != step_breakpoints.end()) {
+			continue; // another stepping thread already planted one here
+		}
+		std::vector<uint8_t> original = debugger.ReadMemory(addr, sizeof(uint32_t));
+		debugger.WriteMemory(addr, brk);
+		step_breakpoints.emplace(addr, original);
+		LogMessage(Debug, "planted step breakpoint at 0x%lx for thread 0x%lx", addr, thread.thread_id);
+	}
+}
+
+void GdbStub::Process::RemoveStepBreakpoints() {
+	for(auto &bp : step_breakpoints) {
+		try {
+			debugger.WriteMemory(bp.first, bp.second);
+		} catch(ResultError &e) {
+			LogMessage(Warning, "failed to remove step breakpoint at 0x%lx: 0x%x", bp.first, e.code);
+		}
+	}
+	step_breakpoints.clear();
+}
+
+bool GdbStub::Process::EvaluateBreakpointConditions(Thread &thread, uint64_t &pc) {
+	try {
+		std::vector<uint64_t> registers = thread.GetRegisters();
+		pc = registers[32]; // see nx::ThreadContext
+		auto i = breakpoints.find(pc);
+		if(i == breakpoints.end() || i->second.conditions.empty()) {
+			return true;
+		}
+
+		BreakpointConditionContext context(debugger, registers);
+		for(AgentExpression &condition : i->second.conditions) {
+			std::optional<uint64_t> result = condition.Evaluate(context);
+			// like gdb, stop if the condition couldn't be evaluated
+			if(!result || *result) {
+				return true;
+			}
+		}
+		return false;
+	} catch(ResultError &e) {
+		LogMessage(Warning, "failed to evaluate breakpoint condition: 0x%x", e.code);
+		return true;
+	}
+}
+
+void GdbStub::Process::Resume() {
+	if(!stepping_thread_ids.empty()) {
+		// no ContinueAll: only the stepping threads may run, or the others
+		// would be reported as stopping on their step breakpoints
+		debugger.ContinueDebugEvent(3, stepping_thread_ids);
+	} else {
+		debugger.ContinueDebugEvent(7, running_thread_ids);
+	}
+}
+
+bool GdbStub::Process::IsParkedAtStepBreakpoint(Thread &thread) {
+	if(step_over.active && thread.thread_id == step_over.thread_id) {
+		return false;
+	}
+	if(std::find(stepping_thread_ids.begin(), stepping_thread_ids.end(), thread.thread_id) !=
+		 stepping_thread_ids.end()) {
+		return false;
+	}
+	try {
+		uint64_t pc = thread.GetRegisters()[32]; // see nx::ThreadContext
+		return step_breakpoints.find(pc) != step_breakpoints.end() &&
+			breakpoints.find(pc) == breakpoints.end();
+	} catch(ResultError &e) {
+		LogMessage(Warning, "failed to read registers for thread 0x%lx: 0x%x", thread.thread_id, e.code);
+		return false;
+	}
+}
+
+void GdbStub::Process::BeginStepOver(Thread &thread, uint64_t address) {
+	step_over.active = true;
+	step_over.thread_id = thread.thread_id;
+	step_over.address = address;
+	
+	// put the original instruction back, let just this thread execute it,
+	// and catch it afterwards with the single-step breakpoints.
+	debugger.WriteMemory(address, breakpoints.at(address).original);
+	PlantStepBreakpoints(thread);
+	// no ContinueAll: the other threads would run into the step breakpoints
+	debugger.ContinueDebugEvent(3, {thread.thread_id});
+	running = true;
+}
+
+void GdbStub::Process::EndStepOver() {
+	RemoveStepBreakpoints();
+	// gdb may have asked for a step while we were busy with this one
+	for(uint64_t thread_id : stepping_thread_ids) {
+		auto t = threads.find(thread_id);
+		if(t == threads.end()) {
+			continue;
+		}
+		try {
+			PlantStepBreakpoints(t->second);
+		} catch(ResultError &e) {
+			LogMessage(Warning, "failed to plant step breakpoints: 0x%x", e.code);
+		}
+	}
+	if(breakpoints.find(step_over.address) != breakpoints.end()) {
+		try {
+			std::vector<uint8_t> brk = BreakpointBytes();
+			debugger.WriteMemory(step_over.address, brk);
+		} catch(ResultError &e) {
+			LogMessage(Warning, "failed to replace breakpoint at 0x%lx: 0x%x", step_over.address, e.code);
+		}
+	}
+	step_over.active = false;
+}
+
 std::string GdbStub::Process::BuildLibraryList() {
 	std::stringstream ss;
 	ss << "<library-list>" << std::endl;
@@ -1113,6 +1505,12 @@ void GdbStub::Logic::Prepare(platform::EventLoop &loop) {
 		case 'T': // is thread alive
 			stub.HandleIsThreadAlive(*buffer);
 			break;
+		case 'z': // remove breakpoint
+			stub.HandleRemoveBreakpoint(*buffer);
+			break;
+		case 'Z': // insert breakpoint
+			stub.HandleInsertBreakpoint(*buffer);
+			break;
 		case 'v': // variable
 			stub.HandleMultiletterPacket(*buffer);
 			break;
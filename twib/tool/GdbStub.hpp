@@ -22,8 +22,10 @@
 
 #include<optional>
 #include<unordered_map>
+#include<deque>
 
 #include "GdbConnection.hpp"
+#include "AgentExpression.hpp"
 #include "interfaces/ITwibDeviceInterface.hpp"
 #include "interfaces/ITwibDebugger.hpp"
 
@@ -85,12 +87,38 @@ class GdbStub {
 	 public:
 		Process(uint64_t pid, ITwibDebugger debugger);
 		bool IngestEvents(GdbStub &stub); // returns whether process is stopped
+		std::optional<nx::DebugEvent> NextEvent();
 		std::string BuildLibraryList();
+		void PlantStepBreakpoints(Thread &thread);
+		void RemoveStepBreakpoints();
+		bool EvaluateBreakpointConditions(Thread &thread, uint64_t &pc); // returns whether the thread should stop
+		bool IsParkedAtStepBreakpoint(Thread &thread); // whether it trapped on a step breakpoint meant for another thread
+		void Resume(); // continues the running threads, or just the stepping ones
+		void BeginStepOver(Thread &thread, uint64_t address);
+		void EndStepOver();
 		uint64_t pid;
 		ITwibDebugger debugger;
 		std::map<uint64_t, Thread> threads;
 		std::vector<uint64_t> running_thread_ids;
+		// threads gdb asked to single-step; while there are any, nothing else runs
+		std::vector<uint64_t> stepping_thread_ids;
+		// events fetched from the device that we haven't handled yet
+		std::deque<nx::DebugEvent> pending_events;
 		std::shared_ptr<bool> has_events;
+		// original instructions under temporary single-step breakpoints
+		std::map<uint64_t, std::vector<uint8_t>> step_breakpoints;
+		struct Breakpoint {
+			std::vector<uint8_t> original;
+			std::vector<AgentExpression> conditions; // stop if any are true
+		};
+		std::map<uint64_t, Breakpoint> breakpoints;
+		// set while we're moving a thread past a conditional breakpoint
+		// whose condition was false, without gdb's involvement
+		struct {
+			bool active = false;
+			uint64_t thread_id = 0;
+			uint64_t address = 0;
+		} step_over;
 		bool running = false;
 	};
 	
@@ -149,6 +177,8 @@ class GdbStub {
 	void HandleSetCurrentThread(util::Buffer &packet);
 	void HandleReadMemory(util::Buffer &packet);
 	void HandleWriteMemory(util::Buffer &packet);
+	void HandleInsertBreakpoint(util::Buffer &packet);
+	void HandleRemoveBreakpoint(util::Buffer &packet);
 	
 	// multiletter packets
 	void HandleVAttach(util::Buffer &packet);
@@ -0,0 +1,172 @@
+//
+// Twili - Homebrew debug monitor for the Nintendo Switch
+// Copyright (C) 2019 misson20000 <xenotoad@xenotoad.net>
+//
+// This file is part of Twili.
+//
+// Twili is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Twili is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Twili.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include "MemorySnapshot.hpp"
+
+#include<algorithm>
+
+#include<stdio.h>
+#include<string.h>
+#include<errno.h>
+#include<inttypes.h>
+
+#include "util.hpp"
+#include "common/Logger.hpp"
+
+namespace twili {
+namespace twib {
+namespace tool {
+
+namespace {
+
+const char SNAPSHOT_MAGIC[8] = {'T', 'W', 'I', 'B', 'S', 'N', 'A', 'P'};
+
+struct SnapshotHeader {
+	char magic[8];
+	uint64_t address;
+	uint64_t page_count;
+};
+
+// largest single ReadMemory request we'll make while fetching changed pages
+const size_t MAX_READ_SIZE = 0x40000;
+
+} // anonymous namespace
+
+MemorySnapshot::MemorySnapshot(uint64_t address, std::vector<uint64_t> hashes, std::vector<uint8_t> data) :
+	address(address),
+	hashes(std::move(hashes)),
+	data(std::move(data)) {
+}
+
+MemorySnapshot MemorySnapshot::Take(ITwibDebugger &debugger, uint64_t address, uint64_t size, const MemorySnapshot *previous, std::vector<util::PageRange> &changed) {
+	const size_t page_size = util::PAGE_HASH_PAGE_SIZE;
+	
+	std::vector<uint64_t> hashes = debugger.HashPages(address, size);
+	std::vector<uint8_t> data(hashes.size() * page_size, 0);
+
+	// only diff against the previous snapshot if it covers the same range
+	std::vector<uint64_t> previous_hashes;
+	if(previous != nullptr && previous->address == address) {
+		previous_hashes = previous->hashes;
+		std::copy_n(
+			previous->data.begin(),
+			std::min(previous->data.size(), data.size()),
+			data.begin());
+	} else if(previous != nullptr) {
+		LogMessage(Warning, "previous snapshot starts at 0x%" PRIx64", not 0x%" PRIx64"; fetching everything", previous->address, address);
+	}
+	
+	for(util::PageRange range : util::DiffPageHashes(previous_hashes, hashes)) {
+		range.page_count = std::min(range.page_count, hashes.size() - range.first_page);
+		if(range.page_count == 0) {
+			continue;
+		}
+		changed.push_back(range);
+		
+		for(size_t page = range.first_page; page < range.first_page + range.page_count; ) {
+			if(hashes[page] == util::PAGE_HASH_UNREADABLE) {
+				std::fill_n(data.begin() + page * page_size, page_size, 0);
+				page++;
+				continue;
+			}
+
+			// coalesce readable pages into as few reads as possible
+			size_t run = 1;
+			while(page + run < range.first_page + range.page_count &&
+						hashes[page + run] != util::PAGE_HASH_UNREADABLE &&
+						(run + 1) * page_size <= MAX_READ_SIZE) {
+				run++;
+			}
+
+			std::vector<uint8_t> bytes = debugger.ReadMemory(address + page * page_size, run * page_size);
+			std::copy(bytes.begin(), bytes.end(), data.begin() + page * page_size);
+			page+= run;
+		}
+	}
+
+	return MemorySnapshot(address, std::move(hashes), std::move(data));
+}
+
+std::optional<MemorySnapshot> MemorySnapshot::Load(const char *path) {
+	std::optional<std::vector<uint8_t>> file = util::ReadFile(path);
+	if(!file) {
+		LogMessage(Error, "could not read snapshot '%s'", path);
+		return std::nullopt;
+	}
+
+	SnapshotHeader header;
+	if(file->size() < sizeof(header)) {
+		LogMessage(Error, "snapshot '%s' is truncated", path);
+		return std::nullopt;
+	}
+	memcpy(&header, file->data(), sizeof(header));
+	if(memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0) {
+		LogMessage(Error, "'%s' is not a twib memory snapshot", path);
+		return std::nullopt;
+	}
+
+	// check page_count against the file before multiplying by it, so a
+	// corrupt header can't wrap the sizes around
+	const size_t page_record_size = sizeof(uint64_t) + util::PAGE_HASH_PAGE_SIZE;
+	size_t body_size = file->size() - sizeof(header);
+	if(body_size % page_record_size != 0 || header.page_count != body_size / page_record_size) {
+		LogMessage(Error, "snapshot '%s' is the wrong size for %" PRIu64" pages", path, header.page_count);
+		return std::nullopt;
+	}
+	size_t hashes_size = header.page_count * sizeof(uint64_t);
+
+	std::vector<uint64_t> hashes(header.page_count);
+	memcpy(hashes.data(), file->data() + sizeof(header), hashes_size);
+	std::vector<uint8_t> data(
+		file->begin() + sizeof(header) + hashes_size,
+		file->end());
+	
+	return MemorySnapshot(header.address, std::move(hashes), std::move(data));
+}
+
+bool MemorySnapshot::Save(const char *path) const {
+	FILE *f = fopen(path, "wb");
+	if(!f) {
+		LogMessage(Error, "could not open '%s': %s", path, strerror(errno));
+		return false;
+	}
+
+	SnapshotHeader header;
+	memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+	header.address = address;
+	header.page_count = hashes.size();
+	
+	bool ok =
+		fwrite(&header, sizeof(header), 1, f) == 1 &&
+		fwrite(hashes.data(), sizeof(hashes[0]), hashes.size(), f) == hashes.size() &&
+		fwrite(data.data(), 1, data.size(), f) == data.size();
+	if(fclose(f) != 0) {
+		ok = false;
+	}
+	if(!ok) {
+		LogMessage(Error, "write error on '%s'", path);
+	}
+	return ok;
+}
+
+} // namespace tool
+} // namespace twib
+} // namespace twili
@@ -0,0 +1,57 @@
+//
+// Twili - Homebrew debug monitor for the Nintendo Switch
+// Copyright (C) 2019 misson20000 <xenotoad@xenotoad.net>
+//
+// This file is part of Twili.
+//
+// Twili is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Twili is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Twili.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#pragma once
+
+#include<optional>
+#include<string>
+#include<vector>
+
+#include "PageHash.hpp"
+
+#include "interfaces/ITwibDebugger.hpp"
+
+namespace twili {
+namespace twib {
+namespace tool {
+
+// A copy of a range of process memory along with per-page hashes, so that a
+// later snapshot only needs to fetch the pages whose hashes changed.
+class MemorySnapshot {
+ public:
+	MemorySnapshot(uint64_t address, std::vector<uint64_t> hashes, std::vector<uint8_t> data);
+
+	// Hashes [address, address + size) on the device and fetches every page
+	// that isn't identical in `previous`. Ranges of pages that differ from
+	// `previous` (or every page, if there is no previous snapshot) are
+	// appended to `changed`.
+	static MemorySnapshot Take(ITwibDebugger &debugger, uint64_t address, uint64_t size, const MemorySnapshot *previous, std::vector<util::PageRange> &changed);
+	static std::optional<MemorySnapshot> Load(const char *path);
+	bool Save(const char *path) const;
+
+	uint64_t address;
+	std::vector<uint64_t> hashes;
+	std::vector<uint8_t> data;
+};
+
+} // namespace tool
+} // namespace twib
+} // namespace twili
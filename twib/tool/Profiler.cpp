@@ -0,0 +1,261 @@
+//
+// Twili - Homebrew debug monitor for the Nintendo Switch
+// Copyright (C) 2019 misson20000 <xenotoad@xenotoad.net>
+//
+// This file is part of Twili.
+//
+// Twili is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Twili is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Twili.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "Profiler.hpp"
+
+#include<algorithm>
+#include<chrono>
+#include<map>
+#include<thread>
+
+#include<string.h>
+#include<inttypes.h>
+
+#include "common/Logger.hpp"
+#include "common/ResultError.hpp"
+
+namespace twili {
+namespace twib {
+namespace tool {
+
+namespace {
+
+// indices into the register list from GetThreadContext, see nx::ThreadContext
+const size_t REGISTER_FP = 29;
+const size_t REGISTER_PC = 32;
+
+double Seconds(std::chrono::steady_clock::duration d) {
+	return std::chrono::duration<double>(d).count();
+}
+
+} // anonymous namespace
+
+Profiler::Profiler(ITwibDebugger &debugger, uint64_t pid, Config config) :
+	debugger(debugger),
+	pid(pid),
+	config(config) {
+}
+
+void Profiler::Run() {
+	std::vector<nx::LoadedModuleInfo> nsos = debugger.GetNsoInfos();
+	for(size_t i = 0; i < nsos.size(); i++) {
+		std::string name;
+		if(nsos.size() == 1) {
+			name = "main";
+		} else if(i < 2) {
+			name = i == 0 ? "rtld" : "main"; // rtld, main, subsdks, etc.
+		} else {
+			name = "nso" + std::to_string(i);
+		}
+		modules.push_back(Module {name, nsos[i].base_addr, nsos[i].size});
+	}
+	try {
+		std::vector<nx::LoadedModuleInfo> nros = debugger.GetNroInfos();
+		for(size_t i = 0; i < nros.size(); i++) {
+			modules.push_back(Module {"nro" + std::to_string(i), nros[i].base_addr, nros[i].size});
+		}
+	} catch(ResultError &e) {
+		LogMessage(Debug, "couldn't get NRO infos: 0x%x", e.code);
+	}
+	std::sort(modules.begin(), modules.end(), [](const Module &a, const Module &b) {
+		return a.base < b.base;
+	});
+	for(const Module &m : modules) {
+		LogMessage(Info, "module %s: 0x%" PRIx64 "-0x%" PRIx64, m.name.c_str(), m.base, m.base + m.size);
+	}
+
+	// attaching stopped the process, so pick up its threads and let it go
+	if(!IngestEvents()) {
+		return;
+	}
+	debugger.ContinueDebugEvent(7, thread_ids);
+
+	using clock = std::chrono::steady_clock;
+	clock::duration interval = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(1.0 / config.rate));
+	clock::time_point start = clock::now();
+	clock::time_point end = start + std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(config.duration));
+	clock::time_point next = start;
+	
+	while((next+= interval) < end) {
+		std::this_thread::sleep_until(next);
+
+		clock::time_point stop_begin = clock::now();
+		debugger.BreakProcess();
+		if(!IngestEvents()) {
+			break;
+		}
+		for(uint64_t thread_id : thread_ids) {
+			TakeSample(thread_id, Seconds(stop_begin - start));
+		}
+		debugger.ContinueDebugEvent(7, thread_ids);
+		clock::time_point stop_end = clock::now();
+		
+		stopped_time+= Seconds(stop_end - stop_begin);
+		sample_rounds++;
+
+		// if a round took longer than the interval, skip the ones we missed
+		// instead of stopping the process again immediately
+		while(next + interval <= stop_end) {
+			next+= interval;
+			missed_rounds++;
+		}
+	}
+	
+	wall_time = Seconds(clock::now() - start);
+}
+
+bool Profiler::IngestEvents() {
+	bool alive = true;
+	for(nx::DebugEvent &event : debugger.GetDebugEvents()) {
+		switch(event.event_type) {
+		case nx::DebugEvent::EventType::AttachThread:
+			thread_ids.push_back(event.attach_thread.thread_id);
+			break;
+		case nx::DebugEvent::EventType::ExitThread:
+			thread_ids.erase(std::remove(thread_ids.begin(), thread_ids.end(), event.thread_id), thread_ids.end());
+			break;
+		case nx::DebugEvent::EventType::ExitProcess:
+			LogMessage(Warning, "process exited while profiling");
+			alive = false;
+			break;
+		case nx::DebugEvent::EventType::Exception:
+			switch(event.exception.exception_type) {
+			case nx::DebugEvent::ExceptionType::DebuggerAttached:
+			case nx::DebugEvent::ExceptionType::DebuggerBreak:
+				break;
+			default:
+				LogMessage(Warning, "process hit exception %d while profiling", event.exception.exception_type);
+				alive = false;
+				break;
+			}
+			break;
+		default:
+			break;
+		}
+	}
+	return alive;
+}
+
+void Profiler::TakeSample(uint64_t thread_id, double time) {
+	std::vector<uint64_t> registers;
+	try {
+		registers = debugger.GetThreadContext(thread_id);
+	} catch(ResultError &e) {
+		LogMessage(Debug, "failed to get context for thread 0x%" PRIx64 ": 0x%x", thread_id, e.code);
+		return;
+	}
+
+	Sample sample;
+	sample.thread_id = thread_id;
+	sample.time = time;
+	sample.frames.push_back(registers[REGISTER_PC]);
+	
+	// each frame record is {previous fp, return address}
+	uint64_t fp = registers[REGISTER_FP];
+	while(sample.frames.size() < config.max_depth && fp != 0 && (fp & 7) == 0) {
+		std::vector<uint8_t> record;
+		try {
+			record = debugger.ReadMemory(fp, 2 * sizeof(uint64_t));
+		} catch(ResultError&) {
+			break;
+		}
+		uint64_t next_fp, lr;
+		memcpy(&next_fp, record.data(), sizeof(next_fp));
+		memcpy(&lr, record.data() + sizeof(next_fp), sizeof(lr));
+		if(lr == 0) {
+			break;
+		}
+		sample.frames.push_back(lr);
+		if(next_fp <= fp) { // callers' frames are always further up the stack
+			break;
+		}
+		fp = next_fp;
+	}
+	
+	samples.push_back(std::move(sample));
+}
+
+const Profiler::Module *Profiler::FindModule(uint64_t address) const {
+	auto i = std::upper_bound(modules.begin(), modules.end(), address, [](uint64_t address, const Module &m) {
+		return address < m.base;
+	});
+	if(i == modules.begin()) {
+		return nullptr;
+	}
+	i--;
+	if(address - i->base >= i->size) {
+		return nullptr;
+	}
+	return &*i;
+}
+
+std::string Profiler::Symbolize(uint64_t address) const {
+	char buffer[64];
+	const Module *module = FindModule(address);
+	if(module) {
+		snprintf(buffer, sizeof(buffer), "%s+0x%" PRIx64, module->name.c_str(), address - module->base);
+	} else {
+		snprintf(buffer, sizeof(buffer), "0x%" PRIx64, address);
+	}
+	return buffer;
+}
+
+void Profiler::Write(Format format, FILE *out) const {
+	switch(format) {
+	case Format::Folded: {
+		std::map<std::string, size_t> stacks;
+		for(const Sample &sample : samples) {
+			char thread[32];
+			snprintf(thread, sizeof(thread), "thread-0x%" PRIx64, sample.thread_id);
+			std::string stack = thread;
+			for(auto i = sample.frames.rbegin(); i != sample.frames.rend(); i++) {
+				stack+= ";" + Symbolize(*i);
+			}
+			stacks[stack]++;
+		}
+		for(auto &s : stacks) {
+			fprintf(out, "%s %zu\n", s.first.c_str(), s.second);
+		}
+		break; }
+	case Format::PerfScript: {
+		for(const Sample &sample : samples) {
+			fprintf(out, "twib %" PRIu64 "/%" PRIu64 " %.6f: 1 cpu-clock:\n", pid, sample.thread_id, sample.time);
+			for(uint64_t frame : sample.frames) {
+				const Module *module = FindModule(frame);
+				fprintf(out, "\t%16" PRIx64 " %s (%s)\n", frame, Symbolize(frame).c_str(), module ? module->name.c_str() : "[unknown]");
+			}
+			fprintf(out, "\n");
+		}
+		break; }
+	}
+}
+
+void Profiler::PrintOverhead(FILE *out) const {
+	fprintf(out, "%zu samples from %zu rounds over %.2fs (%.1f rounds/s, %zu rounds skipped because sampling fell behind)\n",
+		samples.size(), sample_rounds, wall_time, wall_time > 0 ? sample_rounds / wall_time : 0.0, missed_rounds);
+	fprintf(out, "process was stopped for %.3fs (%.1f%% of the time, %.2fms per round)\n",
+		stopped_time,
+		wall_time > 0 ? 100.0 * stopped_time / wall_time : 0.0,
+		sample_rounds > 0 ? 1000.0 * stopped_time / sample_rounds : 0.0);
+}
+
+} // namespace tool
+} // namespace twib
+} // namespace twili
@@ -0,0 +1,90 @@
+//
+// Twili - Homebrew debug monitor for the Nintendo Switch
+// Copyright (C) 2019 misson20000 <xenotoad@xenotoad.net>
+//
+// This file is part of Twili.
+//
+// Twili is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Twili is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Twili.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#pragma once
+
+#include<string>
+#include<vector>
+
+#include<stdio.h>
+
+#include "interfaces/ITwibDebugger.hpp"
+
+namespace twili {
+namespace twib {
+namespace tool {
+
+// Samples every thread of a running process by periodically breaking into
+// it, fetching each thread's PC and walking its frame pointer chain.
+class Profiler {
+ public:
+	enum class Format {
+		Folded, // one "frame;frame;frame count" line per unique stack
+		PerfScript, // like `perf script`, for stackcollapse-perf.pl
+	};
+	
+	struct Config {
+		double rate = 100; // samples per second
+		double duration = 10; // seconds
+		size_t max_depth = 32; // frames, including the PC
+	};
+
+	// debugger should have just been opened, with its attach events still pending.
+	Profiler(ITwibDebugger &debugger, uint64_t pid, Config config);
+
+	void Run();
+	void Write(Format format, FILE *out) const;
+	void PrintOverhead(FILE *out) const;
+	
+ private:
+	struct Module {
+		std::string name;
+		uint64_t base;
+		uint64_t size;
+	};
+	struct Sample {
+		uint64_t thread_id;
+		double time; // seconds since profiling started
+		std::vector<uint64_t> frames; // innermost first
+	};
+
+	// returns false once the process is gone or hit a real exception
+	bool IngestEvents();
+	void TakeSample(uint64_t thread_id, double time);
+	const Module *FindModule(uint64_t address) const;
+	std::string Symbolize(uint64_t address) const;
+
+	ITwibDebugger &debugger;
+	uint64_t pid;
+	Config config;
+	std::vector<Module> modules;
+	std::vector<uint64_t> thread_ids;
+	std::vector<Sample> samples;
+	
+	// for the overhead report
+	size_t sample_rounds = 0;
+	size_t missed_rounds = 0;
+	double wall_time = 0;
+	double stopped_time = 0;
+};
+
+} // namespace tool
+} // namespace twib
+} // namespace twili
@@ -36,9 +36,10 @@ RemoteObject::RemoteObject(client::Client &client, uint32_t device_id, uint32_t
 }
 
 RemoteObject::~RemoteObject() {
-	// send close request if we're not object 0
+	// send close request if we're not object 0. twibd answers closes right
+	// away and batches them up for the device, so don't wait for the reply.
 	if(object_id != 0) {
-		SendSyncRequestWithoutAssert(0xffffffff);
+		SendRequest(0xffffffff, std::vector<uint8_t>(), [](Response r) {});
 	}
 }
 
@@ -21,6 +21,8 @@
 #pragma once
 
 #include<functional>
+#include<memory>
+#include<tuple>
 
 #include "common/ResultError.hpp"
 
@@ -64,23 +66,28 @@ class RemoteObject {
 		}
 	}
 
+	// out parameters are written from the client thread when the response
+	// arrives, so whatever they refer to needs to outlive the request.
 	template<typename T, typename... Args>
 	void SendSmartRequest(T command_id, std::function<void(uint32_t)> &&func, Args&&... args) {
 		util::Buffer input_buffer;
 		(detail::WrappingHelper<Args>::Pack(std::move(args), input_buffer), ...);
+		// the wrappers themselves are temporaries, so keep them alive too
+		auto wrappers = std::make_shared<std::tuple<std::decay_t<Args>...>>(std::move(args)...);
 		SendRequest(
 			(uint32_t) command_id,
 			input_buffer.GetData(),
-			[&, func{std::move(func)}](Response r) {
+			[wrappers, func{std::move(func)}](Response r) {
 				if(r.result_code) {
 					func(r.result_code);
+					return;
 				}
 				util::Buffer output_buffer(r.payload);
-				if(!(detail::WrappingHelper<Args>::Unpack(std::move(args), output_buffer, r.objects) && ... && true)) {
-					func(TWILI_ERR_PROTOCOL_BAD_RESPONSE);
-				} else {
-					func(0);
-				}
+				bool ok = std::apply(
+					[&](auto &... wrapper) {
+						return (detail::WrappingHelper<std::decay_t<decltype(wrapper)>>::Unpack(std::move(wrapper), output_buffer, r.objects) && ... && true);
+					}, *wrappers);
+				func(ok ? 0 : TWILI_ERR_PROTOCOL_BAD_RESPONSE);
 			});
 	}
 	
@@ -0,0 +1,519 @@
+//
+// Twili - Homebrew debug monitor for the Nintendo Switch
+// Copyright (C) 2019 misson20000 <xenotoad@xenotoad.net>
+//
+// This file is part of Twili.
+//
+// Twili is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Twili is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Twili.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include "platform/platform.hpp"
+
+#include<algorithm>
+#include<chrono>
+#include<condition_variable>
+#include<map>
+#include<mutex>
+#include<optional>
+#include<set>
+#include<thread>
+
+#include<string.h>
+#include<inttypes.h>
+
+#include<msgpack11.hpp>
+
+#include "CLI/CLI.hpp"
+
+#include "common/Logger.hpp"
+#include "common/Capture.hpp"
+#include "common/config.hpp"
+
+#include "Connect.hpp"
+#include "RemoteObject.hpp"
+
+void show(msgpack11::MsgPack const& blob);
+
+namespace twili {
+namespace twib {
+namespace tool {
+
+namespace {
+
+class LatencyStats {
+ public:
+	void Add(uint64_t ns) {
+		samples.push_back(ns);
+	}
+
+	void Print(const char *name) {
+		if(samples.empty()) {
+			printf("%s: no samples\n", name);
+			return;
+		}
+		std::sort(samples.begin(), samples.end());
+		auto ms = [this](double fraction) {
+			return samples[std::min(samples.size() - 1, (size_t) (samples.size() * fraction))] / 1000000.0;
+		};
+		printf("%s: %zu samples, min %.3f ms, p50 %.3f ms, p90 %.3f ms, p99 %.3f ms, max %.3f ms\n",
+					 name, samples.size(), ms(0), ms(0.5), ms(0.9), ms(0.99), samples.back() / 1000000.0);
+	}
+ private:
+	std::vector<uint64_t> samples;
+};
+
+// A request captured at the frontend, along with the IDs of any objects its
+// response carried, so that later requests on those objects can be
+// redirected to whatever objects the replayed response carries instead.
+struct CapturedRequest {
+	common::CaptureRecord record;
+	std::vector<uint32_t> response_object_ids;
+};
+
+uint64_t MessageKey(uint32_t client_id, uint32_t tag) {
+	return ((uint64_t) client_id << 32) | tag;
+}
+
+bool LoadRequests(const char *path, std::vector<CapturedRequest> &requests) {
+	std::unique_ptr<common::CaptureReader> reader = common::CaptureReader::Open(path);
+	if(!reader) {
+		return false;
+	}
+	
+	std::map<uint64_t, size_t> pending;
+	common::CaptureRecord record;
+	while(reader->Next(record)) {
+		if(record.point == common::CapturePoint::FrontendRequest) {
+			pending[MessageKey(record.client_id, record.tag)] = requests.size();
+			requests.push_back(CapturedRequest {record, {}});
+		} else if(record.point == common::CapturePoint::FrontendResponse) {
+			auto i = pending.find(MessageKey(record.client_id, record.tag));
+			if(i != pending.end()) {
+				requests[i->second].response_object_ids = record.object_ids;
+				pending.erase(i);
+			}
+		}
+	}
+	return true;
+}
+
+void DumpPayload(const std::vector<uint8_t> &payload, size_t hex_limit) {
+	// most interfaces wrap msgpack in a length prefix
+	if(payload.size() > 8) {
+		uint64_t size;
+		memcpy(&size, payload.data(), sizeof(size));
+		if(size == payload.size() - 8) {
+			std::string err;
+			msgpack11::MsgPack obj = msgpack11::MsgPack::parse(std::string(payload.begin() + 8, payload.end()), err);
+			if(err.empty()) {
+				printf("    ");
+				fflush(stdout);
+				show(obj);
+				return;
+			}
+		}
+	}
+	for(size_t i = 0; i < std::min(payload.size(), hex_limit); i+= 16) {
+		printf("    %04zx:", i);
+		for(size_t j = i; j < std::min({payload.size(), hex_limit, i + 16}); j++) {
+			printf(" %02x", payload[j]);
+		}
+		printf("\n");
+	}
+	if(payload.size() > hex_limit) {
+		printf("    ... (%zu more bytes)\n", payload.size() - hex_limit);
+	}
+}
+
+int Dump(const char *path, bool show_payloads, size_t hex_limit) {
+	std::unique_ptr<common::CaptureReader> reader = common::CaptureReader::Open(path);
+	if(!reader) {
+		return 1;
+	}
+
+	common::CaptureRecord record;
+	while(reader->Next(record)) {
+		bool is_response =
+			record.point == common::CapturePoint::BackendResponse ||
+			record.point == common::CapturePoint::FrontendResponse;
+		printf("%12.6f %-17s client %08x device %08x object %08x %s %08x tag %08x size %" PRIu64,
+					 record.timestamp / 1000000000.0, common::CapturePointName(record.point),
+					 record.client_id, record.device_id, record.object_id,
+					 is_response ? "result " : "command", record.command_id,
+					 record.tag, record.payload_size);
+		if(!record.object_ids.empty()) {
+			printf(" objects");
+			for(uint32_t id : record.object_ids) {
+				printf(" %x", id);
+			}
+		}
+		printf("\n");
+		if(show_payloads && record.has_payload && !record.payload.empty()) {
+			DumpPayload(record.payload, hex_limit);
+		}
+	}
+	return 0;
+}
+
+// Latency and throughput as seen by twibd when the capture was made.
+int Stats(const char *path) {
+	std::unique_ptr<common::CaptureReader> reader = common::CaptureReader::Open(path);
+	if(!reader) {
+		return 1;
+	}
+
+	std::map<uint64_t, uint64_t> frontend_pending, backend_pending;
+	LatencyStats frontend_latency, backend_latency;
+	uint64_t bytes_in = 0, bytes_out = 0;
+	uint64_t first = 0, last = 0;
+	size_t count = 0;
+	
+	common::CaptureRecord record;
+	while(reader->Next(record)) {
+		if(count++ == 0) {
+			first = record.timestamp;
+		}
+		last = record.timestamp;
+		
+		uint64_t key = MessageKey(record.client_id, record.tag);
+		switch(record.point) {
+		case common::CapturePoint::FrontendRequest:
+			frontend_pending[key] = record.timestamp;
+			bytes_out+= record.payload_size;
+			break;
+		case common::CapturePoint::BackendRequest:
+			backend_pending[key] = record.timestamp;
+			break;
+		case common::CapturePoint::BackendResponse: {
+			auto i = backend_pending.find(key);
+			if(i != backend_pending.end()) {
+				backend_latency.Add(record.timestamp - i->second);
+				backend_pending.erase(i);
+			}
+			break; }
+		case common::CapturePoint::FrontendResponse: {
+			auto i = frontend_pending.find(key);
+			if(i != frontend_pending.end()) {
+				frontend_latency.Add(record.timestamp - i->second);
+				frontend_pending.erase(i);
+			}
+			bytes_in+= record.payload_size;
+			break; }
+		}
+	}
+
+	double seconds = (last - first) / 1000000000.0;
+	printf("%zu records over %.3f s\n", count, seconds);
+	printf("client payload: %" PRIu64 " bytes sent, %" PRIu64 " bytes received", bytes_out, bytes_in);
+	if(seconds > 0) {
+		printf(" (%.1f KiB/s)", (bytes_out + bytes_in) / seconds / 1024.0);
+	}
+	printf("\n");
+	frontend_latency.Print("client latency");
+	backend_latency.Print("device latency");
+	if(!frontend_pending.empty()) {
+		printf("%zu requests never got a response\n", frontend_pending.size());
+	}
+	return 0;
+}
+
+class Replayer {
+ public:
+	Replayer(client::Client &client, std::optional<uint32_t> device_override, bool verbatim) :
+		client(client),
+		device_override(device_override),
+		verbatim(verbatim) {
+	}
+	
+	// speed scales the gaps between requests; 0 sends them as fast as possible
+	void Run(const std::vector<CapturedRequest> &requests, double speed) {
+		if(requests.empty()) {
+			return;
+		}
+		
+		start = std::chrono::steady_clock::now();
+		for(const CapturedRequest &rq : requests) {
+			if(speed > 0) {
+				std::this_thread::sleep_until(
+					start + std::chrono::nanoseconds(
+						(uint64_t) ((rq.record.timestamp - requests[0].record.timestamp) / speed)));
+			}
+			Send(rq);
+		}
+		
+		std::unique_lock<std::mutex> lock(mutex);
+		while(in_flight > 0) {
+			condvar.wait(lock);
+		}
+		end = std::chrono::steady_clock::now();
+	}
+
+	void Report() {
+		double seconds = std::chrono::duration<double>(end - start).count();
+		printf("replayed %zu requests in %.3f s", sent, seconds);
+		if(seconds > 0) {
+			printf(" (%.1f requests/s, %.1f KiB/s)", sent / seconds, (bytes_out + bytes_in) / seconds / 1024.0);
+		}
+		printf("\n");
+		printf("payload: %" PRIu64 " bytes sent, %" PRIu64 " bytes received\n", bytes_out, bytes_in);
+		if(failed) {
+			printf("%zu requests failed\n", failed);
+		}
+		if(skipped) {
+			printf("%zu requests skipped (their objects were opened before the capture started)\n", skipped);
+		}
+		latency.Print("latency");
+	}
+
+	// Closes every object the replay left open.
+	void Close() {
+		std::lock_guard<std::mutex> lock(mutex);
+		objects.clear();
+	}
+ private:
+	// (captured device id, captured object id)
+	using ObjectKey = std::pair<uint32_t, uint32_t>;
+
+	void Send(const CapturedRequest &rq) {
+		const common::CaptureRecord &record = rq.record;
+		uint32_t device_id = device_override ? *device_override : record.device_id;
+		ObjectKey key(record.device_id, record.object_id);
+		
+		std::shared_ptr<RemoteObject> object;
+		if(!verbatim && record.object_id != 0) {
+			std::unique_lock<std::mutex> lock(mutex);
+			// wait for the response that's supposed to create this object
+			while(objects.find(key) == objects.end() && pending_objects.count(key)) {
+				condvar.wait(lock);
+			}
+			auto i = objects.find(key);
+			if(i == objects.end()) {
+				skipped++;
+				return;
+			}
+			object = i->second;
+			if(record.command_id == 0xffffffff) {
+				// dropping the last reference sends the close request
+				objects.erase(i);
+				lock.unlock();
+				object.reset();
+				sent++;
+				return;
+			}
+		}
+
+		std::chrono::steady_clock::time_point sent_at = std::chrono::steady_clock::now();
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			for(uint32_t id : rq.response_object_ids) {
+				pending_objects.insert(ObjectKey(record.device_id, id));
+			}
+			in_flight++;
+			sent++;
+			bytes_out+= record.payload.size();
+		}
+		
+		std::function<void(Response)> cb = [this, &rq, sent_at](Response r) {
+			uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+				std::chrono::steady_clock::now() - sent_at).count();
+			std::lock_guard<std::mutex> lock(mutex);
+			latency.Add(ns);
+			bytes_in+= r.payload.size();
+			if(r.result_code != 0) {
+				failed++;
+			}
+			// objects that aren't mapped are closed when the response is dropped
+			for(size_t i = 0; !verbatim && i < std::min(r.objects.size(), rq.response_object_ids.size()); i++) {
+				objects[ObjectKey(rq.record.device_id, rq.response_object_ids[i])] = r.objects[i];
+			}
+			for(uint32_t id : rq.response_object_ids) {
+				pending_objects.erase(ObjectKey(rq.record.device_id, id));
+			}
+			in_flight--;
+			condvar.notify_all();
+		};
+		
+		if(object) {
+			object->SendRequest(record.command_id, record.payload, std::move(cb));
+		} else {
+			client.SendRequest(
+				Request(device_id, record.object_id, record.command_id, 0, record.payload),
+				std::move(cb));
+		}
+	}
+	
+	client::Client &client;
+	std::optional<uint32_t> device_override;
+	bool verbatim;
+
+	std::mutex mutex;
+	std::condition_variable condvar;
+	std::map<ObjectKey, std::shared_ptr<RemoteObject>> objects;
+	std::set<ObjectKey> pending_objects;
+	size_t in_flight = 0;
+
+	std::chrono::steady_clock::time_point start, end;
+	LatencyStats latency;
+	size_t sent = 0, skipped = 0, failed = 0;
+	uint64_t bytes_out = 0, bytes_in = 0;
+};
+
+} // anonymous namespace
+
+} // namespace tool
+} // namespace twib
+} // namespace twili
+
+using namespace twili;
+using namespace twili::twib;
+
+int main(int argc, char *argv[]) {
+#ifdef _WIN32
+	WSADATA wsaData;
+	int err;
+	err = WSAStartup(MAKEWORD(2, 2), &wsaData);
+	if (err != 0) {
+		printf("WSASStartup failed with error: %d\n", err);
+		return 1;
+	}
+#endif
+
+	CLI::App app {"Replays and inspects twibd traffic captures"};
+
+	bool is_verbose = false;
+	app.add_flag("-v,--verbose", is_verbose, "Enable debug logging");
+
+	std::string frontend;
+	std::string unix_frontend_path = TWIB_UNIX_FRONTEND_DEFAULT_PATH;
+	uint16_t tcp_frontend_port = TWIB_TCP_FRONTEND_DEFAULT_PORT;
+	std::string named_pipe_frontend_path = TWIB_NAMED_PIPE_FRONTEND_DEFAULT_NAME;
+	
+#if TWIB_NAMED_PIPE_FRONTEND_ENABLED == 1
+	frontend = "named_pipe";
+#elif TWIB_UNIX_FRONTEND_ENABLED == 1
+	frontend = "unix";
+#else
+	frontend = "tcp";
+#endif
+	
+	app.add_set("-f,--frontend", frontend, {
+#if TWIB_NAMED_PIPE_FRONTEND_ENABLED == 1
+			"named_pipe",
+#endif
+#if TWIB_UNIX_FRONTEND_ENABLED == 1
+			"unix",
+#endif
+#if TWIB_TCP_FRONTEND_ENABLED == 1
+			"tcp",
+#endif
+		})->envname("TWIB_FRONTEND");
+
+#if TWIB_UNIX_FRONTEND_ENABLED == 1
+	app.add_option(
+		"-P,--unix-path", unix_frontend_path,
+		"Path to the twibd UNIX socket")
+		->envname("TWIB_UNIX_FRONTEND_PATH");
+#endif
+
+#if TWIB_TCP_FRONTEND_ENABLED == 1
+	app.add_option(
+		"-p,--tcp-port", tcp_frontend_port,
+		"Port for the twibd TCP socket")
+		->envname("TWIB_TCP_FRONTEND_PORT");
+#endif
+
+#if TWIB_NAMED_PIPE_FRONTEND_ENABLED == 1
+	app.add_option(
+		"-n,--pipe-name", named_pipe_frontend_path,
+		"Named for the twibd pipe")
+		->envname("TWIB_NAMED_PIPE_FRONTEND_NAME");
+#endif
+
+	CLI::App *dump = app.add_subcommand("dump", "Print every record in a capture");
+	std::string dump_file;
+	bool dump_payloads = false;
+	size_t dump_hex_limit = 64;
+	dump->add_option("file", dump_file, "Capture file")->check(CLI::ExistingFile)->required();
+	dump->add_flag("-x,--payloads", dump_payloads, "Show recorded payloads, decoding msgpack where possible");
+	dump->add_option("--hex-limit", dump_hex_limit, "How many bytes of each binary payload to show");
+
+	CLI::App *stats = app.add_subcommand("stats", "Summarize latency and throughput recorded in a capture");
+	std::string stats_file;
+	stats->add_option("file", stats_file, "Capture file")->check(CLI::ExistingFile)->required();
+
+	CLI::App *replay = app.add_subcommand("replay", "Replay a capture's client requests against twibd");
+	std::string replay_file;
+	double replay_speed = 1.0;
+	std::string replay_device_str;
+	bool replay_verbatim = false;
+	replay->add_option("file", replay_file, "Capture file")->check(CLI::ExistingFile)->required();
+	replay->add_option("-s,--speed", replay_speed, "Speed factor relative to the original timing, or 0 to send as fast as possible");
+	replay->add_option("-d,--device", replay_device_str, "Send every request to this device instead of the captured one")
+		->type_name("DeviceId");
+	replay->add_flag("--verbatim", replay_verbatim, "Send captured object IDs as-is instead of mapping them to replayed objects");
+
+	app.require_subcommand(1);
+	
+	try {
+		app.parse(argc, argv);
+	} catch(const CLI::ParseError &e) {
+		return app.exit(e);
+	}
+
+	log::init_color();
+	if(is_verbose) {
+		log::add_log(std::make_shared<log::PrettyFileLogger>(stderr, log::Level::Debug, log::Level::Error));
+	}
+	log::add_log(std::make_shared<log::PrettyFileLogger>(stderr, log::Level::Error));
+
+	if(dump->parsed()) {
+		return tool::Dump(dump_file.c_str(), dump_payloads, dump_hex_limit);
+	}
+
+	if(stats->parsed()) {
+		return tool::Stats(stats_file.c_str());
+	}
+
+	std::vector<tool::CapturedRequest> requests;
+	if(!tool::LoadRequests(replay_file.c_str(), requests)) {
+		return 1;
+	}
+	std::optional<uint32_t> device_override;
+	if(replay_device_str.size() > 0) {
+		device_override = std::stoul(replay_device_str, NULL, 16);
+	}
+	
+	std::unique_ptr<tool::client::Client> client;
+	if(TWIB_UNIX_FRONTEND_ENABLED && frontend == "unix") {
+		client = tool::connect_unix(unix_frontend_path);
+	} else if(TWIB_TCP_FRONTEND_ENABLED && frontend == "tcp") {
+		client = tool::connect_tcp(tcp_frontend_port);
+	} else if(TWIB_NAMED_PIPE_FRONTEND_ENABLED && frontend == "named_pipe") {
+		client = tool::connect_named_pipe(named_pipe_frontend_path);
+	} else {
+		LogMessage(Fatal, "unrecognized frontend: %s", frontend.c_str());
+		return 1;
+	}
+	if(!client) {
+		return 1;
+	}
+
+	tool::Replayer replayer(*client, device_override, replay_verbatim);
+	replayer.Run(requests, replay_speed);
+	replayer.Report();
+	replayer.Close();
+	
+	return 0;
+}
@@ -21,7 +21,17 @@
 #include "platform/platform.hpp"
 
 #include<iomanip>
+#include<iostream>
+#include<fstream>
 #include<array>
+#include<atomic>
+#include<thread>
+#include<mutex>
+#include<chrono>
+#include<map>
+#include<future>
+#include<optional>
+#include<sstream>
 
 #include<string.h>
 #include<inttypes.h>
@@ -33,25 +43,25 @@
 #include "common/Logger.hpp"
 #include "common/ResultError.hpp"
 #include "common/config.hpp"
+#include "common/Semaphore.hpp"
 
 #include "platform/InputPump.hpp"
 
 #include "Protocol.hpp"
 #include "interfaces/ITwibMetaInterface.hpp"
 #include "interfaces/ITwibDeviceInterface.hpp"
+#include "interfaces/ITwibFilesystemAccessor.hpp"
+#include "MemorySnapshot.hpp"
+#include "Profiler.hpp"
 
 #if TWIB_GDB_ENABLED == 1
 #include "GdbStub.hpp"
 #endif
 
-#if TWIB_TCP_FRONTEND_ENABLED == 1 || TWIB_UNIX_FRONTEND_ENABLED == 1
-#include "SocketClient.hpp"
-#endif
-#if TWIB_NAMED_PIPE_FRONTEND_ENABLED == 1
-#include "NamedPipeClient.hpp"
-#endif
+#include "Connect.hpp"
 
 #include "util.hpp"
+#include "Hash.hpp"
 #include "err.hpp"
 
 namespace twili {
@@ -59,18 +69,18 @@ namespace twib {
 namespace tool {
 
 template<size_t N>
-void PrintTable(std::vector<std::array<std::string, N>> rows) {
+void PrintTable(std::vector<std::array<std::string, N>> rows, FILE *out = stdout) {
 	std::array<int, N> lengths = {0};
 	for(auto r : rows) {
 		for(size_t i = 0; i < N; i++) {
-			if(r[i].size() > lengths[i]) {
+			if(r[i].size() > (size_t) lengths[i]) {
 				lengths[i] = r[i].size();
 			}
 		}
 	}
 	for(auto r : rows) {
 		for(size_t i = 0; i < N; i++) {
-			printf("%-*s%s", lengths[i], r[i].c_str(), (i + 1 == N) ? "\n" : " | ");
+			fprintf(out, "%-*s%s", lengths[i], r[i].c_str(), (i + 1 == N) ? "\n" : " | ");
 		}
 	}
 }
@@ -89,7 +99,7 @@ std::string ToHex(T num, bool prefix) {
 	return stream.str();
 }
 
-void ListDevices(ITwibMetaInterface &iface) {
+void ListDevices(ITwibMetaInterface &iface, FILE *out = stdout) {
 	std::vector<std::array<std::string, 4>> rows;
 	rows.push_back({"Device ID", "Nickname", "Firmware Version", "Bridge Type"});
 	auto devices = iface.ListDevices();
@@ -103,10 +113,10 @@ void ListDevices(ITwibMetaInterface &iface) {
 		
 		rows.push_back({ToHex(device_id, 8, false), nickname, fw_version, bridge_type});
 	}
-	PrintTable(rows);
+	PrintTable(rows, out);
 }
 
-void ListProcesses(ITwibDeviceInterface &iface) {
+void ListProcesses(ITwibDeviceInterface &iface, FILE *out = stdout) {
 	std::vector<std::array<std::string, 5>> rows;
 	rows.push_back({"Process ID", "Result", "Title ID", "Process Name", "MMU Flags"});
 	auto processes = iface.ListProcesses();
@@ -118,18 +128,478 @@ void ListProcesses(ITwibDeviceInterface &iface) {
 			std::string(p.process_name, 12),
 			ToHex(p.mmu_flags, true)});
 	}
-	PrintTable(rows);
+	PrintTable(rows, out);
+}
+
+void PrintMemoryInfo(ITwibDeviceInterface &iface, FILE *out = stdout) {
+	msgpack11::MsgPack meminfo = iface.GetMemoryInfo();
+	uint64_t total_memory_available = meminfo["total_memory_available"].uint64_value();
+	uint64_t total_memory_usage     = meminfo["total_memory_usage"    ].uint64_value();
+	const size_t one_mib = 1024 * 1024;
+	fprintf(
+		out,
+		"Twili Memory: %" PRIu64" MiB / %" PRIu64" MiB (%" PRIu64"%%)\n",
+		total_memory_usage / one_mib,
+		total_memory_available / one_mib,
+		total_memory_usage * 100 / total_memory_available);
+
+	std::vector<const char*> category_labels = {"System", "Application", "Applet"};
+	for(auto &cat_info : meminfo["limits"].array_items()) {
+		fprintf(
+			out,
+			"%s Category Limit: %" PRIu64" MiB / %" PRIu64" MiB (%" PRIu64"%%)\n",
+			category_labels[cat_info["category"].int_value()],
+			cat_info["current_value"].uint64_value() / one_mib,
+			cat_info["limit_value"].uint64_value() / one_mib,
+			cat_info["current_value"].uint64_value() * 100 / cat_info["limit_value"].uint64_value());
+	}
+}
+
+std::string MemoryTypeName(uint32_t type) {
+	static const char *names[] = {
+		"Unmapped", "Io", "Static", "Code", "CodeData", "Heap", "SharedMemory",
+		"Alias", "AliasCode", "AliasCodeData", "Ipc", "Stack", "ThreadLocal",
+		"TransferMemoryIsolated", "TransferMemory", "ProcessMemory", "Inaccessible",
+		"NonSecureIpc", "NonDeviceIpc", "Kernel", "GeneratedCode", "CodeOut"};
+	type&= 0xff; // the rest are state flags
+	if(type < sizeof(names) / sizeof(names[0])) {
+		return names[type];
+	}
+	return ToHex(type, true);
+}
+
+std::string PermissionString(uint32_t permission) {
+	std::string str = "---";
+	if(permission & 1) { str[0] = 'r'; }
+	if(permission & 2) { str[1] = 'w'; }
+	if(permission & 4) { str[2] = 'x'; }
+	return str;
+}
+
+std::string SizeString(uint64_t size) {
+	char buffer[32];
+	if(size >= 1024 * 1024) {
+		snprintf(buffer, sizeof(buffer), "%.1f MiB", size / (1024.0 * 1024.0));
+	} else {
+		snprintf(buffer, sizeof(buffer), "%" PRIu64 " KiB", size / 1024);
+	}
+	return buffer;
+}
+
+void PrintMemoryMap(ITwibDebugger &debugger, bool show_unmapped, FILE *out = stdout) {
+	std::vector<nx::MemoryInfo> regions = debugger.QueryMemoryMap();
+
+	std::vector<std::array<std::string, 5>> rows;
+	rows.push_back({"Start", "End", "Size", "Type", "Perm"});
+	std::map<std::string, std::pair<size_t, uint64_t>> by_type;
+	std::map<std::string, std::pair<size_t, uint64_t>> by_permission;
+	for(nx::MemoryInfo &mi : regions) {
+		if((mi.memory_type & 0xff) == 0 && !show_unmapped) {
+			continue;
+		}
+		std::string type = MemoryTypeName(mi.memory_type);
+		std::string permission = PermissionString(mi.permission);
+		rows.push_back({
+			ToHex(mi.base_addr, 16, true),
+			ToHex(mi.base_addr + mi.size, 16, true),
+			SizeString(mi.size),
+			type,
+			permission});
+		if((mi.memory_type & 0xff) != 0) {
+			by_type[type].first++;
+			by_type[type].second+= mi.size;
+			by_permission[permission].first++;
+			by_permission[permission].second+= mi.size;
+		}
+	}
+	PrintTable(rows, out);
+
+	std::vector<std::array<std::string, 3>> totals;
+	totals.push_back({"Type", "Regions", "Size"});
+	uint64_t total_size = 0;
+	size_t total_count = 0;
+	for(auto &t : by_type) {
+		totals.push_back({t.first, std::to_string(t.second.first), SizeString(t.second.second)});
+		total_count+= t.second.first;
+		total_size+= t.second.second;
+	}
+	totals.push_back({"Total", std::to_string(total_count), SizeString(total_size)});
+	fprintf(out, "\n");
+	PrintTable(totals, out);
+
+	totals.clear();
+	totals.push_back({"Perm", "Regions", "Size"});
+	for(auto &p : by_permission) {
+		totals.push_back({p.first, std::to_string(p.second.first), SizeString(p.second.second)});
+	}
+	fprintf(out, "\n");
+	PrintTable(totals, out);
 }
 
-std::unique_ptr<client::Client> connect_tcp(uint16_t port);
-std::unique_ptr<client::Client> connect_unix(std::string path);
-std::unique_ptr<client::Client> connect_named_pipe(std::string path);
+int WatchMemory(ITwibDebugger &debugger, const std::vector<std::string> &range_specs, double interval_ms, uint64_t count, FILE *out = stdout) {
+	std::vector<protocol::ITwibMemoryWatch::Range> ranges;
+	for(const std::string &spec : range_specs) {
+		size_t colon = spec.find(':');
+		if(colon == std::string::npos) {
+			LogMessage(Fatal, "expected ADDRESS:SIZE, got '%s'", spec.c_str());
+			return 1;
+		}
+		ranges.push_back({
+				std::stoull(spec.substr(0, colon), nullptr, 0),
+				std::stoull(spec.substr(colon + 1), nullptr, 0)});
+	}
+	
+	ITwibMemoryWatch watch = debugger.CreateMemoryWatch((uint64_t) (interval_ms * 1000000), ranges);
+
+	// attaching stopped the process, so let it run again
+	std::vector<uint64_t> thread_ids;
+	for(nx::DebugEvent &event : debugger.GetDebugEvents()) {
+		if(event.event_type == nx::DebugEvent::EventType::AttachThread) {
+			thread_ids.push_back(event.attach_thread.thread_id);
+		}
+	}
+	debugger.ContinueDebugEvent(7, thread_ids);
+
+	const double ticks_per_second = 19200000.0;
+	std::optional<uint64_t> first_timestamp;
+	uint64_t printed = 0;
+	while(count == 0 || printed < count) {
+		uint64_t dropped;
+		std::vector<ITwibMemoryWatch::Change> changes = watch.Read(dropped);
+		if(dropped > 0) {
+			fprintf(stderr, "(%" PRIu64 " changes dropped)\n", dropped);
+		}
+		for(ITwibMemoryWatch::Change &change : changes) {
+			if(!first_timestamp) {
+				first_timestamp = change.timestamp;
+			}
+			fprintf(out, "[%12.6f] 0x%016" PRIx64 ":", (change.timestamp - *first_timestamp) / ticks_per_second, change.address);
+			for(uint8_t byte : change.data) {
+				fprintf(out, " %02x", byte);
+			}
+			fprintf(out, "\n");
+			if(count != 0 && ++printed >= count) {
+				break;
+			}
+		}
+		fflush(out);
+	}
+	return 0;
+}
+
+uint64_t ParseStorageId(const std::string &storage) {
+	if(storage == "none") {
+		return 0;
+	} else if(storage == "host") {
+		return 1;
+	} else if(storage == "gamecard" || storage == "gc") {
+		return 2;
+	} else if(storage == "nand-system" || storage == "system") {
+		return 3;
+	} else if(storage == "nand-user" || storage == "user") {
+		return 4;
+	} else if(storage == "sdcard" || storage == "sd") {
+		return 5;
+	} else {
+		LogMessage(Error, "unrecognized storage: %s\n", storage.c_str());
+		return 0;
+	}
+}
+
+struct FleetDevice {
+	uint32_t device_id;
+	std::string nickname;
+};
+
+// Runs a command on each device, with at most `jobs` devices in flight at
+// once, all over the same client connection. Output from each device is
+// buffered and printed as one block when that device finishes so that
+// devices don't interleave. Returns how many devices failed.
+size_t RunOnFleet(client::Client &client, const std::vector<FleetDevice> &devices, size_t jobs, std::function<int(ITwibDeviceInterface&, FILE*)> job) {
+	std::mutex output_mutex;
+	std::atomic<size_t> next_device(0);
+	std::atomic<size_t> failures(0);
+	
+	auto worker =
+		[&]() {
+			size_t i;
+			while((i = next_device++) < devices.size()) {
+				const FleetDevice &device = devices[i];
+				FILE *out = tmpfile();
+				if(!out) {
+					LogMessage(Error, "could not create temporary file: %s", strerror(errno));
+					failures++;
+					continue;
+				}
+
+				int r;
+				try {
+					ITwibDeviceInterface itdi(std::make_shared<RemoteObject>(client, device.device_id, 0));
+					r = job(itdi, out);
+				} catch(std::exception &e) {
+					fprintf(out, "%s\n", e.what());
+					r = 1;
+				}
+				if(r != 0) {
+					failures++;
+				}
+
+				std::lock_guard<std::mutex> lock(output_mutex);
+				printf("=== %s (%s): %s ===\n", ToHex(device.device_id, 8, false).c_str(), device.nickname.c_str(), r == 0 ? "ok" : "failed");
+				rewind(out);
+				char buffer[4096];
+				size_t read;
+				while((read = fread(buffer, 1, sizeof(buffer), out)) > 0) {
+					fwrite(buffer, 1, read, stdout);
+				}
+				fclose(out);
+				fflush(stdout);
+			}
+		};
+
+	std::vector<std::thread> threads;
+	for(size_t i = 0; i < std::min(std::max(jobs, (size_t) 1), devices.size()); i++) {
+		threads.emplace_back(worker);
+	}
+	for(std::thread &thread : threads) {
+		thread.join();
+	}
+	return failures;
+}
+
+void PrintChangedPages(const MemorySnapshot &snapshot, const std::vector<util::PageRange> &changed, FILE *out = stdout) {
+	size_t changed_pages = 0;
+	for(const util::PageRange &range : changed) {
+		uint64_t begin = snapshot.address + range.first_page * util::PAGE_HASH_PAGE_SIZE;
+		uint64_t end = begin + range.page_count * util::PAGE_HASH_PAGE_SIZE;
+		fprintf(out, "%s-%s (%zu pages)\n", ToHex(begin, 16, true).c_str(), ToHex(end, 16, true).c_str(), range.page_count);
+		changed_pages+= range.page_count;
+	}
+	fprintf(out, "%zu of %zu pages changed\n", changed_pages, snapshot.hashes.size());
+}
+
+// Prints a device's stdio log, starting `tail_lines` lines before the end
+// (or from the oldest line twibd still has, if negative). If `follow` is set,
+// keeps printing new lines as the device logs them.
+void ShowDeviceLog(ITwibMetaInterface &itmi, uint32_t device_id, bool follow, int64_t tail_lines, FILE *out = stdout) {
+	uint64_t sequence = 0;
+	if(tail_lines >= 0) {
+		uint64_t end = itmi.ReadDeviceLog(device_id, UINT64_MAX, false).next_sequence;
+		sequence = end > (uint64_t) tail_lines ? end - tail_lines : 0;
+	}
+
+	bool caught_up = false;
+	bool first = true;
+	while(true) {
+		ITwibMetaInterface::DeviceLogChunk chunk = itmi.ReadDeviceLog(device_id, sequence, follow && caught_up);
+		// lines that fell out of the ring before we started don't count
+		if(chunk.dropped > 0 && !first) {
+			fprintf(stderr, "... %" PRIu64" lines dropped ...\n", chunk.dropped);
+		}
+		for(std::string &line : chunk.lines) {
+			fprintf(out, "%s\n", line.c_str());
+		}
+		fflush(out);
+		
+		if(chunk.lines.empty()) {
+			if(!follow) {
+				break;
+			}
+			caught_up = true;
+		}
+		sequence = chunk.next_sequence;
+		first = false;
+	}
+}
+
+// Returns the ID of the only connected device, or logs why there isn't one.
+std::optional<uint32_t> FindOnlyDevice(ITwibMetaInterface &itmi) {
+	std::vector<msgpack11::MsgPack> devices = itmi.ListDevices();
+	if(devices.size() == 0) {
+		LogMessage(Fatal, "No devices were detected.");
+		return std::nullopt;
+	}
+	if(devices.size() > 1) {
+		LogMessage(Fatal, "Multiple devices were detected. Please use -d to specify which one you mean.");
+		return std::nullopt;
+	}
+	return devices[0]["device_id"].uint32_value();
+}
+
+// State shared by every command in a `twib shell`, so that each command
+// doesn't have to reconnect, wait for twibd to finish scanning for devices,
+// or reopen filesystems.
+class Session {
+ public:
+	Session(client::Client &client, ITwibMetaInterface &itmi) :
+		client(client),
+		itmi(itmi) {
+	}
+
+	std::optional<uint32_t> GetDefaultDevice() {
+		std::lock_guard<std::mutex> lock(mutex);
+		if(!default_device) {
+			default_device = FindOnlyDevice(itmi);
+		}
+		return default_device;
+	}
+
+	ITwibFilesystemAccessor OpenFilesystemAccessor(ITwibDeviceInterface &itdi, uint32_t device_id, const std::string &name) {
+		std::lock_guard<std::mutex> lock(mutex);
+		auto key = std::make_pair(device_id, name);
+		auto i = filesystems.find(key);
+		if(i == filesystems.end()) {
+			i = filesystems.emplace(key, itdi.OpenFilesystemAccessor(name)).first;
+		}
+		return i->second;
+	}
+
+	client::Client &client;
+ private:
+	ITwibMetaInterface &itmi;
+	std::mutex mutex;
+	std::optional<uint32_t> default_device;
+	std::map<std::pair<uint32_t, std::string>, ITwibFilesystemAccessor> filesystems;
+};
+
+// Splits a line into words on whitespace, honoring single quotes, double
+// quotes, and backslash escapes.
+std::vector<std::string> SplitCommandLine(const std::string &line) {
+	std::vector<std::string> words;
+	std::string word;
+	bool in_word = false;
+	char quote = 0;
+	for(size_t i = 0; i < line.size(); i++) {
+		char c = line[i];
+		if(quote) {
+			if(c == quote) {
+				quote = 0;
+			} else if(c == '\\' && quote == '"' && i + 1 < line.size()) {
+				word.push_back(line[++i]);
+			} else {
+				word.push_back(c);
+			}
+		} else if(c == '\'' || c == '"') {
+			quote = c;
+			in_word = true;
+		} else if(c == '\\' && i + 1 < line.size()) {
+			word.push_back(line[++i]);
+			in_word = true;
+		} else if(isspace((unsigned char) c)) {
+			if(in_word) {
+				words.push_back(word);
+				word.clear();
+				in_word = false;
+			}
+		} else {
+			word.push_back(c);
+			in_word = true;
+		}
+	}
+	if(in_word) {
+		words.push_back(word);
+	}
+	return words;
+}
+
+// Runs twib commands read from `script`, one per line, over a single
+// connection. A line ending in '&' runs in the background while the
+// following lines are read, with at most `jobs` background commands at once,
+// and "wait" waits for every background command to finish. Each command's
+// output is printed as one block when it finishes, and how long it took is
+// printed to stderr. Returns how many commands failed.
+size_t RunShell(std::istream &script, size_t jobs, bool stop_on_error, std::function<int(std::vector<std::string>&, FILE*)> command) {
+	std::mutex output_mutex;
+	std::atomic<size_t> failures(0);
+	common::Semaphore slots(std::max(jobs, (size_t) 1));
+	std::vector<std::thread> background;
+
+	auto execute =
+		[&](size_t number, std::string line, std::vector<std::string> args) {
+			FILE *out = tmpfile();
+			if(!out) {
+				LogMessage(Error, "could not create temporary file: %s", strerror(errno));
+				failures++;
+				return;
+			}
+			
+			auto start = std::chrono::steady_clock::now();
+			int r;
+			try {
+				r = command(args, out);
+			} catch(std::exception &e) {
+				fprintf(out, "%s\n", e.what());
+				r = 1;
+			}
+			double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			if(r != 0) {
+				failures++;
+			}
+
+			std::lock_guard<std::mutex> lock(output_mutex);
+			rewind(out);
+			char buffer[4096];
+			size_t read;
+			while((read = fread(buffer, 1, sizeof(buffer), out)) > 0) {
+				fwrite(buffer, 1, read, stdout);
+			}
+			fclose(out);
+			fflush(stdout);
+			fprintf(stderr, "[%zu] %s: %s in %.3f ms\n", number, line.c_str(), r == 0 ? "ok" : "failed", ms);
+		};
+	auto wait =
+		[&]() {
+			for(std::thread &thread : background) {
+				thread.join();
+			}
+			background.clear();
+		};
+
+	std::string line;
+	size_t number = 0;
+	while(!(stop_on_error && failures > 0) && std::getline(script, line)) {
+		line.erase(line.find_last_not_of(" \t\r\n") + 1);
+		line.erase(0, line.find_first_not_of(" \t"));
+		if(line.empty() || line[0] == '#') {
+			continue;
+		}
+		if(line == "wait") {
+			wait();
+			continue;
+		}
+		
+		bool is_background = line.back() == '&';
+		if(is_background) {
+			line.pop_back();
+			line.erase(line.find_last_not_of(" \t") + 1);
+		}
+		std::vector<std::string> args = SplitCommandLine(line);
+		if(args.empty()) {
+			continue;
+		}
+		
+		number++;
+		if(is_background) {
+			slots.wait();
+			background.emplace_back(
+				[&, number, line, args]() {
+					execute(number, line, args);
+					slots.notify();
+				});
+		} else {
+			execute(number, line, args);
+		}
+	}
+	wait();
+	
+	return failures;
+}
 
 } // namespace tool
 } // namespace twib
 } // namespace twili
 
-void show(msgpack11::MsgPack const& blob);
+void show(msgpack11::MsgPack const& blob, std::ostream &os);
 
 using namespace twili;
 using namespace twili::twib;
@@ -152,8 +622,17 @@ class FSCommands {
 
 		ls = subcommand->add_subcommand("ls", "Lists files on device filesystem");
 		ls->add_flag("-l", ls_details, "Show more details");
+		ls->add_flag("-R", ls_recursive, "List subdirectories recursively");
+		ls->add_option("--max-depth", ls_max_depth, "How many levels of subdirectories to list with -R (0 for no limit)", true);
+		ls->add_option("--name", ls_pattern, "Only list entries whose names match this pattern");
 		ls->add_option("path", ls_path, "Directory to list files in");
 
+		du = subcommand->add_subcommand("du", "Shows how much space each directory takes up");
+		du->add_flag("-s", du_summarize, "Only show the total");
+		du->add_option("--max-depth", du_max_depth, "How many levels of subdirectories to show (0 for no limit)", true);
+		du->add_option("--name", du_pattern, "Only count files whose names match this pattern");
+		du->add_option("path", du_path, "Directory to measure");
+
 		rm = subcommand->add_subcommand("rm", "Removes a file or directory");
 		rm->add_flag("-r", rm_recursive, "Delete recursively");
 		rm->add_option("path", rm_path, "File or directory to remove")->required();
@@ -161,6 +640,9 @@ class FSCommands {
 		mkdir = subcommand->add_subcommand("mkdir", "Creates a directory");
 		mkdir->add_option("path", mkdir_path, "Directory to create")->required();
 
+		verify = subcommand->add_subcommand("verify", "Checks that files on the device match files on the host");
+		AddVerifyOptions(verify);
+
 		mv = subcommand->add_subcommand("mv", "Rename a file or directory");
 		mv->add_option("src", mv_src, "Source path")->required();
 		mv->add_option("dst", mv_dst, "Destination path")->required();
@@ -168,30 +650,63 @@ class FSCommands {
 		subcommand->require_subcommand(1);
 	}
 
-	int Run(tool::ITwibDeviceInterface &itdi) {
+	// Adds `twib <name>` as a shorthand for this filesystem's verify.
+	void AddVerifyAlias(const char *name) {
+		verify_alias = app.add_subcommand(name, std::string("Checks that files on the device match files on the host (same as ") + cmdname + " verify)");
+		AddVerifyOptions(verify_alias);
+	}
+
+	bool Parsed() {
+		return subcommand->parsed() || (verify_alias && verify_alias->parsed());
+	}
+
+	// reuse the session's filesystem accessors instead of opening our own
+	void UseSession(tool::Session *session, uint32_t device_id) {
+		this->session = session;
+		this->device_id = device_id;
+	}
+
+	tool::ITwibFilesystemAccessor OpenFilesystemAccessor(tool::ITwibDeviceInterface &itdi) {
+		if(session) {
+			return session->OpenFilesystemAccessor(itdi, device_id, fsname);
+		}
+		return itdi.OpenFilesystemAccessor(fsname);
+	}
+
+	// whether this command can be run against several devices at once
+	bool SupportsFleet() {
+		return !pull->parsed();
+	}
+	
+	int Run(tool::ITwibDeviceInterface &itdi, FILE *out = stdout, FILE *err = stderr) {
 		if(pull->parsed()) {
-			return DoPull(itdi);
+			return DoPull(itdi, out, err);
 		}
 		if(push->parsed()) {
-			return DoPush(itdi);
+			return DoPush(itdi, err);
 		}
 		if(ls->parsed()) {
-			return DoLs(itdi);
+			return DoLs(itdi, out);
+		}
+		if(du->parsed()) {
+			return DoDu(itdi, out, err);
+		}
+		if(verify->parsed() || (verify_alias && verify_alias->parsed())) {
+			return DoVerify(itdi, out, err);
 		}
 		if(rm->parsed()) {
-			return DoRm(itdi);
+			return DoRm(itdi, err);
 		}
 		if(mkdir->parsed()) {
-			return DoMkdir(itdi);
+			return DoMkdir(itdi, err);
 		}
 		if(mv->parsed()) {
-			return DoMv(itdi);
+			return DoMv(itdi, err);
 		}
 		return 0;
 	}
 
-	int DoPull(tool::ITwibDeviceInterface &itdi) {
-		struct stat target_stat;
+	int DoPull(tool::ITwibDeviceInterface &itdi, FILE *out, FILE *err) {
 		bool is_target_directory = false;
 
 		// stupid hack for stupid command line parser
@@ -216,7 +731,7 @@ class FSCommands {
 			}
 		}
 
-		tool::ITwibFilesystemAccessor itfsa = itdi.OpenFilesystemAccessor(fsname);
+		tool::ITwibFilesystemAccessor itfsa = OpenFilesystemAccessor(itdi);
 		
 		for(std::string &src : pull_from) {
 			tool::ITwibFileAccessor itfa = itfsa.OpenFile(1, "/" + src);
@@ -225,7 +740,9 @@ class FSCommands {
 			platform::File dst;
 			if(pull_to == "-") {
 				dst_path = "<stdout>";
-				dst = platform::File::BorrowStdout();
+				if(out == stdout) {
+					dst = platform::File::BorrowStdout();
+				}
 			} else {
 				if(is_target_directory) {
 					dst_path = pull_to + src;
@@ -235,11 +752,16 @@ class FSCommands {
 				dst = platform::File::OpenForClobberingWrite(dst_path.c_str());
 			}
 
+			// twibd and twib each hold a whole response in memory, so big
+			// files still come over in a few pieces
+			const size_t window_size = 64 * 1024 * 1024;
 			size_t total_size = itfa.GetSize();
 			size_t offset = 0;
 			while(offset < total_size) {
-				std::vector<uint8_t> data = itfa.Read(offset, total_size - offset);
-				if(data.size() == 0 || dst.Write(data.data(), data.size()) < data.size()) {
+				std::vector<uint8_t> data = itfa.ReadStream(offset, std::min(total_size - offset, window_size));
+				// in a shell, "-" means the command's own output
+				size_t written = (pull_to == "-" && out != stdout) ? fwrite(data.data(), 1, data.size(), out) : dst.Write(data.data(), data.size());
+				if(data.size() == 0 || written < data.size()) {
 					LogMessage(Error, "hit EoF/IO error unexpectedly?");
 					return 1;
 				}
@@ -247,15 +769,19 @@ class FSCommands {
 			}
 
 			if(pull_to != "-") {
-				fprintf(stderr, "%s -> %s\n", src.c_str(), dst_path.c_str());
+				fprintf(err, "%s -> %s\n", src.c_str(), dst_path.c_str());
 			}
 		}
 		return 0;
 	}
 
-	int DoPush(tool::ITwibDeviceInterface &itdi) {
+	int DoPush(tool::ITwibDeviceInterface &itdi, FILE *err) {
 		bool is_target_directory = false;
 
+		// this may run for several devices at once, so work on copies
+		std::vector<std::string> push_from = this->push_from;
+		std::string push_to = this->push_to;
+		
 		// stupid hack for stupid command line parser
 		if(push_from.size() > 1) {
 			push_to = push_from.back();
@@ -266,7 +792,7 @@ class FSCommands {
 			push_to.insert(push_to.begin(), '/');
 		}
 
-		tool::ITwibFilesystemAccessor itfsa = itdi.OpenFilesystemAccessor(fsname);
+		tool::ITwibFilesystemAccessor itfsa = OpenFilesystemAccessor(itdi);
 
 		LogMessage(Debug, "checking if is file");
 		std::optional<bool> is_file_result = itfsa.IsFile(push_to);
@@ -317,14 +843,33 @@ class FSCommands {
 				offset+= data.size();
 			}
 
-			fprintf(stderr, "%s -> %s\n", src_path.c_str(), dst_path.c_str());
+			fprintf(err, "%s -> %s\n", src_path.c_str(), dst_path.c_str());
 		}
 
 		return 0;
 	}
 
-	int DoLs(tool::ITwibDeviceInterface &itdi) {
-		tool::ITwibFilesystemAccessor itfsa = itdi.OpenFilesystemAccessor(fsname);
+	int DoLs(tool::ITwibDeviceInterface &itdi, FILE *out) {
+		tool::ITwibFilesystemAccessor itfsa = OpenFilesystemAccessor(itdi);
+		if(ls_recursive || !ls_pattern.empty()) {
+			// walk the tree on the device instead of opening every directory
+			bool truncated;
+			std::vector<tool::ITwibFilesystemAccessor::WalkEntry> entries = itfsa.WalkDirectory(ls_path, ls_recursive ? ls_max_depth : 1, ls_pattern, truncated);
+			std::sort(entries.begin(), entries.end(), [](auto &a, auto &b) { return a.path < b.path; });
+			for(auto &e : entries) {
+				if(ls_details) {
+					fprintf(out, "%s %12" PRIu64"  %s\n", e.entry_type == 0 ? "d" : "-", e.file_size, e.path.c_str());
+				} else {
+					fprintf(out, "%s\n", e.path.c_str());
+				}
+			}
+			if(truncated) {
+				LogMessage(Error, "listing is incomplete; the device stopped after %zu entries", entries.size());
+				return 1;
+			}
+			return 0;
+		}
+		
 		tool::ITwibDirectoryAccessor itda = itfsa.OpenDirectory(ls_path);
 
 		uint64_t read = 0;
@@ -345,20 +890,184 @@ class FSCommands {
 		
 		for(auto &e : entries) {
 			if(ls_details) {
-				printf("%s%s %9" PRIu64"  %s\n", e.entry_type == 0 ? "d" : "-", e.attributes & 1 ? "a" : "-", e.file_size, e.path);
+				fprintf(out, "%s%s %9" PRIu64"  %s\n", e.entry_type == 0 ? "d" : "-", e.attributes & 1 ? "a" : "-", e.file_size, e.path);
 			} else {
-				printf("%s\n", e.path);
+				fprintf(out, "%s\n", e.path);
 			}
 		}
 
 		return 0;
 	}
 
-	int DoRm(tool::ITwibDeviceInterface &itdi) {
-		tool::ITwibFilesystemAccessor itfsa = itdi.OpenFilesystemAccessor(fsname);
+	int DoDu(tool::ITwibDeviceInterface &itdi, FILE *out, FILE *err) {
+		tool::ITwibFilesystemAccessor itfsa = OpenFilesystemAccessor(itdi);
+		bool truncated;
+		std::vector<tool::ITwibFilesystemAccessor::WalkEntry> entries = itfsa.WalkDirectory(du_path, 0, du_pattern, truncated);
+		if(truncated) {
+			fprintf(err, "warning: listing is incomplete, so totals are too small\n");
+		}
+
+		// total size of files under each directory, relative to du_path
+		std::map<std::string, uint64_t> totals;
+		totals[""] = 0;
+		for(auto &e : entries) {
+			if(e.entry_type == 0) {
+				totals[e.path];
+				continue;
+			}
+			totals[""]+= e.file_size;
+			for(size_t slash = e.path.find('/'); slash != std::string::npos; slash = e.path.find('/', slash + 1)) {
+				totals[e.path.substr(0, slash)]+= e.file_size;
+			}
+		}
+
+		std::string root = du_path;
+		while(!root.empty() && root.back() == '/') {
+			root.pop_back();
+		}
+		if(!du_summarize) {
+			for(auto &t : totals) {
+				if(t.first.empty()) {
+					continue;
+				}
+				size_t depth = std::count(t.first.begin(), t.first.end(), '/') + 1;
+				if(du_max_depth == 0 || depth <= du_max_depth) {
+					fprintf(out, "%12" PRIu64"  %s/%s\n", t.second, root.c_str(), t.first.c_str());
+				}
+			}
+		}
+		fprintf(out, "%12" PRIu64"  %s\n", totals[""], du_path.c_str());
+		
+		return truncated ? 1 : 0;
+	}
+
+	int DoVerify(tool::ITwibDeviceInterface &itdi, FILE *out, FILE *err) {
+		// this may run for several devices at once, so work on copies
+		std::vector<std::string> verify_from = this->verify_from;
+		std::string verify_to = this->verify_to;
+		
+		// stupid hack for stupid command line parser
+		if(verify_from.size() > 1) {
+			verify_to = verify_from.back();
+			verify_from.pop_back();
+		}
+		
+		if(verify_to.front() != '/') {
+			verify_to.insert(verify_to.begin(), '/');
+		}
+
+		if(verify_block_size != 0 && verify_block_size < 0x1000) {
+			fprintf(err, "block size must be at least 4096 bytes\n");
+			return 1;
+		}
+		
+		tool::ITwibFilesystemAccessor itfsa = OpenFilesystemAccessor(itdi);
+		std::optional<bool> is_file_result = itfsa.IsFile(verify_to);
+		bool is_target_directory = is_file_result && !(*is_file_result);
+		if(verify_from.size() > 1 && !is_target_directory) {
+			fprintf(err, "target '%s' is not a directory\n", verify_to.c_str());
+			return 1;
+		}
+		if(is_target_directory && verify_to.back() != '/') {
+			verify_to.push_back('/');
+		}
+
+		util::HashAlgorithm algorithm = verify_sha256 ? util::HashAlgorithm::Sha256 : util::HashAlgorithm::Fast;
+		size_t digest_size = util::GetDigestSize(algorithm);
+		size_t failures = 0;
+		for(std::string &src_path : verify_from) {
+			std::string dst_path = is_target_directory ? verify_to + platform::fs::BaseName(src_path.c_str()) : verify_to;
+			
+			std::optional<bool> is_file = itfsa.IsFile(dst_path);
+			if(!is_file || !*is_file) {
+				fprintf(out, "missing   %s -> %s\n", src_path.c_str(), dst_path.c_str());
+				failures++;
+				continue;
+			}
+			
+			platform::File src = platform::File::OpenForRead(src_path.c_str());
+			tool::ITwibFileAccessor itfa = itfsa.OpenFile(1, dst_path);
+			size_t size = src.GetSize();
+			size_t remote_size = itfa.GetSize();
+			if(size != remote_size) {
+				fprintf(out, "size      %s -> %s (%zu bytes here, %zu on device)\n", src_path.c_str(), dst_path.c_str(), size, remote_size);
+				failures++;
+				continue;
+			}
+			if(verify_block_size != 0 && size / verify_block_size >= 0x10000) {
+				fprintf(err, "'%s' is too big for %" PRIu64 "-byte blocks\n", src_path.c_str(), verify_block_size);
+				return 1;
+			}
+
+			// let the device hash its copy while we hash ours
+			auto remote = std::make_shared<std::promise<std::pair<uint32_t, std::vector<uint8_t>>>>();
+			std::future<std::pair<uint32_t, std::vector<uint8_t>>> remote_future = remote->get_future();
+			itfa.AsyncHash(
+				(uint32_t) algorithm, 0, size, verify_block_size,
+				[remote](uint32_t r, std::vector<uint8_t> digests) {
+					remote->set_value({r, std::move(digests)});
+				});
+
+			util::BlockHasher hasher(algorithm, verify_block_size);
+			std::vector<uint8_t> buffer(0x40000);
+			size_t r;
+			while((r = src.Read(buffer.data(), buffer.size())) > 0) {
+				hasher.Update(buffer.data(), r);
+			}
+			std::vector<uint8_t> local_digests = hasher.Finish();
+			
+			std::pair<uint32_t, std::vector<uint8_t>> remote_result = remote_future.get();
+			if(remote_result.first == TWILI_ERR_PROTOCOL_UNRECOGNIZED_FUNCTION) {
+				// older versions of Twili can't hash, so pull the file instead
+				for(size_t offset = 0; offset < size; ) {
+					std::vector<uint8_t> data = itfa.ReadStream(offset, std::min<size_t>(size - offset, 64 * 1024 * 1024));
+					if(data.empty()) {
+						break;
+					}
+					hasher.Update(data.data(), data.size());
+					offset+= data.size();
+				}
+				remote_result = {0, hasher.Finish()};
+			}
+			if(remote_result.first != 0) {
+				throw ResultError(remote_result.first);
+			}
+			std::vector<uint8_t> &remote_digests = remote_result.second;
+			if(local_digests == remote_digests) {
+				fprintf(out, "ok        %s -> %s\n", src_path.c_str(), dst_path.c_str());
+				continue;
+			}
+			failures++;
+			fprintf(out, "different %s -> %s", src_path.c_str(), dst_path.c_str());
+			if(verify_block_size != 0 && local_digests.size() == remote_digests.size()) {
+				// list the byte ranges that differ, merging neighbouring blocks
+				const char *separator = " (differs at";
+				size_t blocks = local_digests.size() / digest_size;
+				for(size_t i = 0; i < blocks; i++) {
+					if(!memcmp(local_digests.data() + i * digest_size, remote_digests.data() + i * digest_size, digest_size)) {
+						continue;
+					}
+					size_t end = i + 1;
+					while(end < blocks && memcmp(local_digests.data() + end * digest_size, remote_digests.data() + end * digest_size, digest_size)) {
+						end++;
+					}
+					fprintf(out, "%s 0x%" PRIx64 "-0x%" PRIx64, separator, i * verify_block_size, std::min<uint64_t>(end * verify_block_size, size));
+					separator = ",";
+					i = end;
+				}
+				fprintf(out, ")");
+			}
+			fprintf(out, "\n");
+		}
+		
+		return failures > 0 ? 1 : 0;
+	}
+
+	int DoRm(tool::ITwibDeviceInterface &itdi, FILE *err) {
+		tool::ITwibFilesystemAccessor itfsa = OpenFilesystemAccessor(itdi);
 		std::optional<bool> is_file_result = itfsa.IsFile(rm_path);
 		if(!is_file_result) {
-			fprintf(stderr, "'%s': No such file or directory\n", rm_path.c_str());
+			fprintf(err, "'%s': No such file or directory\n", rm_path.c_str());
 			return 1;
 		}
 
@@ -374,20 +1083,21 @@ class FSCommands {
 		return 0;
 	}
 
-	int DoMkdir(tool::ITwibDeviceInterface &itdi) {
-		tool::ITwibFilesystemAccessor itfsa = itdi.OpenFilesystemAccessor(fsname);
+	int DoMkdir(tool::ITwibDeviceInterface &itdi, FILE *err) {
+		tool::ITwibFilesystemAccessor itfsa = OpenFilesystemAccessor(itdi);
 		if(!itfsa.CreateDirectory(mkdir_path)) {
-			fprintf(stderr, "'%s': File exists\n", mkdir_path.c_str());
+			fprintf(err, "'%s': File exists\n", mkdir_path.c_str());
 			return 1;
 		}
 		return 0;
 	}
 
-	int DoMv(tool::ITwibDeviceInterface &itdi) {
-		tool::ITwibFilesystemAccessor itfsa = itdi.OpenFilesystemAccessor(fsname);
+	int DoMv(tool::ITwibDeviceInterface &itdi, FILE *err) {
+		std::string mv_dst = this->mv_dst;
+		tool::ITwibFilesystemAccessor itfsa = OpenFilesystemAccessor(itdi);
 		std::optional<bool> is_src_file = itfsa.IsFile(mv_src);
 		if(!is_src_file) {
-			fprintf(stderr, "'%s': No such file or directory\n", mv_src.c_str());
+			fprintf(err, "'%s': No such file or directory\n", mv_src.c_str());
 			return 1;
 		}
 		
@@ -422,7 +1132,16 @@ class FSCommands {
 
 	CLI::App *ls;
 	bool ls_details;
+	bool ls_recursive = false;
+	uint32_t ls_max_depth = 0;
+	std::string ls_pattern;
 	std::string ls_path = "/";
+
+	CLI::App *du;
+	bool du_summarize = false;
+	uint32_t du_max_depth = 0;
+	std::string du_pattern;
+	std::string du_path = "/";
 	
 	CLI::App *rm;
 	bool rm_recursive;
@@ -431,25 +1150,35 @@ class FSCommands {
 	CLI::App *mkdir;
 	std::string mkdir_path;
 
+	void AddVerifyOptions(CLI::App *command) {
+		command->add_option("from", verify_from, "Path(s) to compare against (on host)")->expected(-1);
+		command->add_option("to", verify_to, "Path to check (on device)");
+		command->add_flag("--sha256", verify_sha256, "Use SHA-256 instead of XXH3, a faster, non-cryptographic hash");
+		command->add_option("--block-size", verify_block_size, "Hash in blocks of this many bytes, to show where files differ");
+	}
+
+	CLI::App *verify;
+	CLI::App *verify_alias = nullptr;
+	std::vector<std::string> verify_from;
+	std::string verify_to = "/";
+	bool verify_sha256 = false;
+	uint64_t verify_block_size = 0;
+
 	CLI::App *mv;
 	std::string mv_src;
 	std::string mv_dst;
 	
 	const char *cmdname;
 	const char *fsname;
-};
 
-int main(int argc, char *argv[]) {
-#ifdef _WIN32
-	WSADATA wsaData;
-	int err;
-	err = WSAStartup(MAKEWORD(2, 2), &wsaData);
-	if (err != 0) {
-		printf("WSAStartup failed with error: %d\n", err);
-		return 1;
-	}
-#endif
+	tool::Session *session = nullptr;
+	uint32_t device_id;
+};
 
+// Parses and runs one twib command line. Within a shell session, the
+// session's connection is reused and commands write their output to `out`
+// instead of stdout.
+int RunCommand(int argc, char *argv[], tool::Session *session, FILE *out) {
 	CLI::App app {"Twili debug monitor client"};
 
 	std::string device_id_str;
@@ -460,6 +1189,15 @@ int main(int argc, char *argv[]) {
 	bool is_verbose;
 	app.add_flag("-v,--verbose", is_verbose, "Enable debug logging");
 
+	bool fleet = false;
+	std::string fleet_match;
+	size_t fleet_jobs = 8;
+	app.add_flag("-F,--fleet", fleet, "Run the command on every connected device");
+	app.add_option("--fleet-match", fleet_match, "With --fleet, only use devices whose ID or nickname contains this")
+		->envname("TWIB_FLEET_MATCH");
+	app.add_option("-j,--jobs", fleet_jobs, "With --fleet, how many devices to run the command on at once")
+		->envname("TWIB_FLEET_JOBS");
+
 	std::string frontend;
 	std::string unix_frontend_path = TWIB_UNIX_FRONTEND_DEFAULT_PATH;
 	uint16_t tcp_frontend_port = TWIB_TCP_FRONTEND_DEFAULT_PORT;
@@ -562,7 +1300,68 @@ int main(int argc, char *argv[]) {
 	launch->add_set_ignore_case("storage", launch_storage, {"host", "gamecard", "gc", "nand-system", "system", "nand-user", "user", "sdcard", "sd"}, "Storage for title")->required();
 	launch->add_option("launch-flags", launch_flags, "Flags for launch");
 
+	CLI::App *snapshot = app.add_subcommand("snapshot", "Snapshots process memory, fetching only pages that changed since a previous snapshot");
+	uint64_t snapshot_process_id;
+	std::string snapshot_address;
+	std::string snapshot_size;
+	std::string snapshot_file;
+	std::string snapshot_previous;
+	snapshot->add_option("pid", snapshot_process_id, "Process ID")->required();
+	snapshot->add_option("address", snapshot_address, "Page-aligned start address")->required();
+	snapshot->add_option("size", snapshot_size, "Page-aligned size")->required();
+	snapshot->add_option("file", snapshot_file, "File to write snapshot to")->required();
+	snapshot->add_option("-p,--previous", snapshot_previous, "Previous snapshot to diff against")->check(CLI::ExistingFile);
+
+	CLI::App *snapshot_diff = app.add_subcommand("snapshot-diff", "Lists pages that differ between two memory snapshots");
+	std::string snapshot_diff_a;
+	std::string snapshot_diff_b;
+	snapshot_diff->add_option("a", snapshot_diff_a, "Older snapshot")->check(CLI::ExistingFile)->required();
+	snapshot_diff->add_option("b", snapshot_diff_b, "Newer snapshot")->check(CLI::ExistingFile)->required();
+
+	CLI::App *vmmap = app.add_subcommand("vmmap", "Prints the memory map of a process");
+	uint64_t vmmap_process_id;
+	bool vmmap_all = false;
+	vmmap->add_option("pid", vmmap_process_id, "Process ID")->required();
+	vmmap->add_flag("-a,--all", vmmap_all, "Include unmapped regions");
+
+	CLI::App *watch = app.add_subcommand("watch", "Prints the contents of ranges of process memory whenever they change");
+	uint64_t watch_process_id;
+	std::vector<std::string> watch_ranges;
+	double watch_interval = 16;
+	uint64_t watch_count = 0;
+	watch->add_option("pid", watch_process_id, "Process ID")->required();
+	watch->add_option("ranges", watch_ranges, "Ranges to watch, as ADDRESS:SIZE")->required();
+	watch->add_option("-i,--interval", watch_interval, "Milliseconds between samples on the device", true);
+	watch->add_option("-c,--count", watch_count, "Stop after printing this many changes");
+
+	CLI::App *profile = app.add_subcommand("profile", "Samples a running process's threads to find where it spends its time");
+	uint64_t profile_process_id;
+	std::string profile_output;
+	std::string profile_format = "folded";
+	tool::Profiler::Config profile_config;
+	profile->add_option("pid", profile_process_id, "Process ID")->required();
+	profile->add_option("-o,--output", profile_output, "File to write samples to instead of stdout");
+	profile->add_set_ignore_case("-f,--format", profile_format, {"folded", "perf"}, "Folded stacks, or perf script output for stackcollapse-perf.pl", true);
+	profile->add_option("-r,--rate", profile_config.rate, "Samples per second", true);
+	profile->add_option("-d,--duration", profile_config.duration, "Seconds to sample for", true);
+	profile->add_option("--depth", profile_config.max_depth, "Maximum number of frames to walk per sample", true);
+
+	CLI::App *logs = app.add_subcommand("logs", "Prints what the device has written to its USB stdio interface");
+	bool logs_follow = false;
+	int64_t logs_lines = -1;
+	logs->add_flag("-f,--follow", logs_follow, "Keep printing new lines as they are logged");
+	logs->add_option("-n,--lines", logs_lines, "Only print this many of the most recent lines");
+
+	CLI::App *shell = app.add_subcommand("shell", "Runs commands from a script or stdin over one connection");
+	std::string shell_script;
+	bool shell_stop_on_error = false;
+	size_t shell_jobs = 8;
+	shell->add_option("script", shell_script, "Script to read commands from instead of stdin")->check(CLI::ExistingFile);
+	shell->add_flag("-e,--stop-on-error", shell_stop_on_error, "Stop reading commands once one fails");
+	shell->add_option("-j,--jobs", shell_jobs, "How many background commands to run at once", true);
+
 	FSCommands sd_commands(app, "sd", "Perform operations on target SD card", "sd");
+	sd_commands.AddVerifyAlias("verify");
 	FSCommands nand_user_commands(app, "nu", "Perform operations on target NAND user filesystem", "nand_user");
 	FSCommands nand_system_commands(app, "ns", "Perform operations on target NAND system filesystem", "nand_system");
 	
@@ -574,66 +1373,204 @@ int main(int argc, char *argv[]) {
 		return app.exit(e);
 	}
 
-	log::init_color();
-	if(is_verbose) {
+	if(session && shell->parsed()) {
+		LogMessage(Error, "shells can't be nested");
+		return 1;
+	}
+	
+	if(!session) {
+		log::init_color();
+		if(is_verbose) {
 #if TWIB_GDB_ENABLED == 1
-		if(gdb->parsed()) {
-			// for gdb stub, all logging should go to stderr
-			log::add_log(std::make_shared<log::PrettyFileLogger>(stderr, log::Level::Debug, log::Level::Error));
+			if(gdb->parsed()) {
+				// for gdb stub, all logging should go to stderr
+				log::add_log(std::make_shared<log::PrettyFileLogger>(stderr, log::Level::Debug, log::Level::Error));
 #else
-		if(false) {
+			if(false) {
 #endif
-		} else {
-			log::add_log(std::make_shared<log::PrettyFileLogger>(stdout, log::Level::Debug, log::Level::Error));
+			} else {
+				log::add_log(std::make_shared<log::PrettyFileLogger>(stdout, log::Level::Debug, log::Level::Error));
+			}
 		}
+		log::add_log(std::make_shared<log::PrettyFileLogger>(stderr, log::Level::Error));
+		
+		LogMessage(Message, "starting twib");
 	}
-	log::add_log(std::make_shared<log::PrettyFileLogger>(stderr, log::Level::Error));
-	
-	LogMessage(Message, "starting twib");
-
-	std::unique_ptr<tool::client::Client> client;
-	if(TWIB_UNIX_FRONTEND_ENABLED && frontend == "unix") {
-		client = tool::connect_unix(unix_frontend_path);
-	} else if(TWIB_TCP_FRONTEND_ENABLED && frontend == "tcp") {
-		client = tool::connect_tcp(tcp_frontend_port);
-	} else if(TWIB_NAMED_PIPE_FRONTEND_ENABLED && frontend == "named_pipe") {
-		client = tool::connect_named_pipe(named_pipe_frontend_path);
+
+	std::unique_ptr<tool::client::Client> owned_client;
+	tool::client::Client *client;
+	if(session) {
+		client = &session->client;
 	} else {
-		LogMessage(Fatal, "unrecognized frontend: %s", frontend.c_str());
-		return 1;
-	}
-	if(!client) {
-		return 1;
+		if(TWIB_UNIX_FRONTEND_ENABLED && frontend == "unix") {
+			owned_client = tool::connect_unix(unix_frontend_path);
+		} else if(TWIB_TCP_FRONTEND_ENABLED && frontend == "tcp") {
+			owned_client = tool::connect_tcp(tcp_frontend_port);
+		} else if(TWIB_NAMED_PIPE_FRONTEND_ENABLED && frontend == "named_pipe") {
+			owned_client = tool::connect_named_pipe(named_pipe_frontend_path);
+		} else {
+			LogMessage(Fatal, "unrecognized frontend: %s", frontend.c_str());
+			return 1;
+		}
+		if(!owned_client) {
+			return 1;
+		}
+		client = owned_client.get();
 	}
 	
 	tool::ITwibMetaInterface itmi(tool::RemoteObject(*client, 0, 0));
+
+	if(shell->parsed()) {
+		std::ifstream script_file;
+		if(!shell_script.empty()) {
+			script_file.open(shell_script);
+			if(!script_file) {
+				LogMessage(Fatal, "could not open '%s'", shell_script.c_str());
+				return 1;
+			}
+		}
+		
+		tool::Session new_session(*client, itmi);
+		size_t failures = tool::RunShell(
+			shell_script.empty() ? std::cin : script_file, shell_jobs, shell_stop_on_error,
+			[&new_session](std::vector<std::string> &args, FILE *out) {
+				std::string name = "twib";
+				std::vector<char*> command_argv = {name.data()};
+				for(std::string &arg : args) {
+					command_argv.push_back(arg.data());
+				}
+				return RunCommand(command_argv.size(), command_argv.data(), &new_session, out);
+			});
+		return failures > 0 ? 1 : 0;
+	}
 	
 	if(ld->parsed()) {
-		ListDevices(itmi);
+		ListDevices(itmi, out);
 		return 0;
 	}
 
 	if(cmd_connect_tcp->parsed()) {
-		printf("%s\n", itmi.ConnectTcp(connect_tcp_hostname, connect_tcp_port).c_str());
+		fprintf(out, "%s\n", itmi.ConnectTcp(connect_tcp_hostname, connect_tcp_port).c_str());
 		return 0;
 	}
 
-	uint32_t device_id;
-	if(device_id_str.size() > 0) {
-		device_id = std::stoul(device_id_str, NULL, 16);
+	if(snapshot_diff->parsed()) {
+		std::optional<tool::MemorySnapshot> a = tool::MemorySnapshot::Load(snapshot_diff_a.c_str());
+		std::optional<tool::MemorySnapshot> b = tool::MemorySnapshot::Load(snapshot_diff_b.c_str());
+		if(!a || !b) {
+			return 1;
+		}
+		if(a->address != b->address) {
+			LogMessage(Fatal, "snapshots start at different addresses");
+			return 1;
+		}
+		tool::PrintChangedPages(*b, util::DiffPageHashes(a->hashes, b->hashes), out);
+		return 0;
+	}
+
+	// commands that can write their output somewhere other than stdout, so
+	// they can run on several devices at once or alongside other commands in
+	// a shell
+	std::function<int(tool::ITwibDeviceInterface&, FILE*)> job;
+	if(reboot->parsed()) {
+		job = [](tool::ITwibDeviceInterface &itdi, FILE*) {
+			itdi.Reboot();
+			return 0;
+		};
+	} else if(terminate->parsed()) {
+		job = [&](tool::ITwibDeviceInterface &itdi, FILE*) {
+			itdi.Terminate(terminate_process_id);
+			return 0;
+		};
+	} else if(ps->parsed()) {
+		job = [](tool::ITwibDeviceInterface &itdi, FILE *out) {
+			tool::ListProcesses(itdi, out);
+			return 0;
+		};
+	} else if(list_named_pipes->parsed()) {
+		job = [](tool::ITwibDeviceInterface &itdi, FILE *out) {
+			for(auto n : itdi.ListNamedPipes()) {
+				fprintf(out, "%s\n", n.c_str());
+			}
+			return 0;
+		};
+	} else if(get_memory_info->parsed()) {
+		job = [](tool::ITwibDeviceInterface &itdi, FILE *out) {
+			tool::PrintMemoryInfo(itdi, out);
+			return 0;
+		};
+	} else if(launch->parsed()) {
+		uint64_t storage_id = tool::ParseStorageId(launch_storage);
+		uint64_t title_id = std::stoull(launch_title_id, nullptr, 16);
+		job = [&, storage_id, title_id](tool::ITwibDeviceInterface &itdi, FILE *out) {
+			fprintf(out, "0x%" PRIx64"\n", itdi.LaunchUnmonitoredProcess(title_id, storage_id, launch_flags));
+			return 0;
+		};
 	} else {
-		std::vector<msgpack11::MsgPack> devices = itmi.ListDevices();
+		for(FSCommands *fs : {&sd_commands, &nand_user_commands, &nand_system_commands}) {
+			if(fs->Parsed() && fs->SupportsFleet()) {
+				job = [fs](tool::ITwibDeviceInterface &itdi, FILE *out) {
+					return fs->Run(itdi, out, out);
+				};
+			}
+		}
+	}
+
+	if(fleet) {
+		if(!job) {
+			LogMessage(Fatal, "This command can't be run with --fleet.");
+			return 1;
+		}
+
+		std::vector<tool::FleetDevice> devices;
+		for(msgpack11::MsgPack device : itmi.ListDevices()) {
+			tool::FleetDevice fd;
+			fd.device_id = device["device_id"].uint32_value();
+			fd.nickname = device["identification"]["device_nickname"].string_value();
+			if(fleet_match.empty() ||
+				 fd.nickname.find(fleet_match) != std::string::npos ||
+				 tool::ToHex(fd.device_id, 8, false).find(fleet_match) != std::string::npos) {
+				devices.push_back(fd);
+			}
+		}
 		if(devices.size() == 0) {
-			LogMessage(Fatal, "No devices were detected.");
+			LogMessage(Fatal, "No matching devices were detected.");
+			return 1;
+		}
+
+		size_t failures = tool::RunOnFleet(*client, devices, fleet_jobs, job);
+		if(failures > 0) {
+			LogMessage(Error, "command failed on %zu of %zu devices", failures, devices.size());
 			return 1;
 		}
-		if(devices.size() > 1) {
-			LogMessage(Fatal, "Multiple devices were detected. Please use -d to specify which one you mean.");
+		return 0;
+	}
+	
+	uint32_t device_id;
+	if(device_id_str.size() > 0) {
+		device_id = std::stoul(device_id_str, NULL, 16);
+	} else {
+		std::optional<uint32_t> only_device = session ? session->GetDefaultDevice() : tool::FindOnlyDevice(itmi);
+		if(!only_device) {
 			return 1;
 		}
-		device_id = devices[0]["device_id"].uint32_value();
+		device_id = *only_device;
 	}
 	tool::ITwibDeviceInterface itdi(std::make_shared<tool::RemoteObject>(*client, device_id, 0));
+
+	if(logs->parsed()) {
+		tool::ShowDeviceLog(itmi, device_id, logs_follow, logs_lines, out);
+		return 0;
+	}
+
+	if(session) {
+		for(FSCommands *fs : {&sd_commands, &nand_user_commands, &nand_system_commands}) {
+			fs->UseSession(session, device_id);
+		}
+		if(job) {
+			return job(itdi, out);
+		}
+	}
 	
 	if(run->parsed()) {
 		auto code_opt = util::ReadFile(run_file.c_str());
@@ -646,7 +1583,7 @@ int main(int argc, char *argv[]) {
 		mon.AppendCode(*code_opt);
 		uint64_t pid = run_suspend ? mon.LaunchSuspended() : mon.Launch();
 		if(!run_quiet) {
-			printf("PID: 0x%" PRIx64"\n", pid);
+			fprintf(out, "PID: 0x%" PRIx64"\n", pid);
 		}
 		auto pump_output =
 			[](tool::ITwibPipeReader reader, FILE *stream) {
@@ -669,8 +1606,9 @@ int main(int argc, char *argv[]) {
 					}
 				}
 			};
-		std::thread stdout_pump(pump_output, mon.OpenStdout(), stdout);
-		std::thread stderr_pump(pump_output, mon.OpenStderr(), stderr);
+		// in a shell, everything the process prints is part of the command's output
+		std::thread stdout_pump(pump_output, mon.OpenStdout(), out);
+		std::thread stderr_pump(pump_output, mon.OpenStderr(), session ? out : stderr);
 
 		class Logic : public platform::EventLoop::Logic {
 		 public:
@@ -684,20 +1622,26 @@ int main(int argc, char *argv[]) {
 		};
 
 		tool::ITwibPipeWriter r = mon.OpenStdin();
-		platform::InputPump input_pump(4096,
-			[&r](std::vector<uint8_t> &data) {
-				r.WriteSync(data);
-			}, [&r]() {
-				r.Close();
-			});
-		
+		std::optional<platform::InputPump> input_pump;
 		Logic logic(
 			[&](platform::EventLoop &l) {
 				l.Clear();
-				l.AddMember(input_pump);
+				l.AddMember(*input_pump);
 			});
-		platform::EventLoop stdin_loop(logic);
-		stdin_loop.Begin();
+		std::optional<platform::EventLoop> stdin_loop;
+		if(session) {
+			// our stdin holds the rest of the shell's commands
+			r.Close();
+		} else {
+			input_pump.emplace(4096,
+				[&r](std::vector<uint8_t> &data) {
+					r.WriteSync(data);
+				}, [&r]() {
+					r.Close();
+				});
+			stdin_loop.emplace(logic);
+			stdin_loop->Begin();
+		}
 		
 		stdout_pump.join();
 		stderr_pump.join();
@@ -711,7 +1655,9 @@ int main(int argc, char *argv[]) {
 			LogMessage(Error, "got 0x%x waiting for process exit", e.code);
 		}
 		LogMessage(Debug, "  process exited");
-		stdin_loop.Destroy();
+		if(stdin_loop) {
+			stdin_loop->Destroy();
+		}
 		return 0;
 	}
 
@@ -739,24 +1685,86 @@ int main(int argc, char *argv[]) {
 		fclose(f);
 	}
 	
+	if(snapshot->parsed()) {
+		std::optional<tool::MemorySnapshot> previous;
+		if(!snapshot_previous.empty()) {
+			previous = tool::MemorySnapshot::Load(snapshot_previous.c_str());
+			if(!previous) {
+				return 1;
+			}
+		}
+
+		tool::ITwibDebugger debugger = itdi.OpenActiveDebugger(snapshot_process_id);
+		std::vector<util::PageRange> changed;
+		tool::MemorySnapshot snap = tool::MemorySnapshot::Take(
+			debugger,
+			std::stoull(snapshot_address, nullptr, 0),
+			std::stoull(snapshot_size, nullptr, 0),
+			previous ? &*previous : nullptr,
+			changed);
+		if(!snap.Save(snapshot_file.c_str())) {
+			return 1;
+		}
+		tool::PrintChangedPages(snap, changed, out);
+		return 0;
+	}
+	
+	if(vmmap->parsed()) {
+		tool::ITwibDebugger debugger = itdi.OpenActiveDebugger(vmmap_process_id);
+		tool::PrintMemoryMap(debugger, vmmap_all, out);
+		return 0;
+	}
+
+	if(watch->parsed()) {
+		tool::ITwibDebugger debugger = itdi.OpenActiveDebugger(watch_process_id);
+		return tool::WatchMemory(debugger, watch_ranges, watch_interval, watch_count, out);
+	}
+
+	if(profile->parsed()) {
+		if(profile_config.rate <= 0 || profile_config.duration <= 0) {
+			LogMessage(Fatal, "rate and duration must be positive");
+			return 1;
+		}
+		FILE *f = out;
+		if(!profile_output.empty()) {
+			f = fopen(profile_output.c_str(), "w");
+			if(!f) {
+				LogMessage(Fatal, "could not open '%s': %s", profile_output.c_str(), strerror(errno));
+				return 1;
+			}
+		}
+		
+		tool::ITwibDebugger debugger = itdi.OpenActiveDebugger(profile_process_id);
+		tool::Profiler profiler(debugger, profile_process_id, profile_config);
+		profiler.Run();
+		profiler.Write(profile_format == "perf" ? tool::Profiler::Format::PerfScript : tool::Profiler::Format::Folded, f);
+		if(f != out) {
+			fclose(f);
+		}
+		profiler.PrintOverhead(stderr);
+		return 0;
+	}
+	
 	if(terminate->parsed()) {
 		itdi.Terminate(terminate_process_id);
 		return 0;
 	}
 
 	if(ps->parsed()) {
-		ListProcesses(itdi);
+		ListProcesses(itdi, out);
 		return 0;
 	}
 
 	if(identify->parsed()) {
-		show(itdi.Identify());
+		std::ostringstream identification;
+		show(itdi.Identify(), identification);
+		fputs(identification.str().c_str(), out);
 		return 0;
 	}
 
 	if(list_named_pipes->parsed()) {
 		for(auto n : itdi.ListNamedPipes()) {
-			printf("%s\n", n.c_str());
+			fprintf(out, "%s\n", n.c_str());
 		}
 		return 0;
 	}
@@ -766,7 +1774,7 @@ int main(int argc, char *argv[]) {
 		try {
 			while(true) {
 				std::vector<uint8_t> str = reader.ReadSync();
-				std::cout << std::string(str.begin(), str.end());
+				fwrite(str.data(), 1, str.size(), out);
 			}
 		} catch(ResultError &e) {
 			if(e.code == TWILI_ERR_EOF) {
@@ -779,25 +1787,7 @@ int main(int argc, char *argv[]) {
 	}
 
 	if(get_memory_info->parsed()) {
-		msgpack11::MsgPack meminfo = itdi.GetMemoryInfo();
-		uint64_t total_memory_available = meminfo["total_memory_available"].uint64_value();
-		uint64_t total_memory_usage     = meminfo["total_memory_usage"    ].uint64_value();
-		const size_t one_mib = 1024 * 1024;
-		printf(
-			"Twili Memory: %" PRIu64" MiB / %" PRIu64" MiB (%" PRIu64"%%)\n",
-			total_memory_usage / one_mib,
-			total_memory_available / one_mib,
-			total_memory_usage * 100 / total_memory_available);
-
-		std::vector<const char*> category_labels = {"System", "Application", "Applet"};
-		for(auto &cat_info : meminfo["limits"].array_items()) {
-			printf(
-				"%s Category Limit: %" PRIu64" MiB / %" PRIu64" MiB (%" PRIu64"%%)\n",
-				category_labels[cat_info["category"].int_value()],
-				cat_info["current_value"].uint64_value() / one_mib,
-				cat_info["limit_value"].uint64_value() / one_mib,
-				cat_info["current_value"].uint64_value() * 100 / cat_info["limit_value"].uint64_value());
-		}
+		tool::PrintMemoryInfo(itdi, out);
 		return 0;
 	}
 
@@ -807,127 +1797,50 @@ int main(int argc, char *argv[]) {
 	}
 
 	if(launch->parsed()) {
-		uint64_t storage_id = 0;
-		if(launch_storage == "none") {
-			storage_id = 0;
-		} else if(launch_storage == "host") {
-			storage_id = 1;
-		} else if(launch_storage == "gamecard" || launch_storage == "gc") {
-			storage_id = 2;
-		} else if(launch_storage == "nand-system" || launch_storage == "system") {
-			storage_id = 3;
-		} else if(launch_storage == "nand-user" || launch_storage == "user") {
-			storage_id = 4;
-		} else if(launch_storage == "sdcard" || launch_storage == "sd") {
-			storage_id = 5;
-		} else {
-			LogMessage(Error, "unrecognized storage: %s\n", launch_storage.c_str());
-		}
-
+		uint64_t storage_id = tool::ParseStorageId(launch_storage);
 		uint64_t title_id = std::stoull(launch_title_id, nullptr, 16);
 
-		printf("0x%" PRIx64"\n", itdi.LaunchUnmonitoredProcess(title_id, storage_id, launch_flags));
+		fprintf(out, "0x%" PRIx64"\n", itdi.LaunchUnmonitoredProcess(title_id, storage_id, launch_flags));
 	}
 
 #if TWIB_GDB_ENABLED == 1
 	if(gdb->parsed()) {
+		if(session) {
+			// the remote protocol needs our stdin and stdout to itself
+			LogMessage(Error, "gdb can't be run from a shell");
+			return 1;
+		}
 		tool::gdb::GdbStub stub(itdi);
 		stub.Run();
 		return 0;
 	}
 #endif
 
-	if(sd_commands.subcommand->parsed()) {
-		return sd_commands.Run(itdi);
+	if(sd_commands.Parsed()) {
+		return sd_commands.Run(itdi, out, session ? out : stderr);
 	}
 
-	if(nand_user_commands.subcommand->parsed()) {
-		return nand_user_commands.Run(itdi);
+	if(nand_user_commands.Parsed()) {
+		return nand_user_commands.Run(itdi, out, session ? out : stderr);
 	}
 
-	if(nand_system_commands.subcommand->parsed()) {
-		return nand_system_commands.Run(itdi);
+	if(nand_system_commands.Parsed()) {
+		return nand_system_commands.Run(itdi, out, session ? out : stderr);
 	}
 
 	return 0;
 }
 
-namespace twili {
-namespace twib {
-namespace tool {
-
-std::unique_ptr<client::Client> connect_tcp(uint16_t port) {
-#if TWIB_TCP_FRONTEND_ENABLED == 0
-	LogMessage(Fatal, "TCP socket not supported");
-	return std::unique_ptr<client::Client>();
-#else
-	platform::Socket socket(AF_INET6, SOCK_STREAM, 0);
-
-	struct sockaddr_in6 addr;
-	memset(&addr, 0, sizeof(addr));
-	addr.sin6_family = AF_INET6;
-	addr.sin6_addr = in6addr_loopback;
-	addr.sin6_port = htons(port);
-
-	socket.Connect((struct sockaddr *) &addr, sizeof(addr));
-	LogMessage(Info, "connected to twibd: %d", socket.fd);
-	
-	return std::make_unique<client::SocketClient>(std::move(socket));
-#endif
-}
-
-std::unique_ptr<client::Client> connect_unix(std::string path) {
-#if TWIB_UNIX_FRONTEND_ENABLED == 0
-	LogMessage(Fatal, "UNIX domain socket not supported");
-	return std::unique_ptr<client::Client>();
-#else
-	platform::Socket socket(AF_UNIX, SOCK_STREAM, 0);
-
-	struct sockaddr_un addr;
-	memset(&addr, 0, sizeof(addr));
-	addr.sun_family = AF_UNIX;
-	strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
-
-	socket.Connect((struct sockaddr *) &addr, sizeof(addr));
-	LogMessage(Info, "connected to twibd: %d", socket.fd);
-	
-	return std::make_unique<client::SocketClient>(std::move(socket));
-#endif
-}
-
-std::unique_ptr<client::Client> connect_named_pipe(std::string path) {
-#if TWIB_NAMED_PIPE_FRONTEND_ENABLED == 0
-	LogMessage(Fatal, "Named pipe not supported");
-	return std::unique_ptr<client::Client>();
-#else
-	twili::platform::windows::Pipe pipe; 
-	LogMessage(Debug, "connecting to %s...", path.c_str());
-	while(1) {
-		pipe = platform::windows::Pipe::OpenNamed(path.c_str());
-		if(pipe.handle != INVALID_HANDLE_VALUE) {
-			break;
-		}
-
-		if(GetLastError() != ERROR_PIPE_BUSY) {
-			LogMessage(Fatal, "Could not open pipe. GLE=%d", GetLastError());
-			return std::unique_ptr<client::Client>();
-		}
-
-		LogMessage(Info, "got ERROR_PIPE_BUSY, waiting...");
-		if(!WaitNamedPipe(path.c_str(), 20000)) {
-			LogMessage(Fatal, "Could not open pipe: 20 second wait timed out");
-			return std::unique_ptr<client::Client>();
-		}
+int main(int argc, char *argv[]) {
+#ifdef _WIN32
+	WSADATA wsaData;
+	int err;
+	err = WSAStartup(MAKEWORD(2, 2), &wsaData);
+	if (err != 0) {
+		printf("WSAStartup failed with error: %d\n", err);
+		return 1;
 	}
-	/*DWORD mode = PIPE_READMODE_BYTE | PIPE_NOWAIT;
-	if(!SetNamedPipeHandleState(pipe.handle, &mode, nullptr, nullptr)) {
-		LogMessage(Fatal, "Failed to set named pipe handle state. GLE=%d", GetLastError());
-		return std::unique_ptr<client::Client>();
-	}*/
-	return std::make_unique<client::NamedPipeClient>(std::move(pipe));
 #endif
-}
 
-} // namespace tool
-} // namespace twib
-} // namespace twili
+	return RunCommand(argc, argv, nullptr, stdout);
+}
@@ -21,6 +21,8 @@
 #include "ITwibDebugger.hpp"
 
 #include "Protocol.hpp"
+#include "err.hpp"
+#include "PageHash.hpp"
 #include "common/ResultError.hpp"
 
 #include<cstring>
@@ -44,6 +46,36 @@ std::tuple<nx::MemoryInfo, nx::PageInfo> ITwibDebugger::QueryMemory(uint64_t add
 	return std::make_tuple(mi, pi);
 }
 
+std::vector<nx::MemoryInfo> ITwibDebugger::QueryMemoryMap() {
+	std::vector<nx::MemoryInfo> regions;
+	uint32_t r = obj->SendSmartSyncRequestWithoutAssert(
+		CommandID::QUERY_MEMORY_MAP,
+		out(regions));
+	if(r == TWILI_ERR_PROTOCOL_UNRECOGNIZED_FUNCTION) {
+		// older versions of Twili make us walk it one region at a time
+		uint64_t addr = 0;
+		do {
+			regions.push_back(std::get<0>(QueryMemory(addr)));
+			addr = regions.back().base_addr + regions.back().size;
+		} while(addr > 0);
+		return regions;
+	}
+	if(r != 0) {
+		throw ResultError(r);
+	}
+	return regions;
+}
+
+ITwibMemoryWatch ITwibDebugger::CreateMemoryWatch(uint64_t interval_ns, std::vector<protocol::ITwibMemoryWatch::Range> ranges) {
+	std::optional<ITwibMemoryWatch> watch;
+	obj->SendSmartSyncRequest(
+		CommandID::CREATE_MEMORY_WATCH,
+		in<uint64_t>(interval_ns),
+		in<std::vector<protocol::ITwibMemoryWatch::Range>>(ranges),
+		out_object<ITwibMemoryWatch>(watch));
+	return *watch;
+}
+
 std::vector<uint8_t> ITwibDebugger::ReadMemory(uint64_t addr, uint64_t size) {
 	std::vector<uint8_t> bytes;
 	obj->SendSmartSyncRequest(
@@ -54,6 +86,18 @@ std::vector<uint8_t> ITwibDebugger::ReadMemory(uint64_t addr, uint64_t size) {
 	return bytes;
 }
 
+void ITwibDebugger::AsyncReadMemory(uint64_t addr, uint64_t size, std::function<void(uint32_t, std::vector<uint8_t>)> &&cb) {
+	std::shared_ptr<std::vector<uint8_t>> bytes = std::make_shared<std::vector<uint8_t>>();
+	obj->SendSmartRequest(
+		CommandID::READ_MEMORY,
+		[cb{std::move(cb)}, bytes](uint32_t r) {
+			cb(r, std::move(*bytes));
+		},
+		in<uint64_t>(addr),
+		in<uint64_t>(size),
+		out<std::vector<uint8_t>>(*bytes));
+}
+
 void ITwibDebugger::WriteMemory(uint64_t addr, std::vector<uint8_t> &bytes) {
 	obj->SendSmartSyncRequest(
 		CommandID::WRITE_MEMORY,
@@ -75,6 +119,29 @@ std::optional<nx::DebugEvent> ITwibDebugger::GetDebugEvent() {
 	return event;
 }
 
+std::vector<nx::DebugEvent> ITwibDebugger::GetDebugEvents() {
+	std::vector<nx::DebugEvent> events;
+	uint32_t r = TWILI_ERR_PROTOCOL_UNRECOGNIZED_FUNCTION;
+	if(!without_get_debug_events) {
+		r = obj->SendSmartSyncRequestWithoutAssert(
+			CommandID::GET_DEBUG_EVENTS,
+			out(events));
+	}
+	if(r == TWILI_ERR_PROTOCOL_UNRECOGNIZED_FUNCTION) {
+		// older versions of Twili only give us one event at a time
+		without_get_debug_events = true;
+		std::optional<nx::DebugEvent> event;
+		while((event = GetDebugEvent())) {
+			events.push_back(*event);
+		}
+		return events;
+	}
+	if(r != 0) {
+		throw ResultError(r);
+	}
+	return events;
+}
+
 std::vector<uint64_t> ITwibDebugger::GetThreadContext(uint64_t thread_id) {
 	struct ThreadContext {
 		uint64_t regs[100];
@@ -144,6 +211,42 @@ std::vector<nx::LoadedModuleInfo> ITwibDebugger::GetNroInfos() {
 	return infos;
 }
 
+std::vector<uint64_t> ITwibDebugger::SearchMemory(uint64_t addr, uint64_t size, std::vector<uint8_t> pattern, std::vector<uint8_t> mask, uint64_t alignment, uint32_t max_results) {
+	std::vector<uint64_t> matches;
+	obj->SendSmartSyncRequest(
+		CommandID::SEARCH_MEMORY,
+		in<uint64_t>(addr),
+		in<uint64_t>(size),
+		in<std::vector<uint8_t>>(pattern),
+		in<std::vector<uint8_t>>(mask),
+		in<uint64_t>(alignment),
+		in<uint32_t>(max_results),
+		out(matches));
+	return matches;
+}
+
+std::vector<uint64_t> ITwibDebugger::HashPages(uint64_t addr, uint64_t size) {
+	const uint64_t page_size = util::PAGE_HASH_PAGE_SIZE;
+	
+	// the device may hash less than we asked for, so keep asking for the rest
+	std::vector<uint64_t> hashes;
+	while(hashes.size() < size / page_size) {
+		uint64_t done = hashes.size() * page_size;
+		std::vector<uint64_t> part;
+		obj->SendSmartSyncRequest(
+			CommandID::HASH_PAGES,
+			in<uint64_t>(addr + done),
+			in<uint64_t>(size - done),
+			out(part));
+		if(part.empty()) {
+			throw ResultError(TWILI_ERR_PROTOCOL_BAD_RESPONSE);
+		}
+		hashes.insert(hashes.end(), part.begin(), part.end());
+	}
+	hashes.resize(size / page_size);
+	return hashes;
+}
+
 } // namespace tool
 } // namespace twib
 } // namespace twili
@@ -26,6 +26,7 @@
 
 #include "../RemoteObject.hpp"
 #include "../DebugTypes.hpp"
+#include "ITwibMemoryWatch.hpp"
 
 namespace twili {
 namespace twib {
@@ -38,9 +39,18 @@ class ITwibDebugger {
 	using CommandID = protocol::ITwibDebugger::Command;
 
 	std::tuple<nx::MemoryInfo, nx::PageInfo> QueryMemory(uint64_t addr);
+	// Fetches every region of the address space in one request.
+	std::vector<nx::MemoryInfo> QueryMemoryMap();
+	// Has the device sample the given ranges every interval_ns and report
+	// the ones that changed through the returned watch.
+	ITwibMemoryWatch CreateMemoryWatch(uint64_t interval_ns, std::vector<protocol::ITwibMemoryWatch::Range> ranges);
 	std::vector<uint8_t> ReadMemory(uint64_t addr, uint64_t size);
+	void AsyncReadMemory(uint64_t addr, uint64_t size, std::function<void(uint32_t, std::vector<uint8_t>)> &&cb);
 	void WriteMemory(uint64_t addr, std::vector<uint8_t> &bytes);
 	std::optional<nx::DebugEvent> GetDebugEvent();
+	// Fetches every pending debug event in one request. Returns an empty list
+	// if there aren't any.
+	std::vector<nx::DebugEvent> GetDebugEvents();
 	std::vector<uint64_t> GetThreadContext(uint64_t thread_id);
 	void SetThreadContext(uint64_t thread_id, std::vector<uint64_t> registeres);
 	void ContinueDebugEvent(uint32_t flags, std::vector<uint64_t> thread_ids);
@@ -50,8 +60,12 @@ class ITwibDebugger {
 	void LaunchDebugProcess();
 	std::vector<nx::LoadedModuleInfo> GetNsoInfos();
 	std::vector<nx::LoadedModuleInfo> GetNroInfos();
+	std::vector<uint64_t> SearchMemory(uint64_t addr, uint64_t size, std::vector<uint8_t> pattern, std::vector<uint8_t> mask, uint64_t alignment, uint32_t max_results);
+	std::vector<uint64_t> HashPages(uint64_t addr, uint64_t size);
  private:
 	std::shared_ptr<RemoteObject> obj;
+	// set once the device has told us it doesn't know GET_DEBUG_EVENTS
+	bool without_get_debug_events = false;
 };
 
 } // namespace tool
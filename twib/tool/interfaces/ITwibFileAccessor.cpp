@@ -22,6 +22,7 @@
 
 #include "Protocol.hpp"
 
+#include<algorithm>
 #include<cstring>
 
 namespace twili {
@@ -42,6 +43,49 @@ std::vector<uint8_t> ITwibFileAccessor::Read(uint64_t offset, uint64_t size) {
 	return vec;
 }
 
+std::vector<uint8_t> ITwibFileAccessor::ReadStream(uint64_t offset, uint64_t size) {
+	std::vector<uint8_t> vec;
+	uint32_t result;
+	uint32_t r = obj->SendSmartSyncRequestWithoutAssert(
+		CommandID::READ_STREAM,
+		in<uint64_t>(offset),
+		in<uint64_t>(size),
+		out<std::vector<uint8_t>>(vec),
+		out<uint32_t>(result));
+	if(r == TWILI_ERR_PROTOCOL_UNRECOGNIZED_FUNCTION) {
+		// older versions of Twili allocate a buffer as big as the read, so
+		// keep each one small
+		const uint64_t chunk_size = 0x40000;
+		while(vec.size() < size) {
+			std::vector<uint8_t> chunk = Read(offset + vec.size(), std::min(size - vec.size(), chunk_size));
+			if(chunk.empty()) {
+				break;
+			}
+			vec.insert(vec.end(), chunk.begin(), chunk.end());
+		}
+		return vec;
+	}
+	if(r != 0) {
+		throw ResultError(r);
+	}
+	if(result != 0) {
+		throw ResultError(result);
+	}
+	return vec;
+}
+
+void ITwibFileAccessor::AsyncRead(uint64_t offset, uint64_t size, std::function<void(uint32_t, std::vector<uint8_t>)> &&cb) {
+	std::shared_ptr<std::vector<uint8_t>> vec = std::make_shared<std::vector<uint8_t>>();
+	obj->SendSmartRequest(
+		CommandID::READ,
+		[cb{std::move(cb)}, vec](uint32_t r) {
+			cb(r, std::move(*vec));
+		},
+		in<uint64_t>(offset),
+		in<uint64_t>(size),
+		out<std::vector<uint8_t>>(*vec));
+}
+
 void ITwibFileAccessor::Write(uint64_t offset, std::vector<uint8_t> &vec) {
 	obj->SendSmartSyncRequest(
 		CommandID::WRITE,
@@ -63,6 +107,32 @@ size_t ITwibFileAccessor::GetSize() {
 	return size;
 }
 
+std::vector<uint8_t> ITwibFileAccessor::Hash(uint32_t algorithm, uint64_t offset, uint64_t size, uint64_t block_size) {
+	std::vector<uint8_t> digests;
+	obj->SendSmartSyncRequest(
+		CommandID::HASH,
+		in<uint32_t>(algorithm),
+		in<uint64_t>(offset),
+		in<uint64_t>(size),
+		in<uint64_t>(block_size),
+		out<std::vector<uint8_t>>(digests));
+	return digests;
+}
+
+void ITwibFileAccessor::AsyncHash(uint32_t algorithm, uint64_t offset, uint64_t size, uint64_t block_size, std::function<void(uint32_t, std::vector<uint8_t>)> &&cb) {
+	std::shared_ptr<std::vector<uint8_t>> digests = std::make_shared<std::vector<uint8_t>>();
+	obj->SendSmartRequest(
+		CommandID::HASH,
+		[cb{std::move(cb)}, digests](uint32_t r) {
+			cb(r, std::move(*digests));
+		},
+		in<uint32_t>(algorithm),
+		in<uint64_t>(offset),
+		in<uint64_t>(size),
+		in<uint64_t>(block_size),
+		out<std::vector<uint8_t>>(*digests));
+}
+
 
 } // namespace tool
 } // namespace twib
@@ -37,10 +37,18 @@ class ITwibFileAccessor {
 	using CommandID = protocol::ITwibFileAccessor::Command;
 
 	std::vector<uint8_t> Read(uint64_t offset, uint64_t size);
+	// reads the whole range in one request, stopping short only at the end of
+	// the file
+	std::vector<uint8_t> ReadStream(uint64_t offset, uint64_t size);
+	void AsyncRead(uint64_t offset, uint64_t size, std::function<void(uint32_t, std::vector<uint8_t>)> &&cb);
 	void Write(uint64_t offset, std::vector<uint8_t> &vec);
 	void Flush();
 	void SetSize(size_t size);
 	size_t GetSize();
+	// digests of the range, back to back, one per block or one for the whole
+	// range if block_size is 0; see util::BlockHasher
+	std::vector<uint8_t> Hash(uint32_t algorithm, uint64_t offset, uint64_t size, uint64_t block_size);
+	void AsyncHash(uint32_t algorithm, uint64_t offset, uint64_t size, uint64_t block_size, std::function<void(uint32_t, std::vector<uint8_t>)> &&cb);
 
  private:
 	std::shared_ptr<RemoteObject> obj;
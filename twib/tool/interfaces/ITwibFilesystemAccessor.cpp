@@ -21,6 +21,7 @@
 #include "ITwibFilesystemAccessor.hpp"
 
 #include "Protocol.hpp"
+#include "util.hpp"
 
 #include<cstring>
 
@@ -129,6 +130,85 @@ ITwibDirectoryAccessor ITwibFilesystemAccessor::OpenDirectory(std::string path)
 	return *ida;
 }
 
+std::vector<ITwibFilesystemAccessor::WalkEntry> ITwibFilesystemAccessor::WalkDirectory(std::string path, uint32_t max_depth, std::string pattern, bool &truncated) {
+	std::vector<uint8_t> packed;
+	uint8_t truncated_flag;
+	uint32_t r = obj->SendSmartSyncRequestWithoutAssert(
+		CommandID::WALK_DIRECTORY,
+		in<std::string>(path),
+		in<uint32_t>(max_depth),
+		in<std::string>(pattern),
+		out<std::vector<uint8_t>>(packed),
+		out<uint8_t>(truncated_flag));
+	
+	std::vector<WalkEntry> entries;
+	if(r == TWILI_ERR_PROTOCOL_UNRECOGNIZED_FUNCTION) {
+		// older versions of Twili make us open every directory ourselves
+		truncated = false;
+		std::string root = path;
+		while(!root.empty() && root.back() == '/') {
+			root.pop_back();
+		}
+		std::vector<std::pair<std::string, uint32_t>> pending;
+		pending.push_back({"", 1});
+		while(!pending.empty()) {
+			std::string relative = pending.back().first;
+			uint32_t depth = pending.back().second;
+			pending.pop_back();
+
+			std::optional<ITwibDirectoryAccessor> itda;
+			try {
+				itda = OpenDirectory(relative.empty() ? path : root + "/" + relative);
+			} catch(ResultError&) {
+				if(relative.empty()) {
+					throw;
+				}
+				continue;
+			}
+			
+			uint64_t remaining = itda->GetEntryCount();
+			while(remaining > 0) {
+				std::vector<ITwibDirectoryAccessor::DirectoryEntry> batch = itda->Read();
+				if(batch.empty()) {
+					break;
+				}
+				remaining-= std::min<uint64_t>(remaining, batch.size());
+				for(ITwibDirectoryAccessor::DirectoryEntry &e : batch) {
+					std::string name(e.path, strnlen(e.path, sizeof(e.path)));
+					std::string entry_path = relative.empty() ? name : relative + "/" + name;
+					if(e.entry_type == 0 && (max_depth == 0 || depth < max_depth)) {
+						pending.push_back({entry_path, depth + 1});
+					}
+					if(util::GlobMatch(pattern.c_str(), name.c_str())) {
+						entries.push_back({entry_path, e.entry_type, e.entry_type == 0 ? 0 : e.file_size});
+					}
+				}
+			}
+		}
+		return entries;
+	}
+	if(r != 0) {
+		throw ResultError(r);
+	}
+
+	truncated = truncated_flag != 0;
+	size_t offset = 0;
+	while(offset < packed.size()) {
+		protocol::ITwibFilesystemAccessor::WalkEntry we;
+		if(packed.size() - offset < sizeof(we)) {
+			throw ResultError(TWILI_ERR_PROTOCOL_BAD_RESPONSE);
+		}
+		memcpy(&we, packed.data() + offset, sizeof(we));
+		offset+= sizeof(we);
+		if(packed.size() - offset < we.path_size) {
+			throw ResultError(TWILI_ERR_PROTOCOL_BAD_RESPONSE);
+		}
+		entries.push_back({std::string((char*) packed.data() + offset, we.path_size), we.entry_type, we.file_size});
+		offset+= we.path_size;
+	}
+	return entries;
+}
+
 } // namespace tool
 } // namespace twib
 } // namespace twili
@@ -49,6 +49,18 @@ class ITwibFilesystemAccessor {
 	std::optional<bool> IsFile(std::string path);
 	ITwibFileAccessor OpenFile(uint32_t mode, std::string path);
 	ITwibDirectoryAccessor OpenDirectory(std::string path);
+
+	struct WalkEntry {
+		std::string path; // relative to the directory that was walked
+		uint32_t entry_type;
+		uint64_t file_size;
+	};
+
+	// Lists the whole tree under path, down to max_depth levels (0 for no
+	// limit), keeping only entries whose names match pattern. Directories are
+	// walked whether or not they match. Sets truncated if the device gave up
+	// because the listing got too big.
+	std::vector<WalkEntry> WalkDirectory(std::string path, uint32_t max_depth, std::string pattern, bool &truncated);
 	
  private:
 	std::shared_ptr<RemoteObject> obj;
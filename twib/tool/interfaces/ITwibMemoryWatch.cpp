@@ -0,0 +1,61 @@
+//
+// Twili - Homebrew debug monitor for the Nintendo Switch
+// Copyright (C) 2019 misson20000 <xenotoad@xenotoad.net>
+//
+// This file is part of Twili.
+//
+// Twili is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Twili is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Twili.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "ITwibMemoryWatch.hpp"
+
+#include "Protocol.hpp"
+#include "err.hpp"
+#include "common/ResultError.hpp"
+
+namespace twili {
+namespace twib {
+namespace tool {
+
+ITwibMemoryWatch::ITwibMemoryWatch(std::shared_ptr<RemoteObject> obj) : obj(obj) {
+	
+}
+
+std::vector<ITwibMemoryWatch::Change> ITwibMemoryWatch::Read(uint64_t &dropped) {
+	std::vector<protocol::ITwibMemoryWatch::Change> headers;
+	std::vector<uint8_t> data;
+	obj->SendSmartSyncRequest(
+		CommandID::READ,
+		out(headers),
+		out(data),
+		out<uint64_t>(dropped));
+
+	std::vector<Change> changes;
+	size_t offset = 0;
+	for(auto &header : headers) {
+		if(header.size > data.size() - offset) {
+			throw ResultError(TWILI_ERR_PROTOCOL_BAD_RESPONSE);
+		}
+		changes.push_back(Change {
+				header.timestamp,
+				header.address,
+				std::vector<uint8_t>(data.begin() + offset, data.begin() + offset + header.size)});
+		offset+= header.size;
+	}
+	return changes;
+}
+
+} // namespace tool
+} // namespace twib
+} // namespace twili
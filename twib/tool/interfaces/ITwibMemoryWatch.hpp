@@ -0,0 +1,53 @@
+//
+// Twili - Homebrew debug monitor for the Nintendo Switch
+// Copyright (C) 2019 misson20000 <xenotoad@xenotoad.net>
+//
+// This file is part of Twili.
+//
+// Twili is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Twili is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Twili.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#pragma once
+
+#include<vector>
+
+#include "../RemoteObject.hpp"
+
+namespace twili {
+namespace twib {
+namespace tool {
+
+class ITwibMemoryWatch {
+ public:
+	ITwibMemoryWatch(std::shared_ptr<RemoteObject> obj);
+
+	using CommandID = protocol::ITwibMemoryWatch::Command;
+
+	struct Change {
+		uint64_t timestamp; // system ticks
+		uint64_t address;
+		std::vector<uint8_t> data;
+	};
+
+	// Blocks until at least one watched range changes. `dropped` is set to
+	// the number of changes the device discarded because we didn't read
+	// them fast enough.
+	std::vector<Change> Read(uint64_t &dropped);
+ private:
+	std::shared_ptr<RemoteObject> obj;
+};
+
+} // namespace tool
+} // namespace twib
+} // namespace twili
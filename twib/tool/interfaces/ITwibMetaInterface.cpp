@@ -47,6 +47,19 @@ std::string ITwibMetaInterface::ConnectTcp(std::string hostname, std::string por
 	return message;
 }
 
+ITwibMetaInterface::DeviceLogChunk ITwibMetaInterface::ReadDeviceLog(uint32_t device_id, uint64_t sequence, bool wait) {
+	DeviceLogChunk chunk;
+	obj.SendSmartSyncRequest(
+		CommandID::READ_DEVICE_LOG,
+		in<uint32_t>(device_id),
+		in<uint64_t>(sequence),
+		in<uint8_t>(wait),
+		out<uint64_t>(chunk.next_sequence),
+		out<uint64_t>(chunk.dropped),
+		out<std::vector<std::string>>(chunk.lines));
+	return chunk;
+}
+
 } // namespace tool
 } // namespace twib
 } // namespace twili
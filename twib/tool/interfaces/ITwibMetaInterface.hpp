@@ -38,6 +38,15 @@ class ITwibMetaInterface {
 	
 	std::vector<msgpack11::MsgPack> ListDevices();
 	std::string ConnectTcp(std::string hostname, std::string port);
+
+	struct DeviceLogChunk {
+		uint64_t next_sequence; // pass this to the next ReadDeviceLog call
+		uint64_t dropped; // lines lost from twibd's ring before they could be read
+		std::vector<std::string> lines;
+	};
+	// Reads a device's stdio log starting at `sequence`. If `wait` is set and
+	// there are no new lines yet, blocks until the device logs something.
+	DeviceLogChunk ReadDeviceLog(uint32_t device_id, uint64_t sequence, bool wait);
  private:
 	RemoteObject obj;
 };
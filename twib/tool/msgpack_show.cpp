@@ -8,116 +8,116 @@
 
 using namespace msgpack11;
 
-void show_impl(MsgPack const& blob, int level);
+void show_impl(MsgPack const& blob, int level, std::ostream &os);
 
-void show_null(MsgPack const& blob, int level) {
-    std::cout << "nil";
+void show_null(MsgPack const& blob, int level, std::ostream &os) {
+    os << "nil";
 }
 
-void show_bool(MsgPack const& blob, int level) {
-    std::cout << (blob.bool_value() ? "true" : "false");
+void show_bool(MsgPack const& blob, int level, std::ostream &os) {
+    os << (blob.bool_value() ? "true" : "false");
 }
 
-void show_float32(MsgPack const& blob, int level) {
-    std::cout << std::to_string(blob.float32_value());
+void show_float32(MsgPack const& blob, int level, std::ostream &os) {
+    os << std::to_string(blob.float32_value());
 }
 
-void show_float64(MsgPack const& blob, int level) {
-    std::cout << std::to_string(blob.float64_value());
+void show_float64(MsgPack const& blob, int level, std::ostream &os) {
+    os << std::to_string(blob.float64_value());
 }
 
-void show_int8(MsgPack const& blob, int level) {
-    std::cout << std::to_string(blob.int8_value());
+void show_int8(MsgPack const& blob, int level, std::ostream &os) {
+    os << std::to_string(blob.int8_value());
 }
 
-void show_int16(MsgPack const& blob, int level) {
-    std::cout << blob.int16_value();
+void show_int16(MsgPack const& blob, int level, std::ostream &os) {
+    os << blob.int16_value();
 }
 
-void show_int32(MsgPack const& blob, int level) {
-    std::cout << blob.int32_value();
+void show_int32(MsgPack const& blob, int level, std::ostream &os) {
+    os << blob.int32_value();
 }
 
-void show_int64(MsgPack const& blob, int level) {
-    std::cout << blob.int64_value();
+void show_int64(MsgPack const& blob, int level, std::ostream &os) {
+    os << blob.int64_value();
 }
 
-void show_uint8(MsgPack const& blob, int level) {
-    std::cout << std::to_string(blob.uint8_value());
+void show_uint8(MsgPack const& blob, int level, std::ostream &os) {
+    os << std::to_string(blob.uint8_value());
 }
 
-void show_uint16(MsgPack const& blob, int level) {
-    std::cout << blob.uint16_value();
+void show_uint16(MsgPack const& blob, int level, std::ostream &os) {
+    os << blob.uint16_value();
 }
 
-void show_uint32(MsgPack const& blob, int level) {
-    std::cout << blob.uint32_value();
+void show_uint32(MsgPack const& blob, int level, std::ostream &os) {
+    os << blob.uint32_value();
 }
 
-void show_uint64(MsgPack const& blob, int level) {
-    std::cout << blob.uint64_value();
+void show_uint64(MsgPack const& blob, int level, std::ostream &os) {
+    os << blob.uint64_value();
 }
 
-void show_string(MsgPack const& blob, int level) {
-    std::cout << blob.string_value();
+void show_string(MsgPack const& blob, int level, std::ostream &os) {
+    os << blob.string_value();
 }
 
-void show_array(MsgPack const& blob, int level) {
-    std::cout << "[ ";
+void show_array(MsgPack const& blob, int level, std::ostream &os) {
+    os << "[ ";
 
     MsgPack::array const& elements = blob.array_items();
-    std::for_each( elements.begin(), elements.end(), [level](MsgPack const& elm) {
-        show_impl( elm, level );
-        std::cout << ", ";
+    std::for_each( elements.begin(), elements.end(), [level, &os](MsgPack const& elm) {
+        show_impl( elm, level, os );
+        os << ", ";
     });
 
-    std::cout << "]";
+    os << "]";
 }
 
-void show_binary(MsgPack const& blob, int level) {
-    std::cout << "[ ";
+void show_binary(MsgPack const& blob, int level, std::ostream &os) {
+    os << "[ ";
 
     MsgPack::binary const& elements = blob.binary_items();
-    std::for_each( elements.begin(), elements.end(), [level](uint8_t const elm) {
-        std::cout << std::to_string(elm) << ", ";
+    std::for_each( elements.begin(), elements.end(), [level, &os](uint8_t const elm) {
+        os << std::to_string(elm) << ", ";
     });
 
-    std::cout << "]";
+    os << "]";
 }
 
-void show_object(MsgPack const& blob, int level) {
+void show_object(MsgPack const& blob, int level, std::ostream &os) {
     bool is_first = level == 0;
 
     MsgPack::object const& elements = blob.object_items();
-    std::for_each( elements.begin(), elements.end(), [level, &is_first](std::pair< MsgPack, MsgPack > const& elm ) {
+    std::for_each( elements.begin(), elements.end(), [level, &is_first, &os](std::pair< MsgPack, MsgPack > const& elm ) {
         if(!is_first)
         {
-            std::cout << std::endl;
+            os << std::endl;
         }
         is_first = false;
 
         for( int i = 0; i < (2 * level) ; ++i )
         {
-            std:: cout << " ";
+            os << " ";
         }
-        show_impl( elm.first, level + 1 );
-        std::cout << " : ";
-        show_impl( elm.second, level + 1 );
+        show_impl( elm.first, level + 1, os );
+        os << " : ";
+        show_impl( elm.second, level + 1, os );
     });
 }
 
-void show_extension(MsgPack const& blob, int level) {
+void show_extension(MsgPack const& blob, int level, std::ostream &os) {
     int8_t const info = std::get<0>(blob.extension_items());
     MsgPack::binary const& elements = std::get<1>( blob.extension_items());
 
-    std::cout << info << " - ";
-    std::for_each( elements.begin(), elements.end(), [level](uint8_t const elm) {
-        std::cout << std::to_string(elm) << ",";
+    os << info << " - ";
+    std::for_each( elements.begin(), elements.end(), [level, &os](uint8_t const elm) {
+        os << std::to_string(elm) << ",";
     });
 }
 
-void show_impl(MsgPack const& blob, int level) {
-    using func_pair = std::tuple< bool (MsgPack::*)() const, std::function< void(MsgPack const&, int) > >;
+void show_impl(MsgPack const& blob, int level, std::ostream &os) {
+    using func_pair = std::tuple< bool (MsgPack::*)() const, std::function< void(MsgPack const&, int, std::ostream&) > >;
     static std::array<func_pair, 17> const func_table{
         std::make_tuple(&MsgPack::is_null, show_null),
         std::make_tuple(&MsgPack::is_bool, show_bool),
@@ -138,16 +138,20 @@ void show_impl(MsgPack const& blob, int level) {
         std::make_tuple(&MsgPack::is_extension, show_extension)
     };
 
-    std::for_each(func_table.begin(), func_table.end(), [&blob,level](func_pair const& funcs) {
+    std::for_each(func_table.begin(), func_table.end(), [&blob,level,&os](func_pair const& funcs) {
         auto pred_pointer = std::get<0>(funcs);
         auto show_func = std::get<1>(funcs);
         if((blob.*pred_pointer)()) {
-            show_func(blob,level);
+            show_func(blob,level,os);
         }
     });
 }
 
+void show(MsgPack const& blob, std::ostream &os ) {
+    show_impl( blob, 0, os );
+    os << std::endl;
+}
+
 void show(MsgPack const& blob ) {
-    show_impl( blob, 0 );
-    std::cout << std::endl;
+    show( blob, std::cout );
 }
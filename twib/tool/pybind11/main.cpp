@@ -1,7 +1,17 @@
 // Copyright 2019 leoetlino <leo@leolam.fr>
 // Licensed under GPLv3
 
+#include <deque>
+#include <map>
+#include <mutex>
+#include <optional>
 #include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
 
 #include <msgpack11.hpp>
 #include <pybind11/functional.h>
@@ -35,18 +45,146 @@ static std::unique_ptr<tool::client::Client> connect_unix(std::string path) {
   return std::make_unique<tool::client::SocketClient>(std::move(socket));
 }
 
+// Completions for async requests. Responses arrive on the client thread, which must never
+// wait for the GIL (a blocking call holding the GIL may be waiting on that very thread), so
+// it only queues plain C++ values here and pokes a pipe that the asyncio loop is watching.
+class AsyncCompletionQueue {
+public:
+  struct Completion {
+    uint64_t id;
+    uint32_t result;
+    std::function<py::object()> make_value;  // only called with the GIL held
+  };
+
+  AsyncCompletionQueue() {
+    if (pipe(fds) != 0)
+      throw std::system_error(errno, std::generic_category());
+    fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+    fcntl(fds[1], F_SETFL, fcntl(fds[1], F_GETFL) | O_NONBLOCK);
+  }
+
+  ~AsyncCompletionQueue() {
+    close(fds[0]);
+    close(fds[1]);
+  }
+
+  void Post(uint64_t id, uint32_t result, std::function<py::object()>&& make_value) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      completions.push_back({id, result, std::move(make_value)});
+    }
+    // if the pipe is full, the loop already has a wakeup pending
+    const char c = 0;
+    [[maybe_unused]] ssize_t r = write(fds[1], &c, 1);
+  }
+
+  std::deque<Completion> Take() {
+    char buf[64];
+    while (read(fds[0], buf, sizeof(buf)) > 0) {
+    }
+    std::deque<Completion> taken;
+    std::lock_guard<std::mutex> lock(mutex);
+    taken.swap(completions);
+    return taken;
+  }
+
+  int GetReadFd() const { return fds[0]; }
+
+private:
+  int fds[2];
+  std::mutex mutex;
+  std::deque<Completion> completions;
+};
+
+// Hands out asyncio futures and resolves them from the loop's thread.
+class AsyncDispatcher {
+public:
+  explicit AsyncDispatcher(py::object loop_)
+      : loop(std::move(loop_)), queue(std::make_shared<AsyncCompletionQueue>()) {
+    loop.attr("add_reader")(queue->GetReadFd(), py::cpp_function([this] { Drain(); }));
+  }
+
+  void Detach() {
+    if (!loop.attr("is_closed")().cast<bool>())
+      loop.attr("remove_reader")(queue->GetReadFd());
+  }
+
+  // Returns a future along with a callback that completes it from any thread.
+  template <typename T>
+  std::pair<py::object, std::function<void(uint32_t, T)>> MakeFuture() {
+    const uint64_t id = next_id++;
+    py::object future = loop.attr("create_future")();
+    futures[py::int_(id)] = future;
+    return {future, [queue = queue, id](uint32_t r, T value) {
+              auto holder = std::make_shared<T>(std::move(value));
+              queue->Post(id, r, [holder] { return py::cast(std::move(*holder)); });
+            }};
+  }
+
+  std::pair<py::object, std::function<void(uint32_t)>> MakeVoidFuture() {
+    auto [future, complete] = MakeFuture<bool>();
+    return {future, [complete = complete](uint32_t r) { complete(r, true); }};
+  }
+
+  const py::object loop;
+
+private:
+  void Drain() {
+    for (AsyncCompletionQueue::Completion& c : queue->Take()) {
+      py::object future = futures.attr("pop")(py::int_(c.id), py::none());
+      if (future.is_none() || future.attr("cancelled")().cast<bool>())
+        continue;
+      if (c.result != 0) {
+        py::object error =
+            py::module::import("pytwib").attr("ResultError")(ResultError(c.result).what());
+        error.attr("code") = c.result;
+        future.attr("set_exception")(error);
+      } else {
+        future.attr("set_result")(c.make_value());
+      }
+    }
+  }
+
+  std::shared_ptr<AsyncCompletionQueue> queue;
+  py::dict futures;
+  uint64_t next_id = 0;
+};
+
+static AsyncDispatcher& GetDispatcher() {
+  // intentionally leaked so that no Python objects are released during interpreter teardown
+  static AsyncDispatcher* dispatcher = nullptr;
+  py::object loop = py::module::import("asyncio").attr("get_event_loop")();
+  if (dispatcher == nullptr || !dispatcher->loop.is(loop)) {
+    if (dispatcher != nullptr) {
+      dispatcher->Detach();
+      delete dispatcher;
+    }
+    dispatcher = new AsyncDispatcher(loop);
+  }
+  return *dispatcher;
+}
+
 PYBIND11_MODULE(pytwib, m) {
+  py::register_exception<ResultError>(m, "ResultError");
+
+  // Blocking calls release the GIL while waiting for the device. Calls ending in "Async" return
+  // asyncio futures bound to the current event loop. Memory and file reads return Bytes, which
+  // supports the buffer protocol, so memoryview() can view the data without copying it.
+
   // Client
 
   py::class_<tool::client::Client>(m, "Client");
-  m.def("GetClient", [] { return connect_unix(TWIB_UNIX_FRONTEND_DEFAULT_PATH); });
+  m.def("GetClient", &connect_unix, "path"_a = TWIB_UNIX_FRONTEND_DEFAULT_PATH);
 
   // ITwibDeviceInterface
 
   py::class_<tool::ITwibDeviceInterface>(m, "ITwibDeviceInterface")
-      .def("ListProcesses", &tool::ITwibDeviceInterface::ListProcesses)
+      .def("ListProcesses", &tool::ITwibDeviceInterface::ListProcesses,
+           py::call_guard<py::gil_scoped_release>())
       .def("OpenActiveDebugger", &tool::ITwibDeviceInterface::OpenActiveDebugger, "pid"_a,
-           py::keep_alive<0, 1>());
+           py::keep_alive<0, 1>(), py::call_guard<py::gil_scoped_release>())
+      .def("OpenFilesystemAccessor", &tool::ITwibDeviceInterface::OpenFilesystemAccessor,
+           "name"_a, py::keep_alive<0, 1>(), py::call_guard<py::gil_scoped_release>());
 
   py::class_<tool::ProcessListEntry>(m, "ProcessListEntry")
       .def("__repr__",
@@ -60,18 +198,49 @@ PYBIND11_MODULE(pytwib, m) {
 
   m.def(
       "GetDeviceInterface",
-      [](tool::client::Client& client) {
-        tool::ITwibMetaInterface itmi(tool::RemoteObject(client, 0, 0));
-        std::vector<msgpack11::MsgPack> devices = itmi.ListDevices();
-        if (devices.size() != 1) {
-          throw std::logic_error("exactly one device should be connected");
+      [](tool::client::Client& client, std::optional<uint32_t> device_id) {
+        py::gil_scoped_release release;
+        if (!device_id) {
+          tool::ITwibMetaInterface itmi(tool::RemoteObject(client, 0, 0));
+          std::vector<msgpack11::MsgPack> devices = itmi.ListDevices();
+          if (devices.size() != 1) {
+            throw std::logic_error(
+                "exactly one device should be connected; pass device_id or use GetDeviceInterfaces");
+          }
+          device_id = devices[0]["device_id"].uint32_value();
         }
-        const uint32_t device_id = devices[0]["device_id"].uint32_value();
-        tool::ITwibDeviceInterface itdi(std::make_shared<tool::RemoteObject>(client, device_id, 0));
+        tool::ITwibDeviceInterface itdi(std::make_shared<tool::RemoteObject>(client, *device_id, 0));
         return itdi;
       },
-      "client"_a,
-      py::keep_alive<0, 1>());
+      "client"_a, "device_id"_a = py::none(), py::keep_alive<0, 1>());
+
+  // All device interfaces share the client's connection. Since blocking calls release the GIL,
+  // a thread pool can drive many devices concurrently.
+  m.def(
+      "GetDeviceInterfaces",
+      [](py::object client_object) {
+        tool::client::Client& client = client_object.cast<tool::client::Client&>();
+        std::vector<std::pair<uint32_t, tool::ITwibDeviceInterface>> found;
+        {
+          py::gil_scoped_release release;
+          tool::ITwibMetaInterface itmi(tool::RemoteObject(client, 0, 0));
+          for (const msgpack11::MsgPack& device : itmi.ListDevices()) {
+            const uint32_t device_id = device["device_id"].uint32_value();
+            found.emplace_back(device_id, tool::ITwibDeviceInterface(std::make_shared<tool::RemoteObject>(
+                                              client, device_id, 0)));
+          }
+        }
+        // A dict can't be a keep_alive nurse (it isn't weak-referenceable), so each interface
+        // keeps the client alive instead, the same way GetDeviceInterface's result does.
+        py::dict interfaces;
+        for (auto& entry : found) {
+          py::object itdi = py::cast(std::move(entry.second));
+          py::detail::keep_alive_impl(itdi, client_object);
+          interfaces[py::int_(entry.first)] = itdi;
+        }
+        return interfaces;
+      },
+      "client"_a);
 
   // DebugTypes
 
@@ -94,15 +263,71 @@ PYBIND11_MODULE(pytwib, m) {
       .def_readonly("base_addr", &nx::LoadedModuleInfo::base_addr)
       .def_readonly("size", &nx::LoadedModuleInfo::size);
 
+  py::class_<nx::MemoryInfo>(m, "MemoryInfo")
+      .def_readonly("base_addr", &nx::MemoryInfo::base_addr)
+      .def_readonly("size", &nx::MemoryInfo::size)
+      .def_readonly("memory_type", &nx::MemoryInfo::memory_type)
+      .def_readonly("memory_attribute", &nx::MemoryInfo::memory_attribute)
+      .def_readonly("permission", &nx::MemoryInfo::permission);
+
   // ITwibDebugger
 
   py::bind_vector<std::vector<std::uint8_t>>(m, "Bytes", py::buffer_protocol());
   py::class_<tool::ITwibDebugger>(m, "ITwibDebugger")
-      .def("ReadMemory", &tool::ITwibDebugger::ReadMemory, "addr"_a, "size"_a)
-      .def("WriteMemory", &tool::ITwibDebugger::WriteMemory, "addr"_a, "data"_a)
-      .def("GetDebugEvent", &tool::ITwibDebugger::GetDebugEvent)
-      .def("ContinueDebugEvent", &tool::ITwibDebugger::ContinueDebugEvent, "flags"_a, "thread_ids"_a)
-      .def("BreakProcess", &tool::ITwibDebugger::BreakProcess)
-      .def("GetTargetEntry", &tool::ITwibDebugger::GetTargetEntry)
-      .def("GetNsoInfos", &tool::ITwibDebugger::GetNsoInfos);
+      .def("ReadMemory", &tool::ITwibDebugger::ReadMemory, "addr"_a, "size"_a,
+           py::call_guard<py::gil_scoped_release>())
+      .def("ReadMemoryAsync",
+           [](tool::ITwibDebugger& self, uint64_t addr, uint64_t size) {
+             auto [future, complete] = GetDispatcher().MakeFuture<std::vector<uint8_t>>();
+             self.AsyncReadMemory(addr, size, std::move(complete));
+             return future;
+           },
+           "addr"_a, "size"_a)
+      .def("WriteMemory", &tool::ITwibDebugger::WriteMemory, "addr"_a, "data"_a,
+           py::call_guard<py::gil_scoped_release>())
+      .def("GetDebugEvent", &tool::ITwibDebugger::GetDebugEvent,
+           py::call_guard<py::gil_scoped_release>())
+      .def("GetDebugEvents", &tool::ITwibDebugger::GetDebugEvents,
+           py::call_guard<py::gil_scoped_release>())
+      .def("ContinueDebugEvent", &tool::ITwibDebugger::ContinueDebugEvent, "flags"_a,
+           "thread_ids"_a, py::call_guard<py::gil_scoped_release>())
+      .def("BreakProcess", &tool::ITwibDebugger::BreakProcess,
+           py::call_guard<py::gil_scoped_release>())
+      .def("WaitEventAsync",
+           [](tool::ITwibDebugger& self) {
+             auto [future, complete] = GetDispatcher().MakeVoidFuture();
+             self.AsyncWait(std::move(complete));
+             return future;
+           })
+      .def("GetTargetEntry", &tool::ITwibDebugger::GetTargetEntry,
+           py::call_guard<py::gil_scoped_release>())
+      .def("GetNsoInfos", &tool::ITwibDebugger::GetNsoInfos,
+           py::call_guard<py::gil_scoped_release>())
+      .def("QueryMemoryMap", &tool::ITwibDebugger::QueryMemoryMap,
+           py::call_guard<py::gil_scoped_release>());
+
+  // Filesystem
+
+  py::class_<tool::ITwibFilesystemAccessor>(m, "ITwibFilesystemAccessor")
+      .def("IsFile", &tool::ITwibFilesystemAccessor::IsFile, "path"_a,
+           py::call_guard<py::gil_scoped_release>())
+      .def("OpenFile", &tool::ITwibFilesystemAccessor::OpenFile, "mode"_a, "path"_a,
+           py::keep_alive<0, 1>(), py::call_guard<py::gil_scoped_release>());
+
+  py::class_<tool::ITwibFileAccessor>(m, "ITwibFileAccessor")
+      .def("Read", &tool::ITwibFileAccessor::Read, "offset"_a, "size"_a,
+           py::call_guard<py::gil_scoped_release>())
+      .def("ReadStream", &tool::ITwibFileAccessor::ReadStream, "offset"_a, "size"_a,
+           py::call_guard<py::gil_scoped_release>())
+      .def("ReadAsync",
+           [](tool::ITwibFileAccessor& self, uint64_t offset, uint64_t size) {
+             auto [future, complete] = GetDispatcher().MakeFuture<std::vector<uint8_t>>();
+             self.AsyncRead(offset, size, std::move(complete));
+             return future;
+           },
+           "offset"_a, "size"_a)
+      .def("GetSize", &tool::ITwibFileAccessor::GetSize,
+           py::call_guard<py::gil_scoped_release>())
+      .def("Hash", &tool::ITwibFileAccessor::Hash, "algorithm"_a, "offset"_a, "size"_a,
+           "block_size"_a, py::call_guard<py::gil_scoped_release>());
 }
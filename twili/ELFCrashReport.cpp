@@ -23,6 +23,7 @@
 #include<libtransistor/cpp/svc.hpp>
 #include<libtransistor/util.h>
 
+#include<algorithm>
 #include<vector>
 #include<string>
 
@@ -60,11 +61,9 @@ ELFCrashReport::Thread *ELFCrashReport::GetThread(uint64_t thread_id) {
 	return &threads.find(thread_id)->second;
 }
 
-void ELFCrashReport::Generate(process::Process &process, twili::bridge::ResponseOpener ro) {
-	process.AddNotes(*this);
-	
+void ELFCrashReport::Generate(uint64_t pid, WorkerPool::StreamWriter &r) {
 	trn::KDebug debug = ResultCode::AssertOk(
-		trn::svc::DebugActiveProcess(process.GetPid()));
+		trn::svc::DebugActiveProcess(pid));
 	printf("  opened debug: 0x%x\n", debug.handle);
 
 	while(1) {
@@ -244,7 +243,7 @@ void ELFCrashReport::Generate(process::Process &process, twili::bridge::Response
 	size_t ph_offset = total_size;
 	total_size+= sizeof(ELF::Elf64_Phdr) * (1 + vmas.size());
 
-	bridge::ResponseWriter r = ro.BeginOk(sizeof(uint64_t) + total_size);
+	r.Begin(sizeof(uint64_t) + total_size);
 	r.Write<uint64_t>(total_size);
 	r.Write<ELF::Elf64_Ehdr>({
 			.e_ident = {
@@ -266,14 +265,20 @@ void ELFCrashReport::Generate(process::Process &process, twili::bridge::Response
 		});
 
 	// write VMAs
-	std::vector<uint8_t> transfer_buffer(r.GetMaxTransferSize(), 0);
+	std::vector<uint8_t> transfer_buffer(0x10000, 0);
 	for(auto i = vmas.begin(); i != vmas.end(); i++) {
 		for(size_t offset = 0; offset < i->size; offset+= transfer_buffer.size()) {
 			size_t size = transfer_buffer.size();
 			if(size > i->size - offset) {
 				size = i->size - offset;
 			}
-			ResultCode::AssertOk(trn::svc::ReadDebugProcessMemory(transfer_buffer.data(), debug, i->virtual_addr + offset, size));
+			// the size is already promised, so leave holes in the dump
+			// rather than give up on all of it
+			auto rc = trn::svc::ReadDebugProcessMemory(transfer_buffer.data(), debug, i->virtual_addr + offset, size);
+			if(!rc) {
+				printf("  failed to read 0x%lx bytes at 0x%lx: 0x%x\n", size, i->virtual_addr + offset, rc.error().code);
+				std::fill(transfer_buffer.begin(), transfer_buffer.begin() + size, 0);
+			}
 			r.Write(transfer_buffer.data(), size);
 		}
 	}
@@ -29,7 +29,7 @@
 #include<map>
 
 #include "Elf.hpp"
-#include "bridge/ResponseOpener.hpp"
+#include "WorkerPool.hpp"
 
 namespace twili {
 namespace process {
@@ -75,7 +75,10 @@ class ELFCrashReport {
 		AddNote(name, type, bytes);
 	}
 	
-	void Generate(process::Process &process, bridge::ResponseOpener opener);
+	// Writes a dump of pid along with any notes added beforehand. This does a
+	// lot of reading and writing, so it runs as a streamed WorkerPool job, and
+	// only makes system calls.
+	void Generate(uint64_t pid, WorkerPool::StreamWriter &w);
 	void AddNote(std::string name, uint32_t type, std::vector<uint8_t> desc);
 
 	template<typename T>
@@ -0,0 +1,369 @@
+//
+// Twili - Homebrew debug monitor for the Nintendo Switch
+// Copyright (C) 2019 misson20000 <xenotoad@xenotoad.net>
+//
+// This file is part of Twili.
+//
+// Twili is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Twili is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Twili.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "WorkerPool.hpp"
+
+#include<algorithm>
+#include<mutex>
+
+#include "twili.hpp"
+#include "MutexShim.hpp"
+#include "err.hpp"
+
+using trn::ResultCode;
+using trn::ResultError;
+
+namespace twili {
+
+WorkerPool::WorkerPool(Twili &twili, size_t thread_count) :
+	threads(thread_count),
+	scheduler(64) {
+	finished_signal = twili.event_waiter.AddSignal(
+		[this]() {
+			finished_signal->ResetSignal();
+			
+			std::deque<Job> jobs;
+			{
+				util::MutexShim shim(mutex);
+				std::unique_lock<util::MutexShim> lock(shim);
+				std::swap(jobs, finished_jobs);
+			}
+			for(auto i = streams.begin(); i != streams.end(); ) {
+				if(Pump(**i)) {
+					i = streams.erase(i);
+				} else {
+					i++;
+				}
+			}
+			for(Job &job : jobs) {
+				Complete(job);
+			}
+			return true;
+		});
+
+	for(trn_thread_t &thread : threads) {
+		ResultCode::AssertOk(trn_thread_create(&thread, WorkerPool::ThreadEntryShim, this, -1, -2, 0x8000, nullptr));
+		ResultCode::AssertOk(trn_thread_start(&thread));
+	}
+}
+
+WorkerPool::~WorkerPool() {
+	{
+		util::MutexShim shim(mutex);
+		std::unique_lock<util::MutexShim> lock(shim);
+		destroying = true;
+		trn_condvar_signal(&job_condvar, -1);
+		trn_condvar_signal(&space_condvar, -1);
+	}
+	for(trn_thread_t &thread : threads) {
+		trn_thread_join(&thread, -1);
+		trn_thread_destroy(&thread);
+	}
+}
+
+void WorkerPool::Run(bridge::ResponseOpener opener, std::shared_ptr<void> keep_alive, Work &&work) {
+	Job job {opener, std::move(keep_alive), std::move(work), nullptr};
+	{
+		util::MutexShim shim(mutex);
+		std::unique_lock<util::MutexShim> lock(shim);
+		if(scheduler.Submit(opener.GetClientId(), std::move(job))) {
+			trn_condvar_signal(&job_condvar, 1);
+			return;
+		}
+	}
+
+	// queue is full; better slow than never
+	Execute(job);
+	Complete(job);
+}
+
+void WorkerPool::RunStream(bridge::ResponseOpener opener, std::shared_ptr<void> keep_alive, StreamWork &&work) {
+	std::unique_ptr<Stream> stream = std::make_unique<Stream>(opener);
+	Stream *stream_ptr = stream.get();
+	Job job {
+		opener, std::move(keep_alive),
+		[this, stream_ptr, work = std::move(work)]() -> Completion {
+			ExecuteStream(*stream_ptr, work);
+			return [](bridge::ResponseOpener &opener) {};
+		},
+		nullptr};
+	{
+		util::MutexShim shim(mutex);
+		std::unique_lock<util::MutexShim> lock(shim);
+		if(scheduler.Submit(opener.GetClientId(), std::move(job))) {
+			streams.push_back(std::move(stream));
+			trn_condvar_signal(&job_condvar, 1);
+			return;
+		}
+	}
+
+	// queue is full; run it here instead, but not while another response is
+	// streaming on the link, since that needs the main loop to finish
+	stream->is_inline = true;
+	std::shared_ptr<Stream> inline_stream(std::move(stream));
+	opener.WhenLinkIdle(
+		[inline_stream, job]() mutable {
+			Execute(job);
+			Complete(job);
+		});
+}
+
+void WorkerPool::ThreadEntryShim(void *arg) {
+	((WorkerPool*) arg)->WorkerThread();
+}
+
+void WorkerPool::WorkerThread() {
+	util::MutexShim shim(mutex);
+	std::unique_lock<util::MutexShim> lock(shim);
+	while(!destroying) {
+		std::optional<Job> job = scheduler.Next();
+		if(!job) {
+			trn_condvar_wait(&job_condvar, &mutex, -1);
+			continue;
+		}
+		
+		lock.unlock();
+		Execute(*job);
+		lock.lock();
+		
+		finished_jobs.push_back(std::move(*job));
+		finished_signal->Signal();
+	}
+}
+
+void WorkerPool::Execute(Job &job) {
+	try {
+		job.completion = job.work();
+	} catch(ResultError &e) {
+		ResultCode code = e.code;
+		job.completion = [code](bridge::ResponseOpener &opener) {
+			opener.RespondError(code);
+		};
+	}
+}
+
+void WorkerPool::Complete(Job &job) {
+	try {
+		job.completion(job.opener);
+	} catch(ResultError &e) {
+		try {
+			job.opener.RespondError(e.code);
+		} catch(ResultError&) {
+			// the response had already begun
+			printf("WorkerPool: dropped error 0x%x while completing a job\n", e.code.code);
+		}
+	}
+}
+
+void WorkerPool::ExecuteStream(Stream &stream, const StreamWork &work) {
+	StreamWriter writer(*this, stream);
+	std::optional<ResultCode> error;
+	try {
+		work(writer);
+	} catch(ResultError &e) {
+		error = e.code;
+	}
+	try {
+		// send whatever was written before any error too
+		writer.Flush();
+	} catch(ResultError &e) {
+		error = error.value_or(e.code);
+	}
+
+	{
+		util::MutexShim shim(mutex);
+		std::unique_lock<util::MutexShim> lock(shim);
+		stream.finished = true;
+		stream.error = error;
+	}
+
+	if(stream.is_inline) {
+		Pump(stream);
+	}
+}
+
+bool WorkerPool::Pump(Stream &stream) {
+	bool begun, finished;
+	std::optional<ResultCode> error;
+	{
+		util::MutexShim shim(mutex);
+		std::unique_lock<util::MutexShim> lock(shim);
+		begun = stream.begun;
+		finished = stream.finished;
+		error = stream.error;
+	}
+
+	if(!stream.writer && !stream.failed) {
+		if(!begun) {
+			if(!finished) {
+				return false;
+			}
+			// work failed before it began the response, so we can still report it
+			try {
+				stream.opener.RespondError(error.value_or(ResultCode(TWILI_ERR_INTERNAL_ERROR)));
+			} catch(ResultError &e) {
+				printf("WorkerPool: failed to report stream error: 0x%x\n", e.code.code);
+			}
+			return true;
+		}
+		if(!stream.waiting_for_link) {
+			stream.waiting_for_link = true;
+			stream.opener.WhenLinkIdle([this, &stream]() { StartStream(stream); });
+		}
+		if(!stream.writer && !stream.failed) {
+			return false;
+		}
+	}
+
+	std::deque<std::vector<uint8_t>> chunks;
+	size_t payload_size;
+	{
+		util::MutexShim shim(mutex);
+		std::unique_lock<util::MutexShim> lock(shim);
+		std::swap(chunks, stream.chunks);
+		finished = stream.finished;
+		error = stream.error;
+		payload_size = stream.payload_size;
+		trn_condvar_signal(&space_condvar, -1);
+	}
+
+	if(stream.failed) {
+		return finished;
+	}
+
+	try {
+		for(std::vector<uint8_t> &chunk : chunks) {
+			stream.writer->Write(chunk.data(), chunk.size());
+			stream.written+= chunk.size();
+		}
+		if(!finished) {
+			return false;
+		}
+		
+		if(stream.written < payload_size) {
+			printf("WorkerPool: stream ended short (0x%x); padding it out\n", error ? error->code : 0);
+			std::vector<uint8_t> zeroes(std::min(payload_size - stream.written, ChunkSize), 0);
+			while(stream.written < payload_size) {
+				size_t size = std::min(payload_size - stream.written, zeroes.size());
+				stream.writer->Write(zeroes.data(), size);
+				stream.written+= size;
+			}
+		}
+		stream.writer->Finalize();
+	} catch(ResultError &e) {
+		printf("WorkerPool: dropped stream: 0x%x\n", e.code.code);
+		CancelStream(stream);
+	}
+	return finished;
+}
+
+void WorkerPool::StartStream(Stream &stream) {
+	stream.waiting_for_link = false;
+	try {
+		size_t payload_size;
+		{
+			util::MutexShim shim(mutex);
+			std::unique_lock<util::MutexShim> lock(shim);
+			payload_size = stream.payload_size;
+		}
+		stream.writer.emplace(stream.opener.BeginStream(payload_size));
+	} catch(ResultError &e) {
+		printf("WorkerPool: failed to begin stream: 0x%x\n", e.code.code);
+		CancelStream(stream);
+	}
+	if(!stream.is_inline) {
+		// this can run from another stream's pump, so come back to send what's queued
+		finished_signal->Signal();
+	}
+}
+
+void WorkerPool::CancelStream(Stream &stream) {
+	stream.failed = true;
+	if(stream.writer) {
+		stream.writer->Abandon();
+	}
+	
+	util::MutexShim shim(mutex);
+	std::unique_lock<util::MutexShim> lock(shim);
+	stream.cancelled = true;
+	stream.chunks.clear();
+	trn_condvar_signal(&space_condvar, -1);
+}
+
+WorkerPool::StreamWriter::StreamWriter(WorkerPool &pool, Stream &stream) : pool(pool), stream(stream) {
+	chunk.reserve(ChunkSize);
+}
+
+void WorkerPool::StreamWriter::Begin(size_t payload_size) {
+	util::MutexShim shim(pool.mutex);
+	std::unique_lock<util::MutexShim> lock(shim);
+	if(stream.begun) {
+		throw ResultError(TWILI_ERR_FATAL_BRIDGE_STATE);
+	}
+	stream.begun = true;
+	stream.payload_size = payload_size;
+}
+
+void WorkerPool::StreamWriter::Write(const uint8_t *data, size_t size) {
+	while(size > 0) {
+		size_t count = std::min(size, ChunkSize - chunk.size());
+		chunk.insert(chunk.end(), data, data + count);
+		data+= count;
+		size-= count;
+		if(chunk.size() == ChunkSize) {
+			Flush();
+		}
+	}
+}
+
+void WorkerPool::StreamWriter::Flush() {
+	if(chunk.empty()) {
+		return;
+	}
+	
+	{
+		util::MutexShim shim(pool.mutex);
+		std::unique_lock<util::MutexShim> lock(shim);
+		if(!stream.begun) {
+			throw ResultError(TWILI_ERR_FATAL_BRIDGE_STATE);
+		}
+		while(!stream.is_inline && stream.chunks.size() >= MaxQueuedChunks && !stream.cancelled && !pool.destroying) {
+			trn_condvar_wait(&pool.space_condvar, &pool.mutex, -1);
+		}
+		if(stream.cancelled || pool.destroying) {
+			throw ResultError(TWILI_ERR_INTERRUPTED);
+		}
+		stream.chunks.push_back(std::move(chunk));
+		if(!stream.is_inline) {
+			pool.finished_signal->Signal();
+		}
+	}
+	chunk = std::vector<uint8_t>();
+	chunk.reserve(ChunkSize);
+
+	if(stream.is_inline) {
+		pool.Pump(stream);
+		if(stream.failed) {
+			throw ResultError(TWILI_ERR_INTERRUPTED);
+		}
+	}
+}
+
+} // namespace twili
@@ -0,0 +1,164 @@
+//
+// Twili - Homebrew debug monitor for the Nintendo Switch
+// Copyright (C) 2019 misson20000 <xenotoad@xenotoad.net>
+//
+// This file is part of Twili.
+//
+// Twili is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Twili is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Twili.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#pragma once
+
+#include<libtransistor/cpp/waiter.hpp>
+#include<libtransistor/thread.h>
+#include<libtransistor/condvar.h>
+#include<libtransistor/mutex.h>
+
+#include<deque>
+#include<functional>
+#include<list>
+#include<memory>
+#include<optional>
+#include<type_traits>
+#include<vector>
+
+#include "JobScheduler.hpp"
+#include "bridge/ResponseOpener.hpp"
+
+namespace twili {
+
+class Twili;
+
+// Runs slow request handlers, like hashing a whole file, on a few worker
+// threads so that the main loop can keep serving other requests meanwhile.
+// Workers never touch the bridge. Each job hands back a completion, which
+// runs on the main loop and sends the response from there. Jobs are only
+// moved around off the main loop, never copied or destroyed, so reference
+// counts are only touched from the main loop. Work shouldn't capture
+// shared_ptrs either; pass the handler's object as keep_alive and capture it
+// by plain pointer instead.
+//
+// Responses too big to build in memory, like coredumps, are streamed: the
+// worker writes chunks as it goes, and the main loop sends each one as it
+// comes in, between serving other requests. Responses to other requests on
+// the same link are held back until the stream is finished, up to a limit
+// (see bridge::detail::ResponseLink).
+class WorkerPool {
+	struct Stream;
+ public:
+	using Completion = std::function<void(bridge::ResponseOpener &opener)>;
+	using Work = std::function<Completion()>;
+
+	class StreamWriter {
+	 public:
+		// Starts the response. If work throws before this, the request fails
+		// with that error instead. Errors after this can't be reported, so the
+		// rest of the response is padded out with zeroes.
+		void Begin(size_t payload_size);
+		// blocks while the main loop is behind on sending earlier chunks
+		void Write(const uint8_t *data, size_t size);
+		
+		template<typename T>
+		void Write(const std::vector<T> &data) {
+			static_assert(std::is_standard_layout<T>::value, "T must be standard layout");
+			Write((const uint8_t*) data.data(), data.size() * sizeof(T));
+		}
+		
+		template<typename T>
+		void Write(T data) {
+			static_assert(std::is_standard_layout<T>::value, "T must be standard layout");
+			Write((const uint8_t*) &data, sizeof(data));
+		}
+	 private:
+		friend class WorkerPool;
+		StreamWriter(WorkerPool &pool, Stream &stream);
+		void Flush();
+		
+		WorkerPool &pool;
+		Stream &stream;
+		std::vector<uint8_t> chunk;
+	};
+	using StreamWork = std::function<void(StreamWriter &writer)>;
+	
+	WorkerPool(Twili &twili, size_t thread_count = 2);
+	~WorkerPool();
+
+	// Runs work on a worker thread, then the completion it returns on the
+	// main loop. If work throws a ResultError, the request fails with that
+	// instead. If too much is queued already, work runs right away. keep_alive
+	// is held until the completion has run.
+	void Run(bridge::ResponseOpener opener, std::shared_ptr<void> keep_alive, Work &&work);
+	// Runs work on a worker thread, sending what it writes as the response.
+	// Queued like Run, but if the queue is full, work runs on the main loop
+	// once nothing else is streaming on the link.
+	void RunStream(bridge::ResponseOpener opener, std::shared_ptr<void> keep_alive, StreamWork &&work);
+	
+ private:
+	static constexpr size_t ChunkSize = 0x10000;
+	static constexpr size_t MaxQueuedChunks = 4;
+	
+	struct Job {
+		bridge::ResponseOpener opener;
+		std::shared_ptr<void> keep_alive;
+		Work work;
+		Completion completion;
+	};
+
+	struct Stream {
+		Stream(bridge::ResponseOpener opener) : opener(opener) {}
+		
+		// only touched on the main loop
+		bridge::ResponseOpener opener;
+		std::optional<bridge::ResponseWriter> writer;
+		bool waiting_for_link = false;
+		bool failed = false;
+		bool is_inline = false;
+		size_t written = 0;
+
+		// guarded by the pool's mutex
+		bool begun = false;
+		size_t payload_size = 0;
+		std::deque<std::vector<uint8_t>> chunks;
+		bool finished = false;
+		bool cancelled = false;
+		std::optional<trn::ResultCode> error;
+	};
+
+	static void ThreadEntryShim(void *arg);
+	void WorkerThread();
+	static void Execute(Job &job);
+	static void Complete(Job &job);
+	void ExecuteStream(Stream &stream, const StreamWork &work);
+	// sends what a stream has produced so far; true once it's over
+	bool Pump(Stream &stream);
+	void StartStream(Stream &stream);
+	void CancelStream(Stream &stream);
+
+	std::vector<trn_thread_t> threads;
+	bool destroying = false;
+	
+	trn_mutex_t mutex = TRN_MUTEX_STATIC_INITIALIZER;
+	trn_condvar_t job_condvar = TRN_CONDVAR_STATIC_INITIALIZER;
+	trn_condvar_t space_condvar = TRN_CONDVAR_STATIC_INITIALIZER;
+	util::JobScheduler<Job> scheduler;
+	// jobs are destroyed on the main loop too, since they can hold the last
+	// references to bridge objects
+	std::deque<Job> finished_jobs;
+	// only touched on the main loop
+	std::list<std::unique_ptr<Stream>> streams;
+	// wakes the main loop when jobs finish or streams have chunks to send
+	std::shared_ptr<trn::WaitHandle> finished_signal;
+};
+
+} // namespace twili
@@ -20,6 +20,8 @@
 
 #include "ResponseOpener.hpp"
 
+#include<algorithm>
+
 #include "err.hpp"
 
 namespace twili {
@@ -49,7 +51,16 @@ ResponseWriter ResponseOpener::BeginError(ResultCode code, size_t payload_size,
 	state->total_size = payload_size;
 	state->object_count = object_count;
 
-	state->SendHeader(hdr);
+	detail::ResponseLink &link = state->GetLink();
+	if(link.IsStreaming()) {
+		state->is_held = true;
+		state->held_header = hdr;
+		if(payload_size > detail::ResponseLink::MaxHeldBytes - std::min(link.held_bytes, detail::ResponseLink::MaxHeldBytes)) {
+			state->Refuse();
+		}
+	} else {
+		state->SendHeader(hdr);
+	}
 
 	ResponseWriter writer(state);
 	return writer;
@@ -59,9 +70,39 @@ ResponseWriter ResponseOpener::BeginOk(size_t payload_size, uint32_t object_coun
 	return BeginError(ResultCode(0), payload_size, object_count);
 }
 
+ResponseWriter ResponseOpener::BeginStream(size_t payload_size) const {
+	if(state->GetLink().IsStreaming()) {
+		throw ResultError(TWILI_ERR_FATAL_BRIDGE_STATE);
+	}
+	ResponseWriter w = BeginOk(payload_size);
+	state->GetLink().BeginStream();
+	state->is_stream = true;
+	return w;
+}
+
+void ResponseOpener::WhenLinkIdle(std::function<void()> &&fn) const {
+	state->GetLink().WhenIdle(std::move(fn));
+}
+
 void ResponseOpener::RespondError(ResultCode code) const {
 	BeginError(code).Finalize();
 }
 
+void ResponseOpener::CloseObject(uint32_t object_id) const {
+	state->CloseObject(object_id);
+}
+
+uint32_t ResponseOpener::GetClientId() const {
+	return state->client_id;
+}
+
+uint64_t ResponseOpener::GetSessionToken() const {
+	return state->GetSessionToken();
+}
+
+bool ResponseOpener::JoinSession(uint64_t token) const {
+	return state->JoinSession(token);
+}
+
 } // namespace bridge
 } // namespace twili
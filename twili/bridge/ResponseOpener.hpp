@@ -22,6 +22,7 @@
 
 #include<libtransistor/cpp/types.hpp>
 
+#include<functional>
 #include<memory>
 #include<type_traits>
 #include<vector>
@@ -39,6 +40,12 @@ class ResponseOpener {
 	ResponseOpener(std::shared_ptr<detail::ResponseState> state);
 	ResponseWriter BeginOk(size_t payload_size=0, uint32_t object_count=0) const;
 	ResponseWriter BeginError(trn::ResultCode code, size_t payload_size=0, uint32_t object_count=0) const;
+	// Begins a response that will be written over several trips through the
+	// main loop. Nothing else is sent on the link until it's finalized or
+	// abandoned. Only call this once the link is idle.
+	ResponseWriter BeginStream(size_t payload_size) const;
+	// runs fn now, or once the response streaming on this request's link ends
+	void WhenLinkIdle(std::function<void()> &&fn) const;
 
 	template<typename... Args>
 	void RespondOk(Args&&... args) const {
@@ -50,6 +57,12 @@ class ResponseOpener {
 	}
 
 	void RespondError(trn::ResultCode code) const;
+	// drops the bridge's reference to another object, as if it had been sent a close request
+	void CloseObject(uint32_t object_id) const;
+	uint64_t GetSessionToken() const;
+	uint32_t GetClientId() const;
+	// moves the connection this request came in on into another session
+	bool JoinSession(uint64_t token) const;
 	
 	template<typename T, typename... Args>
 	std::shared_ptr<T> MakeObject(Args &&... args) const {
@@ -19,6 +19,9 @@
 //
 
 #include "ResponseOpener.hpp"
+#include "Object.hpp"
+
+#include<stdio.h>
 
 #include "err.hpp"
 
@@ -32,7 +35,13 @@ ResponseWriter::ResponseWriter(std::shared_ptr<detail::ResponseState> state) : s
 }
 
 void ResponseWriter::Write(uint8_t *data, size_t size) {
-	state->SendData(data, size);
+	if(state->is_held) {
+		if(!state->is_refused) {
+			state->held_payload.insert(state->held_payload.end(), data, data + size);
+		}
+	} else {
+		state->SendData(data, size);
+	}
 }
 
 void ResponseWriter::Write(std::string str) {
@@ -40,14 +49,103 @@ void ResponseWriter::Write(std::string str) {
 }
 
 uint32_t ResponseWriter::Object(std::shared_ptr<bridge::Object> object) {
+	if(state->is_refused) {
+		// the client will never hear about it
+		state->CloseObject(object->object_id);
+		return 0;
+	}
 	size_t index = state->objects.size();
 	state->objects.push_back(object);
 	return index;
 }
 
 void ResponseWriter::Finalize() {
+	if(state->is_held) {
+		std::shared_ptr<detail::ResponseState> held = state;
+		detail::ResponseLink &link = state->GetLink();
+		size_t held_size = held->held_payload.size();
+		link.held_bytes+= held_size;
+		link.WhenIdle(
+			[held, held_size, &link]() {
+				link.held_bytes-= held_size;
+				try {
+					held->SendHeader(held->held_header);
+					if(!held->held_payload.empty()) {
+						held->SendData(held->held_payload.data(), held->held_payload.size());
+					}
+					held->Finalize();
+				} catch(ResultError &e) {
+					printf("ResponseWriter: failed to send held response: 0x%x\n", e.code.code);
+				}
+				held->held_payload.clear();
+			});
+		return;
+	}
+	
+	if(state->is_stream) {
+		try {
+			state->Finalize();
+		} catch(ResultError &e) {
+			Abandon();
+			throw;
+		}
+		Abandon();
+		return;
+	}
+	
 	state->Finalize();
 }
 
+void ResponseWriter::Abandon() {
+	if(state->is_stream) {
+		state->is_stream = false;
+		state->GetLink().EndStream();
+	}
+}
+
+namespace detail {
+
+void ResponseState::Refuse() {
+	printf("ResponseWriter: too much held back behind a stream, refusing response\n");
+	is_refused = true;
+	held_header.result_code = TWILI_ERR_LINK_BUSY;
+	held_header.payload_size = 0;
+	held_header.object_count = 0;
+	total_size = 0;
+	object_count = 0;
+	held_payload.clear();
+	held_payload.shrink_to_fit();
+	for(auto &object : objects) {
+		CloseObject(object->object_id);
+	}
+	objects.clear();
+}
+
+void ResponseLink::WhenIdle(std::function<void()> &&fn) {
+	if(streaming) {
+		waiting.push_back(std::move(fn));
+	} else {
+		fn();
+	}
+}
+
+void ResponseLink::BeginStream() {
+	if(streaming) {
+		throw ResultError(TWILI_ERR_FATAL_BRIDGE_STATE);
+	}
+	streaming = true;
+}
+
+void ResponseLink::EndStream() {
+	streaming = false;
+	while(!streaming && !waiting.empty()) {
+		std::function<void()> fn = std::move(waiting.front());
+		waiting.pop_front();
+		fn();
+	}
+}
+
+} // namespace detail
+
 } // namespace bridge
 } // namespace twili
@@ -22,6 +22,8 @@
 
 #include<libtransistor/cpp/types.hpp>
 
+#include<deque>
+#include<functional>
 #include<memory>
 #include<type_traits>
 #include<vector>
@@ -37,6 +39,29 @@ class Object;
 
 namespace detail {
 
+// A link (the USB interface, or one TCP connection) can only carry one
+// response at a time. Streamed responses are written over several trips
+// through the main loop, so while one is in progress, anything else that
+// wants the link waits here until it's finished.
+class ResponseLink {
+ public:
+	// how much response payload may wait for a stream to end before further
+	// responses are replaced with TWILI_ERR_LINK_BUSY
+	static constexpr size_t MaxHeldBytes = 0x100000;
+	
+	inline bool IsStreaming() const { return streaming; }
+	// runs fn now if the link is free, or else once the current stream ends
+	void WhenIdle(std::function<void()> &&fn);
+	void BeginStream();
+	// runs waiting functions until one of them begins another stream
+	void EndStream();
+
+	size_t held_bytes = 0;
+ private:
+	bool streaming = false;
+	std::deque<std::function<void()>> waiting;
+};
+
 class ResponseState {
  public:
 	inline ResponseState(uint32_t client_id, uint32_t tag) : client_id(client_id), tag(tag) {}
@@ -46,6 +71,15 @@ class ResponseState {
 	virtual void Finalize() = 0;
 	virtual uint32_t ReserveObjectId() = 0;
 	virtual void InsertObject(std::pair<uint32_t, std::shared_ptr<Object>> &&pair) = 0;
+	virtual void CloseObject(uint32_t object_id) = 0;
+	// Bridges that can spread one client's requests over several connections
+	// put each connection in a session, and connections in the same session
+	// share objects. A token of 0 means the bridge doesn't support this.
+	virtual uint64_t GetSessionToken() { return 0; }
+	virtual bool JoinSession(uint64_t token) { return false; }
+	virtual ResponseLink &GetLink() = 0;
+	// turns a held response into a TWILI_ERR_LINK_BUSY error
+	void Refuse();
 
 	const uint32_t client_id;
 	const uint32_t tag;
@@ -55,6 +89,15 @@ class ResponseState {
 	size_t total_size = 0;
 	uint32_t object_count = 0;
 	bool has_begun = false;
+	bool is_stream = false;
+
+	// responses begun while another one is streaming on the link are
+	// buffered here until it's done, or turned into an error if that would
+	// hold more than the link allows
+	bool is_held = false;
+	bool is_refused = false;
+	protocol::MessageHeader held_header;
+	std::vector<uint8_t> held_payload;
 };
 
 } // namespace detail
@@ -82,6 +125,9 @@ class ResponseWriter {
 	uint32_t Object(std::shared_ptr<bridge::Object> object);
 
 	void Finalize();
+	// gives up on a streamed response that can't be finished, so that other
+	// responses on the link don't wait on it forever
+	void Abandon();
  private:
 	std::shared_ptr<detail::ResponseState> state;
 };
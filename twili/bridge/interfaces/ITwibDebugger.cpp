@@ -23,6 +23,9 @@
 #include<libtransistor/cpp/svc.hpp>
 
 #include "err.hpp"
+#include "PatternSearch.hpp"
+#include "PageHash.hpp"
+#include "ITwibMemoryWatch.hpp"
 #include "../../twili.hpp"
 #include "../../process/MonitoredProcess.hpp"
 
@@ -46,6 +49,49 @@ void ITwibDebugger::QueryMemory(bridge::ResponseOpener opener, uint64_t addr) {
 		std::move(std::get<1>(info)));
 }
 
+void ITwibDebugger::QueryMemoryMap(bridge::ResponseOpener opener) {
+	std::vector<memory_info_t> regions;
+	uint64_t vaddr = 0;
+	do {
+		std::tuple<memory_info_t, uint32_t> r = ResultCode::AssertOk(
+			trn::svc::QueryDebugProcessMemory(debug, vaddr));
+		memory_info_t mi = std::get<0>(r);
+		regions.push_back(mi);
+		vaddr = ((uint64_t) mi.base_addr) + mi.size;
+	} while(vaddr > 0);
+
+	opener.RespondOk(std::move(regions));
+}
+
+void ITwibDebugger::CreateMemoryWatch(bridge::ResponseOpener opener, uint64_t interval_ns, std::vector<protocol::ITwibMemoryWatch::Range> ranges) {
+	// keep the sampling timer from starving everything else
+	const uint64_t min_interval_ns = 1000000;
+	// an hour; also keeps the conversion to ticks from overflowing
+	const uint64_t max_interval_ns = 3600ull * 1000000000ull;
+	const uint64_t max_watched_bytes = 0x10000;
+
+	uint64_t total_size = 0;
+	for(auto &range : ranges) {
+		if(range.size == 0 || range.address + range.size < range.address) {
+			throw ResultError(TWILI_ERR_PROTOCOL_BAD_REQUEST);
+		}
+		// check each range on its own first so that the sum can't wrap
+		if(range.size > max_watched_bytes) {
+			throw ResultError(TWILI_ERR_PROTOCOL_BAD_REQUEST);
+		}
+		total_size+= range.size;
+		if(total_size > max_watched_bytes) {
+			throw ResultError(TWILI_ERR_PROTOCOL_BAD_REQUEST);
+		}
+	}
+	if(ranges.empty() || interval_ns < min_interval_ns || interval_ns > max_interval_ns) {
+		throw ResultError(TWILI_ERR_PROTOCOL_BAD_REQUEST);
+	}
+
+	uint64_t interval_ticks = interval_ns * (ITwibMemoryWatch::TicksPerSecond / 1000) / 1000000;
+	opener.RespondOk(opener.MakeObject<ITwibMemoryWatch>(twili, shared_from_this(), std::move(ranges), interval_ticks));
+}
+
 void ITwibDebugger::ReadMemory(bridge::ResponseOpener opener, uint64_t addr, uint64_t size) {
 	std::vector<uint8_t> buffer(size);
 	ResultCode::AssertOk(
@@ -86,6 +132,25 @@ void ITwibDebugger::GetDebugEvent(bridge::ResponseOpener opener) {
 	opener.RespondOk(std::move(event));
 }
 
+void ITwibDebugger::GetDebugEvents(bridge::ResponseOpener opener) {
+	const size_t max_events = 256;
+	
+	std::vector<debug_event_info_t> events;
+	while(events.size() < max_events) {
+		auto r = trn::svc::GetDebugEvent(debug);
+		if(!r) {
+			// an empty list means there are no events pending
+			if(r.error().code == 0x8c01 || !events.empty()) {
+				break;
+			}
+			throw ResultError(r.error());
+		}
+		events.push_back(*r);
+	}
+
+	opener.RespondOk(std::move(events));
+}
+
 void ITwibDebugger::GetThreadContext(bridge::ResponseOpener opener, uint64_t thread_id) {
 	thread_context_t context = ResultCode::AssertOk(
 		trn::svc::GetDebugThreadContext(debug, thread_id, 15));
@@ -205,5 +270,87 @@ void ITwibDebugger::GetNroInfos(bridge::ResponseOpener opener) {
 	opener.RespondOk(std::move(nro_info));
 }
 
+void ITwibDebugger::SearchMemory(bridge::ResponseOpener opener, uint64_t address, uint64_t size, std::vector<uint8_t> pattern, std::vector<uint8_t> mask, uint64_t alignment, uint32_t max_results) {
+	util::PatternMatcher matcher(std::move(pattern), std::move(mask), alignment);
+	if(!matcher.IsValid() || address + size < address) {
+		throw ResultError(TWILI_ERR_BAD_REQUEST);
+	}
+
+	if(max_results == 0 || max_results > protocol::ITwibDebugger::SEARCH_MEMORY_MAX_RESULTS) {
+		max_results = protocol::ITwibDebugger::SEARCH_MEMORY_MAX_RESULTS;
+	}
+
+	const size_t chunk_size = 0x10000;
+	std::vector<uint64_t> matches;
+	util::PatternScanner scanner(matcher, matches, max_results);
+
+	uint64_t end = address + size;
+	uint64_t addr = address;
+	bool full = false;
+	while(addr < end && !full) {
+		memory_info_t mi = std::get<0>(
+			ResultCode::AssertOk(
+				trn::svc::QueryDebugProcessMemory(debug, addr)));
+		uint64_t region_end = std::min(end, (uint64_t) mi.base_addr + mi.size);
+		if(region_end <= addr) { // wrapped around the end of the address space
+			break;
+		}
+
+		// skip unmapped and unreadable regions. a match can span adjacent
+		// readable regions, but not a gap.
+		if(mi.memory_type != 0 && (mi.permission & 1)) {
+			for(uint64_t chunk = addr; chunk < region_end && !full; chunk+= chunk_size) {
+				size_t read_size = std::min(region_end - chunk, (uint64_t) chunk_size);
+				ResultCode::AssertOk(
+					trn::svc::ReadDebugProcessMemory(scanner.Prepare(chunk, read_size), debug, chunk, read_size));
+				full = scanner.Commit();
+			}
+		}
+		
+		addr = region_end;
+	}
+
+	opener.RespondOk(std::move(matches));
+}
+
+void ITwibDebugger::HashPages(bridge::ResponseOpener opener, uint64_t address, uint64_t size) {
+	const size_t page_size = util::PAGE_HASH_PAGE_SIZE;
+	if(address % page_size != 0 || size % page_size != 0 || address + size < address) {
+		throw ResultError(TWILI_ERR_BAD_REQUEST);
+	}
+	size = std::min(size, protocol::ITwibDebugger::HASH_PAGES_MAX_SIZE);
+
+	std::vector<uint64_t> hashes(size / page_size, util::PAGE_HASH_UNREADABLE);
+	std::vector<uint8_t> buffer(0x10000);
+
+	uint64_t end = address + size;
+	uint64_t addr = address;
+	while(addr < end) {
+		memory_info_t mi = std::get<0>(
+			ResultCode::AssertOk(
+				trn::svc::QueryDebugProcessMemory(debug, addr)));
+		uint64_t region_end = std::min(end, (uint64_t) mi.base_addr + mi.size);
+		if(region_end <= addr) { // wrapped around the end of the address space
+			break;
+		}
+
+		// pages in unmapped or unreadable regions keep PAGE_HASH_UNREADABLE
+		if(mi.memory_type != 0 && (mi.permission & 1)) {
+			for(uint64_t chunk = addr; chunk < region_end; chunk+= buffer.size()) {
+				size_t read_size = std::min(region_end - chunk, (uint64_t) buffer.size());
+				ResultCode::AssertOk(
+					trn::svc::ReadDebugProcessMemory(buffer.data(), debug, chunk, read_size));
+				for(size_t offset = 0; offset < read_size; offset+= page_size) {
+					hashes[(chunk + offset - address) / page_size] = util::HashPage(buffer.data() + offset, page_size);
+				}
+			}
+		}
+
+		addr = region_end;
+	}
+
+	opener.RespondOk(std::move(hashes));
+}
+
 } // namespace bridge
 } // namespace twili
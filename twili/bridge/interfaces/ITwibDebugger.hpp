@@ -20,6 +20,8 @@
 
 #pragma once
 
+#include<memory>
+
 #include<libtransistor/cpp/types.hpp>
 #include<libtransistor/cpp/waiter.hpp>
 
@@ -39,13 +41,15 @@ class MonitoredProcess;
 
 namespace bridge {
 
-class ITwibDebugger : public ObjectDispatcherProxy<ITwibDebugger> {
+class ITwibDebugger : public ObjectDispatcherProxy<ITwibDebugger>, public std::enable_shared_from_this<ITwibDebugger> {
  public:
 	ITwibDebugger(uint32_t object_id, Twili &twili, trn::KDebug &&debug, std::shared_ptr<process::MonitoredProcess> proc);
 
 	using CommandID = protocol::ITwibDebugger::Command;
 	
  private:
+	friend class ITwibMemoryWatch;
+	
 	Twili &twili;
 	trn::KDebug debug;
 	std::shared_ptr<trn::WaitHandle> wait_handle;
@@ -56,6 +60,7 @@ class ITwibDebugger : public ObjectDispatcherProxy<ITwibDebugger> {
 	void WriteMemory(bridge::ResponseOpener opener, uint64_t address, InputStream &data);
 	void ListThreads(bridge::ResponseOpener opener);
 	void GetDebugEvent(bridge::ResponseOpener opener);
+	void GetDebugEvents(bridge::ResponseOpener opener);
 	void GetThreadContext(bridge::ResponseOpener opener, uint64_t thread_id);
 	void BreakProcess(bridge::ResponseOpener opener);
 	void ContinueDebugEvent(bridge::ResponseOpener opener, uint32_t flags, std::vector<uint64_t> thread_ids);
@@ -65,6 +70,10 @@ class ITwibDebugger : public ObjectDispatcherProxy<ITwibDebugger> {
 	void GetTargetEntry(bridge::ResponseOpener opener);
 	void LaunchDebugProcess(bridge::ResponseOpener opener);
 	void GetNroInfos(bridge::ResponseOpener opener);
+	void SearchMemory(bridge::ResponseOpener opener, uint64_t address, uint64_t size, std::vector<uint8_t> pattern, std::vector<uint8_t> mask, uint64_t alignment, uint32_t max_results);
+	void HashPages(bridge::ResponseOpener opener, uint64_t address, uint64_t size);
+	void QueryMemoryMap(bridge::ResponseOpener opener);
+	void CreateMemoryWatch(bridge::ResponseOpener opener, uint64_t interval_ns, std::vector<protocol::ITwibMemoryWatch::Range> ranges);
 
  public:
 	SmartRequestDispatcher<
@@ -82,7 +91,12 @@ class ITwibDebugger : public ObjectDispatcherProxy<ITwibDebugger> {
 		SmartCommand<CommandID::WAIT_EVENT, &ITwibDebugger::WaitEvent>,
 		SmartCommand<CommandID::GET_TARGET_ENTRY, &ITwibDebugger::GetTargetEntry>,
 		SmartCommand<CommandID::LAUNCH_DEBUG_PROCESS, &ITwibDebugger::LaunchDebugProcess>,
-		SmartCommand<CommandID::GET_NRO_INFOS, &ITwibDebugger::GetNroInfos>
+		SmartCommand<CommandID::GET_NRO_INFOS, &ITwibDebugger::GetNroInfos>,
+		SmartCommand<CommandID::SEARCH_MEMORY, &ITwibDebugger::SearchMemory>,
+		SmartCommand<CommandID::HASH_PAGES, &ITwibDebugger::HashPages>,
+		SmartCommand<CommandID::GET_DEBUG_EVENTS, &ITwibDebugger::GetDebugEvents>,
+		SmartCommand<CommandID::QUERY_MEMORY_MAP, &ITwibDebugger::QueryMemoryMap>,
+		SmartCommand<CommandID::CREATE_MEMORY_WATCH, &ITwibDebugger::CreateMemoryWatch>
 		> dispatcher;
 };
 
@@ -75,8 +75,13 @@ void ITwibDeviceInterface::Reboot(bridge::ResponseOpener opener) {
 
 void ITwibDeviceInterface::CoreDump(bridge::ResponseOpener opener, uint64_t pid) {
 	std::shared_ptr<process::Process> proc = twili.FindProcess(pid);
-	ELFCrashReport report;
-	report.Generate(*proc, opener);
+	std::shared_ptr<ELFCrashReport> report = std::make_shared<ELFCrashReport>();
+	proc->AddNotes(*report);
+	
+	ELFCrashReport *report_ptr = report.get();
+	twili.workers.RunStream(opener, report, [report_ptr, pid](WorkerPool::StreamWriter &w) {
+		report_ptr->Generate(pid, w);
+	});
 }
 
 void ITwibDeviceInterface::Terminate(bridge::ResponseOpener opener, uint64_t pid) {
@@ -192,7 +197,8 @@ void ITwibDeviceInterface::Identify(bridge::ResponseOpener opener) {
 		{"bluetooth_bd_address", bluetooth_bd_address},
 		{"wireless_lan_mac_address", wireless_lan_mac_address},
 		{"device_nickname", std::string((char*) device_nickname.data())},
-		{"mii_author_id", mii_author_id}
+		{"mii_author_id", mii_author_id},
+		{"session_token", opener.GetSessionToken()}
 	};
 
 	opener.RespondOk(std::move(ident));
@@ -292,7 +298,7 @@ void ITwibDeviceInterface::OpenFilesystemAccessor(bridge::ResponseOpener opener,
 		return;
 	}
 	
-	opener.RespondOk(opener.MakeObject<ITwibFilesystemAccessor>(ifs));
+	opener.RespondOk(opener.MakeObject<ITwibFilesystemAccessor>(ifs, twili.workers));
 }
 
 void ITwibDeviceInterface::WaitToDebugApplication(bridge::ResponseOpener opener) {
@@ -379,5 +385,21 @@ void ITwibDeviceInterface::WaitToDebugTitle(bridge::ResponseOpener opener, uint6
 		});
 }
 
+void ITwibDeviceInterface::CloseObjects(bridge::ResponseOpener opener, std::vector<uint32_t> object_ids) {
+	for(uint32_t id : object_ids) {
+		if(id != 0) { // object 0 is us
+			opener.CloseObject(id);
+		}
+	}
+	opener.RespondOk();
+}
+
+void ITwibDeviceInterface::JoinSession(bridge::ResponseOpener opener, uint64_t token) {
+	if(!opener.JoinSession(token)) {
+		throw ResultError(TWILI_ERR_PROTOCOL_BAD_REQUEST);
+	}
+	opener.RespondOk();
+}
+
 } // namespace bridge
 } // namespace twili
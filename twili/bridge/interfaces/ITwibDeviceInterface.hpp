@@ -55,6 +55,8 @@ class ITwibDeviceInterface : public ObjectDispatcherProxy<ITwibDeviceInterface>
 	void OpenFilesystemAccessor(bridge::ResponseOpener opener, std::string fs);
 	void WaitToDebugApplication(bridge::ResponseOpener opener);
 	void WaitToDebugTitle(bridge::ResponseOpener opener, uint64_t tid);
+	void CloseObjects(bridge::ResponseOpener opener, std::vector<uint32_t> object_ids);
+	void JoinSession(bridge::ResponseOpener opener, uint64_t token);
 
  public:
 	SmartRequestDispatcher<
@@ -74,7 +76,9 @@ class ITwibDeviceInterface : public ObjectDispatcherProxy<ITwibDeviceInterface>
 		SmartCommand<CommandID::LAUNCH_UNMONITORED_PROCESS, &ITwibDeviceInterface::LaunchUnmonitoredProcess>,
 		SmartCommand<CommandID::OPEN_FILESYSTEM_ACCESSOR, &ITwibDeviceInterface::OpenFilesystemAccessor>,
 		SmartCommand<CommandID::WAIT_TO_DEBUG_APPLICATION, &ITwibDeviceInterface::WaitToDebugApplication>,
-		SmartCommand<CommandID::WAIT_TO_DEBUG_TITLE, &ITwibDeviceInterface::WaitToDebugTitle>
+		SmartCommand<CommandID::WAIT_TO_DEBUG_TITLE, &ITwibDeviceInterface::WaitToDebugTitle>,
+		SmartCommand<CommandID::CLOSE_OBJECTS, &ITwibDeviceInterface::CloseObjects>,
+		SmartCommand<CommandID::JOIN_SESSION, &ITwibDeviceInterface::JoinSession>
 		> dispatcher;
 
 	trn::KEvent ev_debug_application;
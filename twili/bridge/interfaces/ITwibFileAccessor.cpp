@@ -23,15 +23,19 @@
 #include<libtransistor/cpp/svc.hpp>
 
 #include "err.hpp"
+#include "Hash.hpp"
+#include "../../MutexShim.hpp"
 
+#include<algorithm>
 #include<cstring>
+#include<mutex>
 
 using namespace trn;
 
 namespace twili {
 namespace bridge {
 
-ITwibFileAccessor::ITwibFileAccessor(uint32_t object_id, ifile_t ifile) : ObjectDispatcherProxy(*this, object_id), ifile(ifile), dispatcher(*this) {
+ITwibFileAccessor::ITwibFileAccessor(uint32_t object_id, ifile_t ifile, WorkerPool &workers) : ObjectDispatcherProxy(*this, object_id), ifile(ifile), workers(workers), dispatcher(*this) {
 	
 }
 
@@ -39,16 +43,81 @@ ITwibFileAccessor::~ITwibFileAccessor() {
 	ipc_close(ifile);
 }
 
-void ITwibFileAccessor::Read(bridge::ResponseOpener opener, uint64_t offset, uint64_t size) {
-	const size_t limit = 0x40000;
-
-	std::vector<uint8_t> buffer(std::max(size, limit));
+std::vector<uint8_t> ITwibFileAccessor::ReadLocked(uint64_t offset, size_t size) {
+	std::vector<uint8_t> buffer(size);
 	size_t actual_size;
 
 	ResultCode::AssertOk(ifile_read(ifile, &actual_size, buffer.data(), buffer.size(), 0, offset, buffer.size()));
 	buffer.resize(actual_size);
+	return buffer;
+}
+
+void ITwibFileAccessor::Read(bridge::ResponseOpener opener, uint64_t offset, uint64_t size) {
+	const size_t limit = 0x40000;
+	size = std::min<uint64_t>(size, limit);
+
+	// small reads are quicker to just do than to hand off, as long as a
+	// worker isn't in the middle of using the file
+	if(size <= 0x4000) {
+		util::MutexShim shim(ifile_mutex);
+		std::unique_lock<util::MutexShim> lock(shim, std::try_to_lock);
+		if(lock.owns_lock()) {
+			opener.RespondOk(ReadLocked(offset, size));
+			return;
+		}
+	}
 	
-	opener.RespondOk(std::move(buffer));
+	workers.Run(opener, shared_from_this(), [this, offset, size]() -> WorkerPool::Completion {
+		std::vector<uint8_t> buffer;
+		{
+			util::MutexShim shim(ifile_mutex);
+			std::unique_lock<util::MutexShim> lock(shim);
+			buffer = ReadLocked(offset, size);
+		}
+
+		return [buffer = std::move(buffer)](bridge::ResponseOpener &opener) mutable {
+			opener.RespondOk(std::move(buffer));
+		};
+	});
+}
+
+void ITwibFileAccessor::ReadStream(bridge::ResponseOpener opener, uint64_t offset, uint64_t size) {
+	size_t file_size;
+	{
+		util::MutexShim shim(ifile_mutex);
+		std::unique_lock<util::MutexShim> lock(shim);
+		ResultCode::AssertOk(ifile_get_size(ifile, &file_size));
+	}
+	if(offset > file_size) {
+		size = 0;
+	} else if(size > file_size - offset) {
+		size = file_size - offset;
+	}
+
+	workers.RunStream(opener, shared_from_this(), [this, offset, size](WorkerPool::StreamWriter &w) {
+		w.Begin(sizeof(uint64_t) + size + sizeof(uint32_t));
+		w.Write<uint64_t>(size);
+
+		std::vector<uint8_t> buffer(std::min<uint64_t>(size, 0x40000));
+		uint32_t result = 0;
+		for(uint64_t done = 0; done < size; ) {
+			size_t chunk_size = std::min<uint64_t>(buffer.size(), size - done);
+			size_t actual_size = 0;
+			if(result == 0) {
+				util::MutexShim shim(ifile_mutex);
+				std::unique_lock<util::MutexShim> lock(shim);
+				result = ifile_read(ifile, &actual_size, buffer.data(), chunk_size, 0, offset + done, chunk_size);
+				if(result == 0 && actual_size < chunk_size) {
+					result = TWILI_ERR_EOF; // file shrank under us
+				}
+			}
+			// the size is already promised, so pad out the rest after an error
+			std::fill(buffer.begin() + actual_size, buffer.begin() + chunk_size, 0);
+			w.Write(buffer.data(), chunk_size);
+			done+= chunk_size;
+		}
+		w.Write<uint32_t>(result);
+	});
 }
 
 void ITwibFileAccessor::Write(bridge::ResponseOpener opener, uint64_t offset, InputStream &stream) {
@@ -57,6 +126,8 @@ void ITwibFileAccessor::Write(bridge::ResponseOpener opener, uint64_t offset, In
 	stream.receive =
 		[this, offset_shared](util::Buffer &buffer) {
 			size_t a = buffer.ReadAvailable();
+			util::MutexShim shim(ifile_mutex);
+			std::unique_lock<util::MutexShim> lock(shim);
 			ResultCode::AssertOk(ifile_write(ifile, 0, *offset_shared, a, buffer.Read(), a));
 			*offset_shared+= a;
 		};
@@ -70,20 +141,78 @@ void ITwibFileAccessor::Write(bridge::ResponseOpener opener, uint64_t offset, In
 }
 
 void ITwibFileAccessor::Flush(bridge::ResponseOpener opener) {
-	ResultCode::AssertOk(ifile_flush(ifile));
+	{
+		util::MutexShim shim(ifile_mutex);
+		std::unique_lock<util::MutexShim> lock(shim);
+		ResultCode::AssertOk(ifile_flush(ifile));
+	}
 	opener.RespondOk();
 }
 
 void ITwibFileAccessor::SetSize(bridge::ResponseOpener opener, size_t size) {
-	ResultCode::AssertOk(ifile_set_size(ifile, size));
+	{
+		util::MutexShim shim(ifile_mutex);
+		std::unique_lock<util::MutexShim> lock(shim);
+		ResultCode::AssertOk(ifile_set_size(ifile, size));
+	}
 	opener.RespondOk();
 }
 
 void ITwibFileAccessor::GetSize(bridge::ResponseOpener opener) {
 	size_t size;
-	ResultCode::AssertOk(ifile_get_size(ifile, &size));
+	{
+		util::MutexShim shim(ifile_mutex);
+		std::unique_lock<util::MutexShim> lock(shim);
+		ResultCode::AssertOk(ifile_get_size(ifile, &size));
+	}
 	opener.RespondOk(std::move(size));
 }
 
+void ITwibFileAccessor::Hash(bridge::ResponseOpener opener, uint32_t algorithm, uint64_t offset, uint64_t size, uint64_t block_size) {
+	if(algorithm > (uint32_t) util::HashAlgorithm::Sha256) {
+		throw ResultError(TWILI_ERR_PROTOCOL_BAD_REQUEST);
+	}
+	
+	size_t file_size;
+	{
+		util::MutexShim shim(ifile_mutex);
+		std::unique_lock<util::MutexShim> lock(shim);
+		ResultCode::AssertOk(ifile_get_size(ifile, &file_size));
+	}
+	if(offset > file_size) {
+		size = 0;
+	} else if(size > file_size - offset) {
+		size = file_size - offset;
+	}
+
+	// don't let tiny blocks run us out of memory for digests
+	if(block_size != 0 && (block_size < 0x1000 || size / block_size >= 0x10000)) {
+		throw ResultError(TWILI_ERR_PROTOCOL_BAD_REQUEST);
+	}
+
+	workers.Run(opener, shared_from_this(), [this, algorithm, offset, size, block_size]() -> WorkerPool::Completion {
+		util::BlockHasher hasher((util::HashAlgorithm) algorithm, block_size);
+		std::vector<uint8_t> buffer(std::min<uint64_t>(size, 0x40000));
+		for(uint64_t done = 0; done < size; ) {
+			size_t chunk_size = std::min<uint64_t>(buffer.size(), size - done);
+			size_t actual_size;
+			{
+				util::MutexShim shim(ifile_mutex);
+				std::unique_lock<util::MutexShim> lock(shim);
+				ResultCode::AssertOk(ifile_read(ifile, &actual_size, buffer.data(), chunk_size, 0, offset + done, chunk_size));
+			}
+			if(actual_size == 0) {
+				throw ResultError(TWILI_ERR_EOF); // file shrank under us
+			}
+			hasher.Update(buffer.data(), actual_size);
+			done+= actual_size;
+		}
+
+		return [digests = hasher.Finish()](bridge::ResponseOpener &opener) mutable {
+			opener.RespondOk(std::move(digests));
+		};
+	});
+}
+
 } // namespace bridge
 } // namespace twili
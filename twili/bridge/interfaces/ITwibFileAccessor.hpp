@@ -25,25 +25,38 @@
 #include "../RequestHandler.hpp"
 
 #include<libtransistor/ipc/fs/ifile.h>
+#include<libtransistor/mutex.h>
+
+#include<memory>
+#include<vector>
+
+#include "../../WorkerPool.hpp"
 
 namespace twili {
 namespace bridge {
 
-class ITwibFileAccessor : public ObjectDispatcherProxy<ITwibFileAccessor> {
+class ITwibFileAccessor : public ObjectDispatcherProxy<ITwibFileAccessor>, public std::enable_shared_from_this<ITwibFileAccessor> {
  public:
-	ITwibFileAccessor(uint32_t object_id, ifile_t ifile);
+	ITwibFileAccessor(uint32_t object_id, ifile_t ifile, WorkerPool &workers);
 	~ITwibFileAccessor();
 	
 	using CommandID = protocol::ITwibFileAccessor::Command;
 	
  private:
 	ifile_t ifile;
+	// workers and the main loop take turns with ifile, one call at a time
+	trn_mutex_t ifile_mutex = TRN_MUTEX_STATIC_INITIALIZER;
+	WorkerPool &workers;
+
+	std::vector<uint8_t> ReadLocked(uint64_t offset, size_t size); // with ifile_mutex held
 
 	void Read(bridge::ResponseOpener opener, uint64_t offset, uint64_t size);
+	void ReadStream(bridge::ResponseOpener opener, uint64_t offset, uint64_t size);
 	void Write(bridge::ResponseOpener opener, uint64_t offset, InputStream &stream);
 	void Flush(bridge::ResponseOpener opener);
 	void SetSize(bridge::ResponseOpener opener, uint64_t size);
 	void GetSize(bridge::ResponseOpener opener);
+	void Hash(bridge::ResponseOpener opener, uint32_t algorithm, uint64_t offset, uint64_t size, uint64_t block_size);
 
  public:
 	SmartRequestDispatcher<
@@ -52,7 +65,9 @@ class ITwibFileAccessor : public ObjectDispatcherProxy<ITwibFileAccessor> {
 		SmartCommand<CommandID::WRITE, &ITwibFileAccessor::Write>,
 		SmartCommand<CommandID::FLUSH, &ITwibFileAccessor::Flush>,
 		SmartCommand<CommandID::SET_SIZE, &ITwibFileAccessor::SetSize>,
-		SmartCommand<CommandID::GET_SIZE, &ITwibFileAccessor::GetSize>
+		SmartCommand<CommandID::GET_SIZE, &ITwibFileAccessor::GetSize>,
+		SmartCommand<CommandID::READ_STREAM, &ITwibFileAccessor::ReadStream>,
+		SmartCommand<CommandID::HASH, &ITwibFileAccessor::Hash>
 	 > dispatcher;
 };
 
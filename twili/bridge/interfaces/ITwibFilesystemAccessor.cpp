@@ -23,6 +23,7 @@
 #include<libtransistor/cpp/svc.hpp>
 
 #include "err.hpp"
+#include "util.hpp"
 
 #include "ITwibFileAccessor.hpp"
 #include "ITwibDirectoryAccessor.hpp"
@@ -34,7 +35,7 @@ using namespace trn;
 namespace twili {
 namespace bridge {
 
-ITwibFilesystemAccessor::ITwibFilesystemAccessor(uint32_t object_id, ifilesystem_t ifs) : ObjectDispatcherProxy(*this, object_id), ifs(ifs), dispatcher(*this) {
+ITwibFilesystemAccessor::ITwibFilesystemAccessor(uint32_t object_id, ifilesystem_t ifs, WorkerPool &workers) : ObjectDispatcherProxy(*this, object_id), ifs(ifs), workers(workers), dispatcher(*this) {
 	
 }
 
@@ -112,7 +113,7 @@ void ITwibFilesystemAccessor::OpenFile(bridge::ResponseOpener opener, uint32_t m
 	ifile_t ifile;
 	ResultCode::AssertOk(ifilesystem_open_file(ifs, &ifile, mode, path_buffer));
 	
-	opener.RespondOk(opener.MakeObject<ITwibFileAccessor>(ifile));
+	opener.RespondOk(opener.MakeObject<ITwibFileAccessor>(ifile, workers));
 }
 
 void ITwibFilesystemAccessor::OpenDirectory(bridge::ResponseOpener opener, std::string path) {
@@ -125,5 +126,76 @@ void ITwibFilesystemAccessor::OpenDirectory(bridge::ResponseOpener opener, std::
 	opener.RespondOk(opener.MakeObject<ITwibDirectoryAccessor>(idir));
 }
 
+void ITwibFilesystemAccessor::WalkDirectory(bridge::ResponseOpener opener, std::string path, uint32_t max_depth, std::string pattern) {
+	// this can take a while on big trees, so don't hold up the main loop
+	workers.Run(opener, shared_from_this(), [this, path, max_depth, pattern]() -> WorkerPool::Completion {
+		// keep the response from eating all our memory on huge trees
+		const size_t limit = 0x400000;
+		
+		std::string root = path;
+		while(!root.empty() && root.back() == '/') {
+			root.pop_back();
+		}
+
+		std::vector<uint8_t> packed;
+		bool truncated = false;
+		std::vector<idirectoryentry_t> buffer(32);
+		
+		// directories still to walk, relative to the root, and the depth of the
+		// entries inside them
+		std::vector<std::pair<std::string, uint32_t>> pending;
+		pending.push_back({"", 1});
+		while(!pending.empty() && !truncated) {
+			std::string relative = pending.back().first;
+			uint32_t depth = pending.back().second;
+			pending.pop_back();
+			
+			char path_buffer[0x301];
+			std::strncpy(path_buffer, relative.empty() ? path.c_str() : (root + "/" + relative).c_str(), sizeof(path_buffer));
+
+			idirectory_t idir;
+			result_t r = ifilesystem_open_directory(ifs, &idir, 3, path_buffer);
+			if(r != RESULT_OK) {
+				if(relative.empty()) {
+					throw ResultError(r);
+				}
+				continue; // skip subdirectories we can't open
+			}
+
+			uint64_t actual_count;
+			while(!truncated &&
+						idirectory_read(idir, &actual_count, buffer.data(), buffer.size() * sizeof(idirectoryentry_t)) == RESULT_OK &&
+						actual_count > 0) {
+				for(size_t i = 0; i < actual_count; i++) {
+					idirectoryentry_t &e = buffer[i];
+					std::string name(e.path, strnlen(e.path, sizeof(e.path)));
+					std::string entry_path = relative.empty() ? name : relative + "/" + name;
+					if(e.entry_type == 0 && (max_depth == 0 || depth < max_depth)) {
+						pending.push_back({entry_path, depth + 1});
+					}
+					if(!util::GlobMatch(pattern.c_str(), name.c_str())) {
+						continue;
+					}
+					if(packed.size() + sizeof(protocol::ITwibFilesystemAccessor::WalkEntry) + entry_path.size() > limit) {
+						truncated = true;
+						break;
+					}
+					protocol::ITwibFilesystemAccessor::WalkEntry we;
+					we.file_size = e.entry_type == 0 ? 0 : e.file_size;
+					we.entry_type = e.entry_type;
+					we.path_size = entry_path.size();
+					packed.insert(packed.end(), (uint8_t*) &we, (uint8_t*) (&we + 1));
+					packed.insert(packed.end(), entry_path.begin(), entry_path.end());
+				}
+			}
+			ipc_close(idir);
+		}
+		
+		return [packed = std::move(packed), truncated](bridge::ResponseOpener &opener) mutable {
+			opener.RespondOk(std::move(packed), (uint8_t) truncated);
+		};
+	});
+}
+
 } // namespace bridge
 } // namespace twili
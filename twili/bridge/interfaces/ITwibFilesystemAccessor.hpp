@@ -26,18 +26,23 @@
 
 #include<libtransistor/ipc/fs/ifilesystem.h>
 
+#include<memory>
+
+#include "../../WorkerPool.hpp"
+
 namespace twili {
 namespace bridge {
 
-class ITwibFilesystemAccessor : public ObjectDispatcherProxy<ITwibFilesystemAccessor> {
+class ITwibFilesystemAccessor : public ObjectDispatcherProxy<ITwibFilesystemAccessor>, public std::enable_shared_from_this<ITwibFilesystemAccessor> {
  public:
-	ITwibFilesystemAccessor(uint32_t object_id, ifilesystem_t ifs);
+	ITwibFilesystemAccessor(uint32_t object_id, ifilesystem_t ifs, WorkerPool &workers);
 	~ITwibFilesystemAccessor();
 	
 	using CommandID = protocol::ITwibFilesystemAccessor::Command;
 	
  private:
 	ifilesystem_t ifs;
+	WorkerPool &workers;
 
 	void CreateFile(bridge::ResponseOpener opener, uint32_t mode, uint64_t size, std::string path);
 	void DeleteFile(bridge::ResponseOpener opener, std::string path);
@@ -49,6 +54,7 @@ class ITwibFilesystemAccessor : public ObjectDispatcherProxy<ITwibFilesystemAcce
 	void GetEntryType(bridge::ResponseOpener opener, std::string path);
 	void OpenFile(bridge::ResponseOpener opener, uint32_t mode, std::string path);
 	void OpenDirectory(bridge::ResponseOpener opener, std::string path);
+	void WalkDirectory(bridge::ResponseOpener opener, std::string path, uint32_t max_depth, std::string pattern);
 
  public:
 	SmartRequestDispatcher<
@@ -62,7 +68,8 @@ class ITwibFilesystemAccessor : public ObjectDispatcherProxy<ITwibFilesystemAcce
 		SmartCommand<CommandID::RENAME_DIRECTORY, &ITwibFilesystemAccessor::RenameDirectory>,
 		SmartCommand<CommandID::GET_ENTRY_TYPE, &ITwibFilesystemAccessor::GetEntryType>,
 		SmartCommand<CommandID::OPEN_FILE, &ITwibFilesystemAccessor::OpenFile>,
-		SmartCommand<CommandID::OPEN_DIRECTORY, &ITwibFilesystemAccessor::OpenDirectory>
+		SmartCommand<CommandID::OPEN_DIRECTORY, &ITwibFilesystemAccessor::OpenDirectory>,
+		SmartCommand<CommandID::WALK_DIRECTORY, &ITwibFilesystemAccessor::WalkDirectory>
 	 > dispatcher;
 };
 
@@ -0,0 +1,114 @@
+//
+// Twili - Homebrew debug monitor for the Nintendo Switch
+// Copyright (C) 2019 misson20000 <xenotoad@xenotoad.net>
+//
+// This file is part of Twili.
+//
+// Twili is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Twili is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Twili.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "ITwibMemoryWatch.hpp"
+
+#include<libtransistor/cpp/svc.hpp>
+
+#include<string.h>
+
+#include "err.hpp"
+#include "ITwibDebugger.hpp"
+#include "../../twili.hpp"
+
+using trn::ResultCode;
+using trn::ResultError;
+
+namespace twili {
+namespace bridge {
+
+ITwibMemoryWatch::ITwibMemoryWatch(uint32_t object_id, Twili &twili, std::shared_ptr<ITwibDebugger> debugger, std::vector<protocol::ITwibMemoryWatch::Range> ranges, uint64_t interval_ticks) :
+	ObjectDispatcherProxy(*this, object_id),
+	twili(twili),
+	debugger(debugger),
+	ranges(ranges),
+	last_contents(ranges.size()),
+	interval_ticks(interval_ticks),
+	dispatcher(*this) {
+	Sample(); // report initial contents right away
+	deadline = twili.event_waiter.AddDeadline(
+		svcGetSystemTick() + interval_ticks,
+		[this]() -> uint64_t {
+			Sample();
+			return svcGetSystemTick() + this->interval_ticks;
+		});
+}
+
+ITwibMemoryWatch::~ITwibMemoryWatch() {
+	deadline.reset();
+}
+
+void ITwibMemoryWatch::Sample() {
+	uint64_t timestamp = svcGetSystemTick();
+	for(size_t i = 0; i < ranges.size(); i++) {
+		std::vector<uint8_t> contents(ranges[i].size);
+		if(!trn::svc::ReadDebugProcessMemory(contents.data(), debugger->debug, ranges[i].address, contents.size())) {
+			continue; // probably unmapped for now; try again next time
+		}
+		if(last_contents[i] && *last_contents[i] == contents) {
+			continue;
+		}
+		last_contents[i] = contents;
+
+		queued_bytes+= contents.size();
+		queue.push_back(QueuedChange {{timestamp, ranges[i].address, contents.size()}, std::move(contents)});
+	}
+
+	// don't let a client that stopped reading eat all our memory
+	while(queued_bytes > MaxQueuedBytes && queue.size() > 1) {
+		queued_bytes-= queue.front().data.size();
+		queue.pop_front();
+		dropped++;
+	}
+
+	Flush();
+}
+
+void ITwibMemoryWatch::Flush() {
+	if(!pending_read || queue.empty()) {
+		return;
+	}
+
+	std::vector<protocol::ITwibMemoryWatch::Change> changes;
+	std::vector<uint8_t> data;
+	data.reserve(queued_bytes);
+	for(QueuedChange &c : queue) {
+		changes.push_back(c.change);
+		data.insert(data.end(), c.data.begin(), c.data.end());
+	}
+	
+	pending_read->RespondOk(std::move(changes), std::move(data), (uint64_t) dropped);
+	pending_read.reset();
+	queue.clear();
+	queued_bytes = 0;
+	dropped = 0;
+}
+
+void ITwibMemoryWatch::Read(bridge::ResponseOpener opener) {
+	if(pending_read) {
+		throw ResultError(TWILI_ERR_ALREADY_WAITING);
+	}
+	// held until there is something to report
+	pending_read.emplace(opener);
+	Flush();
+}
+
+} // namespace bridge
+} // namespace twili
@@ -0,0 +1,87 @@
+//
+// Twili - Homebrew debug monitor for the Nintendo Switch
+// Copyright (C) 2019 misson20000 <xenotoad@xenotoad.net>
+//
+// This file is part of Twili.
+//
+// Twili is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Twili is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Twili.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#pragma once
+
+#include<deque>
+#include<memory>
+#include<optional>
+#include<vector>
+
+#include<libtransistor/cpp/waiter.hpp>
+
+#include "../Object.hpp"
+#include "../ResponseOpener.hpp"
+#include "../RequestHandler.hpp"
+
+namespace twili {
+
+class Twili;
+
+namespace bridge {
+
+class ITwibDebugger;
+
+// Samples a set of address ranges in a debugged process on a timer, and
+// reports the ranges whose contents changed.
+class ITwibMemoryWatch : public ObjectDispatcherProxy<ITwibMemoryWatch> {
+ public:
+	ITwibMemoryWatch(uint32_t object_id, Twili &twili, std::shared_ptr<ITwibDebugger> debugger, std::vector<protocol::ITwibMemoryWatch::Range> ranges, uint64_t interval_ticks);
+	~ITwibMemoryWatch();
+
+	using CommandID = protocol::ITwibMemoryWatch::Command;
+
+	// system ticks run at 19.2 MHz
+	static const uint64_t TicksPerSecond = 19200000;
+	// oldest changes are dropped beyond this much unread data
+	static const size_t MaxQueuedBytes = 0x100000;
+	
+ private:
+	struct QueuedChange {
+		protocol::ITwibMemoryWatch::Change change;
+		std::vector<uint8_t> data;
+	};
+	
+	Twili &twili;
+	std::shared_ptr<ITwibDebugger> debugger;
+	std::vector<protocol::ITwibMemoryWatch::Range> ranges;
+	std::vector<std::optional<std::vector<uint8_t>>> last_contents;
+	uint64_t interval_ticks;
+	std::shared_ptr<trn::WaitHandle> deadline;
+	
+	std::deque<QueuedChange> queue;
+	size_t queued_bytes = 0;
+	uint64_t dropped = 0;
+	std::optional<bridge::ResponseOpener> pending_read;
+	
+	void Sample();
+	void Flush();
+	
+	void Read(bridge::ResponseOpener opener);
+
+ public:
+	SmartRequestDispatcher<
+		ITwibMemoryWatch,
+		SmartCommand<CommandID::READ, &ITwibMemoryWatch::Read>
+		> dispatcher;
+};
+
+} // namespace bridge
+} // namespace twili
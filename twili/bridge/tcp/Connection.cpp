@@ -35,8 +35,10 @@ namespace tcp {
 
 TCPBridge::Connection::Connection(TCPBridge &bridge, util::Socket &&socket) :
 	bridge(bridge),
-	socket(std::move(socket)) {
-	objects.insert(std::pair<uint32_t, std::shared_ptr<bridge::Object>>(0, bridge.object_zero));
+	socket(std::move(socket)),
+	session(std::make_shared<Session>()) {
+	session->token = bridge.next_session_token++;
+	session->objects.insert(std::pair<uint32_t, std::shared_ptr<bridge::Object>>(0, bridge.object_zero));
 }
 
 void TCPBridge::Connection::PumpInput() {
@@ -51,18 +53,26 @@ void TCPBridge::Connection::PumpInput() {
 }
 
 void TCPBridge::Connection::Process() {
-	while(!deletion_flag && in_buffer.ReadAvailable() > 0) {
+	while(!deletion_flag) {
 		if(!has_current_mh) {
 			if(in_buffer.Read(current_mh)) {
 				has_current_mh = true;
+				has_begun_command = false;
 				payload_size = 0;
 				payload_buffer.Clear();
 				has_current_payload = false;
-				
-				// pick command handler
-				Synchronize(Task::BeginProcessingCommand);
 			} else {
 				in_buffer.Reserve(sizeof(protocol::MessageHeader));
+				return;
+			}
+		}
+
+		if(!has_begun_command) {
+			// pick command handler
+			Synchronize(Task::BeginProcessingCommand);
+			if(!has_begun_command) {
+				// object is busy; the socket thread will retry us
+				return;
 			}
 		}
 
@@ -139,11 +149,51 @@ void TCPBridge::Connection::Synchronized() {
 	pending_task = Task::Idle;
 }
 
+bool TCPBridge::Connection::IsWaitingForObject() {
+	return has_current_mh && !has_begun_command;
+}
+
+void TCPBridge::Connection::ReleaseBusyObject() {
+	if(busy_session) {
+		busy_session->busy_objects.erase(busy_object_id);
+		busy_session.reset();
+	}
+}
+
+bool TCPBridge::Connection::JoinSession(uint64_t token) {
+	if(session->token == token) {
+		return true;
+	}
+	
+	std::shared_ptr<Session> target;
+	size_t member_count = 0;
+	for(auto &c : bridge.connections) {
+		if(c->session->token == token) {
+			target = c->session;
+			member_count++;
+		}
+	}
+	if(!target || member_count >= MaxSessionConnections) {
+		return false;
+	}
+
+	// any objects that we opened on our old session are dropped with it
+	session = target;
+	return true;
+}
+
 void TCPBridge::Connection::BeginProcessingCommandImpl() {
+	if(session->busy_objects.find(current_mh.object_id) != session->busy_objects.end()) {
+		// Another connection in our session is partway through a command on
+		// this object. Objects only handle one command at a time, so wait.
+		return;
+	}
+	has_begun_command = true;
+	
 	current_state = std::make_shared<Connection::ResponseState>(shared_from_this(), current_mh.client_id, current_mh.tag);
 	ResponseOpener opener(current_state);
-	auto i = objects.find(current_mh.object_id);
-	if(i == objects.end()) {
+	auto i = session->objects.find(current_mh.object_id);
+	if(i == session->objects.end()) {
 		opener.BeginError(TWILI_ERR_PROTOCOL_UNRECOGNIZED_OBJECT).Finalize();
 		return;
 	}
@@ -155,12 +205,16 @@ void TCPBridge::Connection::BeginProcessingCommandImpl() {
 			// for USBBridge, this is intended to cleanup objects left by another
 			// twibd. we get to use TCP connections instead.
 		} else {
-			objects.erase(current_mh.object_id);
+			session->objects.erase(current_mh.object_id);
 		}
 		opener.RespondOk();
 		return;
 	}
 
+	session->busy_objects.insert(current_mh.object_id);
+	busy_session = session;
+	busy_object_id = current_mh.object_id;
+
 	try {
 		current_object = i->second;
 		current_handler = current_object->OpenRequest(current_mh.command_id, current_mh.payload_size, opener);
@@ -178,6 +232,7 @@ void TCPBridge::Connection::CleanupCommand() {
 		current_object->FinalizeCommand();
 		current_object.reset();
 	}
+	ReleaseBusyObject();
 	ResetHandler();
 }
 
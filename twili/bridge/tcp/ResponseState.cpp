@@ -70,11 +70,27 @@ void TCPBridge::Connection::ResponseState::Finalize() {
 }
 
 uint32_t TCPBridge::Connection::ResponseState::ReserveObjectId() {
-	return connection->next_object_id++;
+	return connection->session->next_object_id++;
 }
 
 void TCPBridge::Connection::ResponseState::InsertObject(std::pair<uint32_t, std::shared_ptr<Object>> &&pair) {
-	connection->objects.insert(pair);
+	connection->session->objects.insert(pair);
+}
+
+void TCPBridge::Connection::ResponseState::CloseObject(uint32_t object_id) {
+	connection->session->objects.erase(object_id);
+}
+
+uint64_t TCPBridge::Connection::ResponseState::GetSessionToken() {
+	return connection->session->token;
+}
+
+bool TCPBridge::Connection::ResponseState::JoinSession(uint64_t token) {
+	return connection->JoinSession(token);
+}
+
+detail::ResponseLink &TCPBridge::Connection::ResponseState::GetLink() {
+	return connection->response_link;
 }
 
 void TCPBridge::Connection::ResponseState::Send(uint8_t *data, size_t size) {
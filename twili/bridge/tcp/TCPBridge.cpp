@@ -125,11 +125,17 @@ void TCPBridge::SocketThread() {
 		std::vector<pollfd> fds;
 		fds.push_back({server_socket.fd, POLLIN}); // server socket
 
+		// connections waiting on an object that another connection in their
+		// session is busy with need to be retried without new input
+		int timeout = -1;
 		for(auto &c : connections) {
 			fds.push_back({c->socket.fd, POLLIN});
+			if(c->IsWaitingForObject()) {
+				timeout = 5;
+			}
 		}
 
-		if(bsd_poll(fds.data(), fds.size(), -1) < 0) {
+		if(bsd_poll(fds.data(), fds.size(), timeout) < 0) {
 			printf("poll failure\n");
 			thread_destroy = 1;
 			return;
@@ -175,7 +181,7 @@ void TCPBridge::SocketThread() {
 		for(auto ci = connections.begin(); ci != connections.end(); fdi++) {
 			if(fds[fdi].revents & (POLLERR | POLLHUP | POLLNVAL)) {
 				(*ci)->deletion_flag = true;
-				ci = connections.erase(ci);
+				ci = EraseConnection(ci);
 				continue;
 			}
 			if(fds[fdi].revents & POLLIN) {
@@ -193,7 +199,7 @@ void TCPBridge::SocketThread() {
 			}
 			
 			if((*i)->deletion_flag) {
-				i = connections.erase(i);
+				i = EraseConnection(i);
 				continue;
 			}
 			
@@ -203,6 +209,17 @@ void TCPBridge::SocketThread() {
 	printf("socket thread exiting\n");
 }
 
+std::list<std::shared_ptr<TCPBridge::Connection>>::iterator TCPBridge::EraseConnection(std::list<std::shared_ptr<Connection>>::iterator i) {
+	{ // scope for lock
+		// let other connections in the session use whatever object this one was
+		// partway through a command on
+		util::MutexShim shim(request_processing_mutex);
+		std::unique_lock<util::MutexShim> lock(shim);
+		(*i)->ReleaseBusyObject();
+	}
+	return connections.erase(i);
+}
+
 void TCPBridge::ResetSockets() {
 	// recreate server socket
 	server_socket = {bsd_socket(AF_INET, SOCK_STREAM, 0)};
@@ -26,7 +26,9 @@
 #include<libtransistor/mutex.h>
 
 #include<list>
+#include<map>
 #include<memory>
+#include<set>
 
 #include "../../../common/Protocol.hpp"
 #include "../../../common/Buffer.hpp"
@@ -49,6 +51,18 @@ namespace tcp {
 class TCPBridge {
  public:
 	class Connection;
+
+	// Connections in the same session share objects, so that twibd can spread
+	// requests to one device over several connections.
+	struct Session {
+		uint64_t token;
+		uint32_t next_object_id = 1;
+		std::map<uint32_t, std::shared_ptr<bridge::Object>> objects;
+		// objects that a connection is partway through a command on
+		std::set<uint32_t> busy_objects;
+	};
+
+	static const size_t MaxSessionConnections = 8;
 	
 	TCPBridge(Twili &twili, std::shared_ptr<bridge::Object> object_zero);
 	~TCPBridge();
@@ -63,6 +77,9 @@ class TCPBridge {
 	util::Socket server_socket;
 	std::list<std::shared_ptr<Connection>> connections;
 	std::shared_ptr<bridge::Object> object_zero;
+	uint64_t next_session_token = 1;
+
+	std::list<std::shared_ptr<Connection>>::iterator EraseConnection(std::list<std::shared_ptr<Connection>>::iterator i);
 	
 	service::nifm::IRequest network;
 	
@@ -95,6 +112,12 @@ class TCPBridge::Connection : public std::enable_shared_from_this<TCPBridge::Con
 
 	// called when command processing has ended and further input should be discarded
 	void ResetHandler();
+
+	// true if we have a command waiting on an object that another
+	// connection in our session is busy with
+	bool IsWaitingForObject();
+	void ReleaseBusyObject();
+	bool JoinSession(uint64_t token); // should run on main thread
 	
 	bool deletion_flag = false;
 
@@ -128,6 +151,7 @@ class TCPBridge::Connection : public std::enable_shared_from_this<TCPBridge::Con
 	util::Buffer in_buffer;
 
 	bool has_current_mh = false;
+	bool has_begun_command = false;
 	bool has_current_payload = false;
 	protocol::MessageHeader current_mh;
 	size_t payload_size;
@@ -138,8 +162,11 @@ class TCPBridge::Connection : public std::enable_shared_from_this<TCPBridge::Con
 	std::shared_ptr<Object> current_object;
 	RequestHandler *current_handler = DiscardingRequestHandler::GetInstance();
 	
-	uint32_t next_object_id = 1;
-	std::map<uint32_t, std::shared_ptr<bridge::Object>> objects;
+	std::shared_ptr<Session> session;
+	std::shared_ptr<Session> busy_session;
+	uint32_t busy_object_id;
+
+	detail::ResponseLink response_link;
 };
 
 class TCPBridge::Connection::ResponseState : public bridge::detail::ResponseState {
@@ -152,6 +179,10 @@ class TCPBridge::Connection::ResponseState : public bridge::detail::ResponseStat
 	virtual void Finalize() override;
 	virtual uint32_t ReserveObjectId() override;
 	virtual void InsertObject(std::pair<uint32_t, std::shared_ptr<Object>> &&pair) override;
+	virtual void CloseObject(uint32_t object_id) override;
+	virtual uint64_t GetSessionToken() override;
+	virtual bool JoinSession(uint64_t token) override;
+	virtual detail::ResponseLink &GetLink() override;
 	
  private:
 	void Send(uint8_t *data, size_t size);
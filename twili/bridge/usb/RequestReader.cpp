@@ -292,6 +292,12 @@ void USBBridge::RequestReader::ResetHandler() {
 	current_handler = DiscardingRequestHandler::GetInstance();
 }
 
+void USBBridge::RequestReader::ResponseBegun(detail::ResponseState *state) {
+	if(current_state.get() == state) {
+		ResetHandler();
+	}
+}
+
 } // namespace usb
 } // namespace bridge
 } // namespace twili
@@ -37,11 +37,11 @@ USBBridge::ResponseState::ResponseState(USBBridge &bridge, uint32_t client_id, u
 }
 
 size_t USBBridge::ResponseState::GetMaxTransferSize() {
-	return bridge.response_data_buffer.size;
+	return bridge.response_data_ring.GetBufferSize();
 }
 
 void USBBridge::ResponseState::SendHeader(protocol::MessageHeader &hdr) {
-	bridge.request_reader.ResetHandler();
+	bridge.request_reader.ResponseBegun(this);
 	
 	memcpy(
 		bridge.response_meta_buffer.data,
@@ -55,14 +55,13 @@ void USBBridge::ResponseState::SendHeader(protocol::MessageHeader &hdr) {
 }
 
 void USBBridge::ResponseState::SendData(uint8_t *data, size_t size) {
-	auto max_size = bridge.response_data_buffer.size;
+	auto max_size = bridge.response_data_ring.GetBufferSize();
 	while(size > max_size) {
 		SendData(data, max_size);
 		data+= max_size;
 		size-= max_size;
 	}
-	memcpy(bridge.response_data_buffer.data, data, size);
-	USBBridge::PostBufferSync(bridge.endpoint_response_data, bridge.response_data_buffer.data, size);
+	bridge.response_data_ring.Post(bridge.endpoint_response_data, data, size);
 	transferred_size+= size;
 }
 
@@ -76,12 +75,14 @@ void USBBridge::ResponseState::Finalize() {
 
 	if(object_count > 0) {
 		// send object IDs
-		uint32_t *out = (uint32_t*) bridge.response_data_buffer.data;
+		std::vector<uint32_t> ids;
 		for(auto p : objects) {
-			*(out++) = p->object_id;
+			ids.push_back(p->object_id);
 		}
-		USBBridge::PostBufferSync(bridge.endpoint_response_data, bridge.response_data_buffer.data, object_count * sizeof(uint32_t));
+		bridge.response_data_ring.Post(bridge.endpoint_response_data, (uint8_t*) ids.data(), ids.size() * sizeof(uint32_t));
 	}
+
+	bridge.response_data_ring.Flush(bridge.endpoint_response_data);
 }
 
 uint32_t USBBridge::ResponseState::ReserveObjectId() {
@@ -92,6 +93,14 @@ void USBBridge::ResponseState::InsertObject(std::pair<uint32_t, std::shared_ptr<
 	bridge.objects.insert(pair);
 }
 
+void USBBridge::ResponseState::CloseObject(uint32_t object_id) {
+	bridge.objects.erase(object_id);
+}
+
+detail::ResponseLink &USBBridge::ResponseState::GetLink() {
+	return bridge.response_link;
+}
+
 } // namespace usb
 } // namespace bridge
 } // namespace twili
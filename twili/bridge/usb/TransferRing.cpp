@@ -0,0 +1,72 @@
+//
+// Twili - Homebrew debug monitor for the Nintendo Switch
+// Copyright (C) 2019 misson20000 <xenotoad@xenotoad.net>
+//
+// This file is part of Twili.
+//
+// Twili is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Twili is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Twili.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include "USBBridge.hpp"
+
+#include<stdio.h>
+
+namespace twili {
+namespace bridge {
+namespace usb {
+
+using trn::ResultCode;
+
+uint32_t DSEndpointTraits::PostBufferAsync(Endpoint &endpoint, uint8_t *data, size_t size) {
+	return ResultCode::AssertOk(endpoint->PostBufferAsync(data, size));
+}
+
+bool DSEndpointTraits::WaitForTransfer(Endpoint &endpoint, uint32_t urb_id, size_t &transferred_size) {
+	while(true) {
+		usb_ds_report_t report = ResultCode::AssertOk(endpoint->GetReportData());
+		usb_ds_report_entry_t *entry = nullptr;
+		for(uint32_t i = 0; i < report.entry_count; i++) {
+			if(report.entries[i].urb_id == urb_id) {
+				entry = &report.entries[i];
+			}
+		}
+		
+		if(entry != nullptr && entry->urb_status == 3) { // completed
+			transferred_size = entry->transferred_size;
+			return true;
+		}
+		if(entry != nullptr && entry->urb_status > 3) { // failed or cancelled
+			return false;
+		}
+
+		trn::Result<std::nullopt_t> r(std::nullopt);
+		while(!(r = endpoint->completion_event.WaitSignal(30000000000))) {
+			// if we time out, just keep waiting since we can't really cancel the transfer
+			if(r.error().code != 0xea01) {
+				ResultCode::AssertOk(r.error().code);
+			}
+		}
+		ResultCode::AssertOk(endpoint->completion_event.ResetSignal());
+	}
+}
+
+void DSEndpointTraits::PostBufferSync(Endpoint &endpoint, uint8_t *data, size_t size) {
+	printf("[USBB] didn't send all bytes, posting again...\n");
+	USBBridge::PostBufferSync(endpoint, data, size);
+}
+
+} // namespace usb
+} // namespace bridge
+} // namespace twili
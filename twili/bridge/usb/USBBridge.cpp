@@ -73,6 +73,8 @@ using trn::ResultCode;
 using trn::ResultError;
 
 static const size_t TRANSFER_BUFFER_SIZE = 64 * 1024; // 64 KiB
+// the endpoint report only holds the last 8 URBs, so keep this below that
+static const size_t RESPONSE_BUFFER_COUNT = 4;
 
 USBBridge::USBBridge(Twili *twili, std::shared_ptr<bridge::Object> object_zero) :
 	twili(twili),
@@ -82,7 +84,7 @@ USBBridge::USBBridge(Twili *twili, std::shared_ptr<bridge::Object> object_zero)
 	request_meta_buffer(0x1000),
 	response_meta_buffer(0x1000),
 	request_data_buffer(TRANSFER_BUFFER_SIZE),
-	response_data_buffer(TRANSFER_BUFFER_SIZE) {
+	response_data_ring(RESPONSE_BUFFER_COUNT, TRANSFER_BUFFER_SIZE) {
 	
 	interface = ResultCode::AssertOk(
 		ds.GetInterface(interface_descriptor, "twili_bridge"));
@@ -154,6 +156,7 @@ bool USBBridge::USBStateChangeCallback() {
 
 void USBBridge::ResetInterface() {
 	interface->Disable();
+	response_data_ring.Reset();
 	interface->Enable();
 }
 
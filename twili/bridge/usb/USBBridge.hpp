@@ -27,8 +27,10 @@
 #include<type_traits>
 #include<map>
 #include<functional>
+#include<memory>
 
 #include "../../../common/Protocol.hpp"
+#include "../../../common/TransferRing.hpp"
 #include "../ResponseOpener.hpp"
 #include "../RequestHandler.hpp"
 
@@ -50,6 +52,19 @@ class USBBuffer {
 	size_t size;
 };
 
+// Lets util::TransferRing send on a usb:ds endpoint.
+struct DSEndpointTraits {
+	using Endpoint = std::shared_ptr<trn::service::usb::ds::Endpoint>;
+	using Buffer = USBBuffer;
+	using Error = trn::ResultError;
+
+	static uint32_t PostBufferAsync(Endpoint &endpoint, uint8_t *data, size_t size);
+	static bool WaitForTransfer(Endpoint &endpoint, uint32_t urb_id, size_t &transferred_size);
+	static void PostBufferSync(Endpoint &endpoint, uint8_t *data, size_t size);
+};
+
+using TransferRing = util::TransferRing<DSEndpointTraits>;
+
 class USBBridge {
  public:
 	class RequestReader {
@@ -67,6 +82,9 @@ class USBBridge {
 		// called when command processing has ended (normally or fatally)
 		// and any further input for this request should be discarded.
 		void ResetHandler();
+		// called when a response begins; only a response to the request
+		// being read ends it early
+		void ResponseBegun(detail::ResponseState *state);
 		
 	 private:
 		USBBridge *bridge;
@@ -118,10 +136,11 @@ class USBBridge {
 	std::map<uint32_t, std::shared_ptr<bridge::Object>> objects;
 	
 	RequestReader request_reader;
+	detail::ResponseLink response_link;
 	USBBuffer request_meta_buffer;
 	USBBuffer response_meta_buffer;
 	USBBuffer request_data_buffer;
-	USBBuffer response_data_buffer;
+	TransferRing response_data_ring;
 
 	trn::service::usb::ds::DS ds;
 	trn::KEvent usb_state_change_event;
@@ -139,6 +158,8 @@ class USBBridge::ResponseState : public bridge::detail::ResponseState {
 	virtual void Finalize() override;
 	virtual uint32_t ReserveObjectId() override;
 	virtual void InsertObject(std::pair<uint32_t, std::shared_ptr<Object>> &&pair) override;
+	virtual void CloseObject(uint32_t object_id) override;
+	virtual detail::ResponseLink &GetLink() override;
 
  private:
 	USBBridge &bridge;
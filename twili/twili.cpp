@@ -124,7 +124,8 @@ Twili::Twili(const Config &config) :
 			return new twili::service::ITwiliService(this);
 		}),
 	file_manager(*this),
-	applet_tracker(*this) {
+	applet_tracker(*this),
+	workers(*this) {
 	if(config.enable_usb_bridge) {
 		usb_bridge.emplace(this, std::make_shared<bridge::ITwibDeviceInterface>(0, *this));
 	}
@@ -37,6 +37,7 @@
 #include "ipcbind/nifm/IGeneralService.hpp"
 
 #include "FileManager.hpp"
+#include "WorkerPool.hpp"
 
 namespace twili {
 
@@ -102,6 +103,7 @@ class Twili {
 
 	FileManager file_manager;
 	AppletTracker applet_tracker;
+	WorkerPool workers;
 	
 	std::optional<bridge::usb::USBBridge> usb_bridge;
 	std::optional<bridge::tcp::TCPBridge> tcp_bridge;